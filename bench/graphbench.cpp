@@ -0,0 +1,1195 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphbench.cpp
+// Purpose:     Benchmarks for the graph editor
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file graphbench.cpp
+ * @brief Headless benchmarks for the graph editor.
+ *
+ * Times the main operations on synthetic project graphs of increasing size
+ * and writes the results as JSON or CSV so that runs can be compared, e.g.
+ * before and after a change:
+ *
+ * @code
+ *  make -f GNUmakefile bench BENCH_ARGS="--sizes=1000,10000 --output=a.json"
+ *  graphbench --bench=hittest,draw --repeat=20 --format=csv
+ * @endcode
+ *
+ * Each benchmark produces a list of samples, the time per operation in
+ * nanoseconds of each run or of each individual query, which are summarised
+ * as their mean and percentiles.
+ *
+ * The larger sizes of the slower benchmarks are skipped unless @c --all is
+ * given, see the table at the end of the file. The memory benchmark, and
+ * the pool figures of the teardown benchmark, give bytes or allocations per
+ * node instead of times.
+ *
+ * The replay benchmark times interaction: it replays a session of mouse,
+ * wheel and key events on a GraphCtrl and gives the time per event. The
+ * session is synthesised for each graph size, or recorded from a real one
+ * with GraphCtrl::StartRecording() and given with @c --trace, e.g.:
+ *
+ * @code
+ *  graphbench --bench=replay --sizes=1 --trace=session.trace
+ * @endcode
+ *
+ * The replay benchmark shows a window, the others create none, but on X11
+ * a display is needed in any case to initialise wxWidgets, so use @c
+ * xvfb-run on a headless machine.
+ */
+
+#include <wx/wxprec.h>
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include <wx/wx.h>
+#endif
+
+#include <wx/cmdline.h>
+#include <wx/mstream.h>
+#include <wx/wfstream.h>
+#include <wx/tokenzr.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "projectdesigner.h"
+#include "graphsearch.h"
+#include "graphalgo.h"
+#include "graphmemory.h"
+#include "graphtrace.h"
+#include <wx/ogl/ogl.h>
+
+using datactics::ProjectNode;
+
+using namespace tt_solutions;
+using namespace std;
+
+namespace {
+
+// ----------------------------------------------------------------------------
+// Synthetic project graphs
+// ----------------------------------------------------------------------------
+
+// Deterministic pseudo random numbers, so that every run benchmarks the same
+// graphs and queries.
+class Random
+{
+public:
+    Random(wxUint32 seed = 1) : m_state(seed) { }
+
+    wxUint32 Next()
+    {
+        m_state = m_state * 1664525 + 1013904223;
+        return m_state >> 8;
+    }
+
+    size_t Next(size_t n) { return n ? Next() % n : 0; }
+
+private:
+    wxUint32 m_state;
+};
+
+const wxChar *operations[] = {
+    _T("Import"), _T("Filter"), _T("Merge"), _T("Sort"),
+    _T("Deduplicate"), _T("Validate"), _T("Aggregate"), _T("Export")
+};
+
+const size_t numOperations = WXSIZEOF(operations);
+
+// Spacing of the grid the nodes are placed on.
+const int colSpacing = 160;
+const int rowSpacing = 100;
+
+// The number of nodes in each layer of a graph of n nodes.
+size_t LayerWidth(size_t n)
+{
+    return max(size_t(8), size_t(sqrt(double(n))));
+}
+
+// Add n project nodes to the graph, in layers placed on a grid.
+void AddNodes(Graph& graph, size_t n, vector<GraphNode*>& nodes)
+{
+    Random rnd;
+    size_t width = LayerWidth(n);
+
+    nodes.reserve(nodes.size() + n);
+
+    for (size_t i = 0; i < n; i++) {
+        wxString op = operations[rnd.Next(numOperations)];
+        ProjectNode *node = new ProjectNode(
+                wxString::Format(_T("%s %u"), op.c_str(), unsigned(i)),
+                wxString::Format(_T("Result %u"), unsigned(i)),
+                wxString::Format(_T("N%u"), unsigned(i)));
+
+        wxPoint pt(int(i % width) * colSpacing, int(i / width) * rowSpacing);
+        nodes.push_back(graph.Add(node, pt));
+    }
+}
+
+// Connect the layers like the flows of a project, each node taking its
+// inputs from one or two nodes of the layers above. Returns the number of
+// edges added.
+size_t AddEdges(Graph& graph, const vector<GraphNode*>& nodes)
+{
+    Random rnd(7);
+    size_t width = LayerWidth(nodes.size());
+    size_t count = 0;
+
+    for (size_t i = width; i < nodes.size(); i++) {
+        size_t layer = i / width;
+        size_t inputs = 1 + rnd.Next(2);
+
+        for (size_t j = 0; j < inputs; j++) {
+            size_t from = layer > 1 && rnd.Next(4) == 0 ? layer - 2 : layer - 1;
+            size_t src = from * width + rnd.Next(width);
+
+            if (!graph.IsConnected(*nodes[src], *nodes[i]) &&
+                    graph.Add(*nodes[src], *nodes[i]))
+                count++;
+        }
+    }
+
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+// Timing and results
+// ----------------------------------------------------------------------------
+
+typedef chrono::steady_clock Clock;
+
+class Timer
+{
+public:
+    Timer() : m_start(Clock::now()) { }
+
+    // nanoseconds since construction
+    double Elapsed() const
+    {
+        return chrono::duration<double, nano>(Clock::now() - m_start).count();
+    }
+
+private:
+    Clock::time_point m_start;
+};
+
+// Nanoseconds per operation.
+typedef vector<double> Samples;
+
+struct Result
+{
+    wxString name;
+    size_t nodes;
+    size_t edges;
+    size_t ops;         // operations per sample
+    const wxChar *unit;
+    Samples samples;
+};
+
+double Percentile(const Samples& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = size_t(ceil(p / 100 * sorted.size()));
+    return sorted[rank ? rank - 1 : 0];
+}
+
+struct Summary
+{
+    Summary(const Samples& samples)
+      : sorted(samples)
+    {
+        sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (size_t i = 0; i < sorted.size(); i++)
+            sum += sorted[i];
+        mean = sorted.empty() ? 0 : sum / sorted.size();
+    }
+
+    Samples sorted;
+    double mean;
+
+    double Min() const { return sorted.empty() ? 0 : sorted.front(); }
+    double Max() const { return sorted.empty() ? 0 : sorted.back(); }
+};
+
+// Always with a '.', whatever the locale, for the JSON and CSV output.
+wxString Number(double value)
+{
+    return wxString::FromCDouble(value, 1);
+}
+
+void WriteJSON(wxOutputStream& out, const vector<Result>& results, int repeat)
+{
+    wxString json;
+
+    json << _T("{\n")
+         << _T("  \"library\": \"") << wxVERSION_STRING << _T("\",\n")
+         << _T("  \"geometry\": \"")
+         << wxString::FromAscii(wxOGLGeometry::GetInstructionSet()) << _T("\",\n")
+         << _T("  \"repeat\": ") << repeat << _T(",\n")
+         << _T("  \"results\": [");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        Summary s(r.samples);
+
+        json << (i ? _T(",") : _T("")) << _T("\n    {")
+             << _T(" \"name\": \"") << r.name << _T("\",")
+             << _T(" \"nodes\": ") << r.nodes << _T(",")
+             << _T(" \"edges\": ") << r.edges << _T(",")
+             << _T(" \"ops\": ") << r.ops << _T(",")
+             << _T(" \"unit\": \"") << r.unit << _T("\",")
+             << _T(" \"samples\": ") << r.samples.size() << _T(",")
+             << _T(" \"mean\": ") << Number(s.mean) << _T(",")
+             << _T(" \"min\": ") << Number(s.Min()) << _T(",")
+             << _T(" \"p50\": ") << Number(Percentile(s.sorted, 50)) << _T(",")
+             << _T(" \"p90\": ") << Number(Percentile(s.sorted, 90)) << _T(",")
+             << _T(" \"p99\": ") << Number(Percentile(s.sorted, 99)) << _T(",")
+             << _T(" \"max\": ") << Number(s.Max()) << _T(" }");
+    }
+
+    json << _T("\n  ]\n}\n");
+
+    wxScopedCharBuffer utf8 = json.utf8_str();
+    out.Write(utf8.data(), utf8.length());
+}
+
+void WriteCSV(wxOutputStream& out, const vector<Result>& results)
+{
+    wxString csv =
+        _T("name,nodes,edges,ops,unit,samples,mean,min,p50,p90,p99,max\n");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        Summary s(r.samples);
+
+        csv << r.name << _T(",") << r.nodes << _T(",") << r.edges << _T(",")
+            << r.ops << _T(",") << r.unit << _T(",")
+            << r.samples.size() << _T(",")
+            << Number(s.mean) << _T(",") << Number(s.Min()) << _T(",")
+            << Number(Percentile(s.sorted, 50)) << _T(",")
+            << Number(Percentile(s.sorted, 90)) << _T(",")
+            << Number(Percentile(s.sorted, 99)) << _T(",")
+            << Number(s.Max()) << _T("\n");
+    }
+
+    wxScopedCharBuffer utf8 = csv.utf8_str();
+    out.Write(utf8.data(), utf8.length());
+}
+
+// ----------------------------------------------------------------------------
+// Runner
+// ----------------------------------------------------------------------------
+
+// Runs the benchmarks for one graph size, keeping a shared graph for the
+// benchmarks that don't modify it.
+class Runner
+{
+public:
+    Runner(size_t nodes, int repeat, int queries)
+      : m_nodes(nodes), m_edges(0), m_repeat(repeat), m_queries(queries)
+    { }
+
+    size_t GetSize() const { return m_nodes; }
+    int GetRepeat() const { return m_repeat; }
+    int GetQueries() const { return m_queries; }
+
+    // A recorded session for the replay benchmark, empty to synthesise one.
+    void SetTraceFile(const wxString& filename) { m_traceFile = filename; }
+    const wxString& GetTraceFile() const { return m_traceFile; }
+
+    // The shared graph, built on first use.
+    Graph& GetGraph();
+    const vector<GraphNode*>& GetNodes() { GetGraph(); return m_list; }
+
+    // Start a result for a benchmark doing 'ops' operations per sample.
+    Result& Begin(const wxString& name,
+                  size_t ops,
+                  const wxChar *unit = _T("ns/op"));
+
+    // Add a sample of 'ops' operations taking 'ns' nanoseconds, or some
+    // other quantity given by the result's unit.
+    void Add(double ns)
+    {
+        Result& r = m_results.back();
+        r.samples.push_back(ns / max(r.ops, size_t(1)));
+    }
+
+    void SetEdges(size_t edges) { m_edges = edges; }
+
+    vector<Result>& GetResults() { return m_results; }
+
+private:
+    size_t m_nodes;
+    size_t m_edges;
+    int m_repeat;
+    int m_queries;
+    wxString m_traceFile;
+    unique_ptr<Graph> m_graph;
+    vector<GraphNode*> m_list;
+    vector<Result> m_results;
+};
+
+Graph& Runner::GetGraph()
+{
+    if (!m_graph) {
+        m_graph.reset(new Graph);
+        AddNodes(*m_graph, m_nodes, m_list);
+        m_edges = AddEdges(*m_graph, m_list);
+    }
+
+    return *m_graph;
+}
+
+Result& Runner::Begin(const wxString& name,
+                      size_t ops,
+                      const wxChar *unit)
+{
+    Result r;
+    r.name = name;
+    r.nodes = m_nodes;
+    r.edges = m_edges;
+    r.ops = ops;
+    r.unit = unit;
+    m_results.push_back(r);
+    return m_results.back();
+}
+
+// ----------------------------------------------------------------------------
+// Benchmarks
+// ----------------------------------------------------------------------------
+
+void BenchAddNodes(Runner& runner)
+{
+    runner.Begin(_T("add_nodes"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph graph;
+        vector<GraphNode*> nodes;
+        Timer t;
+        AddNodes(graph, runner.GetSize(), nodes);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchAddEdges(Runner& runner)
+{
+    Result& r = runner.Begin(_T("add_edges"), 0);
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph graph;
+        vector<GraphNode*> nodes;
+        AddNodes(graph, runner.GetSize(), nodes);
+
+        Timer t;
+        r.edges = r.ops = AddEdges(graph, nodes);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchDeleteEdges(Runner& runner)
+{
+    Result& r = runner.Begin(_T("delete_edges"), 0);
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph graph;
+        vector<GraphNode*> nodes;
+        AddNodes(graph, runner.GetSize(), nodes);
+        AddEdges(graph, nodes);
+
+        vector<GraphElement*> edges;
+        GraphIterator<GraphEdge> it, end;
+        for (tie(it, end) = graph.GetElements<GraphEdge>(); it != end; ++it)
+            edges.push_back(&*it);
+
+        r.edges = r.ops = edges.size();
+
+        Timer t;
+        for (size_t j = 0; j < edges.size(); j++)
+            graph.Delete(edges[j]);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchDeleteNodes(Runner& runner)
+{
+    Result& r = runner.Begin(_T("delete_nodes"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph graph;
+        vector<GraphNode*> nodes;
+        AddNodes(graph, runner.GetSize(), nodes);
+        r.edges = AddEdges(graph, nodes);
+
+        // deleting a node also deletes its edges
+        Timer t;
+        for (size_t j = 0; j < nodes.size(); j++)
+            graph.Delete(nodes[j]);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchIterateNodes(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    runner.Begin(_T("iterate_nodes"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph::node_iterator it, end;
+        size_t count = 0;
+
+        Timer t;
+        for (tie(it, end) = graph.GetNodes(); it != end; ++it)
+            count++;
+        runner.Add(t.Elapsed());
+
+        wxASSERT(count == runner.GetSize());
+    }
+}
+
+void BenchIterateSelection(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    const vector<GraphNode*>& nodes = runner.GetNodes();
+
+    // select every other node
+    for (size_t i = 0; i < nodes.size(); i += 2)
+        nodes[i]->Select();
+
+    runner.Begin(_T("iterate_selection"), (nodes.size() + 1) / 2);
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph::iterator it, end;
+        size_t count = 0;
+
+        Timer t;
+        for (tie(it, end) = graph.GetSelection(); it != end; ++it)
+            count++;
+        runner.Add(t.Elapsed());
+    }
+
+    graph.UnselectAll();
+}
+
+void BenchHitTest(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    wxRect rc = graph.GetBounds();
+    Random rnd(3);
+
+    runner.Begin(_T("hittest"), 1);
+
+    for (int i = 0; i < runner.GetQueries(); i++) {
+        wxPoint pt(rc.x + int(rnd.Next(rc.width)),
+                   rc.y + int(rnd.Next(rc.height)));
+        Timer t;
+        graph.HitTest(pt);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchFindSpace(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    runner.Begin(_T("findspace"), 1);
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        graph.FindSpace(wxSize(colSpacing, rowSpacing));
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchLayout(Runner& runner)
+{
+#ifdef NO_GRAPHVIZ
+    wxUnusedVar(runner);
+#else
+    runner.Begin(_T("layout"), runner.GetSize());
+
+    // layout moves the nodes, so use a fresh graph each time
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph graph;
+        vector<GraphNode*> nodes;
+        AddNodes(graph, runner.GetSize(), nodes);
+        AddEdges(graph, nodes);
+
+        Timer t;
+        graph.LayoutAll();
+        runner.Add(t.Elapsed());
+    }
+#endif
+}
+
+void BenchSerialise(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    wxMemoryOutputStream out;
+
+    runner.Begin(_T("serialise_xml"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        wxMemoryOutputStream stream;
+        Timer t;
+        graph.Serialise(stream);
+        runner.Add(t.Elapsed());
+        if (i == 0)
+            graph.Serialise(out);
+    }
+
+    wxStreamBuffer *buf = out.GetOutputStreamBuffer();
+    runner.Begin(_T("deserialise_xml"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        wxMemoryInputStream in(buf->GetBufferStart(), buf->GetBufferSize());
+        Graph copy;
+        Timer t;
+        copy.Deserialise(in);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchDraw(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    wxRect rc = graph.GetBounds();
+
+    // the whole graph scaled down to fit the bitmap
+    const int size = 2048;
+    double scale = min(1.0, double(size) / max(rc.width, rc.height));
+
+    wxBitmap bmp(size, size);
+    wxMemoryDC dc(bmp);
+
+    runner.Begin(_T("draw"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        dc.SetUserScale(scale, scale);
+        dc.SetDeviceOrigin(int(-rc.x * scale), int(-rc.y * scale));
+        dc.SetBackground(*wxWHITE_BRUSH);
+        dc.Clear();
+
+        Timer t;
+        graph.Draw(&dc);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchDrawViewport(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    wxRect rc = graph.GetBounds();
+
+    // a window sized area in the middle of the graph, at 100%
+    wxRect view(rc.GetPosition() + rc.GetSize() / 2 - wxSize(512, 384),
+                wxSize(1024, 768));
+
+    wxBitmap bmp(view.width, view.height);
+    wxMemoryDC dc(bmp);
+
+    runner.Begin(_T("draw_viewport"), 1);
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        dc.DestroyClippingRegion();
+        dc.SetDeviceOrigin(-view.x, -view.y);
+        dc.SetBackground(*wxWHITE_BRUSH);
+        dc.Clear();
+
+        Timer t;
+        graph.Draw(&dc, view);
+        runner.Add(t.Elapsed());
+    }
+}
+
+// Edge bundling: the time to compute the bundles, then to draw the whole
+// graph with them as BenchDraw does.
+void BenchBundle(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    wxRect rc = graph.GetBounds();
+
+    wxFrame *frame = new wxFrame(NULL, wxID_ANY, _T("graphbench"));
+    GraphCtrl *ctrl = new GraphCtrl(frame);
+    ctrl->SetGraph(&graph);
+
+    runner.Begin(_T("bundle"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        ctrl->SetEdgeBundling(false);
+
+        Timer t;
+        ctrl->SetEdgeBundling(true);
+        runner.Add(t.Elapsed());
+    }
+
+    const int size = 2048;
+    double scale = min(1.0, double(size) / max(rc.width, rc.height));
+
+    wxBitmap bmp(size, size);
+    wxMemoryDC dc(bmp);
+
+    runner.Begin(_T("draw_bundled"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        dc.SetUserScale(scale, scale);
+        dc.SetDeviceOrigin(int(-rc.x * scale), int(-rc.y * scale));
+        dc.SetBackground(*wxWHITE_BRUSH);
+        dc.Clear();
+
+        Timer t;
+        graph.Draw(&dc);
+        runner.Add(t.Elapsed());
+    }
+
+    ctrl->SetGraph(NULL);
+    frame->Destroy();
+}
+
+void BenchSearch(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+
+    runner.Begin(_T("search_index"), runner.GetSize());
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        GraphSearch search(&graph);
+        runner.Add(t.Elapsed());
+    }
+
+    GraphSearch search(&graph);
+    Random rnd(5);
+
+    runner.Begin(_T("search_find"), 1);
+
+    for (int i = 0; i < runner.GetQueries(); i++) {
+        // a mix of common words and rarer numbers
+        wxString query;
+        if (i % 2)
+            query = wxString(operations[rnd.Next(numOperations)]).Left(5);
+        else
+            query.Printf(_T("%u"), unsigned(rnd.Next(runner.GetSize())));
+
+        Timer t;
+        search.Find(query, 100);
+        runner.Add(t.Elapsed());
+    }
+}
+
+void BenchAlgorithms(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    size_t n = runner.GetSize();
+
+    runner.Begin(_T("snapshot"), n);
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        GraphSnapshot snap(graph);
+        runner.Add(t.Elapsed());
+    }
+
+    GraphSnapshot snap(graph);
+    GraphIndexList sources(1, 0), result;
+    GraphWeightList weights(n, 1.0), distance;
+
+    runner.Begin(_T("bfs"), n);
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        BreadthFirstSearch(snap, sources, result);
+        runner.Add(t.Elapsed());
+    }
+
+    runner.Begin(_T("toposort"), n);
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        TopologicalSort(snap, result);
+        runner.Add(t.Elapsed());
+    }
+
+    runner.Begin(_T("scc"), n);
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        StronglyConnectedComponents(snap, result);
+        runner.Add(t.Elapsed());
+    }
+
+    runner.Begin(_T("shortest_paths"), n);
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        ShortestPaths(snap, 0, GraphWeightList(), distance);
+        runner.Add(t.Elapsed());
+    }
+
+    runner.Begin(_T("critical_path"), n);
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Timer t;
+        CriticalPath(snap, weights, GraphWeightList(), result);
+        runner.Add(t.Elapsed());
+    }
+}
+
+// The footprint of the graph and of its archive, in bytes and allocations
+// per node for each category of GraphMemoryUsage. Not a timing, so there is
+// a single sample of each.
+void BenchMemory(Runner& runner)
+{
+    Graph& graph = runner.GetGraph();
+    size_t n = runner.GetSize();
+
+    GraphMemoryUsage usage;
+    graph.GetMemoryUsage(usage);
+
+    Archive archive;
+    graph.Serialise(archive);
+    archive.GetMemoryUsage(usage);
+
+    for (int i = 0; i < GraphMemoryUsage::Num_Categories; i++) {
+        wxString name = _T("memory_") + GraphMemoryUsage::GetName(i);
+
+        runner.Begin(name, n, _T("bytes/node"));
+        runner.Add(double(usage.GetBytes(i)));
+        runner.Begin(name + _T("_allocs"), n, _T("allocs/node"));
+        runner.Add(double(usage.GetAllocations(i)));
+    }
+
+    runner.Begin(_T("memory_total"), n, _T("bytes/node"));
+    runner.Add(double(usage.GetTotalBytes()));
+    runner.Begin(_T("memory_total_allocs"), n, _T("allocs/node"));
+    runner.Add(double(usage.GetTotalAllocations()));
+}
+
+// Clearing a graph with New(), as when closing or reopening a document. Then
+// what the graph took from the allocation pools, per node.
+void BenchTeardown(Runner& runner)
+{
+    Result& r = runner.Begin(_T("teardown"), runner.GetSize());
+    GraphPoolStats before = GetGraphPoolStats(), built = before;
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        Graph graph;
+        vector<GraphNode*> nodes;
+
+        before = GetGraphPoolStats();
+        AddNodes(graph, runner.GetSize(), nodes);
+        r.edges = AddEdges(graph, nodes);
+        built = GetGraphPoolStats();
+
+        Timer t;
+        graph.New();
+        runner.Add(t.Elapsed());
+    }
+
+    size_t n = runner.GetSize();
+
+    runner.Begin(_T("pool_bytes"), n, _T("bytes/node"));
+    runner.Add(double(built.liveBytes - before.liveBytes));
+    runner.Begin(_T("pool_chunk_bytes"), n, _T("bytes/node"));
+    runner.Add(double(built.chunkBytes - before.chunkBytes));
+    runner.Begin(_T("pool_allocs"), n, _T("allocs/node"));
+    runner.Add(double(built.allocations - before.allocations));
+    runner.Begin(_T("pool_heap_allocs"), n, _T("allocs/node"));
+    runner.Add(double(built.heapAllocations - before.heapAllocations));
+}
+
+// Builds a session for the replay benchmark the way a user works: adds the
+// events of the mouse moving from 'from' to 'to' in 'steps' moves between a
+// press and a release, 10ms apart. 'state' holds the button and modifiers.
+class Session
+{
+public:
+    Session(GraphTrace& trace) : m_trace(trace), m_time(0) { }
+
+    void Add(GraphTrace::EventType type,
+             const wxPoint& pos,
+             int state = 0,
+             int param1 = 0,
+             int param2 = 0)
+    {
+        GraphTrace::Event ev;
+        ev.type = type;
+        ev.time = m_time += 10000000;
+        ev.pos = pos;
+        ev.state = state;
+        ev.param1 = param1;
+        ev.param2 = param2;
+        m_trace.AddEvent(ev);
+    }
+
+    void Move(const wxPoint& from, const wxPoint& to, int steps, int state = 0)
+    {
+        for (int i = 1; i <= steps; i++)
+            Add(GraphTrace::Mouse_Motion,
+                from + wxSize((to.x - from.x) * i / steps,
+                              (to.y - from.y) * i / steps),
+                state);
+    }
+
+    void Drag(GraphTrace::EventType down,
+              const wxPoint& from,
+              const wxPoint& to,
+              int steps,
+              int state)
+    {
+        int button = down == GraphTrace::Mouse_RightDown
+                     ? GraphTrace::State_Right : GraphTrace::State_Left;
+        Add(down, from, state & ~button);
+        Move(from, to, steps, state | button);
+        Add(GraphTrace::EventType(down + 1), to, state & ~button);
+    }
+
+    void Wheel(const wxPoint& pos, int ticks, int state)
+    {
+        int rotation = ticks < 0 ? -120 : 120;
+        for (int i = 0; i < ticks * rotation / 120; i++)
+            Add(GraphTrace::Mouse_Wheel, pos, state, rotation, 120);
+    }
+
+    void Key(int code)
+    {
+        Add(GraphTrace::Key_Down, wxPoint(), 0, code, 0);
+        Add(GraphTrace::Key_Char, wxPoint(), 0, code, 0);
+        Add(GraphTrace::Key_Up, wxPoint(), 0, code, 0);
+    }
+
+private:
+    GraphTrace& m_trace;
+    wxUint64 m_time;
+};
+
+// A point near 'pt' that is clear of the nodes.
+wxPoint FindClear(Graph& graph, wxPoint pt)
+{
+    for (int i = 0; i < 50 && graph.HitTest(pt); i++)
+        pt += wxSize(7, 5);
+    return pt;
+}
+
+// Synthesise a session on the middle of the shared graph, at 100%: hovering,
+// dragging a node, rubber-banding and dragging the selection, connecting two
+// nodes, panning, wheel zooming and scrolling, and the cursor keys.
+void MakeSession(Runner& runner, GraphTrace& trace)
+{
+    Graph& graph = runner.GetGraph();
+    const vector<GraphNode*>& nodes = runner.GetNodes();
+    size_t width = LayerWidth(nodes.size());
+
+    const wxSize view(1024, 768);
+    const wxPoint mid = nodes[nodes.size() / 2]->GetPosition();
+    const wxSize col(colSpacing, 0), row(0, rowSpacing);
+
+    trace.SetGraph(graph);
+    trace.SetView(view, 100, mid);
+
+    // graph to window coordinates
+    const wxSize offset(view.x / 2 - mid.x, view.y / 2 - mid.y);
+    Session s(trace);
+
+    wxPoint pt = mid - col * 3 - row * 3 + offset;
+    s.Move(pt, pt + col * 6 + row * 6, 40);
+
+    // a node moved to the clear space between its neighbours
+    pt = mid + offset;
+    s.Drag(GraphTrace::Mouse_LeftDown, pt, pt + col / 2 + row / 2, 40, 0);
+
+    // a block of nodes selected, then dragged
+    wxPoint from = FindClear(graph, mid - col * 2 - row * 2 - col / 2 - row / 2);
+    wxPoint to = FindClear(graph, mid + col * 2 + row * 2 - col / 2 - row / 2);
+    s.Drag(GraphTrace::Mouse_LeftDown, from + offset, to + offset, 40, 0);
+
+    pt = mid - col + offset;
+    s.Drag(GraphTrace::Mouse_LeftDown, pt, pt + row / 2, 40, 0);
+
+    // a connection between nodes in the next two layers
+    if (nodes.size() / 2 + 2 * width + 1 < nodes.size()) {
+        from = nodes[nodes.size() / 2 + width]->GetPosition() + offset;
+        to = nodes[nodes.size() / 2 + 2 * width + 1]->GetPosition() + offset;
+        s.Drag(GraphTrace::Mouse_RightDown, from, to, 40, 0);
+    }
+
+    // panning by shift dragging the background
+    pt = FindClear(graph, mid + col * 2 - col / 2 - row / 2) + offset;
+    s.Drag(GraphTrace::Mouse_LeftDown, pt, pt - col - row, 40,
+           GraphTrace::State_Shift);
+
+    pt = wxPoint() + view / 2;
+    s.Wheel(pt, -10, GraphTrace::State_Control);
+    s.Wheel(pt, 10, GraphTrace::State_Control);
+    s.Wheel(pt, -10, 0);
+
+    s.Key(WXK_PAGEDOWN);
+    for (int i = 0; i < 5; i++)
+        s.Key(WXK_RIGHT);
+    s.Key(WXK_HOME);
+}
+
+// Interaction: replays a session on a GraphCtrl, giving the time taken by
+// each event's handlers, overall and by kind of event, then the time of the
+// idle processing and painting that follow. With --trace the session and
+// its graph are the recorded ones, whatever the size.
+void BenchReplay(Runner& runner)
+{
+    GraphTrace trace;
+
+    if (runner.GetTraceFile().empty()) {
+        MakeSession(runner, trace);
+    }
+    else {
+        wxFFileInputStream in(runner.GetTraceFile());
+        if (!in.IsOk() || !trace.Load(in))
+            return;
+    }
+
+    wxFrame *frame = new wxFrame(NULL, wxID_ANY, _T("graphbench"));
+    GraphCtrl *ctrl = new GraphCtrl(frame);
+    Graph graph;
+    ctrl->SetGraph(&graph);
+    frame->Show();
+    wxYield();
+
+    const GraphTrace::EventList& events = trace.GetEvents();
+    Samples all, update, motion, button, wheel, key;
+    GraphTrace::TimingList timings;
+
+    for (int i = 0; i < runner.GetRepeat(); i++) {
+        if (!ctrl->Replay(trace, &timings))
+            break;
+
+        for (size_t j = 0; j < timings.size(); j++) {
+            double ns = double(timings[j].handler);
+            GraphTrace::EventType type = events[j].type;
+
+            all.push_back(ns);
+            update.push_back(double(timings[j].update));
+
+            if (events[j].IsKey())
+                key.push_back(ns);
+            else if (type == GraphTrace::Mouse_Wheel)
+                wheel.push_back(ns);
+            else if (type == GraphTrace::Mouse_Motion)
+                motion.push_back(ns);
+            else if (type != GraphTrace::Mouse_Enter &&
+                     type != GraphTrace::Mouse_Leave)
+                button.push_back(ns);
+        }
+    }
+
+    struct { const wxChar *name; const Samples *samples; } results[] = {
+        { _T("replay"),         &all },
+        { _T("replay_update"),  &update },
+        { _T("replay_motion"),  &motion },
+        { _T("replay_button"),  &button },
+        { _T("replay_wheel"),   &wheel },
+        { _T("replay_key"),     &key },
+    };
+
+    for (size_t i = 0; i < WXSIZEOF(results); i++) {
+        if (results[i].samples->empty())
+            continue;
+        Result& r = runner.Begin(results[i].name, 1, _T("ns/event"));
+        r.nodes = graph.GetNodeCount();
+        r.edges = graph.GetElementCount() - r.nodes;
+        r.samples = *results[i].samples;
+    }
+
+    ctrl->SetGraph(NULL);
+    frame->Destroy();
+}
+
+// The benchmarks, and the largest graph each is run on by default.
+struct Benchmark
+{
+    const wxChar *name;
+    void (*run)(Runner& runner);
+    size_t maxNodes;
+};
+
+const Benchmark benchmarks[] = {
+    { _T("add_nodes"),          BenchAddNodes,          1000000 },
+    { _T("add_edges"),          BenchAddEdges,          1000000 },
+    { _T("delete_edges"),       BenchDeleteEdges,       1000000 },
+    { _T("delete_nodes"),       BenchDeleteNodes,       1000000 },
+    { _T("iterate_nodes"),      BenchIterateNodes,      1000000 },
+    { _T("iterate_selection"),  BenchIterateSelection,  1000000 },
+    { _T("hittest"),            BenchHitTest,           1000000 },
+    { _T("findspace"),          BenchFindSpace,         100000 },
+    { _T("layout"),             BenchLayout,            10000 },
+    { _T("serialise"),          BenchSerialise,         100000 },
+    { _T("draw"),               BenchDraw,              100000 },
+    { _T("draw_viewport"),      BenchDrawViewport,      1000000 },
+    { _T("bundle"),             BenchBundle,            100000 },
+    { _T("search"),             BenchSearch,            1000000 },
+    { _T("algorithms"),         BenchAlgorithms,        1000000 },
+    { _T("memory"),             BenchMemory,            1000000 },
+    { _T("teardown"),           BenchTeardown,          1000000 },
+    { _T("replay"),             BenchReplay,            100000 },
+};
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// The application
+// ----------------------------------------------------------------------------
+
+class BenchApp : public wxApp
+{
+public:
+    BenchApp() : m_repeat(5), m_queries(1000), m_all(false), m_list(false) { }
+
+    void OnInitCmdLine(wxCmdLineParser& parser);
+    bool OnCmdLineParsed(wxCmdLineParser& parser);
+    int OnRun();
+
+private:
+    bool IsSelected(const Benchmark& bench, size_t nodes) const;
+
+    vector<size_t> m_sizes;
+    wxArrayString m_filter;
+    wxString m_format;
+    wxString m_output;
+    wxString m_trace;
+    long m_repeat;
+    long m_queries;
+    bool m_all;
+    bool m_list;
+};
+
+IMPLEMENT_APP(BenchApp)
+
+void BenchApp::OnInitCmdLine(wxCmdLineParser& parser)
+{
+    wxApp::OnInitCmdLine(parser);
+
+    parser.AddOption(_T("s"), _T("sizes"),
+                     _T("comma separated graph sizes in nodes ")
+                     _T("(default 1000,10000,100000,1000000)"));
+    parser.AddOption(_T("b"), _T("bench"),
+                     _T("comma separated benchmarks to run (default all)"));
+    parser.AddOption(_T("r"), _T("repeat"),
+                     _T("samples per benchmark (default 5)"),
+                     wxCMD_LINE_VAL_NUMBER);
+    parser.AddOption(_T("q"), _T("queries"),
+                     _T("queries per query benchmark (default 1000)"),
+                     wxCMD_LINE_VAL_NUMBER);
+    parser.AddOption(_T("f"), _T("format"), _T("json or csv (default json)"));
+    parser.AddOption(_T("o"), _T("output"),
+                     _T("output file (default standard output)"));
+    parser.AddOption(_T("t"), _T("trace"),
+                     _T("recorded session for the replay benchmark ")
+                     _T("(default synthesised)"));
+    parser.AddSwitch(_T("a"), _T("all"),
+                     _T("run every benchmark at every size"));
+    parser.AddSwitch(_T("l"), _T("list"), _T("list the benchmarks"));
+}
+
+bool BenchApp::OnCmdLineParsed(wxCmdLineParser& parser)
+{
+    if (!wxApp::OnCmdLineParsed(parser))
+        return false;
+
+    wxString sizes = _T("1000,10000,100000,1000000");
+    wxString filter;
+
+    parser.Found(_T("s"), &sizes);
+    parser.Found(_T("b"), &filter);
+    parser.Found(_T("r"), &m_repeat);
+    parser.Found(_T("q"), &m_queries);
+    m_all = parser.Found(_T("a"));
+    m_list = parser.Found(_T("l"));
+
+    m_format = _T("json");
+    parser.Found(_T("f"), &m_format);
+    parser.Found(_T("o"), &m_output);
+    parser.Found(_T("t"), &m_trace);
+
+    wxStringTokenizer tkz(sizes, _T(","));
+    while (tkz.HasMoreTokens()) {
+        unsigned long n;
+        if (!tkz.GetNextToken().ToULong(&n) || n == 0) {
+            wxLogError(_T("Invalid size list '%s'"), sizes.c_str());
+            return false;
+        }
+        m_sizes.push_back(n);
+    }
+
+    m_filter = wxStringTokenize(filter, _T(","));
+
+    if (m_format != _T("json") && m_format != _T("csv")) {
+        wxLogError(_T("Unknown format '%s'"), m_format.c_str());
+        return false;
+    }
+
+    m_repeat = max(m_repeat, 1L);
+    m_queries = max(m_queries, 1L);
+
+    return true;
+}
+
+bool BenchApp::IsSelected(const Benchmark& bench, size_t nodes) const
+{
+    if (!m_all && nodes > bench.maxNodes)
+        return false;
+    return m_filter.empty() || m_filter.Index(bench.name) != wxNOT_FOUND;
+}
+
+int BenchApp::OnRun()
+{
+    if (m_list) {
+        for (size_t i = 0; i < WXSIZEOF(benchmarks); i++)
+            wxPrintf(_T("%-20s up to %lu nodes\n"), benchmarks[i].name,
+                     (unsigned long)benchmarks[i].maxNodes);
+        return 0;
+    }
+
+    vector<Result> results;
+
+    for (size_t i = 0; i < m_sizes.size(); i++) {
+        Runner runner(m_sizes[i], int(m_repeat), int(m_queries));
+        runner.SetTraceFile(m_trace);
+
+        for (size_t j = 0; j < WXSIZEOF(benchmarks); j++) {
+            const Benchmark& bench = benchmarks[j];
+
+            if (IsSelected(bench, m_sizes[i])) {
+                wxFprintf(stderr, _T("%s %lu\n"), bench.name,
+                          (unsigned long)m_sizes[i]);
+                bench.run(runner);
+            }
+        }
+
+        vector<Result>& r = runner.GetResults();
+        results.insert(results.end(), r.begin(), r.end());
+    }
+
+    unique_ptr<wxOutputStream> out;
+
+    if (m_output.empty())
+        out.reset(new wxFFileOutputStream(stdout));
+    else
+        out.reset(new wxFFileOutputStream(m_output));
+
+    if (!out->IsOk())
+        return 1;
+
+    if (m_format == _T("csv"))
+        WriteCSV(*out, results);
+    else
+        WriteJSON(*out, results, int(m_repeat));
+
+    return 0;
+}
@@ -24,6 +24,8 @@
 
 namespace tt_solutions {
 
+class GraphMemoryUsage;
+
 inline bool ShouldInsert(const wxFont& value, const wxFont& def)
 {
     return !value.IsSameAs(def);
@@ -462,6 +464,9 @@ public:
     /** @brief Save the archive to a stream. */
     bool Save(wxOutputStream& stream) const;
 
+    /** @brief Adds the memory used by the archive's items to @a usage. */
+    void GetMemoryUsage(GraphMemoryUsage& usage) const;
+
     //@{
     /**
      * @brief The 'storing' flag.
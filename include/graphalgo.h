@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphalgo.h
+// Purpose:     Graph algorithms operating on graph snapshots
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHALGO_H
+#define GRAPHALGO_H
+
+/**
+ * @file graphalgo.h
+ * @brief Graph algorithms operating on graph snapshots.
+ *
+ * The algorithms work on a GraphSnapshot rather than directly on a Graph,
+ * since traversing the snapshot's arrays is many times faster than the
+ * graph's iterators. Nodes and edges are identified by their indices in the
+ * snapshot, which GraphSnapshot::GetNode() and GraphSnapshot::GetEdge() map
+ * back to the graph's elements:
+ *
+ * @code
+ *  GraphSnapshot snap(*graph);
+ *  GraphIndexList order;
+ *
+ *  if (TopologicalSort(snap, order))
+ *      for (size_t i = 0; i < order.size(); i++)
+ *          Process(snap.GetNode(order[i]));
+ * @endcode
+ *
+ * Results indexed by node or edge are returned in vectors with one entry per
+ * node or edge of the snapshot. Weights are passed the same way, an empty
+ * weight vector meaning a weight of one for every node or edge.
+ */
+
+#include "graphsnapshot.h"
+
+#include <vector>
+
+namespace tt_solutions {
+
+/** @brief A list of node or edge indices of a GraphSnapshot. */
+typedef std::vector<GraphSnapshot::Index> GraphIndexList;
+
+/** @brief Weights of the nodes or edges of a GraphSnapshot, by index. */
+typedef std::vector<double> GraphWeightList;
+
+/** @brief The directions in which the traversals follow edges. */
+enum GraphDirection
+{
+    Direction_Out = 1,      ///< Follow the edges from their source.
+    Direction_In = 2,       ///< Follow the edges backwards from their target.
+    Direction_Both = Direction_Out | Direction_In   ///< Ignore direction.
+};
+
+/**
+ * @brief Breadth first search from a set of source nodes.
+ *
+ * On return @a depth holds the number of edges on the shortest path from any
+ * of the sources to each node, or GraphSnapshot::npos for the nodes that
+ * can't be reached. If @a order is not @c NULL it receives the reachable
+ * nodes in the order they were visited.
+ *
+ * Large frontiers are expanded in parallel using up to @a threads threads,
+ * zero meaning the number of processors. The results are the same whatever
+ * the number of threads.
+ */
+void BreadthFirstSearch(const GraphSnapshot& graph,
+                        const GraphIndexList& sources,
+                        GraphIndexList& depth,
+                        GraphIndexList *order = NULL,
+                        int direction = Direction_Out,
+                        unsigned threads = 0);
+
+/**
+ * @brief Returns a vector of flags telling which nodes are reachable from
+ * a set of source nodes, including the sources themselves.
+ *
+ * @see BreadthFirstSearch()
+ */
+std::vector<bool> Reachable(const GraphSnapshot& graph,
+                            const GraphIndexList& sources,
+                            int direction = Direction_Out,
+                            unsigned threads = 0);
+
+/**
+ * @brief Depth first search from a set of source nodes.
+ *
+ * Fills @a preorder with the reachable nodes in the order they are
+ * discovered and, if it is not @c NULL, @a postorder in the order they are
+ * finished.
+ */
+void DepthFirstSearch(const GraphSnapshot& graph,
+                      const GraphIndexList& sources,
+                      GraphIndexList& preorder,
+                      GraphIndexList *postorder = NULL,
+                      int direction = Direction_Out);
+
+/**
+ * @brief Sorts the nodes so that every edge goes from an earlier node to a
+ * later one.
+ *
+ * Returns false if the graph contains a cycle, in which case @a order holds
+ * only the nodes that do not depend on a cycle.
+ */
+bool TopologicalSort(const GraphSnapshot& graph, GraphIndexList& order);
+
+/**
+ * @brief Finds the strongly connected components using Tarjan's algorithm.
+ *
+ * On return @a component holds the component number of each node and the
+ * number of components is returned. Components are numbered in reverse
+ * topological order, i.e. edges between components go from higher numbers
+ * to lower ones.
+ */
+size_t StronglyConnectedComponents(const GraphSnapshot& graph,
+                                   GraphIndexList& component);
+
+/**
+ * @brief Finds the connected components of the graph, ignoring the
+ * direction of the edges.
+ *
+ * On return @a component holds the component number of each node and the
+ * number of components is returned.
+ */
+size_t ConnectedComponents(const GraphSnapshot& graph,
+                           GraphIndexList& component);
+
+/**
+ * @brief Finds the shortest paths from a node using Dijkstra's algorithm.
+ *
+ * @param graph The snapshot.
+ * @param source The start node.
+ * @param weights The non-negative length of each edge.
+ * @param distance Receives the length of the shortest path to each node,
+ * or infinity for the nodes that can't be reached.
+ * @param predecessor If not @c NULL, receives the last edge of the
+ * shortest path to each node, or GraphSnapshot::npos for the source and
+ * unreachable nodes.
+ * @param direction The direction in which to follow edges.
+ */
+void ShortestPaths(const GraphSnapshot& graph,
+                   GraphSnapshot::Index source,
+                   const GraphWeightList& weights,
+                   GraphWeightList& distance,
+                   GraphIndexList *predecessor = NULL,
+                   int direction = Direction_Out);
+
+/**
+ * @brief Finds the longest path ending at each node of an acyclic graph.
+ *
+ * The length of a path is the sum of the weights of its nodes and edges, so
+ * with node weights holding the durations of the steps of a pipeline,
+ * @a finish receives the earliest time each step can complete.
+ *
+ * @param graph The snapshot.
+ * @param nodeWeights The weight of each node.
+ * @param edgeWeights The weight of each edge.
+ * @param finish Receives the length of the longest path ending at each node.
+ * @param predecessor If not @c NULL, receives the last edge of the longest
+ * path to each node, or GraphSnapshot::npos if it has no incoming edges.
+ *
+ * Returns false if the graph contains a cycle.
+ */
+bool LongestPaths(const GraphSnapshot& graph,
+                  const GraphWeightList& nodeWeights,
+                  const GraphWeightList& edgeWeights,
+                  GraphWeightList& finish,
+                  GraphIndexList *predecessor = NULL);
+
+/**
+ * @brief Finds the critical path of an acyclic graph, the longest of all
+ * its paths.
+ *
+ * Fills @a path with the nodes of the path from start to end and, if
+ * @a length is not @c NULL, stores its length. Returns false if the graph
+ * contains a cycle.
+ *
+ * @see LongestPaths()
+ */
+bool CriticalPath(const GraphSnapshot& graph,
+                  const GraphWeightList& nodeWeights,
+                  const GraphWeightList& edgeWeights,
+                  GraphIndexList& path,
+                  double *length = NULL);
+
+} // namespace tt_solutions
+
+#endif // GRAPHALGO_H
@@ -0,0 +1,248 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphbundle.h
+// Purpose:     Edge bundling for GraphCtrl
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHBUNDLE_H
+#define GRAPHBUNDLE_H
+
+/**
+ * @file graphbundle.h
+ * @brief Edge bundling for GraphCtrl.
+ */
+
+#include "graphctrl.h"
+
+#include <unordered_map>
+#include <vector>
+
+class wxShapeCanvas;
+
+namespace tt_solutions {
+
+/*
+ * Implementation classes
+ */
+namespace impl
+{
+    /**
+     * Implements GraphCtrl's edge bundling, see GraphCtrl::SetEdgeBundling().
+     *
+     * The area covered by the edges is divided into a grid of Resolution x
+     * Resolution square cells, and the grid into a quadtree of blocks of 2x2,
+     * 4x4, ... cells. Each edge is keyed by the cells of its ends, and the
+     * edges sharing a key are bundled if there are at least the threshold of
+     * them. The bundle's path runs from the centroid of its edges' sources up
+     * through the centres of the blocks containing the source cell to the
+     * smallest block containing both cells, then down through the blocks
+     * containing the target cell to the centroid of the targets. So bundles
+     * leaving or entering the same part of the graph share points on their
+     * paths and run together, as in hierarchical edge bundling.
+     *
+     * Each path is kept in a wxLineShape of its own, which is never added
+     * to the diagram, as the control points of a spline with an arrowhead at
+     * the end. GraphDiagram::Redraw() draws the bundles underneath the
+     * shapes, each as its spline thickened by the number of edges and
+     * labelled with it, and a thin line from each node at its ends. The
+     * bundled lines stay in the diagram but Redraw() steps over them and
+     * GraphCanvas::FindShape() hides them, unless IsCollapsed() says they
+     * have come out of their bundle.
+     *
+     * Update() recomputes the bundles from idle time after shapes have been
+     * added, removed, shown or hidden. For large graphs, keying the edges and
+     * planning the paths are split between threads, each writing only to its
+     * own range of the edges or bundles, so the result does not depend on the
+     * number of threads. When nodes have only moved, Update() keeps the
+     * bundles and plans again just the paths of those whose edges moved,
+     * unless an edge has changed cells.
+     */
+    class EdgeBundles
+    {
+    public:
+        /**
+         * Ctor taking the canvas to draw on.
+         *
+         * The canvas's owner makes it draw the bundles, see
+         * GraphCanvas::SetBundles().
+         */
+        EdgeBundles(wxShapeCanvas *canvas);
+        ~EdgeBundles();
+
+        /// Turn bundling on or off.
+        //@{
+        void Enable(bool enable);
+        bool IsEnabled() const { return m_enabled; }
+        //@}
+
+        /// The fewest edges between two cells that are bundled.
+        //@{
+        void SetThreshold(size_t threshold);
+        size_t GetThreshold() const { return m_threshold; }
+        //@}
+
+        /// The colour the bundles are drawn in.
+        void SetColour(const wxColour& colour);
+
+        /// Expand the bundle at a graph point, wxDefaultPosition for none.
+        void SetHover(const wxPoint& pt);
+
+        /// Called when shapes are added, removed, shown or hidden.
+        void Invalidate() { m_stale = true; }
+
+        /// Called when nodes have been moved or resized.
+        void InvalidatePaths() { m_moved = true; }
+
+        /**
+         * Called by GraphDiagram before a shape is removed, so that a shape
+         * allocated at the same address is not taken for a bundled line.
+         */
+        void RemoveLine(const wxShape *shape);
+
+        /// Returns true if the bundles should be recomputed with Update().
+        bool IsStale() const { return m_enabled && (m_stale || m_moved); }
+
+        /// Recompute the bundles and repaint the canvas.
+        void Update();
+
+        /**
+         * Delete the bundles until the next Update().
+         *
+         * Called by GraphDiagram when all its shapes are removed.
+         */
+        void Clear();
+
+        /// Draw the bundles within the DC's clipping region.
+        void Draw(wxDC& dc);
+
+        /**
+         * Returns true if @a shape is an edge's line drawn as part of a bundle
+         * rather than by itself.
+         *
+         * The lines of a bundle come out of it while the mouse is over the
+         * bundle, and a line comes out while it or either of its nodes is
+         * selected.
+         */
+        bool IsCollapsed(wxShape *shape) const;
+
+        /// Repaint the bundled lines of a shape being selected or unselected.
+        void RefreshLines(wxShape& shape);
+
+        /// The default threshold.
+        enum { DefaultThreshold = 4 };
+
+    private:
+        /// An edge considered for bundling.
+        struct Edge
+        {
+            wxShape *line;              ///< The edge's line.
+            wxRealPoint from;           ///< Centre of the source node.
+            wxRealPoint to;             ///< Centre of the target node.
+            wxUint32 key;               ///< Source and target cells.
+        };
+
+        /// A bundle of edges and its path.
+        struct Bundle
+        {
+            size_t first;               ///< First of its edges in m_work.
+            size_t last;                ///< One past its last edge in m_work.
+            std::vector<wxRealPoint> path; ///< The control points of its path.
+            std::vector<wxPoint> ends[2];  ///< Distinct centres at either end.
+            wxRect rect;                ///< Area covered, including its edges.
+            wxLineShape *line;          ///< The path as a line, owned.
+        };
+
+        /// The bundle of each bundled line.
+        typedef std::unordered_map<const wxShape*, size_t> LineMap;
+
+        enum {
+            Resolution = 16,            ///< Cells along each side of the grid.
+            Levels = 4,                 ///< Depth of the quadtree.
+            MaxWidth = 12,              ///< Pen width of the largest bundles.
+            ArrowSize = 8               ///< Arrowhead of a width 0 bundle.
+        };
+
+        /// Find the shown edges and fit the grid to their ends.
+        void Collect(wxList& shapes);
+
+        /**
+         * Follow moved nodes by planning again the paths of the bundles whose
+         * edges have moved.
+         *
+         * Returns false, having changed nothing visible, if the edges must be
+         * bundled again because one has changed cells, left the grid, been
+         * hidden or lost a node.
+         */
+        bool Replan();
+
+        /**
+         * Call (this->*work)(begin, end) over the range [0, n), split between
+         * threads if @a n is at least @a grain.
+         */
+        void Split(size_t n, size_t grain,
+                   void (EdgeBundles::*work)(size_t, size_t));
+
+        /// Set the keys of the edges m_work[begin, end).
+        void KeyEdges(size_t begin, size_t end);
+
+        /// Plan the paths of the bundles m_bundles[begin, end).
+        void PlanBundles(size_t begin, size_t end);
+
+        /// Set the control points of a bundle's line from its path.
+        static void SetLinePoints(Bundle& bundle);
+
+        /// The index of the cell containing a point.
+        wxUint32 GetCell(const wxRealPoint& pt) const;
+
+        /// The key of an edge between two points.
+        wxUint32 GetKey(const wxRealPoint& from, const wxRealPoint& to) const;
+
+        /// Returns true if a point is within the grid.
+        bool IsOnGrid(const wxRealPoint& pt) const;
+
+        /// The index of the block at @a level containing a cell.
+        static wxUint32 GetBlock(wxUint32 cell, int level);
+
+        /// The centre of the block at @a level containing a cell.
+        wxRealPoint GetCentre(wxUint32 cell, int level) const;
+
+        /// The pen width of a bundle of @a count edges.
+        static int GetWidth(size_t count);
+
+        /// Order edges by key, for sort().
+        static bool KeyLess(const Edge& e1, const Edge& e2)
+            { return e1.key < e2.key; }
+
+        /// Order points top to bottom, left to right, for sort().
+        static bool PointLess(const wxPoint& pt1, const wxPoint& pt2)
+            { return pt1.y < pt2.y || (pt1.y == pt2.y && pt1.x < pt2.x); }
+
+        /// Repaint an area given in graph coordinates.
+        void RefreshArea(const wxRect& rc);
+
+        wxShapeCanvas *m_canvas;        ///< The canvas drawn on.
+        bool m_enabled;                 ///< Bundling is on.
+        bool m_stale;                   ///< The shapes have changed.
+        bool m_moved;                   ///< Nodes have moved.
+        size_t m_threshold;             ///< Fewest edges in a bundle.
+        wxColour m_colour;              ///< Colour of the bundles.
+        std::vector<Edge> m_work;       ///< The edges, in order of key.
+        std::vector<Bundle> m_bundles;  ///< The bundles.
+        LineMap m_lines;                ///< The bundle of each bundled line.
+        int m_hover;                    ///< Bundle under the mouse, or -1.
+        wxRealPoint m_origin;           ///< Top left corner of the grid.
+        double m_cell;                  ///< Size of a cell.
+
+        DECLARE_NO_COPY_CLASS(EdgeBundles)
+    };
+
+} // namespace impl
+
+} // namespace tt_solutions
+
+#endif // GRAPHBUNDLE_H
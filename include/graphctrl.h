@@ -21,6 +21,7 @@
 #include "archive.h"
 #include "coords.h"
 #include "tie.h"
+#include "graphtrace.h"
 
 /**
  * @file graphctrl.h
@@ -29,6 +30,7 @@
 
 class wxShape;
 class wxLineShape;
+class wxShapeCanvas;
 
 /**
  * @brief TT-Solutions
@@ -43,7 +45,9 @@ typedef wxLineShape GraphLineShape;
 
 class Graph;
 class GraphElement;
+class GraphEdge;
 class GraphNode;
+class GraphMemoryUsage;
 class TipWindow;
 
 /*
@@ -54,6 +58,13 @@ namespace impl
     class GraphIteratorImpl;
     class GraphDiagram;
     class GraphCanvas;
+    class TopologicalOrder;
+    class ConnectionIndex;
+    class GroupIndex;
+    class ImpactHighlight;
+    class EdgeBundles;
+    class PerfHud;
+    class ZoomPreview;
 
     /**
      * @brief Conditions allowing to filter the elements being iterated on.
@@ -150,6 +161,14 @@ namespace impl
         GraphIteratorImpl *m_impl;
     };
 
+    /**
+     * Repaint an area of a GraphCtrl's canvas given in graph coordinates.
+     *
+     * Cheaper than converting with a wxClientDC, which matters as it is
+     * called on mouse moves for the impact highlighting and edge bundles.
+     */
+    void RefreshGraphArea(wxShapeCanvas *canvas, const wxRect& rcGraph);
+
     /**
      * Class used to initialize OGL library only once.
      */
@@ -373,6 +392,17 @@ public:
     /** @brief Destructor. */
     virtual ~GraphElement();
 
+    /**
+     * @brief Elements, including those of derived classes, are allocated
+     * from the same pools as their shapes.
+     *
+     * @see GetGraphPoolStats()
+     */
+    static void *operator new(size_t size);
+    /** @cond */
+    static void operator delete(void *p, size_t size);
+    /** @endcond */
+
     /** @brief Copy constructor. */
     GraphElement(const GraphElement& element);
     /** @brief Assignment operator. */
@@ -434,6 +464,15 @@ public:
      */
     virtual bool Serialise(Archive::Item& arc);
 
+    /**
+     * @brief Adds the memory used by this element and its shape to
+     * @a usage.
+     *
+     * Can be overridden in a derived class to add any additional
+     * attributes that allocate memory.
+     */
+    virtual void GetMemoryUsage(GraphMemoryUsage& usage) const;
+
     /**
      * @brief Called by the graph control when the element must draw itself.
      * Can be overridden to give the element a custom appearance.
@@ -688,6 +727,8 @@ public:
      */
     bool Serialise(Archive::Item& arc);
 
+    void GetMemoryUsage(GraphMemoryUsage& usage) const;
+
     /**
      * @brief Get the associated graphic object from the underlying graphics
      * library.
@@ -816,6 +857,21 @@ public:
         Num_Styles
     };
 
+    /**
+     * @brief An enumeration of the node's text attributes that can be
+     * searched.
+     *
+     * @see GetSearchText() \n GraphSearch
+     */
+    enum SearchField {
+        Search_Text,
+        Search_ToolTip,
+        Search_Rank,
+        Search_Result,
+        Search_Id,
+        Num_SearchFields
+    };
+
     /** @brief Constructor. */
     GraphNode(const wxString& text = wxEmptyString,
               const wxColour& colour = *wxBLACK,
@@ -833,7 +889,7 @@ public:
 
     //@{
     /** @brief Text for the node's tooltip. */
-    virtual void SetToolTip(const wxString& text) { m_tooltip = text; }
+    virtual void SetToolTip(const wxString& text);
     virtual wxString GetToolTip(const wxPoint& pt = wxPoint()) const;
     //@}
 
@@ -844,10 +900,33 @@ public:
      * Nodes given the same rank text will be placed at the same height when
      * automatically laid out.
      */
-    virtual void SetRank(const wxString& name) { m_rank = name; }
+    virtual void SetRank(const wxString& name);
     virtual wxString GetRank() const { return m_rank; }
     //@}
 
+    //@{
+    /**
+     * @brief The name of the group the node belongs to, empty for none.
+     *
+     * A group can be collapsed to a single node with Graph::CollapseGroup().
+     * Nodes of an expanded group are kept together when laid out.
+     */
+    virtual void SetGroup(const wxString& name);
+    virtual wxString GetGroup() const { return m_group; }
+    //@}
+
+    /**
+     * @brief Returns the text of one of the node's searchable attributes.
+     *
+     * @param field A value from the SearchField enumeration.
+     *
+     * The default implementation returns the text, tooltip and rank and an
+     * empty string for the other fields. It can be overridden by derived
+     * classes having additional text attributes to make them searchable with
+     * GraphSearch.
+     */
+    virtual wxString GetSearchText(int field) const;
+
     //@{
     /** @brief The colour of the node's text. */
     virtual void SetTextColour(const wxColour& colour);
@@ -941,6 +1020,8 @@ public:
      */
     bool Serialise(Archive::Item& arc);
 
+    void GetMemoryUsage(GraphMemoryUsage& usage) const;
+
     /**
      * @brief Move the node, centering it on the given point.
      *
@@ -1015,6 +1096,21 @@ protected:
      */
     virtual void DoSetSize(wxDC& dc, const wxSize& size);
 
+    /**
+     * @brief Notifies the graph's observers that one of the text attributes
+     * returned by GetSearchText() has changed.
+     *
+     * Derived classes should call it from the setters of any additional
+     * searchable attributes.
+     */
+    void NotifyTextChanged();
+
+    /**
+     * Sets the tooltip without calling NotifyTextChanged(), for setters that
+     * change it along with other attributes and notify once for all of them.
+     */
+    void DoSetToolTip(const wxString& text) { m_tooltip = text; }
+
     /**
      * @brief Overridable called from Layout().
      */
@@ -1030,7 +1126,22 @@ protected:
      */
     virtual void Layout();
 
+    /**
+     * @brief Returns true if the node looks exactly like a plain
+     * <code>Style_Rectangle</code> GraphNode.
+     *
+     * Such nodes, when not selected, are drawn by the graph control's batch
+     * renderer from a packed copy of their bounds and colours, without
+     * calling OnDraw(). This saves time rather than memory, as the node
+     * still has its shape. The default returns true only for the rectangle
+     * style of GraphNode itself. A derived class that draws as GraphNode does
+     * for some of its styles can override it.
+     */
+    virtual bool IsPlainDrawn() const;
+
 private:
+    friend class impl::GraphDiagram;
+
     /// Get the list of all underlying lines connecting to this node.
     wxList *GetLines() const;
 
@@ -1061,6 +1172,7 @@ private:
     wxString m_text;            ///< Node text content.
     wxString m_tooltip;         ///< Tooltip shown for the node.
     wxString m_rank;            ///< Node rank for layout.
+    wxString m_group;           ///< Group the node belongs to.
     wxFont m_font;              ///< Font used to render the node text.
 
     DECLARE_DYNAMIC_CLASS(GraphNode)
@@ -1338,6 +1450,63 @@ public:
     int GetToolTipDelay() const { return m_tipdelay; }
     //@}
 
+    /**
+     * @brief How zooming with the mouse wheel is drawn.
+     *
+     * @see SetZoomMode() \n SetZoomDelay() \n SetZoomAnimation()
+     */
+    enum ZoomMode {
+        Zoom_Immediate,     /**< Redraw the graph at each wheel step. */
+        Zoom_Progressive,   /**< Scale the last frame, redraw when idle. */
+        Zoom_Animated       /**< As Zoom_Progressive, animating each step. */
+    };
+
+    //@{
+    /**
+     * @brief How zooming with the mouse wheel is drawn.
+     *
+     * In @c Zoom_Immediate mode, the default, the whole graph is redrawn at
+     * the new scale for each step of the wheel, which can stutter when the
+     * graph is large.
+     *
+     * In @c Zoom_Progressive mode the graph is drawn once into a bitmap
+     * when the zooming starts, and while it continues that bitmap is
+     * scaled to the current zoom instead. The graph is redrawn at the final
+     * zoom once the wheel has been still for the delay set by
+     * SetZoomDelay().
+     *
+     * @c Zoom_Animated also scales the bitmap smoothly from one zoom level
+     * to the next over the time set by SetZoomAnimation(), rather than
+     * jumping to it.
+     *
+     * Only zooming with the wheel is affected, SetZoom() always redraws.
+     */
+    void SetZoomMode(ZoomMode mode);
+    int GetZoomMode() const { return m_zoommode; }
+    //@}
+
+    //@{
+    /**
+     * @brief The time in milliseconds the wheel must be still before the
+     * graph is redrawn at the new zoom, in the progressive zoom modes.
+     *
+     * @see SetZoomMode()
+     */
+    void SetZoomDelay(int millisecs) { m_zoomdelay = millisecs; }
+    int GetZoomDelay() const { return m_zoomdelay; }
+    //@}
+
+    //@{
+    /**
+     * @brief The time in milliseconds taken to animate each zoom step in
+     * @c Zoom_Animated mode.
+     *
+     * @see SetZoomMode()
+     */
+    void SetZoomAnimation(int millisecs) { m_zoomanim = millisecs; }
+    int GetZoomAnimation() const { return m_zoomanim; }
+    //@}
+
     /**
      * @brief What happens when nodes are dragged (can be ored together).
      *
@@ -1361,6 +1530,160 @@ public:
     static int GetRightDragMode()           { return sm_rightDrag; }
     //@}
 
+    /**
+     * @brief Which nodes are highlighted as impacted by the node under the
+     * mouse or the node last clicked (can be ored together).
+     *
+     * @see SetImpactMode()
+     */
+    enum ImpactMode {
+        Impact_None       = 0,          /**< No highlighting. */
+        Impact_Upstream   = 1 << 0,     /**< Nodes the node depends on. */
+        Impact_Downstream = 1 << 1,     /**< Nodes depending on the node. */
+        Impact_Both = Impact_Upstream | Impact_Downstream
+    };
+
+    //@{
+    /**
+     * @brief Highlights the nodes upstream and/or downstream of the node
+     * under the mouse, or of the node last clicked when the mouse isn't
+     * over a node.
+     *
+     * The nodes are marked with a halo drawn behind them, so their own
+     * colours are not changed. The sets of reachable nodes are cached and
+     * kept up to date as edges are added and removed, so moving the mouse
+     * back and forth over a group of nodes stays cheap on large graphs.
+     *
+     * Values from the @c #ImpactMode enum, bitwise ored.
+     *
+     * @see SetImpactColours() \n SetImpactNode() \n GraphReachability
+     */
+    void SetImpactMode(int mode);
+    int GetImpactMode() const;
+    //@}
+
+    //@{
+    /**
+     * @brief The node whose impact is highlighted when the mouse isn't over
+     * a node.
+     *
+     * This is set when a node is clicked and cleared when the background is
+     * clicked, and can also be set programmatically. @c NULL for none.
+     */
+    void SetImpactNode(GraphNode *node);
+    GraphNode *GetImpactNode() const;
+    //@}
+
+    /**
+     * @brief The colours of the halos drawn around the upstream and the
+     * downstream nodes.
+     */
+    void SetImpactColours(const wxColour& upstream,
+                          const wxColour& downstream);
+
+    //@{
+    /**
+     * @brief Draws the edges running between the same regions of the graph
+     * as bundles instead of one by one.
+     *
+     * The graph is divided into a grid of regions, and the edges between
+     * two regions, when there are at least GetBundleThreshold() of them,
+     * are drawn as a single thick curve labelled with their number. The
+     * curves are routed through the centres of larger and larger blocks of
+     * regions, so bundles heading the same way share their paths. Edges
+     * within a region, or between regions with fewer edges, are drawn as
+     * usual.
+     *
+     * The edges of a bundle are drawn individually while the mouse is over
+     * it, and an edge is drawn individually while it or either of its
+     * nodes is selected. A bundled edge can't be clicked.
+     *
+     * The bundles are recomputed in idle time after the graph changes,
+     * using several threads for large graphs. Moving nodes only bends the
+     * paths of the bundles their edges are in, unless an edge changes
+     * region.
+     */
+    void SetEdgeBundling(bool bundle = true);
+    bool IsEdgeBundling() const;
+    //@}
+
+    //@{
+    /**
+     * @brief The fewest edges between two regions that are drawn as a
+     * bundle.
+     *
+     * The default is 4.
+     */
+    void SetBundleThreshold(size_t threshold);
+    size_t GetBundleThreshold() const;
+    //@}
+
+    /** @brief The colour the bundles are drawn in. */
+    void SetBundleColour(const wxColour& colour);
+
+    //@{
+    /**
+     * @brief Shows an overlay of performance figures in the corner of the
+     * control.
+     *
+     * The overlay shows the time taken by the last paint and the rolling
+     * frame rate, the number of shapes drawn and how many of them were
+     * outside the area being painted, the element counts, the time of the
+     * last layout and load, and the hit rates of the caches that keep
+     * profiling counters.
+     *
+     * It can also be toggled with Ctrl+Shift+F12. Profiling is enabled
+     * while it is shown.
+     *
+     * @see GraphProfiler
+     */
+    void ShowPerfHud(bool show = true);
+    bool IsPerfHudShown() const { return m_hud != NULL; }
+    //@}
+
+    //@{
+    /**
+     * @brief Records the interaction with the control into a trace.
+     *
+     * StartRecording() clears @a trace and stores the graph and the view in
+     * it, then the mouse, wheel and key events received are added to it
+     * until StopRecording(). The trace must outlive the recording.
+     *
+     * @see graphtrace.h
+     */
+    void StartRecording(GraphTrace& trace);
+    void StopRecording();
+    bool IsRecording() const;
+    //@}
+
+    /**
+     * @brief Replays a recorded trace.
+     *
+     * Replaces the graph's contents with the graph stored in the trace,
+     * restores the size, zoom and scroll position of the view, then injects
+     * the recorded events one by one. After each event the control's idle
+     * processing is run and any pending paint done, as they would be between
+     * events in a real session. The events are injected as fast as they can
+     * be handled, the recorded times aren't waited for.
+     *
+     * If @a timings is given, it receives the time taken by each event's
+     * handlers and by the update that followed.
+     *
+     * The control should be shown, since dragging captures the mouse, and
+     * the replay is only faithful if the graph's node and edge types and the
+     * application's event handlers are the same as when recording.
+     *
+     * Returns false if there is no graph, the control is recording, or the
+     * trace holds no graph.
+     */
+    bool Replay(const GraphTrace& trace,
+                GraphTrace::TimingList *timings = NULL);
+
+    /**
+     * @brief Overridden to add the key events to the trace when recording.
+     */
+    bool ProcessEvent(wxEvent& event);
+
     /**
      * @brief Converts a point from screen coordinates to the coordinate
      * system used by the graph.
@@ -1388,7 +1711,8 @@ public:
     /**
      * Key press event handler.
      *
-     * Used to implement scrolling using the cursor keys.
+     * Used to implement scrolling using the cursor keys, and to toggle the
+     * performance overlay.
      */
     void OnChar(wxKeyEvent& event);
 
@@ -1474,9 +1798,42 @@ private:
      */
     void CloseTip(const wxPoint& pt = wxDefaultPosition);
 
+    /** @brief Returns the impact highlighting, creating it if necessary. */
+    impl::ImpactHighlight *GetImpact();
+
+    /** @brief Returns the edge bundling, creating it if necessary. */
+    impl::EdgeBundles *GetBundles();
+
+    /**
+     * @brief Sends the Evt_Graph_Ctrl_Zoom event for a change of zoom.
+     *
+     * Returns false if the change was vetoed, otherwise @a percent and
+     * @a pt are updated with any changes made by the handlers.
+     */
+    bool SendZoomEvent(double& percent, wxPoint& pt);
+
+    /**
+     * @brief Zooms by @a factor for a step of the wheel, fixing the given
+     * point in the viewport, as set by SetZoomMode().
+     */
+    void ZoomBy(double factor, const wxPoint& pt);
+
     impl::Initialisor m_initalise;  ///< Initialization counter.
     impl::GraphCanvas *m_canvas;    ///< The associated canvas.
     Graph *m_graph;                 ///< The associated graph object.
+    impl::ImpactHighlight *m_impact; ///< Impact highlighting or NULL.
+    impl::EdgeBundles *m_bundles;   ///< Edge bundling or NULL.
+    impl::PerfHud *m_hud;           ///< Performance overlay or NULL.
+
+    /**
+        @name Zooming data.
+     */
+    //@{
+    impl::ZoomPreview *m_zoom;      ///< Progressive zooming or NULL.
+    ZoomMode m_zoommode;            ///< See ZoomMode elements.
+    int m_zoomdelay;                ///< Idle time before redrawing.
+    int m_zoomanim;                 ///< Duration of an animated step.
+    //@}
 
     /**
         @name Tooltip data.
@@ -1523,6 +1880,67 @@ template <class T> void GraphCtrl::SetMargin(const wxSize& size)
     SetMargin(Pixels::From<T>(size, GetDPI()));
 }
 
+/**
+ * @brief Interface for objects following the changes made to a Graph.
+ *
+ * Observers are registered with Graph::AddObserver() and are notified after
+ * elements are added to the graph and before they are removed from it, which
+ * allows them to maintain auxiliary data structures incrementally instead of
+ * rescanning the whole graph. Unlike the graph events, these notifications
+ * are sent for all changes, including the ones done by Deserialise(), and
+ * can't be vetoed.
+ *
+ * The default implementations of all the methods do nothing.
+ *
+ * @see Graph::AddObserver()
+ */
+class GraphObserver
+{
+public:
+    /** @brief Destructor. */
+    virtual ~GraphObserver() { }
+
+    /** @brief Called after a node has been added to the graph. */
+    virtual void OnNodeAdded(GraphNode&) { }
+
+    /** @brief Called after an edge has been added and connected. */
+    virtual void OnEdgeAdded(GraphEdge&) { }
+
+    /**
+     * @brief Called before a node or an edge is removed from the graph.
+     *
+     * An edge is still connected to its nodes when this is called.
+     */
+    virtual void OnElementRemoving(GraphElement&) { }
+
+    /**
+     * @brief Called when one of the attributes returned by
+     * GraphNode::GetSearchText() changes.
+     */
+    virtual void OnNodeTextChanged(GraphNode&) { }
+
+    /** @brief Called after a node has been moved or resized. */
+    virtual void OnNodeMoved(GraphNode&) { }
+
+    /**
+     * @brief Called after a node has been hidden by collapsing its group,
+     * or shown again by expanding it.
+     *
+     * Graph::IsHidden() returns which.
+     */
+    virtual void OnNodeShown(GraphNode&) { }
+
+    /** @brief Called after Graph::New() has removed all the elements. */
+    virtual void OnGraphCleared() { }
+
+    /**
+     * @brief Called when the graph is destroyed.
+     *
+     * The observer is unregistered automatically after this call.
+     */
+    virtual void OnGraphDestroyed() { }
+};
+
 /**
  * @brief Holds a graph for editing using a GraphCtrl.
  *
@@ -1911,6 +2329,152 @@ public:
     /** @brief The DPI of the graph's nominal pixels. */
     wxSize GetDPI() const { return m_dpi; }
 
+    //@{
+    /**
+     * @brief Registers or unregisters an observer of the graph's changes.
+     *
+     * The graph does not take ownership of the observer.
+     *
+     * @see GraphObserver
+     */
+    void AddObserver(GraphObserver *observer);
+    void RemoveObserver(GraphObserver *observer);
+    //@}
+
+    /**
+     * @brief Notifies the observers that a node's text attributes changed.
+     *
+     * This is called by GraphNode, it is not necessary to call it directly.
+     */
+    void NotifyTextChanged(GraphNode& node);
+
+    /**
+     * @brief Notifies the observers that a node has been moved or resized.
+     *
+     * This is called by GraphNode, it is not necessary to call it directly.
+     */
+    void NotifyMoved(GraphNode& node);
+
+    /**
+     * @brief Notifies the observers that a node has been hidden or shown.
+     *
+     * This is called when groups are collapsed or expanded, it is not
+     * necessary to call it directly.
+     */
+    void NotifyShown(GraphNode& node);
+
+    /**
+     * @brief Returns true if there is an edge between two nodes.
+     *
+     * If @a directed is false an edge in either direction counts, otherwise
+     * only an edge from @a from to @a to. The graph keeps a hash of the
+     * connected pairs up to date as edges are added and deleted, so this
+     * takes constant time however many edges the nodes have.
+     */
+    bool IsConnected(const GraphNode& from,
+                     const GraphNode& to,
+                     bool directed = false) const;
+
+    //@{
+    /**
+     * @brief Collapse a group of nodes to a single proxy node, or expand it
+     * again.
+     *
+     * Nodes are put into groups with GraphNode::SetGroup(). Collapsing a
+     * group hides its nodes and their edges and shows a proxy node in their
+     * place, centred on them. The group's edges to other nodes are shown as
+     * edges of the proxy, one for each node or collapsed group connected to.
+     * Expanding the group removes the proxy and shows the nodes again, moved
+     * by as far as the proxy was moved.
+     *
+     * Both take time proportional to the size of the group and its edges,
+     * not of the graph. Hidden elements aren't hit tested or drawn, and
+     * Layout() places the proxy of a collapsed group as a single node.
+     *
+     * The hidden nodes and edges are still part of the graph and returned by
+     * GetNodes() and GetElements(). The proxies aren't, they are returned
+     * only by HitTest() and, when selected, GetSelection(), so that they can
+     * be clicked and dragged. They can't be deleted or connected to, and
+     * aren't serialised. Which groups are collapsed isn't serialised either.
+     *
+     * CollapseGroup() returns the proxy, which can be restyled, or @c NULL
+     * if the group has no nodes. The proxy's GetGroup() is the group's name.
+     */
+    GraphNode *CollapseGroup(const wxString& name);
+    void ExpandGroup(const wxString& name);
+    //@}
+
+    /**
+     * @brief Returns the proxy node of a collapsed group, or @c NULL if the
+     * group is expanded or has no nodes.
+     */
+    GraphNode *GetGroupProxy(const wxString& name) const;
+
+    /** @brief Returns true if the group is collapsed. */
+    bool IsCollapsed(const wxString& name) const
+        { return GetGroupProxy(name) != NULL; }
+
+    /**
+     * @brief Returns true if the element is a proxy node or edge, shown in
+     * place of a collapsed group.
+     */
+    bool IsGroupProxy(const GraphElement& element) const;
+
+    /**
+     * @brief Returns true if the element is hidden in a collapsed group.
+     */
+    bool IsHidden(const GraphElement& element) const;
+
+    /**
+     * @brief Moves a node between groups after its group has been changed.
+     *
+     * This is called by GraphNode, it is not necessary to call it directly.
+     */
+    void NotifyGroupChanged(GraphNode& node);
+
+    /**
+     * @brief Adds the memory used by the graph's elements and their shapes
+     * to @a usage.
+     *
+     * This includes the packed copies of the nodes' bounds and colours that
+     * the graph control keeps for hit testing and drawing, counted as
+     * <code>Mem_Shapes</code>.
+     *
+     * @see GraphMemoryUsage
+     */
+    void GetMemoryUsage(GraphMemoryUsage& usage) const;
+
+    //@{
+    /**
+     * @brief Acyclic mode, in which edges that would create a cycle can't be
+     * added.
+     *
+     * In acyclic mode the graph maintains a topological order of its nodes,
+     * updated incrementally as edges are added and deleted. Add() refuses
+     * edges that would create a cycle and returns @c NULL, the graph control
+     * does not offer such connections when the user drags between nodes,
+     * and they are dropped when deserialising.
+     *
+     * Enabling acyclic mode fails, returning false, if the graph already
+     * contains a cycle.
+     *
+     * @see WouldCreateCycle()
+     */
+    bool SetAcyclic(bool acyclic = true);
+    bool IsAcyclic() const { return m_order != NULL; }
+    //@}
+
+    /**
+     * @brief Returns true if adding an edge from @a from to @a to would
+     * create a cycle.
+     *
+     * In acyclic mode this takes constant time when the edge agrees with the
+     * topological order, otherwise only the nodes between the two in the
+     * order are searched. When not in acyclic mode it does a search of the
+     * graph from @a to.
+     */
+    bool WouldCreateCycle(const GraphNode& from, const GraphNode& to) const;
+
     //@{
     /**
      * @brief The graph's default font.
@@ -1984,6 +2548,18 @@ private:
     /// Delete an element from the graph.
     void DoDelete(GraphElement *element);
 
+    /**
+     * Remove an element that was never announced, without events or
+     * notifications.
+     */
+    void Discard(GraphElement *element);
+
+    /// Notify the observers that an element has been added.
+    void NotifyAdded(GraphElement& element);
+
+    /// Notify the observers that an element is about to be removed.
+    void NotifyRemoving(GraphElement& element);
+
     /**
      * @brief Creates a new iterator over graph elements.
      *
@@ -2073,6 +2649,18 @@ private:
      */
     wxSize m_dpi;
 
+    /// Registered observers, not owned. @see AddObserver()
+    std::list<GraphObserver*> m_observers;
+
+    /// Count of the edges between each pair of nodes.
+    impl::ConnectionIndex *m_connections;
+
+    /// Topological order maintained in acyclic mode, otherwise @c NULL.
+    impl::TopologicalOrder *m_order;
+
+    /// The groups of nodes and the proxies of the collapsed ones.
+    impl::GroupIndex *m_groups;
+
     DECLARE_DYNAMIC_CLASS(Graph)
     DECLARE_NO_COPY_CLASS(Graph)
 };
@@ -0,0 +1,147 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphmemory.h
+// Purpose:     Accounting of the memory used by graphs and archives
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHMEMORY_H
+#define GRAPHMEMORY_H
+
+/**
+ * @file graphmemory.h
+ * @brief Accounting of the memory used by graphs and archives.
+ */
+
+#include <wx/wx.h>
+
+#include <unordered_set>
+
+class wxShape;
+
+namespace tt_solutions {
+
+/**
+ * @brief Totals the memory used by graph elements, their shapes and
+ * archives, by category.
+ *
+ * Pass an instance to Graph::GetMemoryUsage() or Archive::GetMemoryUsage(),
+ * or to GraphElement::GetMemoryUsage() for a single element, then read back
+ * the bytes and number of heap allocations in each category:
+ *
+ * @code
+ *  GraphMemoryUsage usage;
+ *  graph->GetMemoryUsage(usage);
+ *  size_t perNode = usage.GetTotalBytes() / graph->GetNodeCount();
+ * @endcode
+ *
+ * The figures are the sizes requested from the allocator, as far as they can
+ * be known without instrumenting it, so they don't include the allocator's
+ * own overhead. Reference counted data, such as bitmaps, is counted once
+ * however many objects share it. The same instance can be passed to several
+ * calls to accumulate a total.
+ */
+class GraphMemoryUsage
+{
+public:
+    /** @brief The categories the memory is divided into. */
+    enum Category {
+        Mem_Nodes,      /**< GraphNode objects. */
+        Mem_Edges,      /**< GraphEdge objects. */
+        Mem_Shapes,     /**< The shapes of the graphics library, their lists
+                             and control points. */
+        Mem_Regions,    /**< The shapes' text regions. */
+        Mem_Text,       /**< Strings, including the regions' text. */
+        Mem_Images,     /**< Bitmaps and icons. */
+        Mem_Archive,    /**< Archive items and their attributes. */
+        Num_Categories
+    };
+
+    /** @brief Constructor. */
+    GraphMemoryUsage() { Clear(); }
+
+    /** @brief Adds @a bytes in @a allocations allocations to a category. */
+    void Add(int category, size_t bytes, size_t allocations = 1);
+
+    /** @brief Adds a string's buffer, if it has one. */
+    void AddString(int category, const wxString& str);
+
+    /**
+     * @brief Adds the nodes of a wxList, but not the objects the list points
+     * to.
+     */
+    void AddList(int category, const wxList& list);
+
+    /**
+     * @brief Adds an object, using the size of the most derived class that
+     * has run-time type information.
+     */
+    void AddObject(int category, const wxObject& object);
+
+    /**
+     * @brief Adds a shape of the graphics library, along with its text
+     * regions, lists, control points and child shapes.
+     */
+    void AddShape(const wxShape& shape);
+
+    /**
+     * @brief Adds an image such as a wxBitmap or wxIcon, unless it shares
+     * its data with one already added.
+     */
+    void AddImage(const wxObject& image, int width, int height, int depth);
+
+    /** @brief Returns the bytes counted in a category. */
+    size_t GetBytes(int category) const;
+    /** @brief Returns the number of heap allocations counted in a category. */
+    size_t GetAllocations(int category) const;
+
+    //@{
+    /** @brief Totals over all the categories. */
+    size_t GetTotalBytes() const;
+    size_t GetTotalAllocations() const;
+    //@}
+
+    /** @brief Returns a category's name, e.g. "nodes". */
+    static wxString GetName(int category);
+
+    /** @brief Zeros the counts. */
+    void Clear();
+
+private:
+    size_t m_bytes[Num_Categories];         ///< Bytes in each category.
+    size_t m_allocations[Num_Categories];   ///< Allocations in each category.
+
+    /// Shared data already counted.
+    std::unordered_set<const void*> m_shared;
+};
+
+/**
+ * @brief Statistics of the pools that graph elements, their shapes, shape
+ * event handlers and text regions are allocated from.
+ *
+ * These are shared by all graphs. The counts of allocations and frees are
+ * totals since start up, the rest are the current state.
+ *
+ * @see GetGraphPoolStats()
+ */
+struct GraphPoolStats
+{
+    size_t allocations;     ///< Blocks allocated from the pools.
+    size_t frees;           ///< Blocks returned to the pools.
+    size_t live;            ///< Blocks in use.
+    size_t liveBytes;       ///< Bytes in use, rounded up to the block sizes.
+    size_t chunks;          ///< Chunks the pools hold from the heap.
+    size_t chunkBytes;      ///< Bytes the pools hold from the heap.
+    size_t heapAllocations; ///< Objects too large for the pools.
+};
+
+/** @brief Returns the current statistics of the allocation pools. */
+GraphPoolStats GetGraphPoolStats();
+
+} // namespace tt_solutions
+
+#endif // GRAPHMEMORY_H
@@ -0,0 +1,210 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphoverview.h
+// Purpose:     Overview of a whole graph for navigating a GraphCtrl
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHOVERVIEW_H
+#define GRAPHOVERVIEW_H
+
+/**
+ * @file graphoverview.h
+ * @brief Overview of a whole graph for navigating a GraphCtrl.
+ */
+
+#include "graphctrl.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace tt_solutions {
+
+/**
+ * @brief A small view of the whole graph shown in a GraphCtrl, with the
+ * GraphCtrl's viewport marked on it.
+ *
+ * Clicking in the overview centres the GraphCtrl on that point, and
+ * dragging pans it. Dragging from inside the viewport rectangle moves the
+ * rectangle rather than jumping to the point clicked.
+ *
+ * The graph is shown at low detail, as the density of the nodes over a
+ * coarse grid. The grid is kept up to date from the graph's GraphObserver
+ * notifications, so adding, moving or removing a node only updates the
+ * cells it covers. The diagram is never drawn for the overview, which
+ * costs next to nothing while the graph is edited.
+ *
+ * @code
+ *  GraphOverviewCtrl *overview = new GraphOverviewCtrl(panel);
+ *  overview->SetGraphCtrl(m_graphctrl);
+ * @endcode
+ */
+class GraphOverviewCtrl : public wxControl, public GraphObserver
+{
+public:
+    /// Default ctor.
+    GraphOverviewCtrl() { Init(); }
+
+    /// Constructor taking the same arguments as wxControl.
+    GraphOverviewCtrl(wxWindow *parent, wxWindowID id = wxID_ANY,
+                      const wxPoint& pos = wxDefaultPosition,
+                      const wxSize& size = wxDefaultSize,
+                      long style = wxBORDER_SIMPLE | wxFULL_REPAINT_ON_RESIZE,
+                      const wxString& name = DefaultName);
+
+    ~GraphOverviewCtrl();
+
+    //@{
+    /**
+     * @brief The GraphCtrl shown and panned by the overview, or NULL.
+     *
+     * The graph shown is the GraphCtrl's GetGraph(), and is followed if the
+     * GraphCtrl is given a different one. The GraphCtrl must outlive the
+     * overview or be unset first.
+     */
+    void SetGraphCtrl(GraphCtrl *ctrl);
+    GraphCtrl *GetGraphCtrl() const { return m_ctrl; }
+    //@}
+
+    //@{
+    /**
+     * @brief The number of cells along the longer side of the grid.
+     *
+     * Higher values show more detail but take more memory and time to
+     * rebuild when the graph grows beyond the grid. The default is 256.
+     */
+    void SetResolution(int cells);
+    int GetResolution() const { return m_resolution; }
+    //@}
+
+    //@{
+    /**
+     * @brief The colour of the cells fully covered by nodes.
+     *
+     * Cells partly covered are shaded between this and the background.
+     */
+    void SetNodeColour(const wxColour& colour);
+    wxColour GetNodeColour() const { return m_nodeColour; }
+    //@}
+
+    //@{
+    /** @brief The colour of the rectangle marking the viewport. */
+    void SetViewportColour(const wxColour& colour);
+    wxColour GetViewportColour() const { return m_viewportColour; }
+    //@}
+
+    /**
+     * @name Overridden GraphObserver methods.
+     */
+    //@{
+    void OnNodeAdded(GraphNode& node);
+    void OnElementRemoving(GraphElement& element);
+    void OnNodeMoved(GraphNode& node);
+    void OnNodeShown(GraphNode& node);
+    void OnGraphCleared();
+    void OnGraphDestroyed();
+    //@}
+
+    /**
+     * @name Event handlers.
+     */
+    //@{
+    void OnPaint(wxPaintEvent& event);
+    void OnSize(wxSizeEvent& event);
+    void OnMouse(wxMouseEvent& event);
+    void OnCaptureLost(wxMouseCaptureLostEvent& event);
+    /// Follows changes of the GraphCtrl's graph and viewport.
+    void OnIdle(wxIdleEvent& event);
+    //@}
+
+    /// Default name for GraphOverviewCtrl objects.
+    static const wxChar DefaultName[];
+
+private:
+    /// Common part of all ctors.
+    void Init();
+
+    /// Observe a different graph, NULL for none.
+    void SetGraph(Graph *graph);
+
+    /**
+     * Choose the grid to cover the nodes with a margin for growth, and count
+     * them into it again from their cached bounds.
+     */
+    void Rebuild();
+
+    /// Add @a delta to the cells covered by @a rc and update their pixels.
+    void Count(const wxRect& rc, int delta);
+
+    /// Update the cached bounds of a node, NULL @a rc removing it.
+    void Update(const GraphNode& node, const wxRect *rc);
+
+    /// Count a node at its current bounds, or uncount it if it's hidden.
+    void Update(const GraphNode& node);
+
+    /// The GraphCtrl's viewport in graph coordinates.
+    wxRect GetViewport() const;
+
+    /**
+     * Recompute m_viewport if the GraphCtrl has been scrolled, zoomed or
+     * resized since, returning true if it has changed.
+     *
+     * Converting the corners to graph coordinates needs a DC, so this is
+     * checked from idle time by comparing the canvas's scroll position, zoom
+     * and size instead.
+     */
+    bool UpdateViewport();
+
+    /// Fit the grid and the viewport into the client area.
+    void UpdateLayout();
+
+    /// Convert between client and graph coordinates.
+    //@{
+    wxPoint ClientToGraph(const wxPoint& pt) const;
+    wxRect GraphToClient(const wxRect& rc) const;
+    //@}
+
+    /// Centre the GraphCtrl on a client point, offset by m_dragOffset.
+    void Pan(const wxPoint& pt);
+
+    GraphCtrl *m_ctrl;          ///< The GraphCtrl followed, or NULL.
+    Graph *m_graph;             ///< The graph observed, or NULL.
+
+    /// The bounds of each shown node when last counted.
+    std::unordered_map<const GraphNode*, wxRect> m_nodes;
+
+    wxRect m_grid;              ///< Area covered by the grid.
+    int m_cell;                 ///< Size of a cell in graph units.
+    int m_cols;                 ///< Columns in the grid.
+    int m_rows;                 ///< Rows in the grid.
+    std::vector<wxUint32> m_density; ///< Nodes covering each cell.
+    wxImage m_image;            ///< The grid, one pixel per cell.
+    wxBitmap m_bitmap;          ///< m_image converted for drawing.
+    bool m_stale;               ///< m_bitmap is out of date.
+    bool m_rebuild;             ///< A node lies outside the grid.
+
+    wxRect m_viewport;          ///< The viewport, see UpdateViewport().
+    wxPoint m_viewStart;        ///< Canvas scroll position for m_viewport.
+    double m_viewZoom;          ///< Zoom for m_viewport, 0 to recompute.
+    wxSize m_viewSize;          ///< Canvas client size for m_viewport.
+    wxRect m_extent;            ///< Area shown, in graph coordinates.
+    double m_scale;             ///< Client pixels per graph unit.
+    wxPoint m_offset;           ///< Client position of m_extent.
+    wxSize m_dragOffset;        ///< From the mouse to the viewport centre.
+
+    int m_resolution;           ///< Cells along the longer side.
+    wxColour m_nodeColour;      ///< Colour of a full cell.
+    wxColour m_viewportColour;  ///< Colour of the viewport rectangle.
+
+    DECLARE_EVENT_TABLE()
+    DECLARE_DYNAMIC_CLASS(GraphOverviewCtrl)
+    DECLARE_NO_COPY_CLASS(GraphOverviewCtrl)
+};
+
+} // namespace tt_solutions
+
+#endif // GRAPHOVERVIEW_H
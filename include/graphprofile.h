@@ -0,0 +1,283 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphprofile.h
+// Purpose:     Lightweight timers and counters for profiling the hot paths
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHPROFILE_H
+#define GRAPHPROFILE_H
+
+/**
+ * @file graphprofile.h
+ * @brief Lightweight timers and counters for profiling the hot paths.
+ *
+ * The library times its expensive operations, such as layout, redrawing,
+ * loading and saving, with probes declared by the @c GRAPH_PROFILE_SCOPE
+ * and @c GRAPH_PROFILE_COUNT macros. The probes are always compiled in, but
+ * do nothing more than test a flag until profiling is switched on with
+ * GraphProfiler::Enable() or GraphProfiler::Hold(). The results can then be
+ * read back with GraphProfiler::GetStats(), or written to a trace file which
+ * can be loaded into Chrome's @c about:tracing or Perfetto:
+ *
+ * @code
+ *  GraphProfiler::StartTrace(_T("grapheditor.json"));
+ *  ...
+ *  GraphProfiler::StopTrace();
+ * @endcode
+ *
+ * The probes may only be used from the main thread.
+ */
+
+#include <wx/wx.h>
+#include <wx/cpp.h>
+
+#include <vector>
+
+namespace tt_solutions {
+
+/**
+ * @brief A named timer or counter.
+ *
+ * Probes are normally declared as local statics by the @c
+ * GRAPH_PROFILE_SCOPE and @c GRAPH_PROFILE_COUNT macros, and register
+ * themselves with GraphProfiler when constructed.
+ */
+class GraphProbe
+{
+public:
+    /** @brief The kinds of probe. */
+    enum Kind {
+        Timer,      /**< Times a scope. */
+        Counter     /**< Counts something, e.g. shapes drawn. */
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     * @param name The name, must be a string literal or otherwise outlive
+     * the probe. Names are written "Class::Method" or "Class::Method/phase".
+     * @param kind Timer or Counter.
+     */
+    GraphProbe(const char *name, Kind kind = Timer);
+
+    /** @brief Records a time for a timer, in nanoseconds since @a start. */
+    void AddTime(wxUint64 start, wxUint64 elapsed);
+    /** @brief Adds to a counter. */
+    void AddCount(wxUint64 n = 1) { m_count++; m_total += n; }
+
+    /** @brief The probe's name. */
+    const char *GetName() const { return m_name; }
+    /** @brief Timer or Counter. */
+    Kind GetKind() const { return m_kind; }
+    /** @brief The number of times recorded or the number of additions. */
+    wxUint64 GetCount() const { return m_count; }
+    /** @brief The total time in nanoseconds, or the total count. */
+    wxUint64 GetTotal() const { return m_total; }
+    /** @brief The shortest and longest time recorded, in nanoseconds. */
+    //@{
+    wxUint64 GetMin() const { return m_count ? m_min : 0; }
+    wxUint64 GetMax() const { return m_max; }
+    //@}
+    /** @brief The last time recorded, in nanoseconds. */
+    wxUint64 GetLast() const { return m_last; }
+
+    /** @brief Clears the results. */
+    void Reset();
+
+private:
+    const char *m_name;     ///< The name.
+    Kind m_kind;            ///< Timer or Counter.
+    wxUint64 m_count;       ///< Number of times or additions.
+    wxUint64 m_total;       ///< Total time or count.
+    wxUint64 m_min;         ///< Shortest time.
+    wxUint64 m_max;         ///< Longest time.
+    wxUint64 m_last;        ///< Last time.
+    GraphProbe *m_next;     ///< Next registered probe.
+
+    friend class GraphProfiler;
+
+    DECLARE_NO_COPY_CLASS(GraphProbe)
+};
+
+/**
+ * @brief Controls profiling and gives access to the results of the probes.
+ *
+ * All methods are static.
+ */
+class GraphProfiler
+{
+public:
+    /**
+     * @brief The results of a probe.
+     *
+     * Times are in milliseconds.
+     */
+    struct Stats
+    {
+        wxString name;          ///< The probe's name.
+        GraphProbe::Kind kind;  ///< Timer or Counter.
+        wxUint64 count;         ///< Number of times or additions.
+        double total;           ///< Total time, or total count.
+        double mean;            ///< Mean time.
+        double min;             ///< Shortest time.
+        double max;             ///< Longest time.
+        double last;            ///< Last time.
+    };
+
+    /** @brief A list of results. */
+    typedef std::vector<Stats> StatsList;
+
+    //@{
+    /**
+     * @brief Switches profiling on or off.
+     *
+     * When off, which is the default, the probes don't record anything.
+     * Profiling stays on while it is held by Hold() even if switched off
+     * here, so IsEnabled() can differ from the last Enable().
+     */
+    static void Enable(bool enable = true);
+    static bool IsEnabled() { return sm_enabled; }
+    //@}
+
+    //@{
+    /**
+     * @brief Keeps profiling on until a matching Release().
+     *
+     * Used by tools needing the probes, such as a trace or GraphCtrl's
+     * performance overlay, so that one finishing doesn't switch profiling
+     * off under another still using it. The holds are counted.
+     */
+    static void Hold();
+    static void Release();
+    //@}
+
+    /**
+     * @brief Returns the results of the probes that have recorded something,
+     * sorted by name.
+     */
+    static StatsList GetStats();
+
+    /** @brief Returns a probe by name, or @c NULL if there is none. */
+    static const GraphProbe *Find(const char *name);
+
+    /** @brief Clears the results of all the probes. */
+    static void Reset();
+
+    /**
+     * @brief Holds profiling on and starts writing the timings to a trace
+     * file in Chrome's trace event format.
+     *
+     * The events are buffered and appended to the file every
+     * @a flushMillisecs, also while the application is idle, so the file can
+     * be inspected while the application is running and isn't lost if it
+     * crashes. Counters are written with their totals at each flush. Scopes
+     * that began before the trace aren't written.
+     *
+     * Returns false if the file can't be created.
+     */
+    static bool StartTrace(const wxString& filename, int flushMillisecs = 1000);
+
+    /**
+     * @brief Writes any remaining events and closes the trace file.
+     *
+     * Releases the hold StartTrace() took on profiling.
+     */
+    static void StopTrace();
+
+    /** @brief Returns true if a trace file is being written. */
+    static bool IsTracing() { return sm_tracing; }
+
+    /** @brief Writes the buffered events to the trace file. */
+    static void FlushTrace();
+
+    /** @brief A monotonic time in nanoseconds used for the timings. */
+    static wxUint64 Now();
+
+private:
+    friend class GraphProbe;
+
+    /// Record a timer event for the trace file.
+    static void AddEvent(const GraphProbe& probe,
+                         wxUint64 start,
+                         wxUint64 elapsed);
+
+    /// Set sm_enabled from sm_switchedOn and sm_holds.
+    static void Update() { sm_enabled = sm_switchedOn || sm_holds != 0; }
+
+    static bool sm_enabled;         ///< Profiling on.
+    static bool sm_switchedOn;      ///< Switched on by Enable().
+    static int sm_holds;            ///< Number of Hold()s not released.
+    static bool sm_tracing;         ///< Writing a trace file.
+    static GraphProbe *sm_probes;   ///< The registered probes.
+};
+
+/**
+ * @brief Times a scope with a GraphProbe.
+ *
+ * Normally declared with the @c GRAPH_PROFILE_SCOPE macro. Stop() can be
+ * used to end the timing before the end of the scope, for timing the
+ * successive phases of a function.
+ */
+class GraphProfileScope
+{
+public:
+    /** @brief Starts timing if profiling is enabled. */
+    GraphProfileScope(GraphProbe& probe)
+      : m_probe(GraphProfiler::IsEnabled() ? &probe : NULL),
+        m_start(m_probe ? GraphProfiler::Now() : 0)
+    { }
+
+    /** @brief Records the time. */
+    ~GraphProfileScope() { Stop(); }
+
+    /** @brief Records the time, if it has not already been recorded. */
+    void Stop()
+    {
+        if (m_probe) {
+            m_probe->AddTime(m_start, GraphProfiler::Now() - m_start);
+            m_probe = NULL;
+        }
+    }
+
+private:
+    GraphProbe *m_probe;    ///< The probe or NULL when not timing.
+    wxUint64 m_start;       ///< Start time.
+
+    DECLARE_NO_COPY_CLASS(GraphProfileScope)
+};
+
+} // namespace tt_solutions
+
+/**
+ * @brief Times the rest of the enclosing scope with a probe of the given
+ * name.
+ */
+#define GRAPH_PROFILE_SCOPE(name) \
+    GRAPH_PROFILE_NAMED_SCOPE(wxMAKE_UNIQUE_NAME(graphProfileScope), name)
+
+/**
+ * @brief Times the rest of the enclosing scope with a probe of the given
+ * name, declaring a GraphProfileScope variable @a var whose Stop() method
+ * can end the timing early.
+ */
+#define GRAPH_PROFILE_NAMED_SCOPE(var, name) \
+    static tt_solutions::GraphProbe wxCONCAT(var, Probe)(name); \
+    tt_solutions::GraphProfileScope var(wxCONCAT(var, Probe))
+
+/**
+ * @brief Adds @a n to the counter of the given name.
+ */
+#define GRAPH_PROFILE_COUNT(name, n) \
+    do { \
+        static tt_solutions::GraphProbe graphProfileCounter( \
+            name, tt_solutions::GraphProbe::Counter); \
+        if (tt_solutions::GraphProfiler::IsEnabled()) \
+            graphProfileCounter.AddCount(n); \
+    } while (0)
+
+#endif // GRAPHPROFILE_H
@@ -0,0 +1,112 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphreach.h
+// Purpose:     Cache of the nodes upstream and downstream of graph nodes
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHREACH_H
+#define GRAPHREACH_H
+
+/**
+ * @file graphreach.h
+ * @brief Cache of the nodes upstream and downstream of graph nodes.
+ */
+
+#include "graphalgo.h"
+
+#include <list>
+#include <unordered_set>
+
+namespace tt_solutions {
+
+/**
+ * @brief Caches the sets of nodes reachable from recently queried nodes.
+ *
+ * Get() returns the nodes downstream of a node, i.e. reachable following
+ * its out edges, or upstream of it, following in edges. The most recently
+ * used results are kept, and are maintained incrementally as the graph
+ * changes: a new edge extends the cached sets it leads out of, while
+ * deleting an edge discards only the sets that contained it.
+ *
+ * GraphCtrl uses this to implement its impact highlighting.
+ *
+ * @see GraphCtrl::SetImpactMode()
+ */
+class GraphReachability : public GraphObserver
+{
+public:
+    /** @brief A set of nodes. */
+    typedef std::unordered_set<const GraphNode*> NodeSet;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param graph The graph to follow, may be @c NULL and set later with
+     * SetGraph().
+     * @param capacity The number of results to keep.
+     */
+    GraphReachability(Graph *graph = NULL, size_t capacity = 16);
+    /** @brief Destructor, detaches the cache from its graph. */
+    ~GraphReachability();
+
+    //@{
+    /** @brief The graph whose reachability is cached. */
+    void SetGraph(Graph *graph);
+    Graph *GetGraph() const { return m_graph; }
+    //@}
+
+    /**
+     * @brief Returns the nodes reachable from a node, not including the
+     * node itself unless it is part of a cycle.
+     *
+     * @param node The start node.
+     * @param direction @c Direction_Out for the nodes downstream of @a node
+     * or @c Direction_In for the nodes upstream of it.
+     *
+     * The returned set remains valid until the next call or until the graph
+     * is modified.
+     */
+    const NodeSet& Get(const GraphNode& node, int direction);
+
+    /** @brief Returns true if the result for a query is cached. */
+    bool IsCached(const GraphNode& node, int direction) const;
+
+    /** @brief Discards all the cached results. */
+    void Clear() { m_entries.clear(); }
+
+    /** @cond */
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    void OnGraphCleared();
+    void OnGraphDestroyed();
+    /** @endcond */
+
+private:
+    /// A cached result.
+    struct Entry
+    {
+        const GraphNode *node;      ///< The start node.
+        int direction;              ///< Direction_Out or Direction_In.
+        NodeSet nodes;              ///< The nodes reachable from node.
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    /// Add the nodes reachable from @a start to the entry.
+    static void Extend(Entry& entry, const GraphNode& start);
+
+    Graph *m_graph;             ///< The graph.
+    size_t m_capacity;          ///< Maximum number of entries.
+    EntryList m_entries;        ///< Cached results, most recently used first.
+
+    DECLARE_NO_COPY_CLASS(GraphReachability)
+};
+
+} // namespace tt_solutions
+
+#endif // GRAPHREACH_H
@@ -0,0 +1,180 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphsearch.h
+// Purpose:     Full-text search index over the nodes of a graph
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHSEARCH_H
+#define GRAPHSEARCH_H
+
+/**
+ * @file graphsearch.h
+ * @brief Full-text search index over the nodes of a graph.
+ */
+
+#include "graphctrl.h"
+
+#include <vector>
+#include <unordered_map>
+
+namespace tt_solutions {
+
+/**
+ * @brief A search index over the text attributes of the nodes of a Graph.
+ *
+ * The index is attached to a graph as a GraphObserver and is kept up to date
+ * incrementally as nodes are added, deleted or have their text changed, so
+ * that it can be queried on every key press of a search-as-you-type box:
+ *
+ * @code
+ *  m_search = new GraphSearch(m_graph);
+ *  ...
+ *  GraphSearch::MatchList matches = m_search->Find(m_searchbox->GetValue());
+ *  if (!matches.empty())
+ *      m_graphctrl->ScrollTo(*matches.front().node);
+ * @endcode
+ *
+ * The fields searched are those returned by GraphNode::GetSearchText(), i.e.
+ * the text, tooltip and rank of all nodes and also the result and id of
+ * ProjectNode objects. Matching is case-insensitive and finds the query
+ * anywhere within a field. Queries of three or more characters are answered
+ * from a trigram index, shorter ones by scanning the index's own compact copy
+ * of the text.
+ *
+ * @see GraphNode::GetSearchText()
+ */
+class GraphSearch : public GraphObserver
+{
+public:
+    /** @brief A single search result. */
+    struct Match
+    {
+        GraphNode *node;    ///< The matching node.
+        int field;          ///< The GraphNode::SearchField that matched best.
+        int score;          ///< Rank of the match, higher is better.
+        wxRect bounds;      ///< Bounds of the node in graph coordinates.
+    };
+
+    /** @brief The search results, best first. */
+    typedef std::vector<Match> MatchList;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param graph The graph to index, may be @c NULL and set later with
+     * SetGraph().
+     */
+    GraphSearch(Graph *graph = NULL);
+    /** @brief Destructor, detaches the index from its graph. */
+    ~GraphSearch();
+
+    //@{
+    /**
+     * @brief The graph that is indexed.
+     *
+     * Setting the graph rebuilds the index.
+     */
+    void SetGraph(Graph *graph);
+    Graph *GetGraph() const { return m_graph; }
+    //@}
+
+    //@{
+    /**
+     * @brief The fields that are searched.
+     *
+     * A bit mask with the bit <code>1 << field</code> set for each
+     * GraphNode::SearchField to search. All the fields are searched by
+     * default. Changing the fields rebuilds the index.
+     */
+    void SetFields(int mask);
+    int GetFields() const { return m_fields; }
+    //@}
+
+    /**
+     * @brief Finds the nodes containing the given text.
+     *
+     * Exact matches of a whole field rank highest, followed by matches at
+     * the start of a field, at the start of a word and elsewhere. Among these
+     * the text and id fields are ranked above the others.
+     *
+     * @param query The text to search for, case-insensitively.
+     * @param maxResults The maximum number of results to return.
+     */
+    MatchList Find(const wxString& query, size_t maxResults = 100) const;
+
+    /** @brief Returns the number of nodes in the index. */
+    size_t GetCount() const { return m_slots.size(); }
+
+    /** @brief Reindexes all the nodes of the graph. */
+    void Rebuild();
+
+    /** @cond */
+    void OnNodeAdded(GraphNode& node);
+    void OnElementRemoving(GraphElement& element);
+    void OnNodeTextChanged(GraphNode& node);
+    void OnGraphCleared();
+    void OnGraphDestroyed();
+    /** @endcond */
+
+private:
+    /// Three characters packed into an integer.
+    typedef wxUint64 Trigram;
+
+    /// The indexed data of a single node.
+    struct Entry
+    {
+        Entry() : node(NULL), trigrams(0) { }
+
+        GraphNode *node;    ///< The node or @c NULL if the slot is free.
+        wxString text[GraphNode::Num_SearchFields]; ///< Lower case fields.
+        size_t trigrams;    ///< The number of postings added for the node.
+    };
+
+    /// Slots of the nodes containing a trigram, may contain stale entries.
+    typedef std::vector<wxUint32> Postings;
+    /// The trigram index.
+    typedef std::unordered_map<Trigram, Postings> PostingMap;
+    /// Maps nodes to their slots in m_entries.
+    typedef std::unordered_map<const GraphNode*, wxUint32> SlotMap;
+
+    /// Add a node to the index.
+    void Insert(GraphNode& node);
+    /// Remove a node from the index if it is there.
+    void Remove(const GraphNode& node);
+    /// Add the postings for the node in the given slot.
+    void Index(wxUint32 slot);
+    /// Discard the stale postings.
+    void Compact();
+    /// Remove everything from the index.
+    void Clear();
+
+    /// Append the trigrams of @a text to @a trigrams.
+    static void GetTrigrams(const wxString& text,
+                            std::vector<Trigram>& trigrams);
+
+    /**
+     * Return the score of the best match of @a query in @a entry or 0 if
+     * there is none, storing the best field in @a field.
+     */
+    int Score(const Entry& entry, const wxString& query, int *field) const;
+
+    Graph *m_graph;                 ///< The indexed graph.
+    int m_fields;                   ///< Mask of the fields to index.
+    std::vector<Entry> m_entries;   ///< Indexed nodes by slot.
+    std::vector<wxUint32> m_free;   ///< Unused slots in m_entries.
+    SlotMap m_slots;                ///< Slot of each indexed node.
+    PostingMap m_postings;          ///< The trigram index.
+    size_t m_live;                  ///< Postings of the indexed nodes.
+    size_t m_stale;                 ///< Postings left by removed nodes.
+
+    DECLARE_NO_COPY_CLASS(GraphSearch)
+};
+
+} // namespace tt_solutions
+
+#endif // GRAPHSEARCH_H
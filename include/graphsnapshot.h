@@ -0,0 +1,262 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphsnapshot.h
+// Purpose:     Compact read-only copy of a graph's structure
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHSNAPSHOT_H
+#define GRAPHSNAPSHOT_H
+
+/**
+ * @file graphsnapshot.h
+ * @brief Compact read-only copy of a graph's structure.
+ */
+
+#include "graphctrl.h"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace tt_solutions {
+
+/**
+ * @brief An immutable copy of the structure and geometry of a Graph held in
+ * contiguous arrays.
+ *
+ * Traversing a Graph through its iterators involves following several
+ * pointers for each edge. For analysis of large graphs it is much faster to
+ * take a snapshot first, which numbers the nodes and edges densely from zero
+ * and stores the adjacency of the nodes in compressed sparse row form:
+ *
+ * @code
+ *  GraphSnapshot snap(*graph);
+ *
+ *  for (GraphSnapshot::Index n = 0; n < snap.GetNodeCount(); n++) {
+ *      const GraphSnapshot::Index *i, *end = snap.OutEnd(n);
+ *      for (i = snap.OutBegin(n); i != end; ++i)
+ *          Visit(n, *i);
+ *  }
+ * @endcode
+ *
+ * The snapshot does not follow later changes to the graph, the pointers to
+ * the elements it returns become invalid if they are deleted. To keep a
+ * snapshot of the whole graph up to date cheaply use GraphSnapshotTracker.
+ *
+ * @see GraphSnapshotTracker
+ */
+class GraphSnapshot
+{
+public:
+    /** @brief The dense index of a node or an edge in the snapshot. */
+    typedef wxUint32 Index;
+
+    /** @brief An index value meaning no node or edge. */
+    static const Index npos = ~Index(0);
+
+    /** @brief Constructs an empty snapshot. */
+    GraphSnapshot() { m_outOffset.push_back(0); m_inOffset.push_back(0); }
+
+    /** @brief Constructs a snapshot of all the nodes and edges of a graph. */
+    explicit GraphSnapshot(Graph& graph);
+
+    /**
+     * @brief Constructs a snapshot of a range of nodes and the edges
+     * connecting nodes within the range.
+     */
+    explicit GraphSnapshot(const Graph::node_iterator_pair& range);
+
+    /** @brief Returns the number of nodes. */
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    /** @brief Returns the number of edges. */
+    size_t GetEdgeCount() const { return m_edges.size(); }
+
+    /** @brief Returns the node with the given index. */
+    GraphNode *GetNode(Index n) const { return m_nodes[n]; }
+    /** @brief Returns the index of a node, or @c npos if it isn't present. */
+    Index GetIndex(const GraphNode *node) const;
+
+    /** @brief Returns the edge with the given index. */
+    GraphEdge *GetEdge(Index e) const { return m_edges[e]; }
+    /** @brief Returns the index of the node an edge starts from. */
+    Index GetFrom(Index e) const { return m_from[e]; }
+    /** @brief Returns the index of the node an edge goes to. */
+    Index GetTo(Index e) const { return m_to[e]; }
+
+    //@{
+    /**
+     * @brief The range of the indices of the nodes that the edges leaving
+     * node @a n go to.
+     */
+    const Index *OutBegin(Index n) const { return Data(m_outNodes) + m_outOffset[n]; }
+    const Index *OutEnd(Index n) const { return Data(m_outNodes) + m_outOffset[n + 1]; }
+    //@}
+
+    //@{
+    /**
+     * @brief The range of the indices of the edges leaving node @a n, in the
+     * same order as OutBegin()/OutEnd().
+     */
+    const Index *OutEdgesBegin(Index n) const { return Data(m_outEdges) + m_outOffset[n]; }
+    const Index *OutEdgesEnd(Index n) const { return Data(m_outEdges) + m_outOffset[n + 1]; }
+    //@}
+
+    //@{
+    /**
+     * @brief The range of the indices of the nodes that the edges entering
+     * node @a n come from.
+     */
+    const Index *InBegin(Index n) const { return Data(m_inNodes) + m_inOffset[n]; }
+    const Index *InEnd(Index n) const { return Data(m_inNodes) + m_inOffset[n + 1]; }
+    //@}
+
+    //@{
+    /**
+     * @brief The range of the indices of the edges entering node @a n, in
+     * the same order as InBegin()/InEnd().
+     */
+    const Index *InEdgesBegin(Index n) const { return Data(m_inEdges) + m_inOffset[n]; }
+    const Index *InEdgesEnd(Index n) const { return Data(m_inEdges) + m_inOffset[n + 1]; }
+    //@}
+
+    /** @brief Returns the number of edges leaving a node. */
+    size_t GetOutDegree(Index n) const { return m_outOffset[n + 1] - m_outOffset[n]; }
+    /** @brief Returns the number of edges entering a node. */
+    size_t GetInDegree(Index n) const { return m_inOffset[n + 1] - m_inOffset[n]; }
+
+    //@{
+    /**
+     * @brief The geometry of the nodes, in graph coordinates.
+     *
+     * The arrays are indexed by node index and hold the left, top, width and
+     * height of each node's bounding rectangle.
+     */
+    const int *GetLefts() const { return Data(m_left); }
+    const int *GetTops() const { return Data(m_top); }
+    const int *GetWidths() const { return Data(m_width); }
+    const int *GetHeights() const { return Data(m_height); }
+    //@}
+
+    /** @brief Returns the bounding rectangle of a node. */
+    wxRect GetBounds(Index n) const
+    {
+        return wxRect(m_left[n], m_top[n], m_width[n], m_height[n]);
+    }
+
+private:
+    friend class GraphSnapshotTracker;
+
+    /// Pointer to the elements of a vector, which may be empty.
+    template <class T> static const T *Data(const std::vector<T>& v)
+    {
+        return v.empty() ? NULL : &v[0];
+    }
+
+    /// Add a node, reading its geometry.
+    void AddNode(GraphNode *node);
+    /// Add the edges between the nodes already added.
+    void AddEdges();
+    /// Read the geometry of the node with the given index.
+    void SetGeometry(Index n);
+    /// Build the adjacency arrays from m_from and m_to.
+    void BuildAdjacency();
+
+    typedef std::unordered_map<const GraphNode*, Index> IndexMap;
+
+    std::vector<GraphNode*> m_nodes;    ///< Nodes by index.
+    std::vector<GraphEdge*> m_edges;    ///< Edges by index.
+    IndexMap m_index;                   ///< Index of each node.
+
+    std::vector<Index> m_from;          ///< Source node of each edge.
+    std::vector<Index> m_to;            ///< Target node of each edge.
+
+    std::vector<Index> m_outOffset;     ///< Start of each node's out edges.
+    std::vector<Index> m_outNodes;      ///< Targets of the out edges.
+    std::vector<Index> m_outEdges;      ///< Out edges.
+    std::vector<Index> m_inOffset;      ///< Start of each node's in edges.
+    std::vector<Index> m_inNodes;       ///< Sources of the in edges.
+    std::vector<Index> m_inEdges;       ///< In edges.
+
+    std::vector<int> m_left;            ///< Left of each node.
+    std::vector<int> m_top;             ///< Top of each node.
+    std::vector<int> m_width;           ///< Width of each node.
+    std::vector<int> m_height;          ///< Height of each node.
+};
+
+/**
+ * @brief Maintains a GraphSnapshot of a whole Graph, refreshing it
+ * incrementally.
+ *
+ * The tracker observes the changes made to the graph and applies them to its
+ * snapshot the next time GetSnapshot() is called. Moved nodes just have
+ * their geometry updated in place. Added and removed elements cause the
+ * arrays to be rebuilt from the previous snapshot, which only needs to read
+ * the elements that changed from the graph. If a large part of the graph has
+ * changed the snapshot is simply retaken.
+ *
+ * @see GraphSnapshot
+ */
+class GraphSnapshotTracker : public GraphObserver
+{
+public:
+    /** @brief Constructor. */
+    GraphSnapshotTracker(Graph *graph = NULL);
+    /** @brief Destructor, detaches the tracker from its graph. */
+    ~GraphSnapshotTracker();
+
+    //@{
+    /** @brief The graph that is tracked. */
+    void SetGraph(Graph *graph);
+    Graph *GetGraph() const { return m_graph; }
+    //@}
+
+    /**
+     * @brief Returns the snapshot, first bringing it up to date if the graph
+     * has changed.
+     *
+     * The reference remains valid until the next call.
+     */
+    const GraphSnapshot& GetSnapshot();
+
+    /** @brief Returns true if the graph has changed since the last call to
+     * GetSnapshot(). */
+    bool IsModified() const;
+
+    /** @cond */
+    void OnNodeAdded(GraphNode& node);
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    void OnNodeMoved(GraphNode& node);
+    void OnGraphCleared();
+    void OnGraphDestroyed();
+    /** @endcond */
+
+private:
+    /// Apply the recorded changes to the snapshot.
+    void Refresh();
+    /// Forget the recorded changes.
+    void Reset();
+    /// Record an added element.
+    void Record(GraphElement& element);
+
+    typedef std::unordered_set<const GraphElement*> ElementSet;
+
+    Graph *m_graph;                     ///< The tracked graph.
+    GraphSnapshot m_snapshot;           ///< The snapshot.
+    bool m_rebuild;                     ///< The snapshot must be retaken.
+    std::vector<GraphElement*> m_added; ///< Added elements, in order.
+    ElementSet m_addedSet;              ///< Added elements still present.
+    ElementSet m_removed;               ///< Removed elements of m_snapshot.
+    std::unordered_set<GraphNode*> m_moved; ///< Moved nodes.
+
+    DECLARE_NO_COPY_CLASS(GraphSnapshotTracker)
+};
+
+} // namespace tt_solutions
+
+#endif // GRAPHSNAPSHOT_H
@@ -0,0 +1,196 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphtrace.h
+// Purpose:     Recording and replaying of interaction with a GraphCtrl
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPHTRACE_H
+#define GRAPHTRACE_H
+
+/**
+ * @file graphtrace.h
+ * @brief Recording and replaying of interaction with a GraphCtrl.
+ *
+ * The slow interactions, dragging a large selection, connecting, zooming
+ * with the wheel or rubber-banding, depend on the graph and on exactly what
+ * the user did, so they are hard to reproduce by hand. A GraphTrace captures
+ * both: the graph as it was when recording started and the mouse, wheel and
+ * key events that followed, with their times. Replaying it re-injects the
+ * events into a GraphCtrl and times the handling of each one, so that a real
+ * session can be used as a regression test:
+ *
+ * @code
+ *  GraphTrace trace;
+ *  m_graphctrl->StartRecording(trace);
+ *  ...
+ *  m_graphctrl->StopRecording();
+ *  wxFFileOutputStream out(_T("session.trace"));
+ *  trace.Save(out);
+ * @endcode
+ *
+ * The bench target replays a saved trace with
+ * <code>graphbench --bench=replay --trace=session.trace</code>.
+ *
+ * @see GraphCtrl::StartRecording() @n GraphCtrl::Replay()
+ */
+
+#include <wx/wx.h>
+#include <wx/stream.h>
+
+#include <vector>
+
+namespace tt_solutions {
+
+class Graph;
+
+/**
+ * @brief A recorded session of interaction with a GraphCtrl.
+ *
+ * Holds the graph as it was when the recording started, the size, zoom and
+ * scroll position of the view, and the list of events. Saved traces are
+ * archives, the same format as Graph::Serialise() writes with an extra item
+ * for the view and the events, so a trace can also be opened as a graph.
+ */
+class GraphTrace
+{
+public:
+    /** @brief The kinds of event recorded. */
+    enum EventType {
+        Mouse_Motion,       /**< Mouse moved, possibly dragging. */
+        Mouse_LeftDown,     /**< Left button pressed. */
+        Mouse_LeftUp,       /**< Left button released. */
+        Mouse_LeftDClick,   /**< Left button double clicked. */
+        Mouse_MiddleDown,   /**< Middle button pressed. */
+        Mouse_MiddleUp,     /**< Middle button released. */
+        Mouse_MiddleDClick, /**< Middle button double clicked. */
+        Mouse_RightDown,    /**< Right button pressed. */
+        Mouse_RightUp,      /**< Right button released. */
+        Mouse_RightDClick,  /**< Right button double clicked. */
+        Mouse_Wheel,        /**< Wheel turned. */
+        Mouse_Enter,        /**< Mouse entered the canvas. */
+        Mouse_Leave,        /**< Mouse left the canvas. */
+        Key_Down,           /**< Key pressed. */
+        Key_Up,             /**< Key released. */
+        Key_Char,           /**< Character generated. */
+        Event_Max
+    };
+
+    /** @brief Flags for the state of the buttons and modifier keys. */
+    enum StateFlags {
+        State_Left    = 0x01,   /**< Left button down. */
+        State_Middle  = 0x02,   /**< Middle button down. */
+        State_Right   = 0x04,   /**< Right button down. */
+        State_Shift   = 0x08,   /**< Shift key down. */
+        State_Control = 0x10,   /**< Control key down. */
+        State_Alt     = 0x20,   /**< Alt key down. */
+        State_Meta    = 0x40    /**< Meta key down. */
+    };
+
+    /** @brief A recorded mouse, wheel or key event. */
+    struct Event
+    {
+        Event() : type(Mouse_Motion), time(0), state(0), param1(0), param2(0)
+        { }
+
+        EventType type;     ///< What happened.
+        wxUint64 time;      ///< Nanoseconds since the recording started.
+        wxPoint pos;        ///< Position in the canvas's client coordinates.
+        int state;          ///< Combination of StateFlags.
+        int param1;         ///< Wheel rotation, or key code.
+        int param2;         ///< Wheel delta, or Unicode character.
+
+        /** @brief True for the key events, false for the mouse events. */
+        bool IsKey() const { return type >= Key_Down; }
+
+        /**
+         * @brief Fills in the event from a wxMouseEvent or a wxKeyEvent.
+         *
+         * Returns false for any other event, or for a kind of mouse event
+         * that isn't recorded.
+         */
+        bool Set(const wxEvent& event, wxUint64 time);
+
+        /** @brief Makes the wxMouseEvent recorded by a mouse event. */
+        void Get(wxMouseEvent& event) const;
+        /** @brief Makes the wxKeyEvent recorded by a key event. */
+        void Get(wxKeyEvent& event) const;
+
+        /** @brief The name used for the type in saved traces. */
+        static const char *GetTypeName(EventType type);
+    };
+
+    /** @brief A list of events, in the order they happened. */
+    typedef std::vector<Event> EventList;
+
+    /**
+     * @brief Times taken to replay an event, in nanoseconds.
+     *
+     * @see GraphCtrl::Replay()
+     */
+    struct Timing
+    {
+        Timing() : handler(0), update(0) { }
+
+        wxUint64 handler;   ///< Processing the event itself.
+        wxUint64 update;    ///< The idle processing and painting after it.
+    };
+
+    /** @brief A list of timings, one for each event replayed. */
+    typedef std::vector<Timing> TimingList;
+
+    GraphTrace();
+
+    /** @brief Empties the trace. */
+    void Clear();
+
+    //@{
+    /**
+     * @brief The graph as it was when the recording started.
+     *
+     * SetGraph() serialises @a graph into the trace, RestoreGraph() replaces
+     * the contents of @a graph with it. Both return false on failure.
+     */
+    bool SetGraph(Graph& graph);
+    bool RestoreGraph(Graph& graph) const;
+    //@}
+
+    //@{
+    /**
+     * @brief The view when the recording started: the size of the canvas,
+     * the zoom percentage and the centre of the view in graph coordinates.
+     */
+    void SetView(const wxSize& size, double zoom, const wxPoint& centre);
+    wxSize GetViewSize() const { return m_size; }
+    double GetZoom() const { return m_zoom; }
+    wxPoint GetViewCentre() const { return m_centre; }
+    //@}
+
+    //@{
+    /** @brief The recorded events. */
+    void AddEvent(const Event& event) { m_events.push_back(event); }
+    const EventList& GetEvents() const { return m_events; }
+    size_t GetEventCount() const { return m_events.size(); }
+    //@}
+
+    //@{
+    /** @brief Save or load the trace. Return false on failure. */
+    bool Save(wxOutputStream& stream) const;
+    bool Load(wxInputStream& stream);
+    //@}
+
+private:
+    wxMemoryBuffer m_graph;     ///< The serialised graph.
+    wxSize m_size;              ///< Size of the canvas.
+    double m_zoom;              ///< Zoom percentage.
+    wxPoint m_centre;           ///< Centre of the view.
+    EventList m_events;         ///< The events.
+};
+
+} // namespace tt_solutions
+
+#endif // GRAPHTRACE_H
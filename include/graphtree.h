@@ -21,14 +21,102 @@
 #include <wx/treectrl.h>
 #include <wx/dragimag.h>
 
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace tt_solutions {
 
+namespace impl
+{
+    class IconLoader;
+}
+
+/**
+ * @brief Supplies the entries of a GraphTreeCtrl on demand.
+ *
+ * The entries form a tree identified by ids chosen by the provider, with
+ * RootId for the root. The control only asks for the children of an entry
+ * when it is first expanded, so a catalogue of any size costs no more at
+ * startup than its top level.
+ *
+ * Entries naming the same icon share one image in the control's image
+ * list. Icons are loaded by LoadIcon() on a worker thread, and the items
+ * are shown without an image until theirs is ready.
+ *
+ * @see GraphTreeCtrl::SetProvider()
+ */
+class GraphTreeProvider
+{
+public:
+    /// Identifies an entry.
+    typedef size_t Id;
+    /// A list of entries.
+    typedef std::vector<Id> IdList;
+
+    /// The id of the root entry.
+    static const Id RootId;
+    /// An id that identifies no entry.
+    static const Id NoId;
+
+    virtual ~GraphTreeProvider() { }
+
+    /// Append the children of the entry @a parent to @a children, in order.
+    virtual void GetChildren(Id parent, IdList& children) const = 0;
+
+    /// The text of an entry.
+    virtual wxString GetText(Id id) const = 0;
+
+    /**
+     * @brief Whether an entry is a category.
+     *
+     * Categories are shown with an expansion button before their children
+     * are created. Only entries that are not categories can be dragged.
+     */
+    virtual bool HasChildren(Id id) const = 0;
+
+    /**
+     * @brief The name of the icon of an entry, passed to LoadIcon(), or
+     * empty for none.
+     */
+    virtual wxString GetIconName(Id) const { return wxEmptyString; }
+
+    /**
+     * @brief Load the icon with the given name.
+     *
+     * This is called on a worker thread, so it must not use GUI objects
+     * other than wxImage, nor anything the main thread changes. The image
+     * is scaled to fit the image list if needed.
+     */
+    virtual wxImage LoadIcon(const wxString&) const { return wxImage(); }
+
+    /**
+     * @brief The client data for the tree item of an entry, or NULL.
+     *
+     * The tree control takes ownership of the data.
+     */
+    virtual wxTreeItemData *CreateItemData(Id) const { return NULL; }
+};
+
 /**
  * @brief Tree control with items that can be dragged onto a GraphCtrl
  * to create new nodes.
  *
  * Dropping a node fires the event <code>#EVT_GRAPHTREE_DROP</code>.
  *
+ * The items can be added with the usual wxTreeCtrl methods, or, for large
+ * palettes, created lazily from a GraphTreeProvider. For example:
+ *
+ * @code
+ *  m_tree->SetProvider(&m_palette);
+ *  ...
+ *  void MyFrame::OnSearch(wxCommandEvent& event)
+ *  {
+ *      m_tree->SetFilter(event.GetString());
+ *  }
+ * @endcode
+ *
  * @see GraphTreeEvent
  */
 class GraphTreeCtrl : public wxTreeCtrl
@@ -49,6 +137,46 @@ public:
         Init();
     }
 
+    ~GraphTreeCtrl();
+
+    //@{
+    /**
+     * @brief The provider the items are created from, or NULL.
+     *
+     * Setting a provider replaces all the items with its top level entries,
+     * and the children of each item are created when it is first expanded.
+     * Unsetting it deletes all the items. If the control has no image list,
+     * one of 16x16 images is created for the icons. The provider must
+     * outlive the control or be unset first.
+     */
+    void SetProvider(GraphTreeProvider *provider);
+    GraphTreeProvider *GetProvider() const { return m_provider; }
+    //@}
+
+    /**
+     * @brief The provider's entry for an item, or GraphTreeProvider::NoId if
+     * it was not created from the provider.
+     */
+    GraphTreeProvider::Id GetEntry(const wxTreeItemId& item) const;
+
+    //@{
+    /**
+     * @brief Show only the entries whose text contains @a text, ignoring
+     * case, with the categories leading to them.
+     *
+     * The children of a category that matches are all shown. When the text
+     * extends the previous filter, as when typing, only the entries that
+     * matched before are tested again. The categories holding matches are
+     * expanded while the tree stays small. An empty string shows
+     * everything. Has no effect without a provider.
+     */
+    void SetFilter(const wxString& text);
+    wxString GetFilter() const { return m_filter; }
+    //@}
+
+    /// Create the children of a lazily populated item before expanding it.
+    void Expand(const wxTreeItemId& item);
+
     /**
      * @brief Override base class function to avoid auto scrolling.
      *
@@ -66,16 +194,71 @@ public:
     /// Event handler for dragging end event.
     void OnLeftButtonUp(wxMouseEvent& event);
 
+    /// Creates the children of an item from the provider.
+    void OnItemExpanding(wxTreeEvent& event);
+
+    /// Forgets the entry of an item deleted.
+    void OnDeleteItem(wxTreeEvent& event);
+
+    /// Shows the icons loaded since the last idle event.
+    void OnIdle(wxIdleEvent& event);
+
     /// Default name for GraphTreeCtrl objects.
     static const wxChar DefaultName[];
 
 private:
     /// Common part of all ctors.
-    void Init() { m_dragImg = NULL; }
+    void Init() { m_dragImg = NULL; m_provider = NULL; m_loader = NULL; }
+
+    typedef GraphTreeProvider::Id Id;
+    typedef GraphTreeProvider::IdList IdList;
+
+    /// Replace the items with the provider's top level entries.
+    void Repopulate();
+
+    /// Create the children of @a item if it has none yet.
+    void Populate(const wxTreeItemId& item);
+
+    /// Append an item for the entry @a id to @a parent.
+    wxTreeItemId AppendEntry(const wxTreeItemId& parent, Id id);
+
+    /// Expand the categories holding matches while there are few items.
+    void ExpandMatches();
+
+    /**
+     * The children of @a parent shown, those matching if filtered, or from
+     * @a old if given and refining the previous filter.
+     */
+    void GetShown(Id parent, IdList& children,
+                  const std::unordered_map<Id, IdList> *old = NULL) const;
+
+    /// Record the matches under @a parent, returning whether there are any.
+    bool Filter(Id parent, const std::unordered_map<Id, IdList> *old);
+
+    /// The image index for an icon, requesting it if not loaded yet.
+    int GetImage(const wxString& name);
+
+    /// Value of m_images for an icon still loading.
+    enum { Loading = -2 };
+
+    /// Items waiting for an icon, with the entry each was created for.
+    typedef std::vector<std::pair<wxTreeItemId, Id> > WaitList;
 
     wxDragImage *m_dragImg;     ///< Drag image for item being dragged.
     wxTreeItemId m_dragItem;    ///< The item being currently dragged.
 
+    GraphTreeProvider *m_provider;  ///< The items' provider, or NULL.
+    impl::IconLoader *m_loader;     ///< Loads icons on a worker thread.
+
+    /// The provider's entry for each item created from it.
+    std::unordered_map<wxTreeItemIdValue, Id> m_items;
+    /// The children shown under each entry while filtered, absent for all.
+    std::unordered_map<Id, IdList> m_matches;
+    wxString m_filter;          ///< The filter, in lower case.
+
+    std::map<wxString, int> m_images;       ///< Image index of each icon.
+    std::map<wxString, WaitList> m_waiting; ///< Items for icons loading.
+
     DECLARE_EVENT_TABLE()
     DECLARE_DYNAMIC_CLASS(GraphTreeCtrl)
     DECLARE_NO_COPY_CLASS(GraphTreeCtrl)
@@ -81,6 +81,14 @@ public:
     void SetIcon(const wxIcon& icon);
     //@}
 
+    /**
+     * @brief Returns the text of one of the node's searchable attributes.
+     *
+     * In addition to the fields handled by GraphNode, returns the result
+     * label and the id.
+     */
+    wxString GetSearchText(int field) const;
+
     /**
      * @brief Save or load this node's attributes.
      *
@@ -89,6 +97,8 @@ public:
      */
     bool Serialise(tt_solutions::Archive::Item& arc);
 
+    void GetMemoryUsage(tt_solutions::GraphMemoryUsage& usage) const;
+
     /**
      * @brief Indicates what part of the node is at the given point, for
      * example the text label or image.
@@ -159,6 +169,8 @@ protected:
      */
     int GetSpacing() const;
 
+    bool IsPlainDrawn() const;
+
 private:
     /// Bring the Pixels coordinates type into this class scope.
     typedef tt_solutions::Pixels Pixels;
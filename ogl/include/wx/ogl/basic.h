@@ -12,6 +12,10 @@
 #ifndef _OGL_BASIC_H_
 #define _OGL_BASIC_H_
 
+#include <map>
+
+#include "wx/ogl/pool.h"
+
 #define OGL_VERSION     2.0
 
 #ifndef DEFAULT_MOUSE_TOLERANCE
@@ -108,6 +112,7 @@ class wxShape;
 class WXDLLIMPEXP_OGL wxShapeEvtHandler: public wxObject, public wxClientDataContainer
 {
  DECLARE_DYNAMIC_CLASS(wxShapeEvtHandler)
+ DECLARE_OGL_POOLED_ALLOC()
 
  public:
   wxShapeEvtHandler(wxShapeEvtHandler *prev = NULL, wxShape *shape = NULL);
@@ -304,6 +309,15 @@ class WXDLLIMPEXP_OGL wxShape: public wxShapeEvtHandler
   // Return the zero-based position in m_lines of line.
   int GetLinePosition(wxLineShape* line);
 
+  // Find the position of a line amongst the lines at the same attachment
+  // point, and the number of them. Positions are cached, and recounted in
+  // one pass over m_lines after lines are added or removed or their
+  // attachments change.
+  void GetLineOrder(wxLineShape* line, bool incoming, int *nth, int *noArcs);
+
+  // Call after modifying GetLines() directly, e.g. to reorder it.
+  inline void InvalidateLineOrder() { m_lineOrderValid = false; }
+
   void AddText(const wxString& string);
 
   inline wxPen *GetPen() const { return wx_const_cast(wxPen*, m_pen); }
@@ -397,6 +411,9 @@ class WXDLLIMPEXP_OGL wxShape: public wxShapeEvtHandler
   // Apply an attachment ordering change
   void ApplyAttachmentOrdering(wxList& ordering);
 
+  // Recount the positions of the lines at each attachment point
+  void UpdateLineOrder();
+
   // Can override this to prevent or intercept line reordering.
   virtual void OnChangeAttachment(int attachment, wxLineShape* line, wxList& ordering);
 
@@ -535,6 +552,11 @@ class WXDLLIMPEXP_OGL wxShape: public wxShapeEvtHandler
   int                   m_branchStemLength;
   int                   m_branchSpacing;
   long                  m_branchStyle;
+
+  // Number of lines at each attachment point, see GetLineOrder
+  std::map<int, int>    m_attachmentLineCounts;
+  size_t                m_lineOrderCount;   // Size of m_lines when counted
+  bool                  m_lineOrderValid;
 };
 
 class WXDLLIMPEXP_OGL wxPolygonShape: public wxShape
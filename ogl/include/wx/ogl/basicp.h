@@ -122,6 +122,7 @@ public:
 class WXDLLIMPEXP_OGL wxShapeRegion: public wxObject
 {
  DECLARE_DYNAMIC_CLASS(wxShapeRegion)
+ DECLARE_OGL_POOLED_ALLOC()
 
  public:
   // Constructor
@@ -12,6 +12,7 @@
 #ifndef _OGL_COMPOSIT_H_
 #define _OGL_COMPOSIT_H_
 
+#include <vector>
 
 class WXDLLIMPEXP_OGL wxDivisionShape;
 class WXDLLIMPEXP_OGL wxOGLConstraint;
@@ -65,9 +66,18 @@ public:
   // in case it had to find it recursively.
   wxOGLConstraint *FindConstraint(long id, wxCompositeShape **actualComposite = NULL);
 
-  // Returns true if something changed
+  // Returns true if something changed. Only evaluates the constraints
+  // whose shapes have moved or resized since they were last evaluated,
+  // after the constraints that position their constraining objects.
   bool Constrain();
 
+  // Put the constraints in the order Constrain evaluates them
+  void SortConstraints();
+
+  // Call after modifying GetConstraints() or the shapes of a constraint
+  // directly.
+  inline void InvalidateConstraintOrder() { m_constraintOrderValid = false; }
+
   // Make this composite into a container by creating one wxDivisionShape
   void MakeContainer();
 
@@ -94,6 +104,10 @@ protected:
   double             m_oldY;
   wxList            m_constraints;
   wxList            m_divisions; // In case it's a container
+
+  // The constraints sorted by SortConstraints
+  std::vector<wxOGLConstraint*> m_constraintOrder;
+  bool              m_constraintOrderValid;
 };
 
 /*
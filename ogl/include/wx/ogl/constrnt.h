@@ -12,6 +12,7 @@
 #ifndef _OGL_CONSTRNT_H_
 #define _OGL_CONSTRNT_H_
 
+#include <vector>
 
 /*
  * OGL Constraints
@@ -70,6 +71,15 @@ class WXDLLIMPEXP_OGL wxOGLConstraint: public wxObject
   inline void SetSpacing(double x, double y) { m_xSpacing = x; m_ySpacing = y; };
   bool Equals(double a, double b);
 
+  // Returns true if the position or size of any of the shapes involved
+  // has changed since SaveInputs was last called, i.e. if Evaluate could
+  // move anything.
+  bool InputsChanged();
+  // Remember the position and size of the shapes involved.
+  void SaveInputs();
+  // Forget them, so that InputsChanged returns true.
+  inline void Invalidate() { m_inputs.clear(); }
+
   double         m_xSpacing;
   double         m_ySpacing;
   int           m_constraintType;
@@ -78,6 +88,11 @@ class WXDLLIMPEXP_OGL wxOGLConstraint: public wxObject
   wxShape*      m_constrainingObject;
   wxList        m_constrainedObjects;
 
+ private:
+  void GetInputs(std::vector<double>& inputs);
+
+  std::vector<double> m_inputs;   // Saved by SaveInputs
+
 };
 
 void OGLInitializeConstraintTypes();
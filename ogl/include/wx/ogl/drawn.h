@@ -18,6 +18,7 @@
 #define oglMETAFLAGS_ATTACHMENTS     2
 
 class WXDLLIMPEXP_OGL wxDrawnShape;
+class WXDLLIMPEXP_OGL wxXMetaFile;
 class WXDLLIMPEXP_OGL wxPseudoMetaFile: public wxObject
 {
  DECLARE_DYNAMIC_CLASS(wxPseudoMetaFile)
@@ -28,6 +29,34 @@ class WXDLLIMPEXP_OGL wxPseudoMetaFile: public wxObject
 
   void Draw(wxDC& dc, double xoffset, double yoffset);
 
+  // Flatten m_ops into the compiled command buffer used by Draw. Called
+  // lazily; does nothing if the buffer is up to date.
+  void Compile();
+
+  // Mark the compiled buffer stale. Call this after changing the ops
+  // returned by GetOps() in place; appending ops is detected automatically.
+  inline void Invalidate() { m_compiled = false; }
+
+  // Hash of the compiled buffer, equal for metafiles that draw the same
+  // thing, so that renderings can be cached against it and shared.
+  wxUint64 GetFingerprint();
+
+  // Changes whenever the compiled buffer is rebuilt, so that a shape can
+  // cheaply check that its cached rendering is still current.
+  unsigned long GetRevision();
+
+  // Does this draw exactly what another metafile draws? Confirms a match
+  // of fingerprints, which can collide.
+  bool DrawsSameAs(wxPseudoMetaFile& other);
+
+  // Can a rasterised copy be drawn in place of the metafile? Not for text
+  // and arcs, whose bounds GetBounds() does not know, nor for splines,
+  // which are drawn without the offset.
+  bool IsCacheable();
+
+  // Widest pen used by the metafile, for padding rasterised copies.
+  int GetMaxPenWidth();
+
   void Clear();
 
   void Copy(wxPseudoMetaFile& copy);
@@ -39,8 +68,13 @@ class WXDLLIMPEXP_OGL wxPseudoMetaFile: public wxObject
   // Rotate about the given axis by theta radians from the x axis.
   void Rotate(double x, double y, double theta);
 
+  // Parsed files are cached by path and modification time, so loading
+  // the same symbol again only copies its operations.
   bool LoadFromMetaFile(const wxString& filename, double *width, double *height);
 
+  // Convert the records of a parsed metafile into operations, appending them.
+  void AddMetaFileRecords(const wxXMetaFile& metaFile);
+
   void GetBounds(double *minX, double *minY, double *maxX, double *maxY);
 
   // Calculate size from current operations
@@ -112,6 +146,23 @@ public:
   std::vector<int>  m_outlineColours; // All the GDI operations that comprise the outline
   std::vector<int>  m_fillColours; // All of the GDI operations that fill the shape
   double            m_currentRotation;
+
+private:
+  wxUint64 Fingerprint() const;
+
+  // Compiled form of m_ops, one entry per op in each of the m_cmd arrays.
+  std::vector<int>             m_cmdOps;     // DRAWOP_* code
+  std::vector<int>             m_cmdFirst;   // Index into m_cmdCoords or m_cmdPoints
+  std::vector<int>             m_cmdParam;   // Point count, GDI override, RGB or mode
+  std::vector<const wxObject*> m_cmdObjects; // Resolved pen, brush or font; text op
+  std::vector<double>          m_cmdCoords;  // x1, y1, x2, y2, x3, y3, radius
+  std::vector<wxPoint>         m_cmdPoints;  // Rounded polyline/polygon/spline points
+  size_t                       m_compiledOps;
+  int                          m_maxPenWidth;
+  wxUint64                     m_fingerprint;
+  unsigned long                m_revision;   // Count of compilations
+  bool                         m_compiled;
+  bool                         m_cacheable;
 };
 
 #define oglDRAWN_ANGLE_0        0
@@ -187,12 +238,25 @@ class WXDLLIMPEXP_OGL wxDrawnShape: public wxRectangleShape
 
   inline int GetAngle() const { return m_currentAngle; }
 
+  // Draw from a bitmap rendered once per size, rotation and zoom instead
+  // of replaying the metafile on every paint. On by default; only used
+  // for window and memory DCs.
+  inline void SetBitmapCaching(bool cache) { m_bitmapCaching = cache; InvalidateBitmapCache(); }
+  inline bool GetBitmapCaching() const { return m_bitmapCaching; }
+
+  inline void InvalidateBitmapCache() { m_cacheBitmap = wxNullBitmap; }
+
 // Implementation
 protected:
   // Which metafile do we use now? Based on current rotation and validity
   // of metafiles.
   int DetermineMetaFile(double rotation);
 
+  // Blit the cached rendering of the current metafile, re-rendering it
+  // first if stale. Returns false if the metafile must be drawn directly.
+  bool DrawFromCache(wxDC& dc);
+  bool RenderCache(double zoomX, double zoomY, double fracX, double fracY);
+
 private:
   // One metafile for each 90 degree rotation (or just a single one).
   wxPseudoMetaFile      m_metafiles[4];
@@ -203,7 +267,36 @@ private:
 
   // Which angle are we using/drawing into?
   int                   m_currentAngle;
+
+  // Rasterised current metafile, shared with other shapes drawing the
+  // same symbol, and what it was rendered for.
+  bool                  m_bitmapCaching;
+  wxBitmap              m_cacheBitmap;
+  int                   m_cacheAngle;
+  unsigned long         m_cacheRevision; // Of the metafile at m_cacheAngle
+  wxPen                 m_cachePen;     // Copies of m_pen and m_brush
+  wxBrush               m_cacheBrush;
+  double                m_cacheZoomX;
+  double                m_cacheZoomY;
+  double                m_cacheFracX;
+  double                m_cacheFracY;
+  int                   m_cacheOriginX; // Metafile origin within the bitmap
+  int                   m_cacheOriginY;
 };
 
+void OGLCleanUpMetaFileCache();
+
+// The caches looked up by wxDrawnShape, for wxOGLCacheProbe
+enum
+{
+  oglCACHE_SYMBOLS,     // Parsed metafiles, by path and modification time
+  oglCACHE_RENDERINGS   // Rendered bitmaps shared between shapes
+};
+
+// Called on each lookup in the caches with whether it found its entry, to
+// let an application profile them. NULL, the default, for none.
+typedef void (*wxOGLCacheProbe)(int cache, bool hit);
+void OGLSetCacheProbe(wxOGLCacheProbe probe);
+
 #endif
     // _DRAWN_H_
@@ -0,0 +1,135 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        geometry.h
+// Purpose:     Batch geometry kernels over rectangle and segment buffers
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OGL_GEOMETRY_H_
+#define _OGL_GEOMETRY_H_
+
+#include <vector>
+
+// Rectangles stored as structure of arrays, one array per edge, so that the
+// kernels below can test several at once. Rectangles are half open, like
+// wxRect: a point on the right or bottom edge is outside.
+class WXDLLIMPEXP_OGL wxOGLRectBuffer
+{
+ public:
+  inline void Clear() { m_left.clear(); m_top.clear(); m_right.clear(); m_bottom.clear(); }
+  void Reserve(size_t n);
+
+  inline void Add(double left, double top, double right, double bottom)
+  {
+    m_left.push_back(left);
+    m_top.push_back(top);
+    m_right.push_back(right);
+    m_bottom.push_back(bottom);
+  }
+  inline void Add(const wxRect& rect)
+  { Add(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height); }
+
+  inline size_t GetCount() const { return m_left.size(); }
+  inline bool IsEmpty() const { return m_left.empty(); }
+
+  inline const double *GetLefts() const { return m_left.empty() ? NULL : &m_left[0]; }
+  inline const double *GetTops() const { return m_top.empty() ? NULL : &m_top[0]; }
+  inline const double *GetRights() const { return m_right.empty() ? NULL : &m_right[0]; }
+  inline const double *GetBottoms() const { return m_bottom.empty() ? NULL : &m_bottom[0]; }
+
+  // Rectangle i as a wxRect, its edges truncated to integers.
+  inline wxRect GetRect(size_t i) const
+  {
+    return wxRect(int(m_left[i]), int(m_top[i]),
+                  int(m_right[i] - m_left[i]), int(m_bottom[i] - m_top[i]));
+  }
+
+ private:
+  std::vector<double> m_left;
+  std::vector<double> m_top;
+  std::vector<double> m_right;
+  std::vector<double> m_bottom;
+};
+
+// Line segments from (x1, y1) to (x2, y2), stored as structure of arrays.
+class WXDLLIMPEXP_OGL wxOGLSegmentBuffer
+{
+ public:
+  inline void Clear() { m_x1.clear(); m_y1.clear(); m_x2.clear(); m_y2.clear(); }
+  void Reserve(size_t n);
+
+  inline void Add(double x1, double y1, double x2, double y2)
+  {
+    m_x1.push_back(x1);
+    m_y1.push_back(y1);
+    m_x2.push_back(x2);
+    m_y2.push_back(y2);
+  }
+
+  inline size_t GetCount() const { return m_x1.size(); }
+  inline bool IsEmpty() const { return m_x1.empty(); }
+
+  inline const double *GetX1s() const { return m_x1.empty() ? NULL : &m_x1[0]; }
+  inline const double *GetY1s() const { return m_y1.empty() ? NULL : &m_y1[0]; }
+  inline const double *GetX2s() const { return m_x2.empty() ? NULL : &m_x2[0]; }
+  inline const double *GetY2s() const { return m_y2.empty() ? NULL : &m_y2[0]; }
+
+ private:
+  std::vector<double> m_x1;
+  std::vector<double> m_y1;
+  std::vector<double> m_x2;
+  std::vector<double> m_y2;
+};
+
+// Kernels testing one point, rectangle or segment against a buffer of many.
+// They use AVX when compiled for it (e.g. -mavx), otherwise SSE2 where it
+// is available, which is always on x86-64, and otherwise plain C++. Define
+// wxOGL_NO_SIMD to force the plain code. All give the same results.
+class WXDLLIMPEXP_OGL wxOGLGeometry
+{
+ public:
+  // Search backwards from index 'end' (exclusive) for the last rectangle
+  // that touches the closed rectangle given, i.e. overlaps it or shares an
+  // edge. Returns its index, or -1 if there is none.
+  static int FindLastTouching(const wxOGLRectBuffer& rects, size_t end,
+                              double left, double top, double right, double bottom);
+
+  // Set flags[i] to 1 if rectangle i, grown by 'grow' on every side,
+  // overlaps the half open rectangle given, otherwise to 0. An empty query
+  // rectangle overlaps nothing. Returns the number overlapping.
+  static size_t FindOverlapping(const wxOGLRectBuffer& rects,
+                                double left, double top, double right, double bottom,
+                                unsigned char *flags, double grow = 0);
+
+  // The bounding box of the non-empty rectangles. Returns false if there
+  // are none.
+  static bool GetBounds(const wxOGLRectBuffer& rects,
+                        double *left, double *top, double *right, double *bottom);
+
+  // Intersect the line (x1, y1) -> (x2, y2) with n segments given as arrays
+  // of their start and end points. ratios[i], if ratios isn't NULL, gets the
+  // proportion along the line at which it hits segment i, or 1.0 if it
+  // doesn't, exactly as oglCheckLineIntersection's ratio1. Returns the
+  // smallest ratio, 1.0 for no hit.
+  static double IntersectSegments(double x1, double y1, double x2, double y2,
+                                  const double *x3, const double *y3,
+                                  const double *x4, const double *y4,
+                                  size_t n, double *ratios = NULL);
+
+  // As above for the segments [first, last) of a buffer.
+  static double IntersectSegments(double x1, double y1, double x2, double y2,
+                                  const wxOGLSegmentBuffer& segments,
+                                  size_t first, size_t last,
+                                  double *ratios = NULL);
+
+  // The instruction set the kernels were compiled for: "avx", "sse2" or
+  // "scalar".
+  static const char *GetInstructionSet();
+};
+
+#endif
+    // _OGL_GEOMETRY_H_
@@ -84,11 +84,57 @@ class WXDLLIMPEXP_OGL wxArrowHead: public wxObject
   long              m_id;               // identifier
 };
 
+// The points of a line, held contiguously. Most lines have two points,
+// so a few are stored inline and only longer routes allocate.
+class WXDLLIMPEXP_OGL wxLinePoints
+{
+ public:
+  wxLinePoints();
+  wxLinePoints(const wxLinePoints& copy);
+  ~wxLinePoints();
+  wxLinePoints& operator=(const wxLinePoints& copy);
+
+  inline size_t GetCount() const { return m_count; }
+  inline bool IsEmpty() const { return m_count == 0; }
+
+  inline wxRealPoint& Item(size_t i) { wxASSERT(i < m_count); return m_points[i]; }
+  inline const wxRealPoint& Item(size_t i) const { wxASSERT(i < m_count); return m_points[i]; }
+  inline wxRealPoint& operator[](size_t i) { return Item(i); }
+  inline const wxRealPoint& operator[](size_t i) const { return Item(i); }
+  inline wxRealPoint& GetFirst() { return Item(0); }
+  inline wxRealPoint& GetLast() { return Item(m_count - 1); }
+
+  // The points as an array, invalidated when points are added or removed.
+  inline wxRealPoint *GetData() { return m_points; }
+  inline const wxRealPoint *GetData() const { return m_points; }
+
+  // Resize, setting any new points to 'pt'.
+  void SetCount(size_t n, const wxRealPoint& pt = wxRealPoint());
+  void Insert(size_t i, const wxRealPoint& pt);
+  void RemoveAt(size_t i);
+  void Clear();
+
+  // Storage allocated on the heap when the points don't fit inline.
+  inline bool IsInline() const { return m_points == m_inline; }
+  inline size_t GetCapacity() const { return m_capacity; }
+
+ private:
+  void Reserve(size_t n);
+
+  enum { INLINE_POINTS = 4 };
+
+  wxRealPoint*      m_points;
+  size_t            m_count;
+  size_t            m_capacity;
+  wxRealPoint       m_inline[INLINE_POINTS];
+};
+
 // Line object
 class WXDLLIMPEXP_OGL wxLabelShape;
 class WXDLLIMPEXP_OGL wxLineShape: public wxShape
 {
  DECLARE_DYNAMIC_CLASS(wxLineShape)
+ friend class WXDLLIMPEXP_OGL wxShape;
 
  public:
   wxLineShape();
@@ -155,10 +201,20 @@ class WXDLLIMPEXP_OGL wxLineShape: public wxShape
 
   // Make a given number of control points
   virtual void MakeLineControlPoints(int n);
+  // Returns the new point's node in the GetLineControlPoints() list, or
+  // NULL if that list has never been asked for
   virtual wxNode *InsertLineControlPoint(wxDC* dc);
   virtual bool DeleteLineControlPoint();
   virtual void Initialise();
-  inline wxList *GetLineControlPoints() { return m_lineControlPoints; }
+  inline wxLinePoints& GetLinePoints() { return m_lineControlPoints; }
+
+  // For compatibility, returns a list of pointers to the points, built on
+  // the first call and rebuilt by later ones if points have been added or
+  // removed since. The points can be changed through it, but the pointers
+  // are invalidated when points are added or removed, and adding to or
+  // removing from the list doesn't change the line.
+  wxDEPRECATED_MSG("use GetLinePoints()")
+  wxList *GetLineControlPoints() { return SyncLineControlPoints(); }
 
   // Override dragging behaviour - don't want to be able to drag lines!
   void OnDragLeft(bool draw, double x, double y, int keys=0, int attachment = 0);
@@ -180,8 +236,8 @@ class WXDLLIMPEXP_OGL wxLineShape: public wxShape
 
   void Unlink();
   void SetAttachments(int from_attach, int to_attach);
-  inline void SetAttachmentFrom(int attach) { m_attachmentFrom = attach; }
-  inline void SetAttachmentTo(int attach) { m_attachmentTo = attach; }
+  inline void SetAttachmentFrom(int attach) { m_attachmentFrom = attach; if (m_from) m_from->InvalidateLineOrder(); }
+  inline void SetAttachmentTo(int attach) { m_attachmentTo = attach; if (m_to) m_to->InvalidateLineOrder(); }
 
   bool HitTest(double x, double y, int *attachment, double *distance);
 
@@ -246,6 +302,12 @@ class WXDLLIMPEXP_OGL wxLineShape: public wxShape
   wxRealPoint *GetNextControlPoint(wxShape *nodeObject);
   inline bool IsEnd(wxShape *nodeObject) const { return (m_to == nodeObject); }
 
+protected:
+  void ShiftControlPoints(int from, int offset);
+
+  // Bring m_lineControlPointList up to date if it's dirty and return it
+  wxList *SyncLineControlPoints();
+
 private:
   bool              m_erasing;              // flag to say whether we're erasing or drawing
                                             // this line (really so metafiles can draw a
@@ -267,8 +329,13 @@ protected:
 
   // These define the segmented line - not to be confused with temporary control
   // points which appear when object is selected (although in this case they'll
-  // probably be the same)
-  wxList*           m_lineControlPoints;
+  // probably be the same). Empty until MakeLineControlPoints is called.
+  wxLinePoints      m_lineControlPoints;
+
+  // The list returned by GetLineControlPoints(), NULL until it's called,
+  // and whether points have been added or removed since it was built
+  wxList*           m_lineControlPointList;
+  bool              m_lineControlPointListDirty;
 
   double            m_arrowSpacing; // Separation between adjacent arrows
 
@@ -278,6 +345,11 @@ protected:
   int               m_attachmentTo;   // Attachment point at one end
   int               m_attachmentFrom; // Attachment point at other end
 
+  // Position amongst the lines at the same attachment point of each
+  // end, maintained by wxShape::UpdateLineOrder
+  int               m_nthTo;
+  int               m_nthFrom;
+
   // Alignment flags
   int               m_alignmentStart;
   int               m_alignmentEnd;
@@ -16,6 +16,8 @@
 
 #include "wx/metafile.h"
 
+#include <vector>
+
 #ifndef GetRValue
 #define GetRValue(rgb) ((unsigned char)(rgb))
 #define GetGValue(rgb) ((unsigned char)(((int)(rgb)) >> 8))
@@ -360,7 +362,9 @@
   #define HS_DIAGCROSS        5
 #endif
 
-class WXDLLIMPEXP_OGL wxMetaRecord: public wxObject
+// One metafile record. Records are stored by value in wxXMetaFile, with
+// their points and text in the metafile's shared pools.
+class WXDLLIMPEXP_OGL wxMetaRecord
 {
   public:
   int metaFunction;
@@ -372,15 +376,15 @@ class WXDLLIMPEXP_OGL wxMetaRecord: public wxObject
   long param6;
   long param7;
   long param8;
-  wxChar *stringParam;
-  wxRealPoint *points;
+  int firstPoint; // Index into wxXMetaFile::points of param1 points, or -1
+  int text;       // Index into wxXMetaFile::strings, or -1
 
-  wxMetaRecord(int fun)
+  wxMetaRecord(int fun = 0)
   {
-    metaFunction = fun; points = NULL; stringParam = NULL;
-    param1 = 0;
+    metaFunction = fun; firstPoint = -1; text = -1;
+    param1 = param2 = param3 = param4 = 0;
+    param5 = param6 = param7 = param8 = 0;
   }
-  ~wxMetaRecord(void);
 };
 
 class WXDLLIMPEXP_OGL wxXMetaFile: public wxObject
@@ -395,9 +399,13 @@ class WXDLLIMPEXP_OGL wxXMetaFile: public wxObject
   double right;
   double bottom;
 
-  wxList metaRecords;
-  wxList gdiObjects; // List of wxMetaRecord objects created with Create...,
-                     // referenced by position in list by SelectObject
+  std::vector<wxMetaRecord> metaRecords; // All records, in file order
+  std::vector<int> gdiObjects; // Indices into metaRecords of the records created
+                               // with Create..., referenced by position in this
+                               // vector by SelectObject (param2)
+  std::vector<wxRealPoint> points; // Polygon and polyline vertices
+  std::vector<wxString> strings;   // TEXTOUT strings
+
   wxXMetaFile(const wxChar* file = NULL);
   ~wxXMetaFile(void);
 
@@ -407,7 +415,12 @@ class WXDLLIMPEXP_OGL wxXMetaFile: public wxObject
 
   bool Play(wxDC *dc);
   inline bool Ok(void) const { return ok; }
+
+  // Maps the file and decodes its records in a single bounds-checked pass.
   bool ReadFile(const wxChar *file);
+
+  // Decode a placeable or plain metafile held in memory.
+  bool ReadBuffer(const unsigned char *data, size_t size);
 };
 
 #endif
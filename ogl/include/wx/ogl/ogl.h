@@ -36,6 +36,8 @@
 #include "wx/ogl/drawnp.h"
 #include "wx/ogl/mfutils.h"
 #include "wx/ogl/misc.h"
+#include "wx/ogl/geometry.h"
+#include "wx/ogl/pool.h"
 
 // TODO: replace with wxModule implementation
 extern WXDLLIMPEXP_OGL void wxOGLInitialize();
@@ -0,0 +1,64 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        pool.h
+// Purpose:     Pooled allocation of shapes and other small objects
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef _OGL_POOL_H_
+#define _OGL_POOL_H_
+
+// Allocation statistics of wxOGLPool, totalled over all the block sizes.
+struct WXDLLIMPEXP_OGL wxOGLPoolStats
+{
+  size_t m_allocations;   // Blocks handed out since start up
+  size_t m_frees;         // Blocks returned since start up
+  size_t m_live;          // Blocks in use now
+  size_t m_liveBytes;     // Bytes in use now, rounded up to the block sizes
+  size_t m_chunks;        // Chunks held from the heap
+  size_t m_chunkBytes;    // Bytes held in those chunks
+  size_t m_heapAllocations; // Objects too large for a pool, passed to the heap
+};
+
+// Fixed size blocks carved from large chunks, for the many small objects a
+// diagram allocates: shapes, their handlers and regions, and the graph
+// elements built on them. Each block size has a free list, so freeing and
+// reallocating are a pointer swap. Trim() gives the chunks of the sizes no
+// longer in use back to the heap, so after tearing down a whole diagram the
+// memory is released in a few large frees.
+//
+// Not thread safe: like the rest of OGL, use it from the GUI thread only.
+class WXDLLIMPEXP_OGL wxOGLPool
+{
+ public:
+  static void *Alloc(size_t size);
+  static void Free(void *p, size_t size);
+
+  // Release the chunks of every block size that has no blocks in use.
+  static void Trim();
+
+  static void GetStats(wxOGLPoolStats& stats);
+};
+
+// Give a class, and the classes derived from it, pooled operator new and
+// delete. The class must have a virtual destructor so that delete gets the
+// size of the most derived class.
+#if wxUSE_DEBUG_NEW_ALWAYS
+#define DECLARE_OGL_POOLED_ALLOC() \
+ public: \
+  static void *operator new(size_t size) { return wxOGLPool::Alloc(size); } \
+  static void *operator new(size_t size, const wxChar *, int) { return wxOGLPool::Alloc(size); } \
+  static void operator delete(void *p, size_t size) { wxOGLPool::Free(p, size); }
+#else
+#define DECLARE_OGL_POOLED_ALLOC() \
+ public: \
+  static void *operator new(size_t size) { return wxOGLPool::Alloc(size); } \
+  static void operator delete(void *p, size_t size) { wxOGLPool::Free(p, size); }
+#endif
+
+#endif
+    // _OGL_POOL_H_
@@ -296,6 +296,8 @@ wxShape::wxShape(wxShapeCanvas *can)
   m_branchStemLength = 10;
   m_branchSpacing = 10;
   m_branchStyle = BRANCHING_ATTACHMENT_NORMAL;
+  m_lineOrderCount = 0;
+  m_lineOrderValid = false;
 
   // Set up a default region. Much of the above will be put into
   // the region eventually (the duplication is for compatibility)
@@ -1145,6 +1147,41 @@ bool wxShape::MoveLineToNewAttachment(wxDC& dc, wxLineShape *to_move,
   return true;
 }
 
+void wxShape::GetLineOrder(wxLineShape* line, bool incoming, int *nth, int *noArcs)
+{
+  if (!m_lineOrderValid || m_lineOrderCount != m_lines.GetCount())
+    UpdateLineOrder();
+
+  if (incoming)
+    *nth = line->m_to == this ? line->m_nthTo : -1;
+  else
+    *nth = line->m_from == this ? line->m_nthFrom : -1;
+
+  int attachment = line->m_to == this ? line->m_attachmentTo : line->m_attachmentFrom;
+
+  std::map<int, int>::const_iterator it = m_attachmentLineCounts.find(attachment);
+  *noArcs = it != m_attachmentLineCounts.end() ? it->second : 0;
+}
+
+void wxShape::UpdateLineOrder()
+{
+  m_attachmentLineCounts.clear();
+
+  wxNode *node = m_lines.GetFirst();
+  while (node)
+  {
+    wxLineShape *line = (wxLineShape *)node->GetData();
+    if (line->m_from == this)
+      line->m_nthFrom = m_attachmentLineCounts[line->m_attachmentFrom]++;
+    if (line->m_to == this)
+      line->m_nthTo = m_attachmentLineCounts[line->m_attachmentTo]++;
+    node = node->GetNext();
+  }
+
+  m_lineOrderCount = m_lines.GetCount();
+  m_lineOrderValid = true;
+}
+
 void wxShape::OnChangeAttachment(int attachment, wxLineShape* line, wxList& ordering)
 {
     if (line->GetTo() == this)
@@ -1173,7 +1210,7 @@ void wxShape::ApplyAttachmentOrdering(wxList& linesToSort)
   {
     wxLineShape *line = (wxLineShape *)node->GetData();
     linesStore.Append(line);
-    node = node->GetNext();;
+    node = node->GetNext();
   }
 
   m_lines.Clear();
@@ -1199,6 +1236,8 @@ void wxShape::ApplyAttachmentOrdering(wxList& linesToSort)
     m_lines.Append(line);
     node = node->GetNext();
   }
+
+  UpdateLineOrder();
 }
 
 // Reorders the lines coming into the node image at this attachment
@@ -1246,6 +1285,8 @@ void wxShape::SortLines(int attachment, wxList& linesToSort)
     m_lines.Append(line);
     node = node->GetNext();
   }
+
+  UpdateLineOrder();
 }
 
 void wxShape::OnHighlight(wxDC& WXUNUSED(dc))
@@ -1652,6 +1693,9 @@ void wxShape::AddLine(wxLineShape *line, wxShape *other,
     }
 #endif
 
+    InvalidateLineOrder();
+    other->InvalidateLineOrder();
+
     line->SetFrom(this);
     line->SetTo(other);
     line->SetAttachments(attachFrom, attachTo);
@@ -1660,11 +1704,18 @@ void wxShape::AddLine(wxLineShape *line, wxShape *other,
 void wxShape::RemoveLine(wxLineShape *line)
 {
   if (line->GetFrom() == this)
+  {
     line->GetTo()->m_lines.DeleteObject(line);
+    line->GetTo()->InvalidateLineOrder();
+  }
   else
-   line->GetFrom()->m_lines.DeleteObject(line);
+  {
+    line->GetFrom()->m_lines.DeleteObject(line);
+    line->GetFrom()->InvalidateLineOrder();
+  }
 
   m_lines.DeleteObject(line);
+  InvalidateLineOrder();
 }
 
 void wxShape::Copy(wxShape& copy)
@@ -1727,6 +1778,7 @@ void wxShape::Copy(wxShape& copy)
   }
 
   // Copy lines
+  copy.InvalidateLineOrder();
   copy.m_lines.Clear();
   node = m_lines.GetFirst();
   while (node)
@@ -194,38 +194,29 @@ void wxPolygonShape::CalculatePolygonCentre()
 bool PolylineHitTest(double n, double xvec[], double yvec[],
                            double x1, double y1, double x2, double y2)
 {
-  bool isAHit = false;
-  int i;
-  double lastx = xvec[0];
-  double lasty = yvec[0];
-
-  double min_ratio = 1.0;
-  double line_ratio;
-  double other_ratio;
-
-  for (i = 1; i < n; i++)
-  {
-    oglCheckLineIntersection(x1, y1, x2, y2, lastx, lasty, xvec[i], yvec[i],
-                            &line_ratio, &other_ratio);
-    if (line_ratio != 1.0)
-      isAHit = true;
-    lastx = xvec[i];
-    lasty = yvec[i];
-
-    if (line_ratio < min_ratio)
-      min_ratio = line_ratio;
-  }
+  // A hit on a segment gives a ratio below 1.0, so any hit at all shows in
+  // the smallest ratio.
+  size_t count = n > 1 ? size_t(ceil(n)) : 1;
+  double lastx = xvec[count - 1];
+  double lasty = yvec[count - 1];
+
+  if (wxOGLGeometry::IntersectSegments(x1, y1, x2, y2,
+                                       xvec, yvec, xvec + 1, yvec + 1,
+                                       count - 1) < 1.0)
+    return true;
 
   // Do last (implicit) line if last and first doubles are not identical
   if (!(xvec[0] == lastx && yvec[0] == lasty))
   {
+    double line_ratio;
+    double other_ratio;
+
     oglCheckLineIntersection(x1, y1, x2, y2, lastx, lasty, xvec[0], yvec[0],
                             &line_ratio, &other_ratio);
     if (line_ratio != 1.0)
-      isAHit = true;
-
+      return true;
   }
-  return isAHit;
+  return false;
 }
 
 bool wxPolygonShape::HitTest(double x, double y, int *attachment, double *distance)
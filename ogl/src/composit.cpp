@@ -54,6 +54,7 @@ wxCompositeShape::wxCompositeShape(): wxRectangleShape(10.0, 10.0)
 //  selectable = false;
   m_oldX = m_xpos;
   m_oldY = m_ypos;
+  m_constraintOrderValid = false;
 }
 
 wxCompositeShape::~wxCompositeShape()
@@ -318,6 +319,7 @@ void wxCompositeShape::DeleteConstraintsInvolvingChild(wxShape *child)
     }
     node = nextNode;
   }
+  InvalidateConstraintOrder();
 }
 
 void wxCompositeShape::RemoveChildFromConstraints(wxShape *child)
@@ -342,6 +344,7 @@ void wxCompositeShape::RemoveChildFromConstraints(wxShape *child)
 
     node = nextNode;
   }
+  InvalidateConstraintOrder();
 }
 
 void wxCompositeShape::Copy(wxShape& copy)
@@ -352,6 +355,8 @@ void wxCompositeShape::Copy(wxShape& copy)
 
   wxCompositeShape& compositeCopy = (wxCompositeShape&) copy;
 
+  compositeCopy.InvalidateConstraintOrder();
+
   // Associate old and new copies for compositeCopying constraints and division geometry
   oglObjectCopyMapping.Append((long)this, &compositeCopy);
 
@@ -444,6 +449,7 @@ void wxCompositeShape::Copy(wxShape& copy)
 wxOGLConstraint *wxCompositeShape::AddConstraint(wxOGLConstraint *constraint)
 {
   m_constraints.Append(constraint);
+  InvalidateConstraintOrder();
   if (constraint->m_constraintId == 0)
     constraint->m_constraintId = wxNewId();
   return constraint;
@@ -455,6 +461,7 @@ wxOGLConstraint *wxCompositeShape::AddConstraint(int type, wxShape *constraining
   if (constraint->m_constraintId == 0)
     constraint->m_constraintId = wxNewId();
   m_constraints.Append(constraint);
+  InvalidateConstraintOrder();
   return constraint;
 }
 
@@ -466,6 +473,7 @@ wxOGLConstraint *wxCompositeShape::AddConstraint(int type, wxShape *constraining
   if (constraint->m_constraintId == 0)
     constraint->m_constraintId = wxNewId();
   m_constraints.Append(constraint);
+  InvalidateConstraintOrder();
   return constraint;
 }
 
@@ -507,6 +515,7 @@ void wxCompositeShape::DeleteConstraint(wxOGLConstraint *constraint)
 {
   m_constraints.DeleteObject(constraint);
   delete constraint;
+  InvalidateConstraintOrder();
 }
 
 void wxCompositeShape::CalculateSize()
@@ -576,14 +585,93 @@ bool wxCompositeShape::Constrain()
     node = node->GetNext();
   }
 
-  node = m_constraints.GetFirst();
+  if (!m_constraintOrderValid || m_constraintOrder.size() != m_constraints.GetCount())
+    SortConstraints();
+
+  for (size_t i = 0; i < m_constraintOrder.size(); i++)
+  {
+    wxOGLConstraint *constraint = m_constraintOrder[i];
+    if (constraint->InputsChanged())
+    {
+      if (constraint->Evaluate()) changed = true;
+      constraint->SaveInputs();
+    }
+  }
+  return changed;
+}
+
+// Sorts the constraints so that each comes after the constraints that
+// move its constraining object.
+void wxCompositeShape::SortConstraints()
+{
+  std::vector<wxOGLConstraint*> constraints;
+  wxNode *node = m_constraints.GetFirst();
   while (node)
   {
-    wxOGLConstraint *constraint = (wxOGLConstraint *)node->GetData();
-    if (constraint->Evaluate()) changed = true;
+    constraints.push_back((wxOGLConstraint *)node->GetData());
     node = node->GetNext();
   }
-  return changed;
+
+  size_t n = constraints.size();
+  size_t i, j;
+
+  // The constraints moving each shape
+  std::map<wxShape*, std::vector<size_t> > movers;
+  for (i = 0; i < n; i++)
+  {
+    node = constraints[i]->m_constrainedObjects.GetFirst();
+    while (node)
+    {
+      movers[(wxShape *)node->GetData()].push_back(i);
+      node = node->GetNext();
+    }
+  }
+
+  std::vector<std::vector<size_t> > dependents(n);
+  std::vector<int> waiting(n, 0);
+
+  for (j = 0; j < n; j++)
+  {
+    std::map<wxShape*, std::vector<size_t> >::const_iterator it =
+      movers.find(constraints[j]->m_constrainingObject);
+    if (it == movers.end())
+      continue;
+    for (i = 0; i < it->second.size(); i++)
+    {
+      if (it->second[i] != j)
+      {
+        dependents[it->second[i]].push_back(j);
+        waiting[j]++;
+      }
+    }
+  }
+
+  // Take the constraints in list order as they become ready
+  std::vector<size_t> ready;
+  std::vector<bool> sorted(n, false);
+  for (i = 0; i < n; i++)
+    if (waiting[i] == 0)
+      ready.push_back(i);
+
+  m_constraintOrder.clear();
+
+  for (size_t k = 0; k < ready.size(); k++)
+  {
+    i = ready[k];
+    sorted[i] = true;
+    m_constraintOrder.push_back(constraints[i]);
+    for (j = 0; j < dependents[i].size(); j++)
+      if (--waiting[dependents[i][j]] == 0)
+        ready.push_back(dependents[i][j]);
+  }
+
+  // Constraints in a cycle keep their list order; Recompute iterates
+  // until they settle.
+  for (i = 0; i < n; i++)
+    if (!sorted[i])
+      m_constraintOrder.push_back(constraints[i]);
+
+  m_constraintOrderValid = true;
 }
 
 // Make this composite into a container by creating one wxDivisionShape
@@ -25,6 +25,29 @@
 
 wxList *wxOGLConstraintTypes = NULL;
 
+// Creates the DC for moving the constrained objects only if one of them
+// actually moves.
+class wxConstraintDC
+{
+public:
+  wxConstraintDC(wxShapeCanvas *canvas) : m_canvas(canvas), m_dc(NULL) {}
+  ~wxConstraintDC() { delete m_dc; }
+
+  operator wxDC&()
+  {
+    if (!m_dc)
+    {
+      m_dc = new wxClientDC(m_canvas);
+      m_canvas->PrepareDC(*m_dc);
+    }
+    return *m_dc;
+  }
+
+private:
+  wxShapeCanvas *m_canvas;
+  wxClientDC    *m_dc;
+};
+
 /*
  * Constraint type
  *
@@ -144,6 +167,55 @@ wxOGLConstraint::~wxOGLConstraint()
 {
 }
 
+void wxOGLConstraint::GetInputs(std::vector<double>& inputs)
+{
+  double w, h;
+
+  inputs.clear();
+  inputs.push_back(m_constraintType);
+  inputs.push_back(m_xSpacing);
+  inputs.push_back(m_ySpacing);
+
+  if (m_constrainingObject)
+  {
+    inputs.push_back(m_constrainingObject->GetX());
+    inputs.push_back(m_constrainingObject->GetY());
+    m_constrainingObject->GetBoundingBoxMax(&w, &h);
+    inputs.push_back(w);
+    inputs.push_back(h);
+    m_constrainingObject->GetBoundingBoxMin(&w, &h);
+    inputs.push_back(w);
+    inputs.push_back(h);
+  }
+
+  wxNode *node = m_constrainedObjects.GetFirst();
+  while (node)
+  {
+    wxShape *constrainedObject = (wxShape *)node->GetData();
+    inputs.push_back(constrainedObject->GetX());
+    inputs.push_back(constrainedObject->GetY());
+    constrainedObject->GetBoundingBoxMax(&w, &h);
+    inputs.push_back(w);
+    inputs.push_back(h);
+    node = node->GetNext();
+  }
+}
+
+bool wxOGLConstraint::InputsChanged()
+{
+  if (m_inputs.empty())
+    return true;
+
+  std::vector<double> inputs;
+  GetInputs(inputs);
+  return inputs != m_inputs;
+}
+
+void wxOGLConstraint::SaveInputs()
+{
+  GetInputs(m_inputs);
+}
+
 bool wxOGLConstraint::Equals(double a, double b)
 {
   double marg = 0.5;
@@ -161,8 +233,7 @@ bool wxOGLConstraint::Evaluate()
   x = m_constrainingObject->GetX();
   y = m_constrainingObject->GetY();
 
-  wxClientDC dc(m_constrainingObject->GetCanvas());
-  m_constrainingObject->GetCanvas()->PrepareDC(dc);
+  wxConstraintDC dc(m_constrainingObject->GetCanvas());
 
   switch (m_constraintType)
   {
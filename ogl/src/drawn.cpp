@@ -20,9 +20,14 @@
 #include "wx/wx.h"
 #endif
 
+#include "wx/filename.h"
+#include "wx/image.h"
+
 #include "wx/ogl/ogl.h"
 
 #include <algorithm>
+#include <map>
+#include <memory>
 
 extern wxChar *oglBuffer;
 
@@ -39,8 +44,292 @@ inline bool Contains(const std::vector<int>& vec, int value)
     return find(vec.begin(), vec.end(), value) != vec.end();
 }
 
+// How a compiled DRAWOP_SET_PEN/DRAWOP_SET_BRUSH picks its GDI object
+enum
+{
+    GDI_OWN,        // The pen or brush recorded in the metafile
+    GDI_OUTLINE,    // The metafile's outline pen, or a brush of its colour
+    GDI_FILL        // The metafile's fill brush
+};
+
+// Coordinates stored per wxOpDraw/wxOpSetClipping command
+const int COORDS_PER_OP = 7;
+
+// Does a compiled op keep its arguments in m_cmdCoords? Poly ops index
+// m_cmdPoints instead, and GDI ops have no coordinates at all.
+inline bool HasCoords(int op)
+{
+    switch (op)
+    {
+        case DRAWOP_SET_CLIPPING_RECT:
+        case DRAWOP_DESTROY_CLIPPING_RECT:
+        case DRAWOP_DRAW_LINE:
+        case DRAWOP_DRAW_RECT:
+        case DRAWOP_DRAW_ROUNDED_RECT:
+        case DRAWOP_DRAW_ELLIPSE:
+        case DRAWOP_DRAW_ARC:
+        case DRAWOP_DRAW_ELLIPTIC_ARC:
+        case DRAWOP_DRAW_POINT:
+        case DRAWOP_DRAW_TEXT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// FNV-1a, used to fingerprint compiled metafiles and the pen and brush
+// they are drawn with
+const wxUint64 FNV_OFFSET = wxULL(14695981039346656037);
+const wxUint64 FNV_PRIME = wxULL(1099511628211);
+
+inline void HashBytes(wxUint64& hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+inline void HashInt(wxUint64& hash, long value)
+{
+    HashBytes(hash, &value, sizeof(value));
+}
+
+// Pens and brushes are hashed by value, as equal ones are not always
+// the same object
+void HashPen(wxUint64& hash, const wxPen *pen)
+{
+    if (!pen || !pen->Ok())
+    {
+        HashInt(hash, 0);
+        return;
+    }
+    HashInt(hash, 1);
+    HashInt(hash, pen->GetColour().GetRGBA());
+    HashInt(hash, pen->GetWidth());
+    HashInt(hash, pen->GetStyle());
+}
+
+void HashBrush(wxUint64& hash, const wxBrush *brush)
+{
+    if (!brush || !brush->Ok())
+    {
+        HashInt(hash, 0);
+        return;
+    }
+    HashInt(hash, 1);
+    HashInt(hash, brush->GetColour().GetRGBA());
+    HashInt(hash, brush->GetStyle());
+}
+
+// Compare a pen or brush with a copy kept by the cache, on the attributes
+// that are hashed
+bool SamePen(const wxPen *pen, const wxPen& other)
+{
+    if (!pen || !pen->Ok())
+        return !other.Ok();
+    return other.Ok() &&
+           pen->GetColour() == other.GetColour() &&
+           pen->GetWidth() == other.GetWidth() &&
+           pen->GetStyle() == other.GetStyle();
+}
+
+bool SameBrush(const wxBrush *brush, const wxBrush& other)
+{
+    if (!brush || !brush->Ok())
+        return !other.Ok();
+    return other.Ok() &&
+           brush->GetColour() == other.GetColour() &&
+           brush->GetStyle() == other.GetStyle();
+}
+
+// Largest bitmap wxDrawnShape will cache, in pixels along either side
+const int MAX_CACHE_SIZE = 2048;
+
+// Total pixels held by g_renderings before it is emptied
+const size_t MAX_CACHE_PIXELS = 16 * 1024 * 1024;
+
+// What a cached rendering was drawn from, so that every wxDrawnShape
+// showing the same symbol at the same size, angle and zoom shares it.
+// The hashes only narrow the search, the entry itself is compared too.
+struct RenderingKey
+{
+    wxUint64  fingerprint;  // wxPseudoMetaFile::GetFingerprint()
+    wxUint64  gdi;          // Outline pen and fill brush
+    double    zoomX;
+    double    zoomY;
+    double    fracX;        // Fractional part of the shape's position
+    double    fracY;
+
+    bool operator<(const RenderingKey& other) const
+    {
+        if (fingerprint != other.fingerprint)
+            return fingerprint < other.fingerprint;
+        if (gdi != other.gdi)
+            return gdi < other.gdi;
+        if (zoomX != other.zoomX)
+            return zoomX < other.zoomX;
+        if (zoomY != other.zoomY)
+            return zoomY < other.zoomY;
+        if (fracX != other.fracX)
+            return fracX < other.fracX;
+        return fracY < other.fracY;
+    }
+};
+
+struct Rendering
+{
+    wxBitmap  bitmap;
+    int       originX;      // Metafile origin within the bitmap
+    int       originY;
+
+    // A copy of what was drawn, so that drawings with colliding hashes
+    // are not taken for each other
+    std::shared_ptr<wxPseudoMetaFile> drawing;
+    wxPen     pen;
+    wxBrush   brush;
+
+    bool Matches(wxPseudoMetaFile& metafile, const wxPen *p, const wxBrush *b) const
+    {
+        return SamePen(p, pen) && SameBrush(b, brush) &&
+               drawing->DrawsSameAs(metafile);
+    }
+};
+
+typedef std::multimap<RenderingKey, Rendering> RenderingMap;
+
+RenderingMap g_renderings;
+size_t g_renderingPixels = 0;
+
+wxOGLCacheProbe g_cacheProbe = NULL;
+
+inline void CountLookup(int cache, bool hit)
+{
+    if (g_cacheProbe)
+        g_cacheProbe(cache, hit);
+}
+
+// Draws the metafile into a bitmap with an alpha channel. DCs cannot draw
+// alpha portably, so it is drawn once on black and once on white, and
+// each pixel's coverage recovered from the difference; antialiased edges
+// then blend with whatever is underneath rather than with a key colour.
+wxBitmap RenderWithAlpha(wxPseudoMetaFile& metafile, int width, int height,
+                                                  double zoomX, double zoomY, double x, double y)
+{
+    wxImage images[2];
+    const wxColour backgrounds[2] = { *wxBLACK, *wxWHITE };
+
+    for (int i = 0; i < 2; i++)
+    {
+        wxBitmap bitmap(width, height);
+        wxMemoryDC memDC;
+        memDC.SelectObject(bitmap);
+        wxBrush background(backgrounds[i], wxSOLID);
+        memDC.SetBackground(background);
+        memDC.Clear();
+        memDC.SetUserScale(zoomX, zoomY);
+        metafile.Draw(memDC, x, y);
+        memDC.SelectObject(wxNullBitmap);
+        images[i] = bitmap.ConvertToImage();
+    }
+
+    wxImage& image = images[0];
+    image.InitAlpha();
+
+    unsigned char *rgb = image.GetData();
+    unsigned char *alpha = image.GetAlpha();
+    const unsigned char *white = images[1].GetData();
+
+    for (int n = width * height; n > 0; n--, rgb += 3, white += 3, alpha++)
+    {
+        int spread = 0;
+        for (int k = 0; k < 3; k++)
+            spread = std::max(spread, white[k] - rgb[k]);
+
+        // On black the colour came out premultiplied by the coverage
+        int a = 255 - spread;
+        *alpha = (unsigned char)a;
+        for (int k = 0; k < 3; k++)
+            rgb[k] = a ? (unsigned char)std::min(255, rgb[k] * 255 / a) : 0;
+    }
+
+    return wxBitmap(image);
+}
+
+// A metafile read and converted by wxPseudoMetaFile::LoadFromMetaFile,
+// reused by later loads of the same file while it is unmodified
+struct MetaFileSymbol
+{
+    time_t              modified;
+    wxPseudoMetaFile*   metafile;   // Ops before translation and scaling
+    double              left;
+    double              top;
+    double              right;
+    double              bottom;
+};
+
+typedef std::map<wxString, MetaFileSymbol> MetaFileSymbolMap;
+
+MetaFileSymbolMap g_metaFileSymbols;
+
+// Returns the cached symbol for the file, reading it if it is new or has
+// changed since it was cached, or NULL if it cannot be read.
+const MetaFileSymbol *FindMetaFileSymbol(const wxString& filename)
+{
+    wxFileName fn(filename);
+    fn.MakeAbsolute();
+    wxString key = fn.GetFullPath();
+    time_t modified = wxFileModificationTime(filename);
+
+    MetaFileSymbolMap::iterator it = g_metaFileSymbols.find(key);
+    if (it != g_metaFileSymbols.end())
+    {
+        if (it->second.modified == modified)
+        {
+            CountLookup(oglCACHE_SYMBOLS, true);
+            return &it->second;
+        }
+        delete it->second.metafile;
+        g_metaFileSymbols.erase(it);
+    }
+
+    CountLookup(oglCACHE_SYMBOLS, false);
+
+    wxXMetaFile metaFile;
+    if (!metaFile.ReadFile(filename.c_str()))
+        return NULL;
+
+    MetaFileSymbol symbol;
+    symbol.modified = modified;
+    symbol.metafile = new wxPseudoMetaFile;
+    symbol.metafile->AddMetaFileRecords(metaFile);
+    symbol.left = metaFile.left;
+    symbol.top = metaFile.top;
+    symbol.right = metaFile.right;
+    symbol.bottom = metaFile.bottom;
+
+    return &(g_metaFileSymbols[key] = symbol);
+}
+
 } // anonymous namespace
 
+void OGLCleanUpMetaFileCache()
+{
+    MetaFileSymbolMap::iterator it;
+    for (it = g_metaFileSymbols.begin(); it != g_metaFileSymbols.end(); ++it)
+        delete it->second.metafile;
+    g_metaFileSymbols.clear();
+    g_renderings.clear();
+    g_renderingPixels = 0;
+}
+
+void OGLSetCacheProbe(wxOGLCacheProbe probe)
+{
+    g_cacheProbe = probe;
+}
+
 /*
  * Drawn object
  *
@@ -52,6 +341,12 @@ wxDrawnShape::wxDrawnShape():wxRectangleShape(100.0, 50.0)
 {
   m_saveToFile = true;
   m_currentAngle = oglDRAWN_ANGLE_0;
+  m_bitmapCaching = true;
+  m_cacheAngle = -1;
+  m_cacheRevision = 0;
+  m_cacheZoomX = m_cacheZoomY = 0.0;
+  m_cacheFracX = m_cacheFracY = 0.0;
+  m_cacheOriginX = m_cacheOriginY = 0;
 }
 
 wxDrawnShape::~wxDrawnShape()
@@ -72,7 +367,137 @@ void wxDrawnShape::OnDraw(wxDC& dc)
 
   m_metafiles[m_currentAngle].m_outlinePen = m_pen;
   m_metafiles[m_currentAngle].m_fillBrush = m_brush;
-  m_metafiles[m_currentAngle].Draw(dc, m_xpos, m_ypos);
+  if (!DrawFromCache(dc))
+    m_metafiles[m_currentAngle].Draw(dc, m_xpos, m_ypos);
+}
+
+bool wxDrawnShape::DrawFromCache(wxDC& dc)
+{
+  if (!m_bitmapCaching)
+    return false;
+
+  // Printers and vector DCs get the metafile itself
+  if (!dc.IsKindOf(CLASSINFO(wxWindowDC)) && !dc.IsKindOf(CLASSINFO(wxMemoryDC)))
+    return false;
+
+  wxPseudoMetaFile& metafile = m_metafiles[m_currentAngle];
+  if (!metafile.IsCacheable())
+    return false;
+
+  double zoomX, zoomY;
+  dc.GetUserScale(&zoomX, &zoomY);
+
+  // The ops are rounded after adding the offset, so the fractional part
+  // of the position changes the rendering too
+  double left = floor(m_xpos);
+  double top = floor(m_ypos);
+  double fracX = m_xpos - left;
+  double fracY = m_ypos - top;
+
+  if (!m_cacheBitmap.Ok() ||
+      m_cacheAngle != m_currentAngle ||
+      m_cacheRevision != metafile.GetRevision() ||
+      !SamePen(m_pen, m_cachePen) || !SameBrush(m_brush, m_cacheBrush) ||
+      m_cacheZoomX != zoomX || m_cacheZoomY != zoomY ||
+      m_cacheFracX != fracX || m_cacheFracY != fracY)
+  {
+    if (!RenderCache(zoomX, zoomY, fracX, fracY))
+      return false;
+  }
+
+  // Blit in device units so that the bitmap is not scaled again
+  wxCoord devX = dc.LogicalToDeviceX((wxCoord)left - m_cacheOriginX);
+  wxCoord devY = dc.LogicalToDeviceY((wxCoord)top - m_cacheOriginY);
+  dc.SetUserScale(1.0, 1.0);
+  dc.DrawBitmap(m_cacheBitmap, dc.DeviceToLogicalX(devX), dc.DeviceToLogicalY(devY), true);
+  dc.SetUserScale(zoomX, zoomY);
+
+  return true;
+}
+
+bool wxDrawnShape::RenderCache(double zoomX, double zoomY, double fracX, double fracY)
+{
+  InvalidateBitmapCache();
+
+  if (zoomX <= 0.0 || zoomY <= 0.0)
+    return false;
+
+  wxPseudoMetaFile& metafile = m_metafiles[m_currentAngle];
+
+  RenderingKey key;
+  key.fingerprint = metafile.GetFingerprint();
+  key.gdi = FNV_OFFSET;
+  HashPen(key.gdi, m_pen);
+  HashBrush(key.gdi, m_brush);
+  key.zoomX = zoomX;
+  key.zoomY = zoomY;
+  key.fracX = fracX;
+  key.fracY = fracY;
+
+  RenderingMap::iterator it = g_renderings.lower_bound(key);
+  RenderingMap::iterator end = g_renderings.upper_bound(key);
+  while (it != end && !it->second.Matches(metafile, m_pen, m_brush))
+    ++it;
+
+  CountLookup(oglCACHE_RENDERINGS, it != end);
+
+  if (it == end)
+  {
+    double minX, minY, maxX, maxY;
+    metafile.GetBounds(&minX, &minY, &maxX, &maxY);
+    if (maxX < minX || maxY < minY)
+      return false;
+
+    int pad = metafile.GetMaxPenWidth();
+    if (m_pen && m_pen->GetWidth() > pad)
+      pad = m_pen->GetWidth();
+    pad += 2;
+
+    Rendering rendering;
+    rendering.originX = (int)ceil(pad - minX);
+    rendering.originY = (int)ceil(pad - minY);
+    int width = (int)ceil((rendering.originX + maxX + pad) * zoomX) + 1;
+    int height = (int)ceil((rendering.originY + maxY + pad) * zoomY) + 1;
+    if (width <= 0 || height <= 0 || width > MAX_CACHE_SIZE || height > MAX_CACHE_SIZE)
+      return false;
+
+    // Shapes keep their own reference to the bitmap they draw, so
+    // emptying the cache only costs a render when one next changes
+    if (g_renderingPixels > MAX_CACHE_PIXELS)
+    {
+      g_renderings.clear();
+      g_renderingPixels = 0;
+    }
+
+    rendering.bitmap = RenderWithAlpha(metafile, width, height, zoomX, zoomY,
+                                       rendering.originX + fracX,
+                                       rendering.originY + fracY);
+    // The copy is only compared, never drawn, so it keeps no pointers to
+    // this shape's pen and brush
+    rendering.drawing.reset(new wxPseudoMetaFile(metafile));
+    rendering.drawing->SetOutlinePen(NULL);
+    rendering.drawing->SetFillBrush(NULL);
+    if (m_pen)
+      rendering.pen = *m_pen;
+    if (m_brush)
+      rendering.brush = *m_brush;
+    it = g_renderings.insert(RenderingMap::value_type(key, rendering)).first;
+    g_renderingPixels += (size_t)width * height;
+  }
+
+  m_cacheBitmap = it->second.bitmap;
+  m_cacheAngle = m_currentAngle;
+  m_cacheRevision = metafile.GetRevision();
+  m_cachePen = it->second.pen;
+  m_cacheBrush = it->second.brush;
+  m_cacheZoomX = zoomX;
+  m_cacheZoomY = zoomY;
+  m_cacheFracX = fracX;
+  m_cacheFracY = fracY;
+  m_cacheOriginX = it->second.originX;
+  m_cacheOriginY = it->second.originY;
+
+  return true;
 }
 
 void wxDrawnShape::SetSize(double w, double h, bool WXUNUSED(recursive))
@@ -96,6 +521,7 @@ void wxDrawnShape::SetSize(double w, double h, bool WXUNUSED(recursive))
   m_width = w;
   m_height = h;
   SetDefaultRegionSize();
+  InvalidateBitmapCache();
 }
 
 void wxDrawnShape::Scale(double sx, double sy)
@@ -109,6 +535,7 @@ void wxDrawnShape::Scale(double sx, double sy)
             m_metafiles[i].CalculateSize(this);
         }
     }
+    InvalidateBitmapCache();
 }
 
 void wxDrawnShape::Translate(double x, double y)
@@ -122,6 +549,7 @@ void wxDrawnShape::Translate(double x, double y)
             m_metafiles[i].CalculateSize(this);
         }
     }
+    InvalidateBitmapCache();
 }
 
 // theta is absolute rotation from the zero position
@@ -156,6 +584,7 @@ void wxDrawnShape::Rotate(double x, double y, double theta)
   m_rotation = theta;
 
   m_metafiles[m_currentAngle].CalculateSize(this);
+  InvalidateBitmapCache();
 }
 
 // Which metafile do we use now? Based on current rotation and validity
@@ -246,6 +675,8 @@ void wxDrawnShape::Copy(wxShape& copy)
   }
   drawnCopy.m_saveToFile = m_saveToFile;
   drawnCopy.m_currentAngle = m_currentAngle;
+  drawnCopy.m_bitmapCaching = m_bitmapCaching;
+  drawnCopy.InvalidateBitmapCache();
 }
 
 bool wxDrawnShape::LoadFromMetaFile(const wxString& filename)
@@ -944,10 +1375,22 @@ wxPseudoMetaFile::wxPseudoMetaFile()
   m_outlinePen = NULL;
   m_fillBrush = NULL;
   m_outlineOp = -1;
+  m_compiledOps = 0;
+  m_maxPenWidth = 0;
+  m_fingerprint = 0;
+  m_revision = 0;
+  m_compiled = false;
+  m_cacheable = false;
 }
 
 wxPseudoMetaFile::wxPseudoMetaFile(wxPseudoMetaFile& mf):wxObject()
 {
+  m_compiledOps = 0;
+  m_maxPenWidth = 0;
+  m_fingerprint = 0;
+  m_revision = 0;
+  m_compiled = false;
+  m_cacheable = false;
   mf.Copy(*this);
 }
 
@@ -970,17 +1413,396 @@ void wxPseudoMetaFile::Clear()
   m_outlineColours.clear();
   m_fillColours.clear();
   m_outlineOp = -1;
-}
+  Invalidate();
+}
+
+// Flatten the op list into parallel arrays, resolving GDI indices and
+// outline/fill overrides, so that Draw is a single switch over plain data.
+void wxPseudoMetaFile::Compile()
+{
+  if (m_compiled && m_compiledOps == m_ops.GetCount())
+    return;
+
+  size_t count = m_ops.GetCount();
+  m_cmdOps.clear();
+  m_cmdFirst.clear();
+  m_cmdParam.clear();
+  m_cmdObjects.clear();
+  m_cmdCoords.clear();
+  m_cmdPoints.clear();
+  m_cmdOps.reserve(count);
+  m_cmdFirst.reserve(count);
+  m_cmdParam.reserve(count);
+  m_cmdObjects.reserve(count);
+  m_maxPenWidth = 0;
+  m_cacheable = true;
 
-void wxPseudoMetaFile::Draw(wxDC& dc, double xoffset, double yoffset)
-{
   wxNode *node = m_ops.GetFirst();
   while (node)
   {
     wxDrawOp *op = (wxDrawOp *)node->GetData();
-    op->Do(dc, xoffset, yoffset);
+    int first = 0;
+    int param = 0;
+    const wxObject *object = NULL;
+
+    switch (op->GetOp())
+    {
+      case DRAWOP_SET_PEN:
+      case DRAWOP_SET_BRUSH:
+      case DRAWOP_SET_FONT:
+      case DRAWOP_SET_TEXT_COLOUR:
+      case DRAWOP_SET_BK_COLOUR:
+      case DRAWOP_SET_BK_MODE:
+      {
+        wxOpSetGDI *opGDI = (wxOpSetGDI *)op;
+        if (op->GetOp() == DRAWOP_SET_TEXT_COLOUR || op->GetOp() == DRAWOP_SET_BK_COLOUR)
+        {
+          param = (opGDI->m_r << 16) | (opGDI->m_g << 8) | opGDI->m_b;
+          break;
+        }
+        if (op->GetOp() == DRAWOP_SET_BK_MODE)
+        {
+          param = opGDI->m_mode;
+          break;
+        }
+
+        if (op->GetOp() != DRAWOP_SET_FONT && Contains(m_outlineColours, opGDI->m_gdiIndex))
+          param = GDI_OUTLINE;
+        else if (op->GetOp() == DRAWOP_SET_BRUSH && Contains(m_fillColours, opGDI->m_gdiIndex))
+          param = GDI_FILL;
+        else
+        {
+          param = GDI_OWN;
+          wxNode *gdiNode = m_gdiObjects.Item(opGDI->m_gdiIndex);
+          if (gdiNode)
+            object = gdiNode->GetData();
+          if (object && op->GetOp() == DRAWOP_SET_PEN &&
+              ((const wxPen *)object)->GetWidth() > m_maxPenWidth)
+            m_maxPenWidth = ((const wxPen *)object)->GetWidth();
+        }
+        break;
+      }
+      case DRAWOP_SET_CLIPPING_RECT:
+      case DRAWOP_DESTROY_CLIPPING_RECT:
+      {
+        wxOpSetClipping *opClip = (wxOpSetClipping *)op;
+        first = m_cmdCoords.size();
+        m_cmdCoords.push_back(opClip->m_x1);
+        m_cmdCoords.push_back(opClip->m_y1);
+        m_cmdCoords.push_back(opClip->m_x2);
+        m_cmdCoords.push_back(opClip->m_y2);
+        m_cmdCoords.resize(first + COORDS_PER_OP, 0.0);
+        break;
+      }
+      case DRAWOP_DRAW_LINE:
+      case DRAWOP_DRAW_RECT:
+      case DRAWOP_DRAW_ROUNDED_RECT:
+      case DRAWOP_DRAW_ELLIPSE:
+      case DRAWOP_DRAW_ARC:
+      case DRAWOP_DRAW_ELLIPTIC_ARC:
+      case DRAWOP_DRAW_POINT:
+      case DRAWOP_DRAW_TEXT:
+      {
+        wxOpDraw *opDraw = (wxOpDraw *)op;
+        first = m_cmdCoords.size();
+        m_cmdCoords.push_back(opDraw->m_x1);
+        m_cmdCoords.push_back(opDraw->m_y1);
+        m_cmdCoords.push_back(opDraw->m_x2);
+        m_cmdCoords.push_back(opDraw->m_y2);
+        m_cmdCoords.push_back(opDraw->m_x3);
+        m_cmdCoords.push_back(opDraw->m_y3);
+        m_cmdCoords.push_back(opDraw->m_radius);
+        if (op->GetOp() == DRAWOP_DRAW_TEXT)
+          object = opDraw;
+        if (op->GetOp() == DRAWOP_DRAW_TEXT || op->GetOp() == DRAWOP_DRAW_ARC)
+          m_cacheable = false;
+        break;
+      }
+      case DRAWOP_DRAW_POLYLINE:
+      case DRAWOP_DRAW_POLYGON:
+      case DRAWOP_DRAW_SPLINE:
+      {
+        wxOpPolyDraw *poly = (wxOpPolyDraw *)op;
+        first = m_cmdPoints.size();
+        param = poly->m_noPoints;
+        for (int i = 0; i < poly->m_noPoints; i++)
+          m_cmdPoints.push_back(wxPoint(WXROUND(poly->m_points[i].x), WXROUND(poly->m_points[i].y)));
+        // DrawSpline takes no offset, so a cached copy would be misplaced
+        if (op->GetOp() == DRAWOP_DRAW_SPLINE)
+          m_cacheable = false;
+        break;
+      }
+      default:
+        break;
+    }
+
+    m_cmdOps.push_back(op->GetOp());
+    m_cmdFirst.push_back(first);
+    m_cmdParam.push_back(param);
+    m_cmdObjects.push_back(object);
     node = node->GetNext();
   }
+
+  m_compiledOps = count;
+  m_compiled = true;
+  m_fingerprint = Fingerprint();
+  m_revision++;
+}
+
+// Hashes everything Draw depends on by value, so that copies of a symbol
+// scaled to the same size get the same fingerprint
+wxUint64 wxPseudoMetaFile::Fingerprint() const
+{
+  wxUint64 hash = FNV_OFFSET;
+  size_t count = m_cmdOps.size();
+  for (size_t i = 0; i < count; i++)
+  {
+    int op = m_cmdOps[i];
+    HashInt(hash, op);
+    HashInt(hash, m_cmdParam[i]);
+
+    if (m_cmdParam[i] == GDI_OWN && m_cmdObjects[i])
+    {
+      if (op == DRAWOP_SET_PEN)
+        HashPen(hash, (const wxPen *)m_cmdObjects[i]);
+      else if (op == DRAWOP_SET_BRUSH)
+        HashBrush(hash, (const wxBrush *)m_cmdObjects[i]);
+    }
+
+    if (HasCoords(op))
+      HashBytes(hash, &m_cmdCoords[m_cmdFirst[i]], COORDS_PER_OP * sizeof(double));
+    else if (op == DRAWOP_DRAW_POLYLINE || op == DRAWOP_DRAW_POLYGON || op == DRAWOP_DRAW_SPLINE)
+    {
+      for (int j = 0; j < m_cmdParam[i]; j++)
+      {
+        const wxPoint& pt = m_cmdPoints[m_cmdFirst[i] + j];
+        HashInt(hash, pt.x);
+        HashInt(hash, pt.y);
+      }
+    }
+  }
+  return hash;
+}
+
+wxUint64 wxPseudoMetaFile::GetFingerprint()
+{
+  Compile();
+  return m_fingerprint;
+}
+
+unsigned long wxPseudoMetaFile::GetRevision()
+{
+  Compile();
+  return m_revision;
+}
+
+// Compares everything Fingerprint() hashes, and the fonts and text too
+bool wxPseudoMetaFile::DrawsSameAs(wxPseudoMetaFile& other)
+{
+  Compile();
+  other.Compile();
+
+  if (m_cmdOps != other.m_cmdOps ||
+      m_cmdFirst != other.m_cmdFirst ||
+      m_cmdParam != other.m_cmdParam ||
+      m_cmdCoords != other.m_cmdCoords ||
+      m_cmdPoints != other.m_cmdPoints)
+    return false;
+
+  size_t count = m_cmdOps.size();
+  for (size_t i = 0; i < count; i++)
+  {
+    const wxObject *object = m_cmdObjects[i];
+    const wxObject *otherObject = other.m_cmdObjects[i];
+    if (object == otherObject)
+      continue;
+    if (!object || !otherObject)
+      return false;
+
+    switch (m_cmdOps[i])
+    {
+      case DRAWOP_SET_PEN:
+        if (!SamePen((const wxPen *)object, *(const wxPen *)otherObject))
+          return false;
+        break;
+      case DRAWOP_SET_BRUSH:
+        if (!SameBrush((const wxBrush *)object, *(const wxBrush *)otherObject))
+          return false;
+        break;
+      case DRAWOP_SET_FONT:
+        if (*(const wxFont *)object != *(const wxFont *)otherObject)
+          return false;
+        break;
+      case DRAWOP_DRAW_TEXT:
+        if (((const wxOpDraw *)object)->m_textString !=
+            ((const wxOpDraw *)otherObject)->m_textString)
+          return false;
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+bool wxPseudoMetaFile::IsCacheable()
+{
+  Compile();
+  return m_cacheable && !m_cmdOps.empty();
+}
+
+int wxPseudoMetaFile::GetMaxPenWidth()
+{
+  Compile();
+  return m_maxPenWidth;
+}
+
+// Replays the compiled commands; equivalent to calling Do() on each op.
+void wxPseudoMetaFile::Draw(wxDC& dc, double xoffset, double yoffset)
+{
+  Compile();
+
+  const double pi = M_PI ;
+  size_t count = m_cmdOps.size();
+  for (size_t i = 0; i < count; i++)
+  {
+    const double *c = HasCoords(m_cmdOps[i]) ? &m_cmdCoords[m_cmdFirst[i]] : NULL;
+    int param = m_cmdParam[i];
+
+    switch (m_cmdOps[i])
+    {
+      case DRAWOP_SET_PEN:
+      {
+        if (param == GDI_OUTLINE)
+        {
+          if (m_outlinePen)
+            dc.SetPen(* m_outlinePen);
+        }
+        else if (m_cmdObjects[i])
+          dc.SetPen(* (const wxPen *)m_cmdObjects[i]);
+        break;
+      }
+      case DRAWOP_SET_BRUSH:
+      {
+        if (param == GDI_OUTLINE)
+        {
+          // Need to construct a brush to match the outline pen's colour
+          if (m_outlinePen)
+          {
+            wxBrush *br = wxTheBrushList->FindOrCreateBrush(m_outlinePen->GetColour());
+            if (br)
+              dc.SetBrush(* br);
+          }
+        }
+        else if (param == GDI_FILL)
+        {
+          if (m_fillBrush)
+            dc.SetBrush(* m_fillBrush);
+        }
+        else if (m_cmdObjects[i])
+          dc.SetBrush(* (const wxBrush *)m_cmdObjects[i]);
+        break;
+      }
+      case DRAWOP_SET_FONT:
+      {
+        if (m_cmdObjects[i])
+          dc.SetFont(* (const wxFont *)m_cmdObjects[i]);
+        break;
+      }
+      case DRAWOP_SET_TEXT_COLOUR:
+      {
+        dc.SetTextForeground(wxColour((param >> 16) & 0xff, (param >> 8) & 0xff, param & 0xff));
+        break;
+      }
+      case DRAWOP_SET_BK_COLOUR:
+      {
+        dc.SetTextBackground(wxColour((param >> 16) & 0xff, (param >> 8) & 0xff, param & 0xff));
+        break;
+      }
+      case DRAWOP_SET_BK_MODE:
+      {
+        dc.SetBackgroundMode(param);
+        break;
+      }
+      case DRAWOP_SET_CLIPPING_RECT:
+      {
+        dc.SetClippingRegion((long)(c[0] + xoffset), (long)(c[1] + yoffset), (long)(c[2] + xoffset), (long)(c[3] + yoffset));
+        break;
+      }
+      case DRAWOP_DESTROY_CLIPPING_RECT:
+      {
+        dc.DestroyClippingRegion();
+        break;
+      }
+      case DRAWOP_DRAW_LINE:
+      {
+        dc.DrawLine(WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset), WXROUND(c[2]+xoffset), WXROUND(c[3]+yoffset));
+        break;
+      }
+      case DRAWOP_DRAW_RECT:
+      {
+        dc.DrawRectangle(WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset), WXROUND(c[2]), WXROUND(c[3]));
+        break;
+      }
+      case DRAWOP_DRAW_ROUNDED_RECT:
+      {
+        dc.DrawRoundedRectangle(WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset), WXROUND(c[2]), WXROUND(c[3]), c[6]);
+        break;
+      }
+      case DRAWOP_DRAW_ELLIPSE:
+      {
+        dc.DrawEllipse(WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset), WXROUND(c[2]), WXROUND(c[3]));
+        break;
+      }
+      case DRAWOP_DRAW_ARC:
+      {
+        dc.DrawArc(WXROUND(c[2]+xoffset), WXROUND(c[3]+yoffset),
+                   WXROUND(c[4]+xoffset), WXROUND(c[5]+yoffset),
+                   WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset));
+        break;
+      }
+      case DRAWOP_DRAW_ELLIPTIC_ARC:
+      {
+        // Convert back to degrees
+        dc.DrawEllipticArc(
+                   WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset),
+                   WXROUND(c[2]), WXROUND(c[3]),
+                   WXROUND(c[4]*(360.0/(2.0*pi))), WXROUND(c[5]*(360.0/(2.0*pi))));
+        break;
+      }
+      case DRAWOP_DRAW_POINT:
+      {
+        dc.DrawPoint(WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset));
+        break;
+      }
+      case DRAWOP_DRAW_TEXT:
+      {
+        const wxOpDraw *opDraw = (const wxOpDraw *)m_cmdObjects[i];
+        dc.DrawText(opDraw->m_textString, WXROUND(c[0]+xoffset), WXROUND(c[1]+yoffset));
+        break;
+      }
+      case DRAWOP_DRAW_POLYLINE:
+      {
+        if (param > 0)
+          dc.DrawLines(param, &m_cmdPoints[m_cmdFirst[i]], WXROUND(xoffset), WXROUND(yoffset));
+        break;
+      }
+      case DRAWOP_DRAW_POLYGON:
+      {
+        if (param > 0)
+          dc.DrawPolygon(param, &m_cmdPoints[m_cmdFirst[i]], WXROUND(xoffset), WXROUND(yoffset));
+        break;
+      }
+      case DRAWOP_DRAW_SPLINE:
+      {
+        if (param > 0)
+          dc.DrawSpline(param, &m_cmdPoints[m_cmdFirst[i]]); // no offsets in DrawSpline
+        break;
+      }
+      default:
+        break;
+    }
+  }
 }
 
 void wxPseudoMetaFile::Scale(double sx, double sy)
@@ -994,6 +1816,7 @@ void wxPseudoMetaFile::Scale(double sx, double sy)
   }
   m_width *= sx;
   m_height *= sy;
+  Invalidate();
 }
 
 void wxPseudoMetaFile::Translate(double x, double y)
@@ -1005,6 +1828,7 @@ void wxPseudoMetaFile::Translate(double x, double y)
     op->Translate(x, y);
     node = node->GetNext();
   }
+  Invalidate();
 }
 
 void wxPseudoMetaFile::Rotate(double x, double y, double theta)
@@ -1022,6 +1846,7 @@ void wxPseudoMetaFile::Rotate(double x, double y, double theta)
     node = node->GetNext();
   }
   m_currentRotation = theta;
+  Invalidate();
 }
 
 // Does the copying for this object
@@ -1066,27 +1891,16 @@ void wxPseudoMetaFile::Copy(wxPseudoMetaFile& copy)
  *
  */
 
-bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth, double *rheight)
+// Convert the records of a parsed metafile into operations, appending them
+void wxPseudoMetaFile::AddMetaFileRecords(const wxXMetaFile& metaFile)
 {
-  if (!wxFileExists(filename))
-    return false;
-
-  wxXMetaFile *metaFile = new wxXMetaFile;
-
-  if (!metaFile->ReadFile(filename))
-  {
-    delete metaFile;
-    return false;
-  }
-
   double lastX = 0.0;
   double lastY = 0.0;
 
   // Convert from metafile records to wxDrawnShape records
-  wxNode *node = metaFile->metaRecords.GetFirst();
-  while (node)
+  for (size_t i = 0; i < metaFile.metaRecords.size(); i++)
   {
-    wxMetaRecord *record = (wxMetaRecord *)node->GetData();
+    const wxMetaRecord *record = &metaFile.metaRecords[i];
     switch (record->metaFunction)
     {
       case META_SETBKCOLOR:
@@ -1213,7 +2027,7 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
       {
         wxOpDraw *op = new wxOpDraw(DRAWOP_DRAW_TEXT,
               (double)record->param1, (double)record->param2,
-              0.0, 0.0, 0.0, record->stringParam);
+              0.0, 0.0, 0.0, metaFile.strings[record->text]);
         m_ops.Append(op);
         break;
       }
@@ -1222,11 +2036,12 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
       case META_POLYGON:
       {
         int n = (int)record->param1;
+        const wxRealPoint *points = n > 0 ? &metaFile.points[record->firstPoint] : NULL;
         wxRealPoint *newPoints = new wxRealPoint[n];
-        for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
         {
-          newPoints[i].x = record->points[i].x;
-          newPoints[i].y = record->points[i].y;
+          newPoints[j].x = points[j].x;
+          newPoints[j].y = points[j].y;
         }
 
         wxOpPolyDraw *op = new wxOpPolyDraw(DRAWOP_DRAW_POLYGON, n, newPoints);
@@ -1236,11 +2051,12 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
       case META_POLYLINE:
       {
         int n = (int)record->param1;
+        const wxRealPoint *points = n > 0 ? &metaFile.points[record->firstPoint] : NULL;
         wxRealPoint *newPoints = new wxRealPoint[n];
-        for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
         {
-          newPoints[i].x = record->points[i].x;
-          newPoints[i].y = record->points[i].y;
+          newPoints[j].x = points[j].x;
+          newPoints[j].y = points[j].y;
         }
 
         wxOpPolyDraw *op = new wxOpPolyDraw(DRAWOP_DRAW_POLYLINE, n, newPoints);
@@ -1258,11 +2074,10 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
       {
         // The pen, brush etc. has already been created when the metafile
         // was read in, so we don't create it - we set it.
-        wxNode *recNode = metaFile->gdiObjects.Item((int)record->param2);
-        if (recNode)
+        if (record->param2 >= 0 && record->param2 < (long)metaFile.gdiObjects.size())
         {
-          wxMetaRecord *gdiRec = (wxMetaRecord *)recNode->GetData();
-          if (gdiRec && (gdiRec->param1 != 0))
+          const wxMetaRecord *gdiRec = &metaFile.metaRecords[metaFile.gdiObjects[(int)record->param2]];
+          if (gdiRec->param1 != 0)
           {
             wxObject *obj = (wxObject *)gdiRec->param1;
             if (obj->IsKindOf(CLASSINFO(wxPen)))
@@ -1376,10 +2191,35 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
         break;
       }
     }
+  }
+}
+
+bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth, double *rheight)
+{
+  if (!wxFileExists(filename))
+    return false;
+
+  const MetaFileSymbol *symbol = FindMetaFileSymbol(filename);
+  if (!symbol)
+    return false;
+
+  // Copy the converted operations and the GDI objects they refer to
+  wxNode *node = symbol->metafile->m_gdiObjects.GetFirst();
+  while (node)
+  {
+    m_gdiObjects.Append(node->GetData());
+    node = node->GetNext();
+  }
+  node = symbol->metafile->m_ops.GetFirst();
+  while (node)
+  {
+    wxDrawOp *op = (wxDrawOp *)node->GetData();
+    m_ops.Append(op->Copy(this));
     node = node->GetNext();
   }
-  double actualWidth = (double)fabs(metaFile->right - metaFile->left);
-  double actualHeight = (double)fabs(metaFile->bottom - metaFile->top);
+
+  double actualWidth = (double)fabs(symbol->right - symbol->left);
+  double actualHeight = (double)fabs(symbol->bottom - symbol->top);
 
   double initialScaleX = 1.0;
   double initialScaleY = 1.0;
@@ -1387,15 +2227,15 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
   double xoffset, yoffset;
 
   // Translate so origin is at centre of rectangle
-  if (metaFile->bottom > metaFile->top)
-    yoffset = - (double)((metaFile->bottom - metaFile->top)/2.0);
+  if (symbol->bottom > symbol->top)
+    yoffset = - (double)((symbol->bottom - symbol->top)/2.0);
   else
-    yoffset = - (double)((metaFile->top - metaFile->bottom)/2.0);
+    yoffset = - (double)((symbol->top - symbol->bottom)/2.0);
 
-  if (metaFile->right > metaFile->left)
-    xoffset = - (double)((metaFile->right - metaFile->left)/2.0);
+  if (symbol->right > symbol->left)
+    xoffset = - (double)((symbol->right - symbol->left)/2.0);
   else
-    xoffset = - (double)((metaFile->left - metaFile->right)/2.0);
+    xoffset = - (double)((symbol->left - symbol->right)/2.0);
 
   Translate(xoffset, yoffset);
 
@@ -1412,7 +2252,6 @@ bool wxPseudoMetaFile::LoadFromMetaFile(const wxString& filename, double *rwidth
   m_width = (actualWidth*initialScaleX);
   m_height = *rheight;
 
-  delete metaFile;
   return true;
 }
 
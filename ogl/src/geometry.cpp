@@ -0,0 +1,369 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        geometry.cpp
+// Purpose:     Batch geometry kernels over rectangle and segment buffers
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+// For compilers that support precompilation, includes "wx.h".
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+#include "wx/wx.h"
+#endif
+
+#ifdef new
+#undef new
+#endif
+
+#include "wx/ogl/ogl.h"
+
+#if !defined(wxOGL_NO_SIMD) && defined(__AVX__)
+#define wxOGL_USE_AVX 1
+#include <immintrin.h>
+#elif !defined(wxOGL_NO_SIMD) && \
+      (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define wxOGL_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Each kernel has a vector loop over whole blocks of lanes, and finishes
+// the remainder with the scalar code, which is the whole of the fallback.
+// The vector code must give the same answer as the scalar code for every
+// lane, so the scalar code is the reference for both.
+
+#if wxOGL_USE_AVX
+
+const size_t LANES = 4;
+
+typedef __m256d vec;
+
+inline vec Load(const double *p) { return _mm256_loadu_pd(p); }
+inline vec Set(double d) { return _mm256_set1_pd(d); }
+inline vec Lt(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline vec Le(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+inline vec And(vec a, vec b) { return _mm256_and_pd(a, b); }
+inline vec AndNot(vec a, vec b) { return _mm256_andnot_pd(a, b); }
+inline vec Add(vec a, vec b) { return _mm256_add_pd(a, b); }
+inline vec Sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+inline vec Mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+inline vec Div(vec a, vec b) { return _mm256_div_pd(a, b); }
+inline vec Min(vec a, vec b) { return _mm256_min_pd(a, b); }
+inline vec Max(vec a, vec b) { return _mm256_max_pd(a, b); }
+inline vec Select(vec mask, vec a, vec b) { return _mm256_blendv_pd(b, a, mask); }
+inline int Mask(vec a) { return _mm256_movemask_pd(a); }
+inline void Store(double *p, vec a) { _mm256_storeu_pd(p, a); }
+
+#elif wxOGL_USE_SSE2
+
+const size_t LANES = 2;
+
+typedef __m128d vec;
+
+inline vec Load(const double *p) { return _mm_loadu_pd(p); }
+inline vec Set(double d) { return _mm_set1_pd(d); }
+inline vec Lt(vec a, vec b) { return _mm_cmplt_pd(a, b); }
+inline vec Le(vec a, vec b) { return _mm_cmple_pd(a, b); }
+inline vec And(vec a, vec b) { return _mm_and_pd(a, b); }
+inline vec AndNot(vec a, vec b) { return _mm_andnot_pd(a, b); }
+inline vec Add(vec a, vec b) { return _mm_add_pd(a, b); }
+inline vec Sub(vec a, vec b) { return _mm_sub_pd(a, b); }
+inline vec Mul(vec a, vec b) { return _mm_mul_pd(a, b); }
+inline vec Div(vec a, vec b) { return _mm_div_pd(a, b); }
+inline vec Min(vec a, vec b) { return _mm_min_pd(a, b); }
+inline vec Max(vec a, vec b) { return _mm_max_pd(a, b); }
+inline vec Select(vec mask, vec a, vec b)
+{ return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+inline int Mask(vec a) { return _mm_movemask_pd(a); }
+inline void Store(double *p, vec a) { _mm_storeu_pd(p, a); }
+
+#endif
+
+#if wxOGL_USE_AVX || wxOGL_USE_SSE2
+#define wxOGL_USE_VECTORS 1
+
+inline double Lane(vec a, size_t i)
+{
+  double d[LANES];
+  Store(d, a);
+  return d[i];
+}
+
+#endif
+
+// The same tolerance oglCheckLineIntersection uses for parallel lines.
+const double PARALLEL = 0.005;
+
+inline bool Touches(double l, double t, double r, double b,
+                    double left, double top, double right, double bottom)
+{
+  return l <= right && left <= r && t <= bottom && top <= b;
+}
+
+inline bool Overlaps(double l, double t, double r, double b,
+                     double left, double top, double right, double bottom)
+{
+  return l < r && t < b && l < right && left < r && t < bottom && top < b;
+}
+
+inline double Intersect(double x1, double y1, double x2, double y2,
+                        double x3, double y3, double x4, double y4)
+{
+  double ratio, other;
+  oglCheckLineIntersection(x1, y1, x2, y2, x3, y3, x4, y4, &ratio, &other);
+  return ratio;
+}
+
+} // namespace
+
+void wxOGLRectBuffer::Reserve(size_t n)
+{
+  m_left.reserve(n);
+  m_top.reserve(n);
+  m_right.reserve(n);
+  m_bottom.reserve(n);
+}
+
+void wxOGLSegmentBuffer::Reserve(size_t n)
+{
+  m_x1.reserve(n);
+  m_y1.reserve(n);
+  m_x2.reserve(n);
+  m_y2.reserve(n);
+}
+
+int wxOGLGeometry::FindLastTouching(const wxOGLRectBuffer& rects, size_t end,
+                                    double left, double top, double right, double bottom)
+{
+  const double *l = rects.GetLefts(), *t = rects.GetTops();
+  const double *r = rects.GetRights(), *b = rects.GetBottoms();
+  size_t i = wxMin(end, rects.GetCount());
+
+#if wxOGL_USE_VECTORS
+  vec vleft = Set(left), vtop = Set(top), vright = Set(right), vbottom = Set(bottom);
+
+  while (i >= LANES)
+  {
+    size_t base = i - LANES;
+    vec hit = And(And(Le(Load(l + base), vright), Le(vleft, Load(r + base))),
+                  And(Le(Load(t + base), vbottom), Le(vtop, Load(b + base))));
+    int mask = Mask(hit);
+
+    if (mask)
+    {
+      int lane = LANES - 1;
+      while (!(mask & (1 << lane)))
+        lane--;
+      return int(base + lane);
+    }
+
+    i = base;
+  }
+#endif
+
+  while (i-- > 0)
+  {
+    if (Touches(l[i], t[i], r[i], b[i], left, top, right, bottom))
+      return int(i);
+  }
+
+  return -1;
+}
+
+size_t wxOGLGeometry::FindOverlapping(const wxOGLRectBuffer& rects,
+                                      double left, double top, double right, double bottom,
+                                      unsigned char *flags, double grow)
+{
+  const double *l = rects.GetLefts(), *t = rects.GetTops();
+  const double *r = rects.GetRights(), *b = rects.GetBottoms();
+  size_t n = rects.GetCount(), i = 0, count = 0;
+
+  if (!(left < right && top < bottom))
+  {
+    for (i = 0; i < n; i++)
+      flags[i] = 0;
+    return 0;
+  }
+
+#if wxOGL_USE_VECTORS
+  vec vleft = Set(left), vtop = Set(top), vright = Set(right), vbottom = Set(bottom);
+  vec vgrow = Set(grow);
+
+  for (; i + LANES <= n; i += LANES)
+  {
+    vec gl = Sub(Load(l + i), vgrow), gt = Sub(Load(t + i), vgrow);
+    vec gr = Add(Load(r + i), vgrow), gb = Add(Load(b + i), vgrow);
+
+    vec hit = And(And(Lt(gl, gr), Lt(gt, gb)),
+                  And(And(Lt(gl, vright), Lt(vleft, gr)),
+                      And(Lt(gt, vbottom), Lt(vtop, gb))));
+    int mask = Mask(hit);
+
+    for (size_t j = 0; j < LANES; j++)
+    {
+      flags[i + j] = (unsigned char)((mask >> j) & 1);
+      count += flags[i + j];
+    }
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    flags[i] = Overlaps(l[i] - grow, t[i] - grow, r[i] + grow, b[i] + grow,
+                        left, top, right, bottom);
+    count += flags[i];
+  }
+
+  return count;
+}
+
+bool wxOGLGeometry::GetBounds(const wxOGLRectBuffer& rects,
+                              double *left, double *top, double *right, double *bottom)
+{
+  const double *l = rects.GetLefts(), *t = rects.GetTops();
+  const double *r = rects.GetRights(), *b = rects.GetBottoms();
+  size_t n = rects.GetCount(), i = 0;
+
+  const double huge = 1e300;
+  double minL = huge, minT = huge, maxR = -huge, maxB = -huge;
+
+#if wxOGL_USE_VECTORS
+  if (n >= LANES)
+  {
+    vec vminL = Set(huge), vminT = Set(huge), vmaxR = Set(-huge), vmaxB = Set(-huge);
+    vec vhuge = Set(huge), vnhuge = Set(-huge);
+
+    for (; i + LANES <= n; i += LANES)
+    {
+      vec vl = Load(l + i), vt = Load(t + i), vr = Load(r + i), vb = Load(b + i);
+      vec used = And(Lt(vl, vr), Lt(vt, vb));
+
+      vminL = Min(vminL, Select(used, vl, vhuge));
+      vminT = Min(vminT, Select(used, vt, vhuge));
+      vmaxR = Max(vmaxR, Select(used, vr, vnhuge));
+      vmaxB = Max(vmaxB, Select(used, vb, vnhuge));
+    }
+
+    for (size_t j = 0; j < LANES; j++)
+    {
+      minL = wxMin(minL, Lane(vminL, j));
+      minT = wxMin(minT, Lane(vminT, j));
+      maxR = wxMax(maxR, Lane(vmaxR, j));
+      maxB = wxMax(maxB, Lane(vmaxB, j));
+    }
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    if (l[i] < r[i] && t[i] < b[i])
+    {
+      minL = wxMin(minL, l[i]);
+      minT = wxMin(minT, t[i]);
+      maxR = wxMax(maxR, r[i]);
+      maxB = wxMax(maxB, b[i]);
+    }
+  }
+
+  if (!(minL < maxR))
+    return false;
+
+  *left = minL;
+  *top = minT;
+  *right = maxR;
+  *bottom = maxB;
+
+  return true;
+}
+
+double wxOGLGeometry::IntersectSegments(double x1, double y1, double x2, double y2,
+                                        const double *x3, const double *y3,
+                                        const double *x4, const double *y4,
+                                        size_t n, double *ratios)
+{
+  double minRatio = 1.0;
+  size_t i = 0;
+
+#if wxOGL_USE_VECTORS
+  vec vx1 = Set(x1), vy1 = Set(y1);
+  vec dx12 = Set(x2 - x1), dy12 = Set(y2 - y1);
+  vec zero = Set(0.0), one = Set(1.0);
+  vec ptol = Set(PARALLEL), ntol = Set(-PARALLEL);
+  vec vmin = one;
+
+  for (; i + LANES <= n; i += LANES)
+  {
+    vec vx3 = Load(x3 + i), vy3 = Load(y3 + i);
+    vec dx34 = Sub(Load(x4 + i), vx3), dy34 = Sub(Load(y4 + i), vy3);
+
+    vec den = Sub(Mul(dy34, dx12), Mul(dy12, dx34));
+    vec num = Add(Mul(Sub(vx3, vx1), dy34), Mul(dx34, Sub(vy1, vy3)));
+    vec parallel = And(Lt(den, ptol), Lt(ntol, den));
+    vec lc = Div(num, den);
+    vec hit = AndNot(parallel, And(Lt(lc, one), Lt(zero, lc)));
+
+    // where the other segment is near horizontal its position along it is
+    // measured on x, otherwise on y
+    vec flat = And(Lt(dy34, ptol), Lt(ntol, dy34));
+    vec kx = Div(Add(Sub(vx1, vx3), Mul(lc, dx12)), dx34);
+    vec ky = Div(Add(Sub(vy1, vy3), Mul(lc, dy12)), dy34);
+    vec k = Select(flat, kx, ky);
+    hit = And(hit, And(Le(zero, k), Lt(k, one)));
+
+    vec ratio = Select(hit, lc, one);
+    vmin = Min(vmin, ratio);
+
+    if (ratios)
+      Store(ratios + i, ratio);
+  }
+
+  for (size_t j = 0; j < LANES; j++)
+    minRatio = wxMin(minRatio, Lane(vmin, j));
+#endif
+
+  for (; i < n; i++)
+  {
+    double ratio = Intersect(x1, y1, x2, y2, x3[i], y3[i], x4[i], y4[i]);
+    minRatio = wxMin(minRatio, ratio);
+
+    if (ratios)
+      ratios[i] = ratio;
+  }
+
+  return minRatio;
+}
+
+double wxOGLGeometry::IntersectSegments(double x1, double y1, double x2, double y2,
+                                        const wxOGLSegmentBuffer& segments,
+                                        size_t first, size_t last,
+                                        double *ratios)
+{
+  if (first >= last)
+    return 1.0;
+
+  return IntersectSegments(x1, y1, x2, y2,
+                           segments.GetX1s() + first, segments.GetY1s() + first,
+                           segments.GetX2s() + first, segments.GetY2s() + first,
+                           last - first, ratios);
+}
+
+const char *wxOGLGeometry::GetInstructionSet()
+{
+#if wxOGL_USE_AVX
+  return "avx";
+#elif wxOGL_USE_SSE2
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
@@ -29,6 +29,92 @@
 #include "wx/ogl/ogl.h"
 
 
+// Line points
+wxLinePoints::wxLinePoints()
+  : m_points(m_inline), m_count(0), m_capacity(INLINE_POINTS)
+{
+}
+
+wxLinePoints::wxLinePoints(const wxLinePoints& copy)
+  : m_points(m_inline), m_count(0), m_capacity(INLINE_POINTS)
+{
+  *this = copy;
+}
+
+wxLinePoints::~wxLinePoints()
+{
+  if (!IsInline())
+    delete[] m_points;
+}
+
+wxLinePoints& wxLinePoints::operator=(const wxLinePoints& copy)
+{
+  if (&copy != this)
+  {
+    m_count = 0;
+    Reserve(copy.m_count);
+    for (size_t i = 0; i < copy.m_count; i++)
+      m_points[i] = copy.m_points[i];
+    m_count = copy.m_count;
+  }
+  return *this;
+}
+
+void wxLinePoints::Reserve(size_t n)
+{
+  if (n <= m_capacity)
+    return;
+
+  size_t capacity = m_capacity * 2;
+  if (capacity < n)
+    capacity = n;
+
+  wxRealPoint *points = new wxRealPoint[capacity];
+  for (size_t i = 0; i < m_count; i++)
+    points[i] = m_points[i];
+
+  if (!IsInline())
+    delete[] m_points;
+
+  m_points = points;
+  m_capacity = capacity;
+}
+
+void wxLinePoints::SetCount(size_t n, const wxRealPoint& pt)
+{
+  Reserve(n);
+  for (size_t i = m_count; i < n; i++)
+    m_points[i] = pt;
+  m_count = n;
+}
+
+void wxLinePoints::Insert(size_t i, const wxRealPoint& pt)
+{
+  wxASSERT(i <= m_count);
+  Reserve(m_count + 1);
+  for (size_t j = m_count; j > i; j--)
+    m_points[j] = m_points[j - 1];
+  m_points[i] = pt;
+  m_count++;
+}
+
+void wxLinePoints::RemoveAt(size_t i)
+{
+  wxASSERT(i < m_count);
+  for (size_t j = i + 1; j < m_count; j++)
+    m_points[j - 1] = m_points[j];
+  m_count--;
+}
+
+void wxLinePoints::Clear()
+{
+  if (!IsInline())
+    delete[] m_points;
+  m_points = m_inline;
+  m_count = 0;
+  m_capacity = INLINE_POINTS;
+}
+
 // Line shape
 IMPLEMENT_DYNAMIC_CLASS(wxLineShape, wxShape)
 
@@ -38,12 +124,16 @@ wxLineShape::wxLineShape()
   m_draggable = false;
   m_attachmentTo = 0;
   m_attachmentFrom = 0;
+  m_nthTo = -1;
+  m_nthFrom = -1;
 /*
   m_actualTextWidth = 0.0;
   m_actualTextHeight = 0.0;
 */
   m_from = NULL;
   m_to = NULL;
+  m_lineControlPointList = NULL;
+  m_lineControlPointListDirty = true;
   m_erasing = false;
   m_arrowSpacing = 5.0; // For the moment, don't bother saving this to file.
   m_ignoreArrowOffsets = false;
@@ -52,8 +142,6 @@ wxLineShape::wxLineShape()
   m_alignmentStart = 0;
   m_alignmentEnd = 0;
 
-  m_lineControlPoints = NULL;
-
   // Clear any existing regions (created in an earlier constructor)
   // and make the three line regions.
   ClearRegions();
@@ -78,11 +166,6 @@ wxLineShape::wxLineShape()
 
 wxLineShape::~wxLineShape()
 {
-  if (m_lineControlPoints)
-  {
-    ClearPointList(*m_lineControlPoints);
-    delete m_lineControlPoints;
-  }
   for (int i = 0; i < 3; i++)
   {
     if (m_labelObjects[i])
@@ -94,22 +177,14 @@ wxLineShape::~wxLineShape()
     }
   }
   ClearArrowsAtPosition(-1);
+  delete m_lineControlPointList;
 }
 
 void wxLineShape::MakeLineControlPoints(int n)
 {
-  if (m_lineControlPoints)
-  {
-    ClearPointList(*m_lineControlPoints);
-    delete m_lineControlPoints;
-  }
-  m_lineControlPoints = new wxList;
-
-  for (int i = 0; i < n; i++)
-  {
-    wxRealPoint *point = new wxRealPoint(-999, -999);
-    m_lineControlPoints->Append((wxObject*) point);
-  }
+  m_lineControlPoints.Clear();
+  m_lineControlPoints.SetCount(n, wxRealPoint(-999, -999));
+  m_lineControlPointListDirty = true;
 }
 
 wxNode *wxLineShape::InsertLineControlPoint(wxDC* dc)
@@ -117,53 +192,87 @@ wxNode *wxLineShape::InsertLineControlPoint(wxDC* dc)
     if (dc)
         Erase(*dc);
 
-  wxNode *last = m_lineControlPoints->GetLast();
-  wxNode *second_last = last->GetPrevious();
-  wxRealPoint *last_point = (wxRealPoint *)last->GetData();
-  wxRealPoint *second_last_point = (wxRealPoint *)second_last->GetData();
+  int n = m_lineControlPoints.GetCount();
+  const wxRealPoint& last_point = m_lineControlPoints[n - 1];
+  const wxRealPoint& second_last_point = m_lineControlPoints[n - 2];
 
   // Choose a point half way between the last and penultimate points
-  double line_x = ((last_point->x + second_last_point->x)/2);
-  double line_y = ((last_point->y + second_last_point->y)/2);
+  double line_x = ((last_point.x + second_last_point.x)/2);
+  double line_y = ((last_point.y + second_last_point.y)/2);
+
+  m_lineControlPoints.Insert(n - 1, wxRealPoint(line_x, line_y));
+  m_lineControlPointListDirty = true;
+  ShiftControlPoints(n - 1, 1);
 
-  wxRealPoint *point = new wxRealPoint(line_x, line_y);
-  wxNode *node = m_lineControlPoints->Insert(last, (wxObject*) point);
-  return node;
+  // Only code still using the deprecated list can want a node of it
+  if (!m_lineControlPointList)
+    return NULL;
+  return SyncLineControlPoints()->Item(n - 1);
 }
 
 bool wxLineShape::DeleteLineControlPoint()
 {
-  if (m_lineControlPoints->GetCount() < 3)
+  if (m_lineControlPoints.GetCount() < 3)
     return false;
 
-  wxNode *last = m_lineControlPoints->GetLast();
-  wxNode *second_last = last->GetPrevious();
-
-  wxRealPoint *second_last_point = (wxRealPoint *)second_last->GetData();
-  delete second_last_point;
-  delete second_last;
+  int n = m_lineControlPoints.GetCount();
+  m_lineControlPoints.RemoveAt(n - 2);
+  m_lineControlPointListDirty = true;
+  ShiftControlPoints(n - 1, -1);
 
   return true;
 }
 
+// Keep the handles pointing at the same line points after points are
+// inserted or removed before them.
+void wxLineShape::ShiftControlPoints(int from, int offset)
+{
+  wxNode *node = m_controlPoints.GetFirst();
+  while (node)
+  {
+    wxLineControlPoint *control = (wxLineControlPoint *)node->GetData();
+    if (control->m_index >= from)
+      control->m_index += offset;
+    node = node->GetNext();
+  }
+}
+
+wxList *wxLineShape::SyncLineControlPoints()
+{
+  if (!m_lineControlPointList)
+    m_lineControlPointList = new wxList;
+
+  // Points added or removed through GetLinePoints() don't mark the list
+  // dirty, but they change the count or move the points
+  size_t count = m_lineControlPoints.GetCount();
+  wxNode *first = m_lineControlPointList->GetFirst();
+  if (!m_lineControlPointListDirty &&
+      m_lineControlPointList->GetCount() == count &&
+      (!first || first->GetData() == (wxObject*) m_lineControlPoints.GetData()))
+    return m_lineControlPointList;
+
+  m_lineControlPointList->Clear();
+  for (size_t i = 0; i < count; i++)
+    m_lineControlPointList->Append((wxObject*) &m_lineControlPoints[i]);
+  m_lineControlPointListDirty = false;
+
+  return m_lineControlPointList;
+}
+
 void wxLineShape::Initialise()
 {
-  if (m_lineControlPoints)
+  if (!m_lineControlPoints.IsEmpty())
   {
     // Just move the first and last control points
-    wxNode *first = m_lineControlPoints->GetFirst();
-    wxRealPoint *first_point = (wxRealPoint *)first->GetData();
-
-    wxNode *last = m_lineControlPoints->GetLast();
-    wxRealPoint *last_point = (wxRealPoint *)last->GetData();
+    wxRealPoint *first_point = &m_lineControlPoints.GetFirst();
+    wxRealPoint *last_point = &m_lineControlPoints.GetLast();
 
     // If any of the line points are at -999, we must
     // initialize them by placing them half way between the first
     // and the last.
-    wxNode *node = first->GetNext();
-    while (node)
+    for (size_t i = 1; i < m_lineControlPoints.GetCount(); i++)
     {
-      wxRealPoint *point = (wxRealPoint *)node->GetData();
+      wxRealPoint *point = &m_lineControlPoints[i];
       if (point->x == -999)
       {
         double x1, y1, x2, y2;
@@ -180,7 +289,6 @@ void wxLineShape::Initialise()
         point->x = ((x2 - x1)/2 + x1);
         point->y = ((y2 - y1)/2 + y1);
       }
-      node = node->GetNext();
     }
   }
 }
@@ -321,33 +429,29 @@ void wxLineShape::GetLabelPosition(int position, double *x, double *y)
     case 0:
     {
       // Want to take the middle section for the label
-      int n = m_lineControlPoints->GetCount();
+      int n = m_lineControlPoints.GetCount();
       int half_way = (int)(n/2);
 
       // Find middle of this line
-      wxNode *node = m_lineControlPoints->Item(half_way - 1);
-      wxRealPoint *point = (wxRealPoint *)node->GetData();
-      wxNode *next_node = node->GetNext();
-      wxRealPoint *next_point = (wxRealPoint *)next_node->GetData();
-
-      double dx = (next_point->x - point->x);
-      double dy = (next_point->y - point->y);
-      *x = (double)(point->x + dx/2.0);
-      *y = (double)(point->y + dy/2.0);
+      const wxRealPoint& point = m_lineControlPoints[half_way - 1];
+      const wxRealPoint& next_point = m_lineControlPoints[half_way];
+
+      double dx = (next_point.x - point.x);
+      double dy = (next_point.y - point.y);
+      *x = (double)(point.x + dx/2.0);
+      *y = (double)(point.y + dy/2.0);
       break;
     }
     case 1:
     {
-      wxNode *node = m_lineControlPoints->GetFirst();
-      *x = ((wxRealPoint *)node->GetData())->x;
-      *y = ((wxRealPoint *)node->GetData())->y;
+      *x = m_lineControlPoints.GetFirst().x;
+      *y = m_lineControlPoints.GetFirst().y;
       break;
     }
     case 2:
     {
-      wxNode *node = m_lineControlPoints->GetLast();
-      *x = ((wxRealPoint *)node->GetData())->x;
-      *y = ((wxRealPoint *)node->GetData())->y;
+      *x = m_lineControlPoints.GetLast().x;
+      *y = m_lineControlPoints.GetLast().y;
       break;
     }
     default:
@@ -376,30 +480,19 @@ void GraphicsStraightenLine(wxRealPoint *point1, wxRealPoint *point2)
 
 void wxLineShape::Straighten(wxDC *dc)
 {
-  if (!m_lineControlPoints || m_lineControlPoints->GetCount() < 3)
+  size_t n = m_lineControlPoints.GetCount();
+  if (n < 3)
     return;
 
   if (dc)
     Erase(* dc);
 
-  wxNode *first_point_node = m_lineControlPoints->GetFirst();
-  wxNode *last_point_node = m_lineControlPoints->GetLast();
-  wxNode *second_last_point_node = last_point_node->GetPrevious();
+  wxRealPoint *points = m_lineControlPoints.GetData();
 
-  wxRealPoint *last_point = (wxRealPoint *)last_point_node->GetData();
-  wxRealPoint *second_last_point = (wxRealPoint *)second_last_point_node->GetData();
+  GraphicsStraightenLine(&points[n - 1], &points[n - 2]);
 
-  GraphicsStraightenLine(last_point, second_last_point);
-
-  wxNode *node = first_point_node;
-  while (node && (node != second_last_point_node))
-  {
-    wxRealPoint *point = (wxRealPoint *)node->GetData();
-    wxRealPoint *next_point = (wxRealPoint *)(node->GetNext()->GetData());
-
-    GraphicsStraightenLine(point, next_point);
-    node = node->GetNext();
-  }
+  for (size_t i = 0; i < n - 2; i++)
+    GraphicsStraightenLine(&points[i], &points[i + 1]);
 
   if (dc)
     Draw(* dc);
@@ -409,9 +502,15 @@ void wxLineShape::Straighten(wxDC *dc)
 void wxLineShape::Unlink()
 {
   if (m_to)
+  {
     m_to->GetLines().DeleteObject(this);
+    m_to->InvalidateLineOrder();
+  }
   if (m_from)
+  {
     m_from->GetLines().DeleteObject(this);
+    m_from->InvalidateLineOrder();
+  }
   m_to = NULL;
   m_from = NULL;
 }
@@ -419,15 +518,13 @@ void wxLineShape::Unlink()
 void wxLineShape::SetEnds(double x1, double y1, double x2, double y2)
 {
   // Find centre point
-  wxNode *first_point_node = m_lineControlPoints->GetFirst();
-  wxNode *last_point_node = m_lineControlPoints->GetLast();
-  wxRealPoint *first_point = (wxRealPoint *)first_point_node->GetData();
-  wxRealPoint *last_point = (wxRealPoint *)last_point_node->GetData();
+  wxRealPoint& first_point = m_lineControlPoints.GetFirst();
+  wxRealPoint& last_point = m_lineControlPoints.GetLast();
 
-  first_point->x = x1;
-  first_point->y = y1;
-  last_point->x = x2;
-  last_point->y = y2;
+  first_point.x = x1;
+  first_point.y = y1;
+  last_point.x = x2;
+  last_point.y = y2;
 
   m_xpos = (double)((x1 + x2)/2.0);
   m_ypos = (double)((y1 + y2)/2.0);
@@ -436,24 +533,26 @@ void wxLineShape::SetEnds(double x1, double y1, double x2, double y2)
 // Get absolute positions of ends
 void wxLineShape::GetEnds(double *x1, double *y1, double *x2, double *y2)
 {
-  wxNode *first_point_node = m_lineControlPoints->GetFirst();
-  wxNode *last_point_node = m_lineControlPoints->GetLast();
-  wxRealPoint *first_point = (wxRealPoint *)first_point_node->GetData();
-  wxRealPoint *last_point = (wxRealPoint *)last_point_node->GetData();
+  const wxRealPoint& first_point = m_lineControlPoints.GetFirst();
+  const wxRealPoint& last_point = m_lineControlPoints.GetLast();
 
-  *x1 = first_point->x; *y1 = first_point->y;
-  *x2 = last_point->x; *y2 = last_point->y;
+  *x1 = first_point.x; *y1 = first_point.y;
+  *x2 = last_point.x; *y2 = last_point.y;
 }
 
 void wxLineShape::SetAttachments(int from_attach, int to_attach)
 {
   m_attachmentFrom = from_attach;
   m_attachmentTo = to_attach;
+  if (m_from)
+    m_from->InvalidateLineOrder();
+  if (m_to)
+    m_to->InvalidateLineOrder();
 }
 
 bool wxLineShape::HitTest(double x, double y, int *attachment, double *distance)
 {
-  if (!m_lineControlPoints)
+  if (m_lineControlPoints.IsEmpty())
     return false;
 
   // Look at label regions in case mouse is over a label
@@ -486,12 +585,12 @@ bool wxLineShape::HitTest(double x, double y, int *attachment, double *distance)
     }
   }
 
-  wxNode *node = m_lineControlPoints->GetFirst();
+  const wxRealPoint *points = m_lineControlPoints.GetData();
 
-  while (node && node->GetNext())
+  for (size_t i = 0; i + 1 < m_lineControlPoints.GetCount(); i++)
   {
-    wxRealPoint *point1 = (wxRealPoint *)node->GetData();
-    wxRealPoint *point2 = (wxRealPoint *)node->GetNext()->GetData();
+    const wxRealPoint *point1 = &points[i];
+    const wxRealPoint *point2 = &points[i + 1];
 
     // For inaccurate mousing allow 8 pixel corridor
     int extra = 4;
@@ -512,8 +611,6 @@ bool wxLineShape::HitTest(double x, double y, int *attachment, double *distance)
       *distance = distance_from_seg;
       return true;
     }
-
-    node = node->GetNext();
   }
   return false;
 }
@@ -573,15 +670,12 @@ void wxLineShape::DrawArrows(wxDC& dc)
 
 void wxLineShape::DrawArrow(wxDC& dc, wxArrowHead *arrow, double xOffset, bool proportionalOffset)
 {
-  wxNode *first_line_node = m_lineControlPoints->GetFirst();
-  wxRealPoint *first_line_point = (wxRealPoint *)first_line_node->GetData();
-  wxNode *second_line_node = first_line_node->GetNext();
-  wxRealPoint *second_line_point = (wxRealPoint *)second_line_node->GetData();
+  size_t n = m_lineControlPoints.GetCount();
+  wxRealPoint *first_line_point = &m_lineControlPoints[0];
+  wxRealPoint *second_line_point = &m_lineControlPoints[1];
 
-  wxNode *last_line_node = m_lineControlPoints->GetLast();
-  wxRealPoint *last_line_point = (wxRealPoint *)last_line_node->GetData();
-  wxNode *second_last_line_node = last_line_node->GetPrevious();
-  wxRealPoint *second_last_line_point = (wxRealPoint *)second_last_line_node->GetData();
+  wxRealPoint *last_line_point = &m_lineControlPoints[n - 1];
+  wxRealPoint *second_last_line_point = &m_lineControlPoints[n - 2];
 
   // Position where we want to start drawing
   double positionOnLineX = 0.0, positionOnLineY = 0.0;
@@ -886,17 +980,14 @@ void wxLineShape::GetBoundingBoxMin(double *w, double *h)
   double x2 = -10000;
   double y2 = -10000;
 
-  wxNode *node = m_lineControlPoints->GetFirst();
-  while (node)
+  for (size_t i = 0; i < m_lineControlPoints.GetCount(); i++)
   {
-    wxRealPoint *point = (wxRealPoint *)node->GetData();
+    const wxRealPoint& point = m_lineControlPoints[i];
 
-    if (point->x < x1) x1 = point->x;
-    if (point->y < y1) y1 = point->y;
-    if (point->x > x2) x2 = point->x;
-    if (point->y > y2) y2 = point->y;
-
-    node = node->GetNext();
+    if (point.x < x1) x1 = point.x;
+    if (point.y < y1) y1 = point.y;
+    if (point.x > x2) x2 = point.x;
+    if (point.y > y2) y2 = point.y;
   }
   *w = (double)(x2 - x1);
   *h = (double)(y2 - y1);
@@ -909,6 +1000,15 @@ void wxLineShape::GetBoundingBoxMin(double *w, double *h)
  */
 void wxLineShape::FindNth(wxShape *image, int *nth, int *no_arcs, bool incoming)
 {
+  // The image keeps the positions of its lines, except that a self link
+  // with different attachments at each end is counted against the
+  // attachment of the end in question, so walk the lines for those.
+  if (m_from != m_to || m_attachmentFrom == m_attachmentTo)
+  {
+    image->GetLineOrder(this, incoming, nth, no_arcs);
+    return;
+  }
+
   int n = -1;
   int num = 0;
   wxNode *node = image->GetLines().GetFirst();
@@ -973,17 +1073,13 @@ bool wxLineShape::OnMovePre(wxDC& dc, double x, double y, double old_x, double o
   double x_offset = x - old_x;
   double y_offset = y - old_y;
 
-  if (m_lineControlPoints && !(x_offset == 0.0 && y_offset == 0.0))
+  if (!(x_offset == 0.0 && y_offset == 0.0))
   {
-    wxNode *node = m_lineControlPoints->GetFirst();
-    while (node)
+    for (size_t i = 0; i < m_lineControlPoints.GetCount(); i++)
     {
-      wxRealPoint *point = (wxRealPoint *)node->GetData();
-      point->x += x_offset;
-      point->y += y_offset;
-      node = node->GetNext();
+      m_lineControlPoints[i].x += x_offset;
+      m_lineControlPoints[i].y += y_offset;
     }
-
   }
 
   // Move temporary label rectangles if necessary
@@ -1016,7 +1112,7 @@ void wxLineShape::OnMoveLink(wxDC& dc, bool moveControlPoints)
   if (!m_from || !m_to)
    return;
 
-    if (m_lineControlPoints->GetCount() > 2)
+    if (m_lineControlPoints.GetCount() > 2)
       Initialise();
 
     // Do each end - nothing in the middle. User has to move other points
@@ -1026,16 +1122,6 @@ void wxLineShape::OnMoveLink(wxDC& dc, bool moveControlPoints)
 
     FindLineEndPoints(&end_x, &end_y, &other_end_x, &other_end_y);
 
-    wxNode *first = m_lineControlPoints->GetFirst();
-    /* wxRealPoint *first_point = */ (wxRealPoint *)first->GetData();
-    wxNode *last = m_lineControlPoints->GetLast();
-    /* wxRealPoint *last_point = */ (wxRealPoint *)last->GetData();
-
-/* This is redundant, surely? Done by SetEnds.
-    first_point->x = end_x; first_point->y = end_y;
-    last_point->x = other_end_x; last_point->y = other_end_y;
-*/
-
     double oldX = m_xpos;
     double oldY = m_ypos;
 
@@ -1051,18 +1137,12 @@ void wxLineShape::OnMoveLink(wxDC& dc, bool moveControlPoints)
 
 //    if (moveControlPoints && m_lineControlPoints && !(x_offset == 0.0 && y_offset == 0.0))
     // Only move control points if it's a self link. And only works if attachment mode is ON.
-    if ((m_from == m_to) && (m_from->GetAttachmentMode() != ATTACHMENT_MODE_NONE) && moveControlPoints && m_lineControlPoints && !(x_offset == 0.0 && y_offset == 0.0))
+    if ((m_from == m_to) && (m_from->GetAttachmentMode() != ATTACHMENT_MODE_NONE) && moveControlPoints && !(x_offset == 0.0 && y_offset == 0.0))
     {
-      wxNode *node = m_lineControlPoints->GetFirst();
-      while (node)
+      for (size_t i = 1; i + 1 < m_lineControlPoints.GetCount(); i++)
       {
-        if ((node != m_lineControlPoints->GetFirst()) && (node != m_lineControlPoints->GetLast()))
-        {
-          wxRealPoint *point = (wxRealPoint *)node->GetData();
-          point->x += x_offset;
-          point->y += y_offset;
-        }
-        node = node->GetNext();
+        m_lineControlPoints[i].x += x_offset;
+        m_lineControlPoints[i].y += y_offset;
       }
     }
 
@@ -1083,18 +1163,11 @@ void wxLineShape::FindLineEndPoints(double *fromXOut, double *fromYOut, double *
   double end_x = 0.0, end_y = 0.0;
   double other_end_x = 0.0, other_end_y = 0.0;
 
-  wxNode *first = m_lineControlPoints->GetFirst();
-  /* wxRealPoint *first_point = */ (wxRealPoint *)first->GetData();
-  wxNode *last = m_lineControlPoints->GetLast();
-  /* wxRealPoint *last_point = */ (wxRealPoint *)last->GetData();
+  size_t n = m_lineControlPoints.GetCount();
+  const wxRealPoint *second_point = &m_lineControlPoints[1];
+  const wxRealPoint *second_last_point = &m_lineControlPoints[n - 2];
 
-  wxNode *second = first->GetNext();
-  wxRealPoint *second_point = (wxRealPoint *)second->GetData();
-
-  wxNode *second_last = last->GetPrevious();
-  wxRealPoint *second_last_point = (wxRealPoint *)second_last->GetData();
-
-  if (m_lineControlPoints->GetCount() > 2)
+  if (n > 2)
   {
     if (m_from->GetAttachmentMode() != ATTACHMENT_MODE_NONE)
     {
@@ -1161,21 +1234,24 @@ void wxLineShape::FindLineEndPoints(double *fromXOut, double *fromYOut, double *
 
 void wxLineShape::OnDraw(wxDC& dc)
 {
-  if (m_lineControlPoints)
+  if (!m_lineControlPoints.IsEmpty())
   {
     if (m_pen)
       dc.SetPen(* m_pen);
     if (m_brush)
       dc.SetBrush(* m_brush);
 
-    int n = m_lineControlPoints->GetCount();
-    wxPoint *points = new wxPoint[n];
+    // The DC wants integer points; convert on the stack unless the
+    // route is unusually long.
+    wxPoint stackPoints[32];
+    int n = m_lineControlPoints.GetCount();
+    wxPoint *points = n <= (int)WXSIZEOF(stackPoints) ? stackPoints : new wxPoint[n];
+    const wxRealPoint *linePoints = m_lineControlPoints.GetData();
     int i;
     for (i = 0; i < n; i++)
     {
-        wxRealPoint* point = (wxRealPoint*) m_lineControlPoints->Item(i)->GetData();
-        points[i].x = WXROUND(point->x);
-        points[i].y = WXROUND(point->y);
+        points[i].x = WXROUND(linePoints[i].x);
+        points[i].y = WXROUND(linePoints[i].y);
     }
 
     if (m_isSpline)
@@ -1188,7 +1264,8 @@ void wxLineShape::OnDraw(wxDC& dc)
     dc.DrawPoint(points[n-1]);
 #endif
 
-    delete[] points;
+    if (points != stackPoints)
+      delete[] points;
 
 
     // Problem with pen - if not a solid pen, does strange things
@@ -1284,50 +1361,54 @@ void wxLineShape::OnDrawContents(wxDC& dc)
 
 void wxLineShape::SetTo(wxShape *object)
 {
+  if (m_to)
+    m_to->InvalidateLineOrder();
   m_to = object;
+  if (m_to)
+    m_to->InvalidateLineOrder();
 }
 
 void wxLineShape::SetFrom(wxShape *object)
 {
+  if (m_from)
+    m_from->InvalidateLineOrder();
   m_from = object;
+  if (m_from)
+    m_from->InvalidateLineOrder();
 }
 
 void wxLineShape::MakeControlPoints()
 {
-  if (m_canvas && m_lineControlPoints)
+  if (m_canvas && !m_lineControlPoints.IsEmpty())
   {
-    wxNode *first = m_lineControlPoints->GetFirst();
-    wxNode *last = m_lineControlPoints->GetLast();
-    wxRealPoint *first_point = (wxRealPoint *)first->GetData();
-    wxRealPoint *last_point = (wxRealPoint *)last->GetData();
+    int last = m_lineControlPoints.GetCount() - 1;
+    const wxRealPoint& first_point = m_lineControlPoints[0];
+    const wxRealPoint& last_point = m_lineControlPoints[last];
 
     wxLineControlPoint *control = new wxLineControlPoint(m_canvas, this, CONTROL_POINT_SIZE,
-                                               first_point->x, first_point->y,
+                                               first_point.x, first_point.y,
                                                CONTROL_POINT_ENDPOINT_FROM);
-    control->m_point = first_point;
+    control->m_index = 0;
     m_canvas->AddShape(control);
     m_controlPoints.Append(control);
 
 
-    wxNode *node = first->GetNext();
-    while (node != last)
+    for (int i = 1; i < last; i++)
     {
-      wxRealPoint *point = (wxRealPoint *)node->GetData();
+      const wxRealPoint& point = m_lineControlPoints[i];
 
       control = new wxLineControlPoint(m_canvas, this, CONTROL_POINT_SIZE,
-                                               point->x, point->y,
+                                               point.x, point.y,
                                                CONTROL_POINT_LINE);
-      control->m_point = point;
+      control->m_index = i;
 
       m_canvas->AddShape(control);
       m_controlPoints.Append(control);
-
-      node = node->GetNext();
     }
     control = new wxLineControlPoint(m_canvas, this, CONTROL_POINT_SIZE,
-                                               last_point->x, last_point->y,
+                                               last_point.x, last_point.y,
                                                CONTROL_POINT_ENDPOINT_TO);
-    control->m_point = last_point;
+    control->m_index = last;
     m_canvas->AddShape(control);
     m_controlPoints.Append(control);
 
@@ -1337,19 +1418,19 @@ void wxLineShape::MakeControlPoints()
 
 void wxLineShape::ResetControlPoints()
 {
-  if (m_canvas && m_lineControlPoints && m_controlPoints.GetCount() > 0)
+  if (m_canvas && m_controlPoints.GetCount() > 0)
   {
     wxNode *node = m_controlPoints.GetFirst();
-    wxNode *control_node = m_lineControlPoints->GetFirst();
-    while (node && control_node)
+    size_t i = 0;
+    while (node && i < m_lineControlPoints.GetCount())
     {
-      wxRealPoint *point = (wxRealPoint *)control_node->GetData();
+      const wxRealPoint& point = m_lineControlPoints[i];
       wxLineControlPoint *control = (wxLineControlPoint *)node->GetData();
-      control->SetX(point->x);
-      control->SetY(point->y);
+      control->SetX(point.x);
+      control->SetY(point.y);
 
       node = node->GetNext();
-      control_node = control_node->GetNext();
+      i++;
     }
   }
 }
@@ -1379,22 +1460,8 @@ void wxLineShape::Copy(wxShape& copy)
     node = node->GetNext();
   }
 
-  if (lineCopy.m_lineControlPoints)
-  {
-    ClearPointList(*lineCopy.m_lineControlPoints);
-    delete lineCopy.m_lineControlPoints;
-  }
-
-  lineCopy.m_lineControlPoints = new wxList;
-
-  node = m_lineControlPoints->GetFirst();
-  while (node)
-  {
-    wxRealPoint *point = (wxRealPoint *)node->GetData();
-    wxRealPoint *new_point = new wxRealPoint(point->x, point->y);
-    lineCopy.m_lineControlPoints->Append((wxObject*) new_point);
-    node = node->GetNext();
-  }
+  lineCopy.m_lineControlPoints = m_lineControlPoints;
+  lineCopy.m_lineControlPointListDirty = true;
 
   // Copy arrows
   lineCopy.ClearArrowsAtPosition(-1);
@@ -1470,7 +1537,7 @@ wxLineControlPoint::wxLineControlPoint(wxShapeCanvas *theCanvas, wxShape *object
   m_xpos = x;
   m_ypos = y;
   m_type = the_type;
-  m_point = NULL;
+  m_index = -1;
 }
 
 wxLineControlPoint::~wxLineControlPoint()
@@ -1522,7 +1589,7 @@ void wxLineShape::OnSizingDragLeft(wxControlPoint* pt, bool draw, double x, doub
     m_canvas->Snap(&x, &y);
 
     lpt->SetX(x); lpt->SetY(y);
-    lpt->m_point->x = x; lpt->m_point->y = y;
+    m_lineControlPoints[lpt->m_index] = wxRealPoint(x, y);
 
     wxLineShape *lineShape = (wxLineShape *)this;
 
@@ -1556,7 +1623,7 @@ void wxLineShape::OnSizingBeginDragLeft(wxControlPoint* pt, double x, double y,
   wxLineShape *lineShape = (wxLineShape *)this;
   if (lpt->m_type == CONTROL_POINT_LINE)
   {
-    lpt->m_originalPos = * (lpt->m_point);
+    lpt->m_originalPos = m_lineControlPoints[lpt->m_index];
     m_canvas->Snap(&x, &y);
 
     this->Erase(dc);
@@ -1571,7 +1638,7 @@ void wxLineShape::OnSizingBeginDragLeft(wxControlPoint* pt, double x, double y,
     this->SetDisableLabel(true);
 
     lpt->m_xpos = x; lpt->m_ypos = y;
-    lpt->m_point->x = x; lpt->m_point->y = y;
+    m_lineControlPoints[lpt->m_index] = wxRealPoint(x, y);
 
     const wxPen *old_pen = lineShape->GetPen();
     const wxBrush *old_brush = lineShape->GetBrush();
@@ -1615,7 +1682,7 @@ void wxLineShape::OnSizingEndDragLeft(wxControlPoint* pt, double x, double y, in
     // during user feedback so we could redraw the line
     // as it changed shape.
     lpt->m_xpos = lpt->m_originalPos.x; lpt->m_ypos = lpt->m_originalPos.y;
-    lpt->m_point->x = lpt->m_originalPos.x; lpt->m_point->y = lpt->m_originalPos.y;
+    m_lineControlPoints[lpt->m_index] = lpt->m_originalPos;
 
     OnMoveMiddleControlPoint(dc, lpt, ptMid);
   }
@@ -1649,9 +1716,7 @@ void wxLineShape::OnSizingEndDragLeft(wxControlPoint* pt, double x, double y, in
   // Needed?
 #if 0
   int i = 0;
-  for (i = 0; i < lineShape->GetLineControlPoints()->GetCount(); i++)
-    if (((wxRealPoint *)(lineShape->GetLineControlPoints()->Item(i)->GetData())) == lpt->m_point)
-      break;
+  i = lpt->m_index;
 
   // N.B. in OnMoveControlPoint, an event handler in Hardy could have deselected
   // the line and therefore deleted 'this'. -> GPF, intermittently.
@@ -1665,7 +1730,7 @@ void wxLineShape::OnSizingEndDragLeft(wxControlPoint* pt, double x, double y, in
 bool wxLineShape::OnMoveMiddleControlPoint(wxDC& dc, wxLineControlPoint* lpt, const wxRealPoint& pt)
 {
     lpt->m_xpos = pt.x; lpt->m_ypos = pt.y;
-    lpt->m_point->x = pt.x; lpt->m_point->y = pt.y;
+    m_lineControlPoints[lpt->m_index] = pt;
 
     GetEventHandler()->OnMoveLink(dc);
 
@@ -1756,9 +1821,7 @@ void wxLineControlPoint::OnEndDragRight(double x, double y, int keys, int attach
     }
   }
   int i = 0;
-  for (i = 0; i < lineShape->GetLineControlPoints()->GetCount(); i++)
-    if (((wxRealPoint *)(lineShape->GetLineControlPoints()->Item(i)->GetData())) == m_point)
-      break;
+  i = m_index;
   lineShape->OnMoveControlPoint(i+1, x, y);
   if (!m_canvas->GetQuickEditMode()) m_canvas->Redraw(dc);
 }
@@ -2094,7 +2157,7 @@ int wxLineShape::GetAlignmentType(bool isEnd)
 
 wxRealPoint *wxLineShape::GetNextControlPoint(wxShape *nodeObject)
 {
-  int n = m_lineControlPoints->GetCount();
+  int n = m_lineControlPoints.GetCount();
   int nn;
   if (m_to == nodeObject)
   {
@@ -2103,11 +2166,8 @@ wxRealPoint *wxLineShape::GetNextControlPoint(wxShape *nodeObject)
     nn = n - 2;
   }
   else nn = 1;
-  wxNode *node = m_lineControlPoints->Item(nn);
-  if (node)
-  {
-    return (wxRealPoint *)node->GetData();
-  }
+  if (nn >= 0 && nn < n)
+    return &m_lineControlPoints[nn];
   else
     return NULL;
 }
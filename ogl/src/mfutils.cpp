@@ -25,49 +25,202 @@
 
 #include "wx/ogl/ogl.h"
 
-#include <stdio.h>
+#include "wx/file.h"
+
+#ifdef __UNIX__
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-static char _buf[1024]; // a temp buffer to use inplace of wxBuffer, which is deprecated.
+#ifdef __WINDOWS__
+#include "wx/msw/wrapwin.h"
+#endif
 
-// 16-bit unsigned integer
-static unsigned int getshort(FILE *fp)
+namespace
 {
-  int c, c1;
-  c = getc(fp);  c1 = getc(fp);
-  unsigned int res = ((unsigned int) c) + (((unsigned int) c1) << 8);
-  return res;
-}
 
-// 16-bit signed integer
-static int getsignedshort(FILE *fp)
+// Read-only view of a whole file: memory-mapped where the platform
+// supports it, otherwise read into a buffer with a single call.
+class MappedFile
+{
+public:
+  MappedFile(const wxChar *file);
+  ~MappedFile();
+
+  inline const unsigned char *GetData() const { return m_data; }
+  inline size_t GetSize() const { return m_size; }
+  inline bool IsOk() const { return m_data != NULL && m_size > 0; }
+
+private:
+  const unsigned char*          m_data;
+  size_t                        m_size;
+  bool                          m_mapped;
+  std::vector<unsigned char>    m_buffer;
+};
+
+MappedFile::MappedFile(const wxChar *file)
 {
-  int c, c1;
-  c = getc(fp);  c1 = getc(fp);
-#if 0
-   // this is not used value, no need to execute it
-  int testRes = ((unsigned int) c) + (((unsigned int) c1) << 8);
+  m_data = NULL;
+  m_size = 0;
+  m_mapped = false;
+
+#if defined(__UNIX__)
+  int fd = open(wxString(file).fn_str(), O_RDONLY);
+  if (fd != -1)
+  {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      void *view = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (view != MAP_FAILED)
+      {
+        m_data = (const unsigned char *)view;
+        m_size = st.st_size;
+        m_mapped = true;
+      }
+    }
+    close(fd);
+  }
+#elif defined(__WINDOWS__)
+  HANDLE hFile = ::CreateFile(file, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile != INVALID_HANDLE_VALUE)
+  {
+    DWORD size = ::GetFileSize(hFile, NULL);
+    if (size != INVALID_FILE_SIZE && size > 0)
+    {
+      HANDLE hMap = ::CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (hMap)
+      {
+        void *view = ::MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+        if (view)
+        {
+          m_data = (const unsigned char *)view;
+          m_size = size;
+          m_mapped = true;
+        }
+        ::CloseHandle(hMap);
+      }
+    }
+    ::CloseHandle(hFile);
+  }
 #endif
-  unsigned long res1 = ((unsigned int) c) + (((unsigned int) c1) << 8);
-  int res;
-  if (res1 > 32767)
-    res = (int)(res1 - 65536);
-  else
-    res = (int)(res1);
-  return res;
+
+  if (!m_mapped && wxFile::Exists(file))
+  {
+    wxFile f(file);
+    wxFileOffset length = f.IsOpened() ? f.Length() : 0;
+    if (length > 0)
+    {
+      m_buffer.resize((size_t)length);
+      if (f.Read(&m_buffer[0], (size_t)length) == (ssize_t)length)
+      {
+        m_data = &m_buffer[0];
+        m_size = (size_t)length;
+      }
+    }
+  }
 }
 
-// 32-bit integer
-static long getint(FILE *fp)
+MappedFile::~MappedFile()
 {
-  int c, c1, c2, c3;
-  c = getc(fp);  c1 = getc(fp);  c2 = getc(fp);  c3 = getc(fp);
-  long res = (long)((long) c) +
-         (((long) c1) << 8) +
-         (((long) c2) << 16) +
-         (((long) c3) << 24);
-  return res;
+  if (!m_mapped)
+    return;
+#if defined(__UNIX__)
+  munmap((void *)m_data, m_size);
+#elif defined(__WINDOWS__)
+  ::UnmapViewOfFile(m_data);
+#endif
 }
 
+// Little-endian reader over a metafile in memory. Reads beyond the
+// current limit (the end of the record being decoded) return zero
+// rather than touching memory past it.
+class MetaFileReader
+{
+public:
+  MetaFileReader(const unsigned char *data, size_t size)
+  {
+    m_data = data;
+    m_size = size;
+    m_limit = size;
+    m_pos = 0;
+  }
+
+  inline size_t GetPos() const { return m_pos; }
+  inline size_t GetRemaining() const { return m_pos < m_limit ? m_limit - m_pos : 0; }
+  inline void Seek(size_t pos) { m_pos = pos < m_size ? pos : m_size; }
+  inline void SetLimit(size_t limit) { m_limit = limit < m_size ? limit : m_size; }
+
+  // 8-bit unsigned integer
+  inline unsigned int GetByte()
+  {
+    if (GetRemaining() < 1)
+      return 0;
+    return m_data[m_pos++];
+  }
+
+  // 16-bit unsigned integer
+  inline unsigned int GetShort()
+  {
+    if (GetRemaining() < 2)
+    {
+      m_pos = m_limit;
+      return 0;
+    }
+    unsigned int res = ((unsigned int) m_data[m_pos]) +
+                       (((unsigned int) m_data[m_pos + 1]) << 8);
+    m_pos += 2;
+    return res;
+  }
+
+  // 16-bit signed integer
+  inline int GetSignedShort()
+  {
+    unsigned int res = GetShort();
+    return res > 32767 ? (int)res - 65536 : (int)res;
+  }
+
+  // 32-bit integer
+  inline long GetInt()
+  {
+    if (GetRemaining() < 4)
+    {
+      m_pos = m_limit;
+      return 0;
+    }
+    long res = (long)((long) m_data[m_pos]) +
+           (((long) m_data[m_pos + 1]) << 8) +
+           (((long) m_data[m_pos + 2]) << 16) +
+           (((long) m_data[m_pos + 3]) << 24);
+    m_pos += 4;
+    return res;
+  }
+
+  // Returns n bytes, or NULL if the record is too short
+  inline const unsigned char *GetBytes(size_t n)
+  {
+    if (GetRemaining() < n)
+    {
+      m_pos = m_limit;
+      return NULL;
+    }
+    const unsigned char *bytes = m_data + m_pos;
+    m_pos += n;
+    return bytes;
+  }
+
+private:
+  const unsigned char*  m_data;
+  size_t                m_size;
+  size_t                m_limit;
+  size_t                m_pos;
+};
+
+} // anonymous namespace
 
 /* Placeable metafile header
 struct mfPLACEABLEHEADER {
@@ -80,12 +233,6 @@ struct mfPLACEABLEHEADER {
 };
 */
 
-wxMetaRecord::~wxMetaRecord(void)
-{
-  if (points) delete[] points;
-  if (stringParam) delete[] stringParam;
-}
-
 wxXMetaFile::wxXMetaFile(const wxChar *file)
 {
   ok = false;
@@ -102,146 +249,141 @@ wxXMetaFile::wxXMetaFile(const wxChar *file)
   Handle table       gdiObjects
   ------------       ----------
   [0]                  wxPen
-  [1]----param2---     wxBrush
-  [2]             |    wxFont
-  [3]             | -> wxPen
+  [1]----------        wxBrush
+  [2]          |       wxFont
+  [3]          |  ->   wxPen
 
  The handle table works as follows.
  When a GDI object is created while reading in the
- metafile, the (e.g.) createpen record is added to the
- first free entry in the handle table. The createpen
- record's param1 is a pointer to the actual wxPen, and
- its param2 is the index into the gdiObjects list, which only
- grows and never shrinks (unlike the handle table.)
+ metafile, the index of the (e.g.) createpen record in
+ gdiObjects is added to the first free entry in the handle
+ table. The createpen record's param1 is a pointer to the
+ actual wxPen, and its param2 is that index into gdiObjects,
+ which only grows and never shrinks (unlike the handle table.)
 
  When SelectObject(index) is found, the index in the file
- refers to the position in the handle table. BUT we then
- set param2 to be the position of the wxPen in gdiObjects,
- i.e. to param2 of the CreatePen record, itself found in
- the handle table.
+ refers to the position in the handle table. We set the
+ SelectObject record's param2 to the gdiObjects index held
+ there, or -1 if the handle is not in use.
 
- When an object is deleted, the entry in the handletable is
- NULLed but the gdiObjects entry is not removed (no point, and
+ When an object is deleted, the entry in the handle table is
+ freed but the gdiObjects entry is not removed (no point, and
  allows us to create all GDI objects in advance of playing the
  metafile).
 */
 
-
-static wxMetaRecord *HandleTable[100];
-static int HandleTableSize = 0;
-
-void DeleteMetaRecordHandle(int index)
+static void AddMetaRecordHandle(std::vector<int>& handles, int gdiIndex)
 {
-  HandleTable[index] = NULL;
-}
-
-int AddMetaRecordHandle(wxMetaRecord *record)
-{
-  for (int i = 0; i < HandleTableSize; i++)
-    if (!HandleTable[i])
+  for (size_t i = 0; i < handles.size(); i++)
+    if (handles[i] == -1)
     {
-      HandleTable[i] = record;
-      return i;
+      handles[i] = gdiIndex;
+      return;
     }
   // No free spaces in table, so append.
-
-  HandleTable[HandleTableSize] = record;
-  HandleTableSize ++;
-  return (HandleTableSize - 1);
+  handles.push_back(gdiIndex);
 }
 
 bool wxXMetaFile::ReadFile(const wxChar *file)
 {
-  HandleTableSize = 0;
+  MappedFile mapped(file);
+  if (!mapped.IsOk())
+    return false;
 
-  FILE *handle = wxFopen(file, wxT("rb"));
-  if (!handle) return false;
+  return ReadBuffer(mapped.GetData(), mapped.GetSize());
+}
+
+bool wxXMetaFile::ReadBuffer(const unsigned char *data, size_t size)
+{
+  metaRecords.clear();
+  gdiObjects.clear();
+  points.clear();
+  strings.clear();
+
+  MetaFileReader reader(data, size);
+  std::vector<int> handles;
 
   // Read placeable metafile header, if any
-  long key = getint(handle);
+  long key = reader.GetInt();
 
   if (key == (long) 0x9AC6CDD7)
   {
-    /* long hmf = */ getshort(handle);
+    /* long hmf = */ reader.GetShort();
     int iLeft, iTop, iRight, iBottom;
-    iLeft = getsignedshort(handle);
-    iTop = getsignedshort(handle);
-    iRight = getsignedshort(handle);
-    iBottom = getsignedshort(handle);
+    iLeft = reader.GetSignedShort();
+    iTop = reader.GetSignedShort();
+    iRight = reader.GetSignedShort();
+    iBottom = reader.GetSignedShort();
 
     left = (double)iLeft;
     top = (double)iTop;
     right = (double)iRight;
     bottom = (double)iBottom;
 
-    /* int inch = */ getshort(handle);
-    /* long reserved = */ getint(handle);
-    /* int checksum = */ getshort(handle);
-/*
-      double widthInUnits = (double)right - left;
-      double heightInUnits = (double)bottom - top;
-      *width = (int)((widthInUnits*1440.0)/inch);
-      *height = (int)((heightInUnits*1440.0)/inch);
-*/
+    /* int inch = */ reader.GetShort();
+    /* long reserved = */ reader.GetInt();
+    /* int checksum = */ reader.GetShort();
   }
-  else rewind(handle);
+  else reader.Seek(0);
 
   // Read METAHEADER
-  int mtType = getshort(handle);
+  int mtType = reader.GetShort();
 
   if (mtType != 1 && mtType != 2)
-  {
-    fclose(handle);
     return false;
-  }
 
-  /* int mtHeaderSize = */ getshort(handle);
-  int mtVersion = getshort(handle);
+  /* int mtHeaderSize = */ reader.GetShort();
+  int mtVersion = reader.GetShort();
 
   if (mtVersion != 0x0300 && mtVersion != 0x0100)
-  {
-    fclose(handle);
     return false;
-  }
 
-  /* long mtSize = */ getint(handle);
-  /* int mtNoObjects = */ getshort(handle);
-  /* long mtMaxRecord = */ getint(handle);
-  /* int mtNoParameters = */ getshort(handle);
+  /* long mtSize = */ reader.GetInt();
+  /* int mtNoObjects = */ reader.GetShort();
+  /* long mtMaxRecord = */ reader.GetInt();
+  /* int mtNoParameters = */ reader.GetShort();
+
+  // A rough guess that avoids most reallocations
+  metaRecords.reserve(size / 16);
 
-  while (!feof(handle))
+  while (reader.GetRemaining() >= 6)
   {
-    long rdSize = getint(handle);      // 4 bytes
-    int rdFunction = getshort(handle); // 2 bytes
-    if (feof(handle))
+    size_t recordStart = reader.GetPos();
+    long rdSize = reader.GetInt();      // 4 bytes, in 16-bit words
+    int rdFunction = reader.GetShort(); // 2 bytes
+
+    // The smallest record (META_EOF) is 3 words; anything less is corrupt
+    if (rdSize < 3)
       break;
 
+    // Decode the parameters without straying into the next record
+    size_t recordEnd = recordStart + 2 * (size_t)rdSize;
+    reader.SetLimit(recordEnd);
+
+    wxMetaRecord rec(rdFunction);
+    bool keep = true;    // Append to metaRecords
+    bool isGdi = false;  // Append to gdiObjects and the handle table
+
     switch (rdFunction)
     {
       case META_SETBKCOLOR:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETBKCOLOR);
-        long colorref = getint(handle); // COLORREF
-        rec->param1 = GetRValue(colorref);
-        rec->param2 = GetGValue(colorref);
-        rec->param3 = GetBValue(colorref);
-        metaRecords.Append(rec);
+        long colorref = reader.GetInt(); // COLORREF
+        rec.param1 = GetRValue(colorref);
+        rec.param2 = GetGValue(colorref);
+        rec.param3 = GetBValue(colorref);
         break;
       }
       case META_SETBKMODE:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETBKMODE);
-        rec->param1 = getshort(handle); // Background mode
-        if (rec->param1 == OPAQUE) rec->param1 = wxSOLID;
-        else rec->param1 = wxTRANSPARENT;
-        metaRecords.Append(rec);
+        rec.param1 = reader.GetShort(); // Background mode
+        if (rec.param1 == OPAQUE) rec.param1 = wxSOLID;
+        else rec.param1 = wxTRANSPARENT;
         break;
       }
       case META_SETMAPMODE:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETMAPMODE);
-        rec->param1 = getshort(handle);
-        metaRecords.Append(rec);
+        rec.param1 = reader.GetShort();
         break;
       }
 //      case META_SETROP2:
@@ -251,29 +393,18 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
 //      case META_SETTEXTCHAREXTRA:
       case META_SETTEXTCOLOR:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETTEXTCOLOR);
-        long colorref = getint(handle); // COLORREF
-        rec->param1 = GetRValue(colorref);
-        rec->param2 = GetGValue(colorref);
-        rec->param3 = GetBValue(colorref);
-        metaRecords.Append(rec);
+        long colorref = reader.GetInt(); // COLORREF
+        rec.param1 = GetRValue(colorref);
+        rec.param2 = GetGValue(colorref);
+        rec.param3 = GetBValue(colorref);
         break;
       }
 //      case META_SETTEXTJUSTIFICATION:
       case META_SETWINDOWORG:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETWINDOWORG);
-        rec->param2 = getshort(handle);
-        rec->param1 = getshort(handle);
-        metaRecords.Append(rec);
-        break;
-      }
       case META_SETWINDOWEXT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETWINDOWEXT);
-        rec->param2 = getshort(handle);
-        rec->param1 = getshort(handle);
-        metaRecords.Append(rec);
+        rec.param2 = reader.GetShort();
+        rec.param1 = reader.GetShort();
         break;
       }
 //      case META_SETVIEWPORTORG:
@@ -283,149 +414,77 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
 //      case META_OFFSETVIEWPORTORG:
 //      case META_SCALEVIEWPORTEXT:
       case META_LINETO:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_LINETO);
-        rec->param1 = getshort(handle); // x1
-        rec->param2 = getshort(handle); // y1
-        metaRecords.Append(rec);
-        break;
-      }
       case META_MOVETO:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_MOVETO);
-        rec->param1 = getshort(handle); // x1
-        rec->param2 = getshort(handle); // y1
-        metaRecords.Append(rec);
+        rec.param1 = reader.GetShort(); // x1
+        rec.param2 = reader.GetShort(); // y1
         break;
       }
       case META_EXCLUDECLIPRECT:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_EXCLUDECLIPRECT);
-        rec->param4 = getshort(handle); // y2
-        rec->param3 = getshort(handle); // x2
-        rec->param2 = getshort(handle); // y1
-        rec->param1 = getshort(handle); // x1
-        metaRecords.Append(rec);
-        break;
-      }
       case META_INTERSECTCLIPRECT:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_INTERSECTCLIPRECT);
-        rec->param4 = getshort(handle); // y2
-        rec->param3 = getshort(handle); // x2
-        rec->param2 = getshort(handle); // y1
-        rec->param1 = getshort(handle); // x1
-        metaRecords.Append(rec);
-        break;
-      }
 //      case META_ARC: // DO!!!
       case META_ELLIPSE:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_ELLIPSE);
-        rec->param4 = getshort(handle); // y2
-        rec->param3 = getshort(handle); // x2
-        rec->param2 = getshort(handle); // y1
-        rec->param1 = getshort(handle); // x1
-        metaRecords.Append(rec);
-        break;
-      }
 //      case META_FLOODFILL:
 //      case META_PIE: // DO!!!
       case META_RECTANGLE:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_RECTANGLE);
-        rec->param4 = getshort(handle); // y2
-        rec->param3 = getshort(handle); // x2
-        rec->param2 = getshort(handle); // y1
-        rec->param1 = getshort(handle); // x1
-        metaRecords.Append(rec);
+        rec.param4 = reader.GetShort(); // y2
+        rec.param3 = reader.GetShort(); // x2
+        rec.param2 = reader.GetShort(); // y1
+        rec.param1 = reader.GetShort(); // x1
         break;
       }
       case META_ROUNDRECT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_ROUNDRECT);
-        rec->param6 = getshort(handle); // width
-        rec->param5 = getshort(handle); // height
-        rec->param4 = getshort(handle); // y2
-        rec->param3 = getshort(handle); // x2
-        rec->param2 = getshort(handle); // y1
-        rec->param1 = getshort(handle); // x1
-        metaRecords.Append(rec);
+        rec.param6 = reader.GetShort(); // width
+        rec.param5 = reader.GetShort(); // height
+        rec.param4 = reader.GetShort(); // y2
+        rec.param3 = reader.GetShort(); // x2
+        rec.param2 = reader.GetShort(); // y1
+        rec.param1 = reader.GetShort(); // x1
         break;
       }
 //      case META_PATBLT:
 //      case META_SAVEDC:
       case META_SETPIXEL:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SETPIXEL);
-        rec->param1 = getshort(handle); // x1
-        rec->param2 = getshort(handle); // y1
-        rec->param3 = getint(handle);   // COLORREF
-        metaRecords.Append(rec);
+        rec.param1 = reader.GetShort(); // x1
+        rec.param2 = reader.GetShort(); // y1
+        rec.param3 = reader.GetInt();   // COLORREF
         break;
       }
 //      case META_OFFSETCLIPRGN:
       case META_TEXTOUT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_TEXTOUT);
-        int count = getshort(handle);
-        rec->stringParam = new wxChar[count+1];
-        fread((void *)rec->stringParam, sizeof(wxChar), count, handle);
-        rec->stringParam[count] = 0;
-        rec->param2 = getshort(handle); // Y
-        rec->param1 = getshort(handle); // X
-        metaRecords.Append(rec);
+        size_t count = reader.GetShort();
+        if (count > reader.GetRemaining())
+          count = reader.GetRemaining();
+        const unsigned char *text = reader.GetBytes(count);
+        // The string is padded to a whole number of words
+        if (count & 1)
+          reader.GetByte();
+        rec.text = (int)strings.size();
+        strings.push_back(wxString((const char *)text, wxConvISO8859_1, count));
+        rec.param2 = reader.GetShort(); // Y
+        rec.param1 = reader.GetShort(); // X
         break;
       }
-/*
-      case META_EXTTEXTOUT:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_EXTTEXTOUT);
-        int cellSpacing = getshort(handle);
-        int count = getshort(handle);
-        rec->stringParam = new char[count+1];
-        fread((void *)rec->stringParam, sizeof(char), count, handle);
-        rec->stringParam[count] = 0;
-        // Rectangle
-        int rectY2 = getshort(handle);
-        int rectX2 = getshort(handle);
-        int rectY1 = getshort(handle);
-        int rectX1 = getshort(handle);
-        int rectType = getshort(handle);
-        rec->param2 = getshort(handle); // Y
-        rec->param1 = getshort(handle); // X
-        metaRecords.Append(rec);
-        break;
-      }
-*/
 //      case META_BITBLT:
 //      case META_STRETCHBLT:
       case META_POLYGON:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_POLYGON);
-        rec->param1 = getshort(handle);
-        rec->points = new wxRealPoint[(int)rec->param1];
-        for (int i = 0; i < rec->param1; i++)
-        {
-          rec->points[i].x = getshort(handle);
-          rec->points[i].y = getshort(handle);
-        }
-
-        metaRecords.Append(rec);
-        break;
-      }
       case META_POLYLINE:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_POLYLINE);
-        rec->param1 = (long)getshort(handle);
-        rec->points = new wxRealPoint[(int)rec->param1];
-        for (int i = 0; i < rec->param1; i++)
+        long count = (long)reader.GetShort();
+        if (count > (long)(reader.GetRemaining() / 4))
+          count = (long)(reader.GetRemaining() / 4);
+        rec.param1 = count;
+        rec.firstPoint = (int)points.size();
+        for (long i = 0; i < count; i++)
         {
-          rec->points[i].x = getshort(handle);
-          rec->points[i].y = getshort(handle);
+          double x = reader.GetShort();
+          double y = reader.GetShort();
+          points.push_back(wxRealPoint(x, y));
         }
-
-        metaRecords.Append(rec);
         break;
       }
 //      case META_ESCAPE:
@@ -437,12 +496,13 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
 //      case META_SELECTCLIPREGION: // DO THIS!
       case META_SELECTOBJECT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_SELECTOBJECT);
-        rec->param1 = (long)getshort(handle); // Position of object in gdiObjects list
-        metaRecords.Append(rec);
+        rec.param1 = (long)reader.GetShort(); // Position of object in the handle table
         // param2 gives the index into gdiObjects, which is different from
         // the index into the handle table.
-        rec->param2 = HandleTable[(int)rec->param1]->param2;
+        if (rec.param1 < (long)handles.size())
+          rec.param2 = handles[(int)rec.param1];
+        else
+          rec.param2 = -1;
         break;
       }
 //      case META_SETTEXTALIGN:
@@ -459,17 +519,6 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
 //      case META_RESIZEPALETTE:
 //      case META_DIBBITBLT:
 //      case META_DIBSTRETCHBLT:
-      case META_DIBCREATEPATTERNBRUSH:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_DIBCREATEPATTERNBRUSH);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-        break;
-      }
 //      case META_STRETCHDIB:
 //      case META_EXTFLOODFILL:
 //      case META_RESETDC:
@@ -480,48 +529,30 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
 //      case META_ENDDOC:
       case META_DELETEOBJECT:
       {
-        int index = getshort(handle);
-        DeleteMetaRecordHandle(index);
+        size_t index = reader.GetShort();
+        if (index < handles.size())
+          handles[index] = -1;
+        keep = false;
         break;
       }
+      // GDI objects that are only placeholders
+      case META_DIBCREATEPATTERNBRUSH:
       case META_CREATEPALETTE:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEPALETTE);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-        break;
-      }
       case META_CREATEBRUSH:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEBRUSH);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-        break;
-      }
       case META_CREATEPATTERNBRUSH:
+      case META_CREATEBITMAPINDIRECT:
+      case META_CREATEBITMAP:
+      case META_CREATEREGION:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEPATTERNBRUSH);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
+        isGdi = true;
         break;
       }
       case META_CREATEPENINDIRECT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEPENINDIRECT);
-        int msStyle = getshort(handle); // Style: 2 bytes
-        int x = getshort(handle); // X:     2 bytes
-        /* int y = */ getshort(handle); // Y:     2 bytes
-        long colorref = getint(handle); // COLORREF 4 bytes
+        int msStyle = reader.GetShort(); // Style: 2 bytes
+        int x = reader.GetShort(); // X:     2 bytes
+        /* int y = */ reader.GetShort(); // Y:     2 bytes
+        long colorref = reader.GetInt(); // COLORREF 4 bytes
 
         wxPenStyle style;
         if (msStyle == PS_DOT)
@@ -533,42 +564,26 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
         else style = wxPENSTYLE_SOLID;
 
         wxColour colour(GetRValue(colorref), GetGValue(colorref), GetBValue(colorref));
-        rec->param1 = (long)wxThePenList->FindOrCreatePen(colour, x, style);
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-
-        // For some reason, the size of this record is sometimes 9 words!!!
-        // instead of the usual 8. So read 2 characters extra.
-        if (rdSize == 9)
-        {
-          (void) getshort(handle);
-        }
+        rec.param1 = (long)wxThePenList->FindOrCreatePen(colour, x, style);
+        isGdi = true;
         break;
       }
       case META_CREATEFONTINDIRECT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEFONTINDIRECT);
-        int lfHeight = getshort(handle);    // 2 bytes
-        /* int lfWidth = */ getshort(handle);     // 2 bytes
-        /* int lfEsc = */ getshort(handle);       // 2 bytes
-        /* int lfOrient = */ getshort(handle);    // 2 bytes
-        int lfWeight = getshort(handle);    // 2 bytes
-        char lfItalic = (char)getc(handle);       // 1 byte
-        char lfUnderline = (char)getc(handle);    // 1 byte
-        /* char lfStrikeout = */ getc(handle);    // 1 byte
-        /* char lfCharSet = */ getc(handle);      // 1 byte
-        /* char lfOutPrecision = */ getc(handle); // 1 byte
-        /* char lfClipPrecision = */ getc(handle); // 1 byte
-        /* char lfQuality = */ getc(handle);      // 1 byte
-        char lfPitchAndFamily = (char)getc(handle);   // 1 byte (18th)
-        char lfFacename[32];
-        // Read the rest of the record, which is total record size
-        // minus the number of bytes already read (18 record, 6 metarecord
-        // header)
-        fread((void *)lfFacename, sizeof(char), (int)((2*rdSize) - 18 - 6), handle);
+        int lfHeight = reader.GetShort();    // 2 bytes
+        /* int lfWidth = */ reader.GetShort();     // 2 bytes
+        /* int lfEsc = */ reader.GetShort();       // 2 bytes
+        /* int lfOrient = */ reader.GetShort();    // 2 bytes
+        int lfWeight = reader.GetShort();    // 2 bytes
+        char lfItalic = (char)reader.GetByte();       // 1 byte
+        char lfUnderline = (char)reader.GetByte();    // 1 byte
+        /* char lfStrikeout = */ reader.GetByte();    // 1 byte
+        /* char lfCharSet = */ reader.GetByte();      // 1 byte
+        /* char lfOutPrecision = */ reader.GetByte(); // 1 byte
+        /* char lfClipPrecision = */ reader.GetByte(); // 1 byte
+        /* char lfQuality = */ reader.GetByte();      // 1 byte
+        char lfPitchAndFamily = (char)reader.GetByte();   // 1 byte (18th)
+        // The face name makes up the rest of the record
 
         // About how many pixels per inch???
         int logPixelsY = 100;
@@ -612,19 +627,15 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
                                           info.IsUnderlined()
                                          );
 
-        rec->param1 = (long) theFont;
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
+        rec.param1 = (long) theFont;
+        isGdi = true;
         break;
       }
       case META_CREATEBRUSHINDIRECT:
       {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEBRUSHINDIRECT);
-        int msStyle = getshort(handle); // Style: 2 bytes
-        long colorref = getint(handle);   // COLORREF: 4 bytes
-        int hatchStyle = getshort(handle); // Hatch style 2 bytes
+        int msStyle = reader.GetShort(); // Style: 2 bytes
+        long colorref = reader.GetInt();   // COLORREF: 4 bytes
+        int hatchStyle = reader.GetShort(); // Hatch style 2 bytes
 
         wxBrushStyle style;
         switch (msStyle)
@@ -665,68 +676,35 @@ bool wxXMetaFile::ReadFile(const wxChar *file)
         }
 
         wxColour colour(GetRValue(colorref), GetGValue(colorref), GetBValue(colorref));
-        rec->param1 = (long)wxTheBrushList->FindOrCreateBrush(colour, style);
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-        break;
-      }
-      case META_CREATEBITMAPINDIRECT:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEBITMAPINDIRECT);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-        break;
-      }
-      case META_CREATEBITMAP:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEBITMAP);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
-        break;
-      }
-      case META_CREATEREGION:
-      {
-        wxMetaRecord *rec = new wxMetaRecord(META_CREATEREGION);
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
-
-        metaRecords.Append(rec);
-        gdiObjects.Append(rec);
-        AddMetaRecordHandle(rec);
-        rec->param2 = (long)(gdiObjects.GetCount() - 1);
+        rec.param1 = (long)wxTheBrushList->FindOrCreateBrush(colour, style);
+        isGdi = true;
         break;
       }
       default:
       {
-        fread((void *)_buf, sizeof(char), (int)((2*rdSize) - 6), handle);
+        keep = false;
         break;
       }
     }
+
+    if (isGdi)
+    {
+      gdiObjects.push_back((int)metaRecords.size());
+      rec.param2 = (long)(gdiObjects.size() - 1);
+      AddMetaRecordHandle(handles, (int)rec.param2);
+    }
+    if (keep)
+      metaRecords.push_back(rec);
+
+    // Skip whatever of the record was not decoded
+    reader.SetLimit(size);
+    reader.Seek(recordEnd);
   }
-  fclose(handle);
   return true;
 }
 
 wxXMetaFile::~wxXMetaFile(void)
 {
-  wxObjectList::compatibility_iterator node = metaRecords.GetFirst();
-  while (node)
-  {
-    wxMetaRecord *rec = (wxMetaRecord *)node->GetData();
-    delete rec;
-    wxObjectList::compatibility_iterator next = node->GetNext();
-    metaRecords.Erase(node);
-    node = next;
-  }
 }
 
 bool wxXMetaFile::SetClipboard(int WXUNUSED(width), int WXUNUSED(height))
@@ -736,10 +714,9 @@ bool wxXMetaFile::SetClipboard(int WXUNUSED(width), int WXUNUSED(height))
 
 bool wxXMetaFile::Play(wxDC *dc)
 {
-  wxObjectList::compatibility_iterator node = metaRecords.GetFirst();
-  while (node)
+  for (size_t i = 0; i < metaRecords.size(); i++)
   {
-    wxMetaRecord *rec = (wxMetaRecord *)node->GetData();
+    const wxMetaRecord *rec = &metaRecords[i];
     int rdFunction = rec->metaFunction;
 
     switch (rdFunction)
@@ -1070,7 +1047,6 @@ bool wxXMetaFile::Play(wxDC *dc)
         break;
       }
     }
-    node = node->GetNext();
   }
   return true;
 }
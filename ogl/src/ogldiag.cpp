@@ -28,6 +28,8 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <vector>
+
 #include "wx/ogl/ogl.h"
 
 
@@ -152,9 +154,21 @@ void wxDiagram::DeleteAllShapes()
     wxShape *shape = (wxShape *)node->GetData();
     if (!shape->GetParent())
     {
-      RemoveShape(shape);
+      // Carry on after the child shapes already skipped rather than
+      // rescanning them, unless deleting this shape deletes them too.
+      wxNode *prev = node->GetPrevious();
+      if (prev && ((wxShape *)prev->GetData())->GetTopAncestor() == shape)
+        prev = NULL;
+
+      // Shapes on our canvas remove themselves when deleted, and find
+      // themselves near the front of what is left. Removing them here first
+      // would make that search the whole list for nothing.
+      wxShapeCanvas *canvas = shape->GetCanvas();
+      if (!canvas || canvas->GetDiagram() != this)
+        RemoveShape(shape);
       delete shape;
-      node = m_shapeList->GetFirst();
+
+      node = prev ? prev->GetNext() : m_shapeList->GetFirst();
     }
     else
       node = node->GetNext();
@@ -246,71 +260,99 @@ wxLineCrossings::~wxLineCrossings()
 void wxLineCrossings::FindCrossings(wxDiagram& diagram)
 {
     ClearCrossings();
-    wxNode* node1 = diagram.GetShapeList()->GetFirst();
-    while (node1)
+
+    // Gather the segments of all the lines into one buffer, noting the range
+    // each line's segments occupy, so that each segment can be tested
+    // against the segments of all the other lines in one or two batches.
+    struct LineRange
     {
-        wxShape* shape1 = (wxShape*) node1->GetData();
-        if (shape1->IsKindOf(CLASSINFO(wxLineShape)))
+        wxLineShape* lineShape;
+        size_t first, last;
+    };
+
+    std::vector<LineRange> lines;
+    wxOGLSegmentBuffer segments;
+
+    wxNode* node = diagram.GetShapeList()->GetFirst();
+    while (node)
+    {
+        wxShape* shape = (wxShape*) node->GetData();
+        if (shape->IsKindOf(CLASSINFO(wxLineShape)))
         {
-            wxLineShape* lineShape1 = (wxLineShape*) shape1;
-            // Iterate through the segments
-            wxList* pts1 = lineShape1->GetLineControlPoints();
+            LineRange line;
+            line.lineShape = (wxLineShape*) shape;
+            line.first = segments.GetCount();
+
+            wxLinePoints& pts = line.lineShape->GetLinePoints();
             size_t i;
-            for (i = 0; i < (pts1->GetCount() - 1); i++)
+            for (i = 0; i + 1 < pts.GetCount(); i++)
+                segments.Add(pts[i].x, pts[i].y, pts[i+1].x, pts[i+1].y);
+
+            line.last = segments.GetCount();
+            lines.push_back(line);
+        }
+        node = node->GetNext();
+    }
+
+    const double *x1s = segments.GetX1s(), *y1s = segments.GetY1s();
+    const double *x2s = segments.GetX2s(), *y2s = segments.GetY2s();
+    std::vector<double> ratios(segments.GetCount());
+
+    size_t k;
+    for (k = 0; k < lines.size(); k++)
+    {
+        const LineRange& line1 = lines[k];
+        size_t i;
+        for (i = line1.first; i < line1.last; i++)
+        {
+            wxRealPoint pt1_a(x1s[i], y1s[i]);
+            wxRealPoint pt1_b(x2s[i], y2s[i]);
+
+            // Assume that the same line doesn't cross itself
+            double before = wxOGLGeometry::IntersectSegments(
+                pt1_a.x, pt1_a.y, pt1_b.x, pt1_b.y,
+                segments, 0, line1.first, ratios.empty() ? NULL : &ratios[0]);
+            double after = wxOGLGeometry::IntersectSegments(
+                pt1_a.x, pt1_a.y, pt1_b.x, pt1_b.y,
+                segments, line1.last, segments.GetCount(),
+                ratios.empty() ? NULL : &ratios[line1.last]);
+
+            if (before == 1.0 && after == 1.0)
+                continue;
+
+            size_t line2 = 0;
+            size_t j;
+            for (j = 0; j < segments.GetCount(); j++)
             {
-                wxRealPoint* pt1_a = (wxRealPoint*) (pts1->Item(i)->GetData());
-                wxRealPoint* pt1_b = (wxRealPoint*) (pts1->Item(i+1)->GetData());
+                if (j == line1.first)
+                    j = line1.last;
+                if (j == segments.GetCount())
+                    break;
 
-                // Now we iterate through the segments again
+                double ratio1 = ratios[j];
 
-                wxNode* node2 = diagram.GetShapeList()->GetFirst();
-                while (node2)
+                if (ratio1 < 1.0)
                 {
-                    wxShape* shape2 = (wxShape*) node2->GetData();
-
-                    // Assume that the same line doesn't cross itself
-                    if (shape2->IsKindOf(CLASSINFO(wxLineShape)) && (shape1 != shape2))
-                    {
-                        wxLineShape* lineShape2 = (wxLineShape*) shape2;
-                        // Iterate through the segments
-                        wxList* pts2 = lineShape2->GetLineControlPoints();
-                        int j;
-                        for (j = 0; j < (int) (pts2->GetCount() - 1); j++)
-                        {
-                            wxRealPoint* pt2_a = (wxRealPoint*) (pts2->Item(j)->GetData());
-                            wxRealPoint* pt2_b = (wxRealPoint*) (pts2->Item(j+1)->GetData());
-
-                            // Now let's see if these two segments cross.
-                            double ratio1, ratio2;
-                            oglCheckLineIntersection(pt1_a->x, pt1_a->y, pt1_b->x, pt1_b->y,
-                               pt2_a->x, pt2_a->y, pt2_b->x, pt2_b->y,
-                             & ratio1, & ratio2);
-
-                            if ((ratio1 < 1.0) && (ratio1 > -1.0))
-                            {
-                                // Intersection!
-                                wxLineCrossing* crossing = new wxLineCrossing;
-                                crossing->m_intersect.x = (pt1_a->x + (pt1_b->x - pt1_a->x)*ratio1);
-                                crossing->m_intersect.y = (pt1_a->y + (pt1_b->y - pt1_a->y)*ratio1);
-
-                                crossing->m_pt1 = * pt1_a;
-                                crossing->m_pt2 = * pt1_b;
-                                crossing->m_pt3 = * pt2_a;
-                                crossing->m_pt4 = * pt2_b;
-
-                                crossing->m_lineShape1 = lineShape1;
-                                crossing->m_lineShape2 = lineShape2;
-
-                                m_crossings.Append(crossing);
-                            }
-                        }
-                    }
-                    node2 = node2->GetNext();
+                    while (lines[line2].last <= j)
+                        line2++;
+
+                    // Intersection!
+                    wxLineCrossing* crossing = new wxLineCrossing;
+                    crossing->m_intersect.x = (pt1_a.x + (pt1_b.x - pt1_a.x)*ratio1);
+                    crossing->m_intersect.y = (pt1_a.y + (pt1_b.y - pt1_a.y)*ratio1);
+
+                    crossing->m_pt1 = pt1_a;
+                    crossing->m_pt2 = pt1_b;
+                    crossing->m_pt3 = wxRealPoint(x1s[j], y1s[j]);
+                    crossing->m_pt4 = wxRealPoint(x2s[j], y2s[j]);
+
+                    crossing->m_lineShape1 = line1.lineShape;
+                    crossing->m_lineShape2 = lines[line2].lineShape;
+
+                    m_crossings.Append(crossing);
                 }
             }
         }
-
-        node1 = node1->GetNext();
     }
 }
 
@@ -114,6 +114,8 @@ void wxOGLCleanUp()
     }
 
     OGLCleanUpConstraintTypes();
+    OGLCleanUpMetaFileCache();
+    wxOGLPool::Trim();
 }
 
 wxFont *oglMatchFont(int point_size)
@@ -591,28 +593,22 @@ void oglCheckLineIntersection(double x1, double y1, double x2, double y2,
 void oglFindEndForPolyline(double n, double xvec[], double yvec[],
                            double x1, double y1, double x2, double y2, double *x3, double *y3)
 {
-  int i;
-  double lastx = xvec[0];
-  double lasty = yvec[0];
+  // The points are the segments' start and end points offset by one, so the
+  // kernel can take all but the closing segment straight from the arrays.
+  size_t count = n > 1 ? size_t(ceil(n)) : 1;
+  double lastx = xvec[count - 1];
+  double lasty = yvec[count - 1];
 
-  double min_ratio = 1.0;
-  double line_ratio;
-  double other_ratio;
-
-  for (i = 1; i < n; i++)
-  {
-    oglCheckLineIntersection(x1, y1, x2, y2, lastx, lasty, xvec[i], yvec[i],
-                            &line_ratio, &other_ratio);
-    lastx = xvec[i];
-    lasty = yvec[i];
-
-    if (line_ratio < min_ratio)
-      min_ratio = line_ratio;
-  }
+  double min_ratio = wxOGLGeometry::IntersectSegments(x1, y1, x2, y2,
+                                                      xvec, yvec, xvec + 1, yvec + 1,
+                                                      count - 1);
 
   // Do last (implicit) line if last and first doubles are not identical
   if (!(xvec[0] == lastx && yvec[0] == lasty))
   {
+    double line_ratio;
+    double other_ratio;
+
     oglCheckLineIntersection(x1, y1, x2, y2, lastx, lasty, xvec[0], yvec[0],
                             &line_ratio, &other_ratio);
 
@@ -0,0 +1,169 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        pool.cpp
+// Purpose:     Pooled allocation of shapes and other small objects
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+// For compilers that support precompilation, includes "wx.h".
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+#include "wx/wx.h"
+#endif
+
+#ifdef new
+#undef new
+#endif
+
+#include <new>
+
+#include "wx/ogl/ogl.h"
+
+namespace {
+
+// Block sizes are multiples of the granularity, which keeps every block
+// aligned for any type. Larger objects go straight to the heap.
+const size_t POOL_GRANULARITY = 16;
+const size_t POOL_MAX_SIZE = 512;
+const size_t POOL_COUNT = POOL_MAX_SIZE / POOL_GRANULARITY;
+const size_t POOL_CHUNK_SIZE = 64 * 1024;
+
+struct wxOGLFreeBlock
+{
+  wxOGLFreeBlock *m_next;
+};
+
+// Chunks are chained through a header padded to the granularity.
+struct wxOGLChunk
+{
+  wxOGLChunk *m_next;
+};
+
+struct wxOGLBlockPool
+{
+  wxOGLFreeBlock *m_free;
+  wxOGLChunk     *m_chunks;
+  size_t          m_live;
+};
+
+// Plain data, so zero initialised before any constructors run.
+wxOGLBlockPool g_oglPools[POOL_COUNT];
+wxOGLPoolStats g_oglPoolStats;
+
+void GrowPool(wxOGLBlockPool& pool, size_t blockSize)
+{
+  size_t count = (POOL_CHUNK_SIZE - POOL_GRANULARITY) / blockSize;
+  size_t bytes = POOL_GRANULARITY + count * blockSize;
+  char *mem = static_cast<char*>(::operator new(bytes));
+
+  wxOGLChunk *chunk = reinterpret_cast<wxOGLChunk*>(mem);
+  chunk->m_next = pool.m_chunks;
+  pool.m_chunks = chunk;
+
+  // Thread the blocks onto the free list in address order
+  char *block = mem + POOL_GRANULARITY + (count - 1) * blockSize;
+  for (size_t i = 0; i < count; i++, block -= blockSize)
+  {
+    wxOGLFreeBlock *free = reinterpret_cast<wxOGLFreeBlock*>(block);
+    free->m_next = pool.m_free;
+    pool.m_free = free;
+  }
+
+  g_oglPoolStats.m_chunks++;
+  g_oglPoolStats.m_chunkBytes += bytes;
+}
+
+void ReleasePool(wxOGLBlockPool& pool, size_t blockSize)
+{
+  size_t count = (POOL_CHUNK_SIZE - POOL_GRANULARITY) / blockSize;
+  size_t bytes = POOL_GRANULARITY + count * blockSize;
+
+  while (pool.m_chunks)
+  {
+    wxOGLChunk *chunk = pool.m_chunks;
+    pool.m_chunks = chunk->m_next;
+    ::operator delete(chunk);
+
+    g_oglPoolStats.m_chunks--;
+    g_oglPoolStats.m_chunkBytes -= bytes;
+  }
+
+  pool.m_free = NULL;
+}
+
+} // namespace
+
+void *wxOGLPool::Alloc(size_t size)
+{
+  if (size > POOL_MAX_SIZE)
+  {
+    g_oglPoolStats.m_heapAllocations++;
+    return ::operator new(size);
+  }
+
+  size_t index = size ? (size - 1) / POOL_GRANULARITY : 0;
+  size_t blockSize = (index + 1) * POOL_GRANULARITY;
+  wxOGLBlockPool& pool = g_oglPools[index];
+
+  if (!pool.m_free)
+    GrowPool(pool, blockSize);
+
+  wxOGLFreeBlock *block = pool.m_free;
+  pool.m_free = block->m_next;
+  pool.m_live++;
+
+  g_oglPoolStats.m_allocations++;
+  g_oglPoolStats.m_live++;
+  g_oglPoolStats.m_liveBytes += blockSize;
+
+  return block;
+}
+
+void wxOGLPool::Free(void *p, size_t size)
+{
+  if (!p)
+    return;
+
+  if (size > POOL_MAX_SIZE)
+  {
+    ::operator delete(p);
+    return;
+  }
+
+  size_t index = size ? (size - 1) / POOL_GRANULARITY : 0;
+  wxOGLBlockPool& pool = g_oglPools[index];
+
+  wxASSERT_MSG(pool.m_live > 0, wxT("wxOGLPool::Free: block not allocated"));
+
+  wxOGLFreeBlock *block = static_cast<wxOGLFreeBlock*>(p);
+  block->m_next = pool.m_free;
+  pool.m_free = block;
+  pool.m_live--;
+
+  g_oglPoolStats.m_frees++;
+  g_oglPoolStats.m_live--;
+  g_oglPoolStats.m_liveBytes -= (index + 1) * POOL_GRANULARITY;
+}
+
+void wxOGLPool::Trim()
+{
+  for (size_t i = 0; i < POOL_COUNT; i++)
+  {
+    if (g_oglPools[i].m_live == 0)
+      ReleasePool(g_oglPools[i], (i + 1) * POOL_GRANULARITY);
+  }
+}
+
+void wxOGLPool::GetStats(wxOGLPoolStats& stats)
+{
+  stats = g_oglPoolStats;
+}
@@ -277,10 +277,12 @@
 #include <wx/imaglist.h>
 #include <wx/wfstream.h>
 #include <wx/stdpaths.h>
+#include <wx/srchctrl.h>
 
 #include <vector>
 
 #include "graphtree.h"
+#include "graphoverview.h"
 #include "graphprint.h"
 #include "testnodes.h"
 
@@ -368,6 +370,43 @@ private:
     const Factory<ProjectNode> m_factory;
 };
 
+// The entries of the tree control, created as the categories are expanded.
+// A real application would load these from a catalogue.
+class Palette : public GraphTreeProvider
+{
+public:
+    Palette();
+
+    void GetChildren(Id parent, IdList& children) const;
+    wxString GetText(Id id) const { return m_entries[id].text; }
+    bool HasChildren(Id id) const { return m_entries[id].create == NULL; }
+    wxString GetIconName(Id id) const { return m_entries[id].imgfile; }
+    wxImage LoadIcon(const wxString& name) const;
+    wxTreeItemData *CreateItemData(Id id) const;
+
+private:
+    typedef TreeItemData *(*Creator)();
+
+    template <class T> static TreeItemData *NewData()
+    {
+        return new TreeItemData(Factory<T>());
+    }
+
+    Id Add(Id parent, const wxString& text, const wxString& imgfile,
+           Creator create = NULL);
+
+    struct Entry
+    {
+        wxString text;
+        wxString imgfile;
+        Creator create;     // NULL for categories
+        IdList children;
+    };
+
+    std::vector<Entry> m_entries;
+    wxString m_dir;         // only read after construction
+};
+
 // Define a new application type, each program should derive a class from wxApp
 class MyApp : public wxApp
 {
@@ -393,6 +432,7 @@ public:
     // tree control events
     void OnGraphTreeDrop(GraphTreeEvent& event);
     void OnTreeItemActivated(wxTreeEvent& event);
+    void OnFilter(wxCommandEvent& event);
 
     // graph events
     void OnAddNode(GraphEvent& event);
@@ -447,9 +487,12 @@ public:
     void OnUIShowGrid(wxUpdateUIEvent& event);
     void OnSnapToGrid(wxCommandEvent&);
     void OnUISnapToGrid(wxUpdateUIEvent& event);
+    void OnBundleEdges(wxCommandEvent&);
+    void OnUIBundleEdges(wxUpdateUIEvent& event);
     void OnSetGrid(wxCommandEvent&);
     void OnSetGridFactor(wxCommandEvent&);
     void OnSetToolTipMode(wxCommandEvent&);
+    void OnSetZoomMode(wxCommandEvent&);
 
     // help menu
     void OnHelp(wxCommandEvent&);
@@ -458,6 +501,8 @@ public:
     // context menu
     void OnSetSize(wxCommandEvent& event);
     void OnLayout(wxCommandEvent& event);
+    void OnGroup(wxCommandEvent& event);
+    void OnExpandGroup(wxCommandEvent& event);
     void OnSetFont(wxCommandEvent& event);
     void OnSetColour(wxCommandEvent& event);
     void OnSetBgColour(wxCommandEvent& event);
@@ -474,15 +519,10 @@ public:
     bool PickFile(int flags);
     GraphPrintout *NewPrintout();
 
-    template <class T> void AppendTreeItem(const wxTreeItemId& id);
-
-    wxTreeItemId AppendTreeItem(const wxTreeItemId& id,
-                                const ProjectNode& node,
-                                TreeItemData *tid = NULL);
-
     enum { ZoomStep = 25 };
 
 private:
+    Palette m_palette;
     GraphTreeCtrl *m_tree;
     ProjectDesigner *m_graphctrl;
     GraphElement *m_element;
@@ -511,6 +551,7 @@ private:
 
 // IDs for the controls and the menu commands
 enum {
+    ID_FILTER,
     ID_SAVEIMAGE,
     ID_PRINT_SCALING,
     ID_PRINT_POSITION,
@@ -518,15 +559,19 @@ enum {
     ID_LAYOUTALL,
     ID_SHOWGRID,
     ID_SNAPTOGRID,
+    ID_BUNDLEEDGES,
     ID_SETGRID,
     ID_SETGRIDFACTOR,
     ID_SETTOOLTIPMODE,
+    ID_SETZOOMMODE,
     ID_ZOOM,
     ID_ZOOM_NORM,
     ID_FIT,
     ID_BORDER,
     ID_MARGIN,
     ID_LAYOUT,
+    ID_GROUP,
+    ID_EXPANDGROUP,
     ID_SETSIZE,
     ID_SETFONT,
     ID_SETCOLOUR,
@@ -584,11 +629,16 @@ BEGIN_EVENT_TABLE(MyFrame, wxFrame)
     EVT_UPDATE_UI(ID_SHOWGRID, MyFrame::OnUIShowGrid)
     EVT_MENU(ID_SNAPTOGRID, MyFrame::OnSnapToGrid)
     EVT_UPDATE_UI(ID_SNAPTOGRID, MyFrame::OnUISnapToGrid)
+    EVT_MENU(ID_BUNDLEEDGES, MyFrame::OnBundleEdges)
+    EVT_UPDATE_UI(ID_BUNDLEEDGES, MyFrame::OnUIBundleEdges)
     EVT_MENU(ID_SETGRID, MyFrame::OnSetGrid)
     EVT_MENU(ID_SETGRIDFACTOR, MyFrame::OnSetGridFactor)
     EVT_MENU(ID_SETTOOLTIPMODE, MyFrame::OnSetToolTipMode)
+    EVT_MENU(ID_SETZOOMMODE, MyFrame::OnSetZoomMode)
 
     EVT_MENU(ID_LAYOUT, MyFrame::OnLayout)
+    EVT_MENU(ID_GROUP, MyFrame::OnGroup)
+    EVT_MENU(ID_EXPANDGROUP, MyFrame::OnExpandGroup)
     EVT_MENU(ID_SETSIZE, MyFrame::OnSetSize)
     EVT_MENU(ID_SETFONT, MyFrame::OnSetFont)
     EVT_MENU(ID_SETCOLOUR, MyFrame::OnSetColour)
@@ -611,6 +661,7 @@ BEGIN_EVENT_TABLE(MyFrame, wxFrame)
 
     EVT_GRAPHTREE_DROP(wxID_ANY, MyFrame::OnGraphTreeDrop)
     EVT_TREE_ITEM_ACTIVATED(wxID_ANY, MyFrame::OnTreeItemActivated)
+    EVT_TEXT(ID_FILTER, MyFrame::OnFilter)
 
     EVT_GRAPH_NODE_ADD(MyFrame::OnAddNode)
     EVT_GRAPH_NODE_DELETE(MyFrame::OnDeleteNode)
@@ -678,6 +729,89 @@ int MyApp::OnExit()
     return wxApp::OnExit();
 }
 
+// ----------------------------------------------------------------------------
+// the palette
+// ----------------------------------------------------------------------------
+
+Palette::Palette()
+  : m_dir(GetResourceDir())
+{
+    Add(NoId, _T("Root"), wxEmptyString);
+
+    Id id = Add(RootId, _T("Import"), _T("import.png"));
+    Add(id, _T("Import File"), _T("importfile.png"), NewData<ImportFileNode>);
+    Add(id, _T("Import ODBC"), _T("importfile.png"), NewData<ImportODBCNode>);
+
+    id = Add(RootId, _T("Export"), _T("export.png"));
+    Add(id, _T("Export File"), _T("exportfile.png"), NewData<ExportFileNode>);
+    Add(id, _T("Export ODBC"), _T("exportfile.png"), NewData<ExportODBCNode>);
+
+    id = Add(RootId, _T("Analyse"), _T("analyse.png"));
+    Add(id, _T("Search"), _T("search.png"), NewData<SearchNode>);
+    Add(id, _T("Sample"), _T("sample.png"), NewData<SampleNode>);
+    Add(id, _T("Sort"), _T("sort.png"), NewData<SortNode>);
+    Add(id, _T("Validate"), _T("validate.png"), NewData<ValidateNode>);
+    Add(id, _T("Address Validation"), _T("addressval.png"),
+        NewData<AddressValNode>);
+
+    id = Add(RootId, _T("Re-engineer"), _T("reeng.png"));
+    Add(id, _T("Clean"), _T("clean.png"), NewData<CleanNode>);
+    Add(id, _T("Extract"), _T("extract.png"), NewData<ExtractNode>);
+    Add(id, _T("Split"), _T("split.png"), NewData<SplitNode>);
+    Add(id, _T("Unite"), _T("unite.png"), NewData<UniteNode>);
+    Add(id, _T("Insert"), _T("insert.png"), NewData<InsertNode>);
+    Add(id, _T("Delete"), _T("delete.png"), NewData<DeleteNode>);
+    Add(id, _T("Arrange"), _T("arrange.png"), NewData<ArrangeNode>);
+    Add(id, _T("Append"), _T("append.png"), NewData<AppendNode>);
+    Add(id, _T("SQL Query"), _T("sqlquery.png"), NewData<SQLQueryNode>);
+
+    id = Add(RootId, _T("Match"), _T("matchup.png"));
+    Add(id, _T("Match"), _T("match.png"), NewData<MatchNode>);
+    Add(id, _T("Match Table"), _T("matchtbl.png"), NewData<MatchTableNode>);
+    Add(id, _T("Merge"), _T("merge.png"), NewData<MergeNode>);
+}
+
+Palette::Id Palette::Add(Id parent,
+                         const wxString& text,
+                         const wxString& imgfile,
+                         Creator create)
+{
+    Entry entry;
+    entry.text = text;
+    entry.imgfile = imgfile;
+    entry.create = create;
+    m_entries.push_back(entry);
+
+    Id id = m_entries.size() - 1;
+    if (parent != NoId)
+        m_entries[parent].children.push_back(id);
+    return id;
+}
+
+void Palette::GetChildren(Id parent, IdList& children) const
+{
+    const IdList& entries = m_entries[parent].children;
+    children.insert(children.end(), entries.begin(), entries.end());
+}
+
+// Called on the tree control's worker thread.
+wxImage Palette::LoadIcon(const wxString& name) const
+{
+    wxString path = m_dir + name;
+    wxImage image;
+
+    if (wxFileExists(path))
+        image.LoadFile(path, wxBITMAP_TYPE_PNG);
+
+    return image;
+}
+
+wxTreeItemData *Palette::CreateItemData(Id id) const
+{
+    Creator create = m_entries[id].create;
+    return create ? create() : NULL;
+}
+
 // ----------------------------------------------------------------------------
 // main frame
 // ----------------------------------------------------------------------------
@@ -735,6 +869,9 @@ MyFrame::MyFrame(const wxString& title)
     testMenu->Append(ID_ZOOM_NORM, _T("Zoom 100%\tAlt+0"));
     testMenu->Append(ID_ZOOM, _T("Zoom\tAlt+Z"));
     testMenu->Append(ID_FIT, _T("Fit to Window\tCtrl+F"));
+    testMenu->Append(ID_SETZOOMMODE, _T("Set Zoom M&ode..."));
+    testMenu->AppendSeparator();
+    testMenu->AppendCheckItem(ID_BUNDLEEDGES, _T("B&undle Edges\tCtrl+U"));
     testMenu->AppendSeparator();
     testMenu->Append(ID_BORDER, _T("Scroll &Border\tCtrl+B"));
     testMenu->Append(ID_MARGIN, _T("Scroll &Margin\tCtrl+M"));
@@ -759,11 +896,22 @@ MyFrame::MyFrame(const wxString& title)
 
     // Example of creating the graph control and graph.
     wxSplitterWindow *splitter = new wxSplitterWindow(this);
-    m_tree = new GraphTreeCtrl(splitter);
+    wxSplitterWindow *left = new wxSplitterWindow(splitter);
+    wxPanel *palette = new wxPanel(left);
+    wxSearchCtrl *filter = new wxSearchCtrl(palette, ID_FILTER);
+    m_tree = new GraphTreeCtrl(palette);
+    wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(filter, 0, wxEXPAND);
+    sizer->Add(m_tree, 1, wxEXPAND);
+    palette->SetSizer(sizer);
+    GraphOverviewCtrl *overview = new GraphOverviewCtrl(left);
     m_graphctrl = new ProjectDesigner(splitter);
     m_graph = new Graph(this);
     m_graphctrl->SetGraph(m_graph);
-    splitter->SplitVertically(m_tree, m_graphctrl, 240);
+    overview->SetGraphCtrl(m_graphctrl);
+    left->SetSashGravity(1.0);
+    left->SplitHorizontally(palette, overview, -200);
+    splitter->SplitVertically(left, m_graphctrl, 240);
 
     // grey grid on a white background
     m_graphctrl->SetForegroundColour(*wxLIGHT_GREY);
@@ -774,44 +922,17 @@ MyFrame::MyFrame(const wxString& title)
     images->Add(icon);
     m_tree->AssignImageList(images);
 
-    // populate the tree control
-    wxTreeItemId id, idRoot = m_tree->AddRoot(_T("Root"));
-
-    id = AppendTreeItem(idRoot, ImportNode());
-    AppendTreeItem<ImportFileNode>(id);
-    AppendTreeItem<ImportODBCNode>(id);
-    m_tree->Expand(id);
-
-    id = AppendTreeItem(idRoot, ExportNode());
-    AppendTreeItem<ExportFileNode>(id);
-    AppendTreeItem<ExportODBCNode>(id);
-    m_tree->Expand(id);
-
-    id = AppendTreeItem(idRoot, AnalyseNode());
-    AppendTreeItem<SearchNode>(id);
-    AppendTreeItem<SampleNode>(id);
-    AppendTreeItem<SortNode>(id);
-    AppendTreeItem<ValidateNode>(id);
-    AppendTreeItem<AddressValNode>(id);
-    m_tree->Expand(id);
-
-    id = AppendTreeItem(idRoot, ReEngNode());
-    AppendTreeItem<CleanNode>(id);
-    AppendTreeItem<ExtractNode>(id);
-    AppendTreeItem<SplitNode>(id);
-    AppendTreeItem<UniteNode>(id);
-    AppendTreeItem<InsertNode>(id);
-    AppendTreeItem<DeleteNode>(id);
-    AppendTreeItem<ArrangeNode>(id);
-    AppendTreeItem<AppendNode>(id);
-    AppendTreeItem<SQLQueryNode>(id);
-    m_tree->Expand(id);
-
-    id = AppendTreeItem(idRoot, MatchUpNode());
-    AppendTreeItem<MatchNode>(id);
-    AppendTreeItem<MatchTableNode>(id);
-    AppendTreeItem<MergeNode>(id);
-    m_tree->Expand(id);
+    // populate the tree control, the palette is small enough to show it all
+    m_tree->SetProvider(&m_palette);
+
+    wxTreeItemId id, idRoot = m_tree->GetRootItem();
+    wxTreeItemIdValue cookie;
+
+    for (id = m_tree->GetFirstChild(idRoot, cookie); id.IsOk();
+         id = m_tree->GetNextChild(idRoot, cookie))
+    {
+        m_tree->Expand(id);
+    }
 
     // create a status bar just for fun (by default with 1 pane only)
     CreateStatusBar(2);
@@ -832,26 +953,12 @@ MyFrame::MyFrame(const wxString& title)
 
 MyFrame::~MyFrame()
 {
+    // the tree control outlives m_palette
+    m_tree->SetProvider(NULL);
     delete m_graphctrl;
     delete m_graph;
 }
 
-template <class T> void MyFrame::AppendTreeItem(const wxTreeItemId& id)
-{
-    Factory<T> factory;
-    const ProjectNode& node = factory.GetDefault();
-    AppendTreeItem(id, node, new TreeItemData(factory));
-}
-
-wxTreeItemId MyFrame::AppendTreeItem(const wxTreeItemId& id,
-                                     const ProjectNode& node,
-                                     TreeItemData *tid)
-{
-    wxImageList *imglist = m_tree->GetImageList();
-    int imgnum = imglist->Add(node.GetIcon());
-    return m_tree->AppendItem(id, node.GetText(), imgnum, -1, tid);
-}
-
 ProjectNode *MyFrame::NewNode(const wxTreeItemId& id, const wxPoint& pt)
 {
     TreeItemData *tid = static_cast<TreeItemData*>(m_tree->GetItemData(id));
@@ -893,6 +1000,11 @@ void MyFrame::OnTreeItemActivated(wxTreeEvent& event)
     }
 }
 
+void MyFrame::OnFilter(wxCommandEvent& event)
+{
+    m_tree->SetFilter(event.GetString());
+}
+
 void MyFrame::OnAddNode(GraphEvent&)
 {
     wxLogDebug(_T("OnAddNode"));
@@ -927,6 +1039,12 @@ void MyFrame::OnActivateNode(GraphEvent& event)
 {
     wxLogDebug(_T("OnActivateNode"));
 
+    // double clicking a collapsed group expands it
+    if (m_graph->IsGroupProxy(*event.GetNode())) {
+        m_graph->ExpandGroup(event.GetNode()->GetGroup());
+        return;
+    }
+
     ProjectNode *node = event.GetNode<ProjectNode>();
     int hit = node->HitTest(event.GetPosition());
 
@@ -960,7 +1078,19 @@ void MyFrame::OnMenuNode(GraphEvent& event)
     wxLogDebug(_T("OnMenuNode"));
 
     wxMenu menu;
+    wxPoint pt = event.GetPosition();
+    wxPoint ptClient = ScreenToClient(m_graphctrl->GraphToScreen(pt));
+
+    // the proxy of a collapsed group isn't a ProjectNode
+    if (m_graph->IsGroupProxy(*event.GetNode())) {
+        menu.Append(ID_LAYOUT, _T("&Layout Selection"));
+        menu.Append(ID_EXPANDGROUP, _T("&Expand Group"));
+        PopupMenu(&menu, ptClient.x, ptClient.y);
+        return;
+    }
+
     menu.Append(ID_LAYOUT, _T("&Layout Selection"));
+    menu.Append(ID_GROUP, _T("&Group Selection..."));
     menu.Append(ID_SETSIZE, _T("Set &Size..."));
     menu.Append(ID_SETFONT, _T("Set &Font..."));
     menu.Append(ID_SETCOLOUR, _T("Set &Colour..."));
@@ -977,9 +1107,6 @@ void MyFrame::OnMenuNode(GraphEvent& event)
     submenu->Append(ID_DIAMOND, _T("&Diamond"));
     menu.Append(ID_STYLE, _T("Set St&yle"), submenu);
 
-    wxPoint pt = event.GetPosition();
-    wxPoint ptClient = ScreenToClient(m_graphctrl->GraphToScreen(pt));
-
     m_element = m_node = event.GetNode<ProjectNode>();
     PopupMenu(&menu, ptClient.x, ptClient.y);
     m_element = m_node = NULL;
@@ -1628,6 +1755,42 @@ void MyFrame::OnLayout(wxCommandEvent&)
     m_graph->Layout(m_graph->GetSelectionNodes());
 }
 
+// Put the selected nodes into a group and collapse it to a single node.
+// Double clicking the group's node expands it again.
+//
+void MyFrame::OnGroup(wxCommandEvent&)
+{
+    wxString name = wxGetTextFromUser(_T("Group name:"), _T("Group"),
+                                      wxEmptyString, this);
+    if (name.empty())
+        return;
+
+    std::vector<GraphNode*> nodes;
+    Graph::node_iterator it, end;
+
+    for (tie(it, end) = m_graph->GetSelectionNodes(); it != end; ++it)
+        if (!m_graph->IsGroupProxy(*it))
+            nodes.push_back(&*it);
+
+    for (size_t i = 0; i < nodes.size(); i++)
+        nodes[i]->SetGroup(name);
+
+    m_graph->CollapseGroup(name);
+}
+
+void MyFrame::OnExpandGroup(wxCommandEvent&)
+{
+    std::vector<wxString> groups;
+    Graph::node_iterator it, end;
+
+    for (tie(it, end) = m_graph->GetSelectionNodes(); it != end; ++it)
+        if (m_graph->IsGroupProxy(*it))
+            groups.push_back(it->GetGroup());
+
+    for (size_t i = 0; i < groups.size(); i++)
+        m_graph->ExpandGroup(groups[i]);
+}
+
 void MyFrame::OnLayoutAll(wxCommandEvent&)
 {
     m_graph->LayoutAll();
@@ -1725,6 +1888,16 @@ void MyFrame::OnUISnapToGrid(wxUpdateUIEvent& event)
     event.Check(m_graph->GetSnapToGrid());
 }
 
+void MyFrame::OnBundleEdges(wxCommandEvent&)
+{
+    m_graphctrl->SetEdgeBundling(!m_graphctrl->IsEdgeBundling());
+}
+
+void MyFrame::OnUIBundleEdges(wxUpdateUIEvent& event)
+{
+    event.Check(m_graphctrl->IsEdgeBundling());
+}
+
 void MyFrame::OnSetGrid(wxCommandEvent&)
 {
     long spacing = wxGetNumberFromUser(_T(""), _T("Grid Spacing:"),
@@ -1762,4 +1935,20 @@ void MyFrame::OnSetToolTipMode(wxCommandEvent&)
         m_graphctrl->EnableToolTips(static_cast<GraphCtrl::ToolTipMode>(mode));
 }
 
+void MyFrame::OnSetZoomMode(wxCommandEvent&)
+{
+    // These strings must correspond to GraphCtrl::ZoomMode enum elements.
+    static wxString choices[] = {
+        _T("Redraw at each step"),
+        _T("Scale the last frame, redraw when idle"),
+        _T("Scale the last frame smoothly, redraw when idle")
+    };
+
+    int mode = wxGetSingleChoiceIndex(_T("Mouse wheel zoom mode:"), _T("Zoom"),
+                                      WXSIZEOF(choices), choices, this);
+
+    if (mode >= 0)
+        m_graphctrl->SetZoomMode(static_cast<GraphCtrl::ZoomMode>(mode));
+}
+
 /** @endcond */
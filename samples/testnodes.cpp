@@ -61,9 +61,8 @@ Factory<MergeNode>::Impl        merge(_T("merge"));
 
 //@}
 
-/**
- * Return the path of the directory containing the icons.
- */
+} // namespace
+
 wxString GetResourceDir()
 {
     wxString dir;
@@ -74,8 +73,6 @@ wxString GetResourceDir()
     return dir + wxFileName::GetPathSeparator();
 }
 
-} // namespace
-
 TestNode::TestNode(const wxColour& colour,
                    const wxString& operation,
                    const wxString& imgfile,
@@ -16,6 +16,11 @@
 
 #include "projectdesigner.h"
 
+/**
+ * Return the path of the directory containing the icons.
+ */
+wxString GetResourceDir();
+
 /**
  * Base class for test nodes.
  */
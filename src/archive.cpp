@@ -21,6 +21,8 @@
 #include <wx/mstream.h>
 
 #include "archive.h"
+#include "graphmemory.h"
+#include "graphprofile.h"
 #include "tie.h"
 
 /**
@@ -491,6 +493,8 @@ wxString FromXml(const wxString& str)
 
 bool Archive::Load(wxInputStream& stream)
 {
+    GRAPH_PROFILE_SCOPE("Archive::Load");
+
     m_storing = false;
     Clear();
 
@@ -551,6 +555,8 @@ bool Archive::Load(wxInputStream& stream)
 
 bool Archive::Load(wxInputStream& stream)
 {
+    GRAPH_PROFILE_SCOPE("Archive::Load");
+
     m_storing = false;
     Clear();
 
@@ -577,6 +583,8 @@ bool Archive::Load(wxInputStream& stream)
 
 bool Archive::Save(wxOutputStream& stream) const
 {
+    GRAPH_PROFILE_SCOPE("Archive::Save");
+
     Generator out(stream);
     out.Write("<?xml version=\"1.0\" encoding=\"utf-8\"?>");
     out.Start(TAGARCHIVE);
@@ -612,6 +620,42 @@ bool Archive::Save(wxOutputStream& stream) const
     return stream.IsOk();
 }
 
+void Archive::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    const int cat = GraphMemoryUsage::Mem_Archive;
+
+    // the colour, parent and child links of a std::map node
+    const size_t header = 4 * sizeof(void*);
+
+    ItemMap::const_iterator i;
+
+    for (i = m_items.begin(); i != m_items.end(); ++i) {
+        const Item *item = i->second;
+
+        usage.Add(cat, header + sizeof(ItemMap::value_type));
+        usage.AddString(cat, i->first);
+        usage.Add(cat, sizeof(Item));
+        usage.AddString(cat, item->m_class);
+        usage.AddString(cat, item->m_id);
+        usage.AddString(cat, item->m_sort);
+
+        Item::const_iterator j, jend;
+
+        for (tie(j, jend) = item->GetAttribs(); j != jend; ++j) {
+            usage.Add(cat, header + sizeof(Item::StringMap::value_type));
+            usage.AddString(cat, j->first);
+            usage.AddString(cat, j->second);
+        }
+    }
+
+    SortMap::const_iterator k;
+
+    for (k = m_sort.begin(); k != m_sort.end(); ++k) {
+        usage.Add(cat, header + sizeof(SortMap::value_type));
+        usage.AddString(cat, k->first);
+    }
+}
+
 Archive::Item *Archive::Put(const wxString& name,
                             const wxString& id,
                             const wxString& sort)
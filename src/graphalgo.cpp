@@ -0,0 +1,500 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphalgo.cpp
+// Purpose:     Graph algorithms operating on graph snapshots
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of the graph algorithms.
+ *
+ * All the traversals are iterative so that long chains, which are common in
+ * pipelines, can't overflow the stack.
+ *
+ * The breadth first search expands large frontiers in parallel in two
+ * phases. First the frontier is split between threads which scan the
+ * adjacency arrays collecting the unvisited neighbours while the depths are
+ * only read. Then the candidates are merged on the calling thread in thread
+ * order, which marks them visited and drops the duplicates. Since no thread
+ * writes shared data during the scan no synchronisation is needed beyond
+ * joining the threads, and the result does not depend on the number of
+ * threads.
+ */
+
+#include "graphalgo.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <thread>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace {
+
+typedef GraphSnapshot::Index Index;
+const Index npos = GraphSnapshot::npos;
+
+// The smallest frontier that is worth splitting between threads.
+const size_t minParallel = 8192;
+
+// Returns the number of neighbours of a node in the given direction.
+inline size_t Degree(const GraphSnapshot& graph, Index n, int direction)
+{
+    size_t degree = 0;
+    if (direction & Direction_Out)
+        degree += graph.GetOutDegree(n);
+    if (direction & Direction_In)
+        degree += graph.GetInDegree(n);
+    return degree;
+}
+
+// Returns the k'th neighbour of a node in the given direction, the nodes
+// connected by the out edges coming first.
+inline Index Neighbour(const GraphSnapshot& graph,
+                       Index n,
+                       size_t k,
+                       int direction)
+{
+    if (direction & Direction_Out) {
+        size_t out = graph.GetOutDegree(n);
+        if (k < out)
+            return graph.OutBegin(n)[k];
+        k -= out;
+    }
+    return graph.InBegin(n)[k];
+}
+
+inline double Weight(const GraphWeightList& weights, Index i)
+{
+    return weights.empty() ? 1.0 : weights[i];
+}
+
+// Appends the unvisited neighbours of the nodes in [begin, end).
+void Expand(const GraphSnapshot& graph,
+            const Index *begin,
+            const Index *end,
+            const GraphIndexList& depth,
+            int direction,
+            GraphIndexList& candidates)
+{
+    for (const Index *p = begin; p != end; ++p) {
+        size_t degree = Degree(graph, *p, direction);
+
+        for (size_t k = 0; k < degree; k++) {
+            Index m = Neighbour(graph, *p, k, direction);
+            if (depth[m] == npos)
+                candidates.push_back(m);
+        }
+    }
+}
+
+} // namespace
+
+void BreadthFirstSearch(const GraphSnapshot& graph,
+                        const GraphIndexList& sources,
+                        GraphIndexList& depth,
+                        GraphIndexList *order,
+                        int direction,
+                        unsigned threads)
+{
+    depth.assign(graph.GetNodeCount(), npos);
+    if (order)
+        order->clear();
+
+    if (threads == 0)
+        threads = max(thread::hardware_concurrency(), 1u);
+
+    GraphIndexList frontier;
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (depth[sources[i]] == npos) {
+            depth[sources[i]] = 0;
+            frontier.push_back(sources[i]);
+        }
+    }
+
+    vector<GraphIndexList> candidates(threads);
+    GraphIndexList next;
+    Index level = 0;
+
+    while (!frontier.empty()) {
+        if (order)
+            order->insert(order->end(), frontier.begin(), frontier.end());
+
+        level++;
+        size_t parts = 1;
+        const Index *begin = &frontier[0];
+        const Index *end = begin + frontier.size();
+
+        if (threads > 1 && frontier.size() >= minParallel) {
+            parts = min(size_t(threads), frontier.size() / (minParallel / 4));
+            size_t chunk = (frontier.size() + parts - 1) / parts;
+            vector<thread> workers;
+
+            for (size_t t = 1; t < parts; t++) {
+                candidates[t].clear();
+                const Index *b = begin + min(t * chunk, frontier.size());
+                const Index *e = begin + min((t + 1) * chunk, frontier.size());
+                workers.push_back(thread(Expand, cref(graph), b, e,
+                                         cref(depth), direction,
+                                         ref(candidates[t])));
+            }
+
+            candidates[0].clear();
+            Expand(graph, begin, begin + chunk, depth, direction, candidates[0]);
+
+            for (size_t t = 0; t < workers.size(); t++)
+                workers[t].join();
+        }
+        else {
+            candidates[0].clear();
+            Expand(graph, begin, end, depth, direction, candidates[0]);
+        }
+
+        next.clear();
+
+        for (size_t t = 0; t < parts; t++) {
+            const GraphIndexList& c = candidates[t];
+
+            for (size_t i = 0; i < c.size(); i++) {
+                if (depth[c[i]] == npos) {
+                    depth[c[i]] = level;
+                    next.push_back(c[i]);
+                }
+            }
+        }
+
+        frontier.swap(next);
+    }
+}
+
+vector<bool> Reachable(const GraphSnapshot& graph,
+                       const GraphIndexList& sources,
+                       int direction,
+                       unsigned threads)
+{
+    GraphIndexList depth;
+    BreadthFirstSearch(graph, sources, depth, NULL, direction, threads);
+
+    vector<bool> reachable(depth.size());
+    for (size_t n = 0; n < depth.size(); n++)
+        reachable[n] = depth[n] != npos;
+
+    return reachable;
+}
+
+void DepthFirstSearch(const GraphSnapshot& graph,
+                      const GraphIndexList& sources,
+                      GraphIndexList& preorder,
+                      GraphIndexList *postorder,
+                      int direction)
+{
+    vector<bool> visited(graph.GetNodeCount());
+    vector< pair<Index, size_t> > stack;
+
+    preorder.clear();
+    if (postorder)
+        postorder->clear();
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        Index s = sources[i];
+        if (visited[s])
+            continue;
+
+        visited[s] = true;
+        preorder.push_back(s);
+        stack.push_back(make_pair(s, size_t(0)));
+
+        while (!stack.empty()) {
+            Index n = stack.back().first;
+            size_t k = stack.back().second;
+
+            if (k < Degree(graph, n, direction)) {
+                stack.back().second++;
+                Index m = Neighbour(graph, n, k, direction);
+
+                if (!visited[m]) {
+                    visited[m] = true;
+                    preorder.push_back(m);
+                    stack.push_back(make_pair(m, size_t(0)));
+                }
+            }
+            else {
+                if (postorder)
+                    postorder->push_back(n);
+                stack.pop_back();
+            }
+        }
+    }
+}
+
+bool TopologicalSort(const GraphSnapshot& graph, GraphIndexList& order)
+{
+    size_t count = graph.GetNodeCount();
+    GraphIndexList indegree(count);
+
+    order.clear();
+    order.reserve(count);
+
+    for (Index n = 0; n < count; n++) {
+        indegree[n] = Index(graph.GetInDegree(n));
+        if (indegree[n] == 0)
+            order.push_back(n);
+    }
+
+    // order doubles as the queue of nodes with no remaining predecessors
+    for (size_t i = 0; i < order.size(); i++) {
+        Index n = order[i];
+        const Index *p, *end = graph.OutEnd(n);
+
+        for (p = graph.OutBegin(n); p != end; ++p)
+            if (--indegree[*p] == 0)
+                order.push_back(*p);
+    }
+
+    return order.size() == count;
+}
+
+size_t StronglyConnectedComponents(const GraphSnapshot& graph,
+                                   GraphIndexList& component)
+{
+    size_t count = graph.GetNodeCount();
+    GraphIndexList index(count, npos);
+    GraphIndexList low(count);
+    GraphIndexList stack;
+    vector< pair<Index, size_t> > calls;
+    Index counter = 0;
+    size_t components = 0;
+
+    component.assign(count, npos);
+
+    for (Index s = 0; s < count; s++) {
+        if (index[s] != npos)
+            continue;
+
+        index[s] = low[s] = counter++;
+        stack.push_back(s);
+        calls.push_back(make_pair(s, size_t(0)));
+
+        while (!calls.empty()) {
+            Index v = calls.back().first;
+            size_t k = calls.back().second;
+
+            if (k < graph.GetOutDegree(v)) {
+                calls.back().second++;
+                Index w = graph.OutBegin(v)[k];
+
+                if (index[w] == npos) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    calls.push_back(make_pair(w, size_t(0)));
+                }
+                else if (component[w] == npos) {
+                    // w is still on the stack
+                    low[v] = min(low[v], index[w]);
+                }
+            }
+            else {
+                calls.pop_back();
+
+                if (low[v] == index[v]) {
+                    Index w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        component[w] = Index(components);
+                    } while (w != v);
+
+                    components++;
+                }
+
+                if (!calls.empty()) {
+                    Index u = calls.back().first;
+                    low[u] = min(low[u], low[v]);
+                }
+            }
+        }
+    }
+
+    return components;
+}
+
+size_t ConnectedComponents(const GraphSnapshot& graph,
+                           GraphIndexList& component)
+{
+    size_t count = graph.GetNodeCount();
+    GraphIndexList parent(count);
+
+    for (Index n = 0; n < count; n++)
+        parent[n] = n;
+
+    // union-find over the edge arrays, with path halving
+    for (Index e = 0; e < graph.GetEdgeCount(); e++) {
+        Index a = graph.GetFrom(e), b = graph.GetTo(e);
+
+        while (parent[a] != a)
+            a = parent[a] = parent[parent[a]];
+        while (parent[b] != b)
+            b = parent[b] = parent[parent[b]];
+
+        if (a != b)
+            parent[max(a, b)] = min(a, b);
+    }
+
+    // number the components in the order of their first node
+    size_t components = 0;
+    component.assign(count, npos);
+
+    for (Index n = 0; n < count; n++) {
+        Index root = n;
+        while (parent[root] != root)
+            root = parent[root];
+
+        if (component[root] == npos)
+            component[root] = Index(components++);
+        component[n] = component[root];
+    }
+
+    return components;
+}
+
+void ShortestPaths(const GraphSnapshot& graph,
+                   GraphSnapshot::Index source,
+                   const GraphWeightList& weights,
+                   GraphWeightList& distance,
+                   GraphIndexList *predecessor,
+                   int direction)
+{
+    typedef pair<double, Index> Item;
+    priority_queue< Item, vector<Item>, greater<Item> > queue;
+    size_t count = graph.GetNodeCount();
+
+    distance.assign(count, numeric_limits<double>::infinity());
+    if (predecessor)
+        predecessor->assign(count, npos);
+
+    distance[source] = 0;
+    queue.push(Item(0, source));
+
+    while (!queue.empty()) {
+        Item item = queue.top();
+        queue.pop();
+
+        Index n = item.second;
+        if (item.first > distance[n])
+            continue;
+
+        for (int dir = Direction_Out; dir <= Direction_In; dir <<= 1) {
+            if ((direction & dir) == 0)
+                continue;
+
+            const Index *node, *edge, *end;
+
+            if (dir == Direction_Out) {
+                node = graph.OutBegin(n);
+                edge = graph.OutEdgesBegin(n);
+                end = graph.OutEdgesEnd(n);
+            }
+            else {
+                node = graph.InBegin(n);
+                edge = graph.InEdgesBegin(n);
+                end = graph.InEdgesEnd(n);
+            }
+
+            for (; edge != end; ++edge, ++node) {
+                double d = item.first + Weight(weights, *edge);
+
+                if (d < distance[*node]) {
+                    distance[*node] = d;
+                    if (predecessor)
+                        (*predecessor)[*node] = *edge;
+                    queue.push(Item(d, *node));
+                }
+            }
+        }
+    }
+}
+
+bool LongestPaths(const GraphSnapshot& graph,
+                  const GraphWeightList& nodeWeights,
+                  const GraphWeightList& edgeWeights,
+                  GraphWeightList& finish,
+                  GraphIndexList *predecessor)
+{
+    GraphIndexList order;
+    if (!TopologicalSort(graph, order))
+        return false;
+
+    size_t count = graph.GetNodeCount();
+    finish.assign(count, 0);
+    if (predecessor)
+        predecessor->assign(count, npos);
+
+    // predecessors come first in the order so are already final
+    for (size_t i = 0; i < count; i++) {
+        Index n = order[i];
+        const Index *node = graph.InBegin(n);
+        const Index *edge = graph.InEdgesBegin(n);
+        const Index *end = graph.InEdgesEnd(n);
+        double start = 0;
+        Index best = npos;
+
+        for (; edge != end; ++edge, ++node) {
+            double t = finish[*node] + Weight(edgeWeights, *edge);
+            if (best == npos || t > start) {
+                start = t;
+                best = *edge;
+            }
+        }
+
+        finish[n] = start + Weight(nodeWeights, n);
+        if (predecessor)
+            (*predecessor)[n] = best;
+    }
+
+    return true;
+}
+
+bool CriticalPath(const GraphSnapshot& graph,
+                  const GraphWeightList& nodeWeights,
+                  const GraphWeightList& edgeWeights,
+                  GraphIndexList& path,
+                  double *length)
+{
+    GraphWeightList finish;
+    GraphIndexList predecessor;
+
+    path.clear();
+    if (length)
+        *length = 0;
+
+    if (!LongestPaths(graph, nodeWeights, edgeWeights, finish, &predecessor))
+        return false;
+
+    if (finish.empty())
+        return true;
+
+    Index n = Index(max_element(finish.begin(), finish.end()) - finish.begin());
+    if (length)
+        *length = finish[n];
+
+    for (;;) {
+        path.push_back(n);
+        if (predecessor[n] == npos)
+            break;
+        n = graph.GetFrom(predecessor[n]);
+    }
+
+    reverse(path.begin(), path.end());
+    return true;
+}
+
+} // namespace tt_solutions
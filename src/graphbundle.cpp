@@ -0,0 +1,559 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphbundle.cpp
+// Purpose:     Edge bundling for GraphCtrl
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of EdgeBundles.
+ *
+ * The edges are kept after bundling, sorted by key, so that when nodes
+ * have only moved each edge's ends can be compared with where they were.
+ * As long as no edge has changed cells the bundles are the same, and just
+ * the paths of the bundles with an edge that moved are planned again.
+ */
+
+#include "graphbundle.h"
+#include "graphprofile.h"
+#include <wx/ogl/ogl.h>
+#include <algorithm>
+#include <thread>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace impl {
+
+namespace {
+
+/// The fewest edges worth keying to cells on more than one thread.
+const size_t minParallelEdges = 8192;
+
+/// The fewest bundles worth planning on more than one thread.
+const size_t minParallelBundles = 256;
+
+/**
+ * How far the inner points of a bundle's path are pulled towards the
+ * straight line between its ends, zero leaving the path on the centres of
+ * the blocks and one making it straight.
+ */
+const double bundleStraightening = 0.15;
+
+/// The key of an edge within a single cell, which is never bundled.
+const wxUint32 noBundle = ~wxUint32(0);
+
+} // namespace
+
+EdgeBundles::EdgeBundles(wxShapeCanvas *canvas)
+  : m_canvas(canvas),
+    m_enabled(false),
+    m_stale(true),
+    m_moved(false),
+    m_threshold(DefaultThreshold),
+    m_colour(96, 112, 160),
+    m_hover(-1),
+    m_cell(1)
+{
+}
+
+EdgeBundles::~EdgeBundles()
+{
+    Clear();
+}
+
+void EdgeBundles::Enable(bool enable)
+{
+    if (enable != m_enabled) {
+        m_enabled = enable;
+        Update();
+    }
+}
+
+void EdgeBundles::SetThreshold(size_t threshold)
+{
+    m_threshold = max(threshold, size_t(2));
+    Invalidate();
+}
+
+void EdgeBundles::SetColour(const wxColour& colour)
+{
+    m_colour = colour;
+    if (!m_bundles.empty())
+        m_canvas->Refresh();
+}
+
+void EdgeBundles::SetHover(const wxPoint& pt)
+{
+    int hover = -1;
+
+    if (pt != wxDefaultPosition) {
+        for (size_t i = 0; i < m_bundles.size() && hover < 0; i++) {
+            const Bundle& bundle = m_bundles[i];
+            int attachment;
+            double distance;
+
+            if (bundle.rect.Contains(pt) &&
+                    bundle.line->HitTest(pt.x, pt.y, &attachment, &distance))
+                hover = int(i);
+        }
+    }
+
+    if (hover != m_hover) {
+        if (m_hover >= 0)
+            RefreshArea(m_bundles[m_hover].rect);
+        m_hover = hover;
+        if (m_hover >= 0)
+            RefreshArea(m_bundles[m_hover].rect);
+    }
+}
+
+void EdgeBundles::Collect(wxList& shapes)
+{
+    double left = 0, top = 0, right = 0, bottom = 0;
+    wxList::iterator it;
+
+    for (it = shapes.begin(); it != shapes.end(); ++it) {
+        wxShape *shape = static_cast<wxShape*>(*it);
+
+        if (!shape->IsShown() ||
+                !wxDynamicCast(shape->GetClientData(), GraphEdge))
+            continue;
+
+        wxLineShape *line = static_cast<wxLineShape*>(shape);
+        wxShape *from = line->GetFrom(), *to = line->GetTo();
+        if (!from || !to)
+            continue;
+
+        Edge edge = {
+            line,
+            wxRealPoint(from->GetX(), from->GetY()),
+            wxRealPoint(to->GetX(), to->GetY()),
+            noBundle
+        };
+
+        if (m_work.empty()) {
+            left = right = edge.from.x;
+            top = bottom = edge.from.y;
+        }
+
+        left = min(left, min(edge.from.x, edge.to.x));
+        top = min(top, min(edge.from.y, edge.to.y));
+        right = max(right, max(edge.from.x, edge.to.x));
+        bottom = max(bottom, max(edge.from.y, edge.to.y));
+
+        m_work.push_back(edge);
+    }
+
+    // square cells, so that the blocks are square too
+    m_origin = wxRealPoint(left, top);
+    m_cell = max(max(right - left, bottom - top) / Resolution, 1.0);
+}
+
+void EdgeBundles::Split(size_t n, size_t grain,
+                        void (EdgeBundles::*work)(size_t, size_t))
+{
+    unsigned threads = max(thread::hardware_concurrency(), 1u);
+
+    if (threads == 1 || n < grain) {
+        (this->*work)(0, n);
+        return;
+    }
+
+    size_t parts = min(size_t(threads), n / (grain / 4));
+    size_t chunk = (n + parts - 1) / parts;
+    vector<thread> workers;
+
+    for (size_t t = 1; t < parts; t++)
+        workers.push_back(thread(work, this, min(t * chunk, n),
+                                 min((t + 1) * chunk, n)));
+
+    (this->*work)(0, chunk);
+
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+}
+
+wxUint32 EdgeBundles::GetCell(const wxRealPoint& pt) const
+{
+    int x = min(max(int((pt.x - m_origin.x) / m_cell), 0), Resolution - 1);
+    int y = min(max(int((pt.y - m_origin.y) / m_cell), 0), Resolution - 1);
+    return y * Resolution + x;
+}
+
+wxUint32 EdgeBundles::GetKey(const wxRealPoint& from,
+                             const wxRealPoint& to) const
+{
+    wxUint32 cellFrom = GetCell(from), cellTo = GetCell(to);
+    return cellFrom != cellTo ? cellFrom << 16 | cellTo : noBundle;
+}
+
+bool EdgeBundles::IsOnGrid(const wxRealPoint& pt) const
+{
+    double size = m_cell * Resolution;
+
+    return pt.x >= m_origin.x && pt.x <= m_origin.x + size &&
+           pt.y >= m_origin.y && pt.y <= m_origin.y + size;
+}
+
+wxUint32 EdgeBundles::GetBlock(wxUint32 cell, int level)
+{
+    return ((cell / Resolution) >> level) * Resolution +
+           ((cell % Resolution) >> level);
+}
+
+wxRealPoint EdgeBundles::GetCentre(wxUint32 cell, int level) const
+{
+    double size = m_cell * (1 << level);
+    int x = (cell % Resolution) >> level;
+    int y = (cell / Resolution) >> level;
+
+    return wxRealPoint(m_origin.x + (x + 0.5) * size,
+                       m_origin.y + (y + 0.5) * size);
+}
+
+int EdgeBundles::GetWidth(size_t count)
+{
+    int width = 1;
+
+    for (; count > 1 && width < MaxWidth; count >>= 1)
+        width += 2;
+
+    return min(width, int(MaxWidth));
+}
+
+void EdgeBundles::KeyEdges(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+        m_work[i].key = GetKey(m_work[i].from, m_work[i].to);
+}
+
+void EdgeBundles::PlanBundles(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        Bundle& bundle = m_bundles[i];
+        wxRealPoint sum[2];
+
+        for (size_t j = bundle.first; j < bundle.last; j++) {
+            const Edge& edge = m_work[j];
+
+            sum[0].x += edge.from.x;
+            sum[0].y += edge.from.y;
+            sum[1].x += edge.to.x;
+            sum[1].y += edge.to.y;
+
+            bundle.ends[0].push_back(wxPoint(WXROUND(edge.from.x),
+                                             WXROUND(edge.from.y)));
+            bundle.ends[1].push_back(wxPoint(WXROUND(edge.to.x),
+                                             WXROUND(edge.to.y)));
+        }
+
+        // edges often share nodes, draw one line from each
+        for (int k = 0; k < 2; k++) {
+            vector<wxPoint>& ends = bundle.ends[k];
+            sort(ends.begin(), ends.end(), PointLess);
+            ends.erase(unique(ends.begin(), ends.end()), ends.end());
+        }
+
+        double n = double(bundle.last - bundle.first);
+        wxRealPoint start(sum[0].x / n, sum[0].y / n);
+        wxRealPoint finish(sum[1].x / n, sum[1].y / n);
+
+        wxUint32 key = m_work[bundle.first].key;
+        wxUint32 from = key >> 16, to = key & 0xffff;
+
+        // up the quadtree to the smallest block containing both cells
+        int top = 1;
+        while (top < Levels && GetBlock(from, top) != GetBlock(to, top))
+            top++;
+
+        vector<wxRealPoint>& path = bundle.path;
+        path.push_back(start);
+        for (int level = 1; level <= top; level++)
+            path.push_back(GetCentre(from, level));
+        for (int level = top - 1; level >= 1; level--)
+            path.push_back(GetCentre(to, level));
+        path.push_back(finish);
+
+        size_t last = path.size() - 1;
+        wxRect rc(bundle.ends[0].front(), bundle.ends[0].front());
+
+        for (size_t k = 0; k <= last; k++) {
+            if (k > 0 && k < last) {
+                double t = double(k) / last;
+                path[k].x += bundleStraightening *
+                             (start.x + t * (finish.x - start.x) - path[k].x);
+                path[k].y += bundleStraightening *
+                             (start.y + t * (finish.y - start.y) - path[k].y);
+            }
+
+            wxPoint pt(WXROUND(path[k].x), WXROUND(path[k].y));
+            rc.Union(wxRect(pt, pt));
+        }
+
+        for (int k = 0; k < 2; k++)
+            for (size_t j = 0; j < bundle.ends[k].size(); j++)
+                rc.Union(wxRect(bundle.ends[k][j], bundle.ends[k][j]));
+
+        bundle.rect = rc.Inflate(MaxWidth + ArrowSize);
+    }
+}
+
+void EdgeBundles::Update()
+{
+    GRAPH_PROFILE_SCOPE("EdgeBundles::Update");
+
+    // nodes that have only moved are followed without bundling again
+    bool moved = m_moved;
+    m_moved = false;
+
+    if (m_enabled && !m_stale && moved && Replan())
+        return;
+
+    Clear();
+    m_stale = false;
+
+    wxDiagram *diagram = m_canvas->GetDiagram();
+
+    if (m_enabled && diagram && diagram->GetShapeList()) {
+        Collect(*diagram->GetShapeList());
+        Split(m_work.size(), minParallelEdges, &EdgeBundles::KeyEdges);
+        sort(m_work.begin(), m_work.end(), KeyLess);
+
+        // the edges within a cell sort last
+        size_t first = 0;
+
+        while (first < m_work.size() && m_work[first].key != noBundle) {
+            size_t last = first + 1;
+
+            while (last < m_work.size() &&
+                    m_work[last].key == m_work[first].key)
+                last++;
+
+            if (last - first >= m_threshold) {
+                m_bundles.push_back(Bundle());
+                m_bundles.back().first = first;
+                m_bundles.back().last = last;
+                m_bundles.back().line = NULL;
+            }
+
+            first = last;
+        }
+
+        Split(m_bundles.size(), minParallelBundles, &EdgeBundles::PlanBundles);
+
+        // OGL objects are only made on this thread
+        for (size_t i = 0; i < m_bundles.size(); i++) {
+            Bundle& bundle = m_bundles[i];
+            wxLineShape *line = new wxLineShape;
+
+            line->SetSpline(true);
+            line->AddArrow(ARROW_ARROW, ARROW_POSITION_END,
+                           ArrowSize + GetWidth(bundle.last - bundle.first));
+            bundle.line = line;
+            SetLinePoints(bundle);
+
+            for (size_t j = bundle.first; j < bundle.last; j++)
+                m_lines[m_work[j].line] = i;
+        }
+    }
+
+    GRAPH_PROFILE_COUNT("EdgeBundles::Update/bundles", m_bundles.size());
+    GRAPH_PROFILE_COUNT("EdgeBundles::Update/edges", m_lines.size());
+
+    m_canvas->Refresh();
+}
+
+bool EdgeBundles::Replan()
+{
+    GRAPH_PROFILE_SCOPE("EdgeBundles::Replan");
+
+    vector<size_t> moved;
+
+    for (size_t i = 0; i < m_work.size(); i++) {
+        Edge& edge = m_work[i];
+        wxLineShape *line = static_cast<wxLineShape*>(edge.line);
+        wxShape *from = line->GetFrom(), *to = line->GetTo();
+
+        if (!line->IsShown() || !from || !to)
+            return false;
+
+        wxRealPoint ptFrom(from->GetX(), from->GetY());
+        wxRealPoint ptTo(to->GetX(), to->GetY());
+
+        if (ptFrom == edge.from && ptTo == edge.to)
+            continue;
+
+        if (!IsOnGrid(ptFrom) || !IsOnGrid(ptTo) ||
+                GetKey(ptFrom, ptTo) != edge.key)
+            return false;
+
+        edge.from = ptFrom;
+        edge.to = ptTo;
+
+        LineMap::const_iterator it = m_lines.find(edge.line);
+        if (it != m_lines.end())
+            moved.push_back(it->second);
+    }
+
+    sort(moved.begin(), moved.end());
+    moved.erase(unique(moved.begin(), moved.end()), moved.end());
+
+    for (size_t i = 0; i < moved.size(); i++) {
+        Bundle& bundle = m_bundles[moved[i]];
+
+        RefreshArea(bundle.rect);
+
+        bundle.path.clear();
+        bundle.ends[0].clear();
+        bundle.ends[1].clear();
+        PlanBundles(moved[i], moved[i] + 1);
+        SetLinePoints(bundle);
+
+        RefreshArea(bundle.rect);
+    }
+
+    GRAPH_PROFILE_COUNT("EdgeBundles::Replan/bundles", moved.size());
+
+    return true;
+}
+
+void EdgeBundles::SetLinePoints(Bundle& bundle)
+{
+    wxLinePoints& points = bundle.line->GetLinePoints();
+
+    points.SetCount(bundle.path.size());
+    copy(bundle.path.begin(), bundle.path.end(), points.GetData());
+}
+
+void EdgeBundles::Clear()
+{
+    for (size_t i = 0; i < m_bundles.size(); i++)
+        delete m_bundles[i].line;
+
+    m_work.clear();
+    m_bundles.clear();
+    m_lines.clear();
+    m_hover = -1;
+}
+
+void EdgeBundles::RemoveLine(const wxShape *shape)
+{
+    m_lines.erase(shape);
+    Invalidate();
+}
+
+void EdgeBundles::Draw(wxDC& dc)
+{
+    if (m_bundles.empty())
+        return;
+
+    GRAPH_PROFILE_SCOPE("EdgeBundles::Draw");
+
+    wxRect clip;
+    dc.GetClipBox(clip);
+
+    dc.SetFont(m_canvas->GetFont());
+    dc.SetTextBackground(m_canvas->GetBackgroundColour());
+    dc.SetBackgroundMode(wxSOLID);
+
+    for (size_t i = 0; i < m_bundles.size(); i++) {
+        Bundle& bundle = m_bundles[i];
+
+        if (!clip.IsEmpty() && !clip.Intersects(bundle.rect))
+            continue;
+
+        // an expanded bundle fades behind its edges
+        wxColour colour = int(i) == m_hover ?
+                          m_colour.ChangeLightness(170) : m_colour;
+        size_t count = bundle.last - bundle.first;
+        wxLinePoints& points = bundle.line->GetLinePoints();
+        size_t n = points.GetCount();
+        wxPoint start(WXROUND(points[0].x), WXROUND(points[0].y));
+        wxPoint finish(WXROUND(points[n - 1].x), WXROUND(points[n - 1].y));
+
+        dc.SetPen(*wxThePenList->FindOrCreatePen(colour));
+
+        for (size_t j = 0; j < bundle.ends[0].size(); j++)
+            dc.DrawLine(bundle.ends[0][j], start);
+        for (size_t j = 0; j < bundle.ends[1].size(); j++)
+            dc.DrawLine(finish, bundle.ends[1][j]);
+
+        bundle.line->SetPen(wxThePenList->FindOrCreatePen(colour,
+                                                          GetWidth(count)));
+        bundle.line->SetBrush(wxTheBrushList->FindOrCreateBrush(colour));
+        bundle.line->OnDraw(dc);
+
+        // the spline passes through the middle of each inner segment
+        const wxRealPoint& pt1 = points[n / 2 - 1];
+        const wxRealPoint& pt2 = points[n / 2];
+        wxString label = wxString::Format(_T("%lu"), (unsigned long)count);
+        wxSize size = dc.GetTextExtent(label);
+
+        dc.SetTextForeground(colour);
+        dc.DrawText(label, WXROUND((pt1.x + pt2.x) / 2) - size.x / 2,
+                           WXROUND((pt1.y + pt2.y) / 2) - size.y / 2);
+    }
+
+    dc.SetBackgroundMode(wxTRANSPARENT);
+    dc.SetBrush(wxNullBrush);
+    dc.SetPen(wxNullPen);
+}
+
+bool EdgeBundles::IsCollapsed(wxShape *shape) const
+{
+    if (m_lines.empty())
+        return false;
+
+    LineMap::const_iterator it = m_lines.find(shape);
+
+    if (it == m_lines.end() || int(it->second) == m_hover || shape->Selected())
+        return false;
+
+    wxLineShape *line = static_cast<wxLineShape*>(shape);
+    if (!line->GetFrom() || !line->GetTo())
+        return false;
+
+    return !line->GetFrom()->Selected() && !line->GetTo()->Selected();
+}
+
+void EdgeBundles::RefreshLines(wxShape& shape)
+{
+    if (m_lines.empty())
+        return;
+
+    vector<wxShape*> lines;
+
+    if (m_lines.count(&shape)) {
+        lines.push_back(&shape);
+    }
+    else {
+        wxList::iterator it;
+
+        for (it = shape.GetLines().begin(); it != shape.GetLines().end(); ++it)
+            if (m_lines.count(static_cast<wxShape*>(*it)))
+                lines.push_back(static_cast<wxShape*>(*it));
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        GraphElement *element =
+            wxDynamicCast(lines[i]->GetClientData(), GraphElement);
+        if (element)
+            element->Refresh();
+    }
+}
+
+void EdgeBundles::RefreshArea(const wxRect& rc)
+{
+    RefreshGraphArea(m_canvas, rc);
+}
+
+} // namespace impl
+
+} // namespace tt_solutions
@@ -43,12 +43,21 @@
  */
 
 #include "graphctrl.h"
+#include "graphbundle.h"
+#include "graphmemory.h"
+#include "graphprofile.h"
+#include "graphreach.h"
 #include "tipwin.h"
 #include <wx/richtooltip.h>
 #include <wx/tooltip.h>
 #include <wx/ogl/ogl.h>
+#include <algorithm>
 #include <bitset>
+#include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #ifndef NO_GRAPHVIZ
 
@@ -203,22 +212,6 @@ char *unconst(const char *str)
     return const_cast<char*>(str);
 }
 
-/**
- * Create a polygon shape from the given 2D array of points.
- */
-wxPolygonShape *CreatePolygon(int num_points, const int points[][2])
-{
-    wxList *list = new wxList;
-
-    for (int i = 0; i < num_points; i++)
-        list->Append(reinterpret_cast<wxObject*>
-                     (new wxRealPoint(points[i][0], points[i][1])));
-
-    wxPolygonShape *shape = new wxPolygonShape;
-    shape->Create(list);
-    return shape;
-}
-
 /**
  * Return the value between the given limits.
  *
@@ -300,19 +293,45 @@ wxSize GetScreenDPI()
 
 namespace impl {
 
+namespace {
+
+// Count the lookups in OGL's symbol and rendering caches as probes, so that
+// their hit rates show in the profiler's results and the PerfHud.
+void CountOGLCacheLookup(int cache, bool hit)
+{
+    if (cache == oglCACHE_SYMBOLS) {
+        if (hit)
+            GRAPH_PROFILE_COUNT("wxDrawnShape::LoadFromMetaFile/hits", 1);
+        else
+            GRAPH_PROFILE_COUNT("wxDrawnShape::LoadFromMetaFile/misses", 1);
+    }
+    else {
+        if (hit)
+            GRAPH_PROFILE_COUNT("wxDrawnShape::RenderCache/hits", 1);
+        else
+            GRAPH_PROFILE_COUNT("wxDrawnShape::RenderCache/misses", 1);
+    }
+}
+
+} // namespace
+
 int Initialisor::m_initalise;
 
 Initialisor::Initialisor()
 {
-    if (m_initalise++ == 0)
+    if (m_initalise++ == 0) {
         wxOGLInitialize();
+        OGLSetCacheProbe(CountOGLCacheLookup);
+    }
 }
 
 Initialisor::~Initialisor()
 {
     wxASSERT(m_initalise > 0);
-    if (--m_initalise == 0)
+    if (--m_initalise == 0) {
+        OGLSetCacheProbe(NULL);
         wxOGLCleanUp();
+    }
 }
 
 } // namespace impl
@@ -350,6 +369,10 @@ GraphEvent::GraphEvent(const GraphEvent& event)
 
 namespace impl {
 
+class ImpactHighlight;
+class PerfHud;
+class ZoomPreview;
+
 /**
  * Custom graph canvas used by GraphCtrl.
  *
@@ -420,6 +443,16 @@ public:
      * Finalizes a panning or rubber-banding operation.
      */
     void OnEndDragLeft(double x, double y, int keys);
+
+    /**
+     * Find the shape at a point.
+     *
+     * The lines drawn as part of a bundle, see EdgeBundles::IsCollapsed(),
+     * are hidden while the base class looks, so that the shapes under them
+     * can be clicked.
+     */
+    wxShape *FindShape(double x, double y, int *attachment,
+                       wxClassInfo *info = NULL, wxShape *notObject = NULL);
     //@}
 
     /**
@@ -439,11 +472,98 @@ public:
      */
     Graph *GetGraph() const { return m_graph; }
 
+    /**
+     * Associate the impact highlighting drawn by OnPaint(), or NULL.
+     *
+     * Set by the ImpactHighlight itself.
+     */
+    void SetImpact(ImpactHighlight *impact) { m_impact = impact; }
+
+    /// Return the impact highlighting, NULL if not used.
+    ImpactHighlight *GetImpact() const { return m_impact; }
+
+    /**
+     * Associate the edge bundling drawn by GraphDiagram::Redraw(), or NULL.
+     *
+     * Set by GraphCtrl when it creates the bundling.
+     */
+    void SetBundles(EdgeBundles *bundles) { m_bundles = bundles; }
+
+    /// Return the edge bundling, NULL if not used.
+    EdgeBundles *GetBundles() const { return m_bundles; }
+
+    /**
+     * Associate the performance overlay drawn by OnPaint(), or NULL.
+     *
+     * Set by the PerfHud itself.
+     */
+    void SetHud(PerfHud *hud) { m_hud = hud; }
+
+    /**
+     * Associate the progressive zooming drawn by OnPaint(), or NULL.
+     *
+     * Set by the ZoomPreview itself.
+     */
+    void SetZoomPreview(ZoomPreview *zoom) { m_zoom = zoom; }
+
+    /**
+     * End the progressive zooming's preview if it is shown.
+     *
+     * Called on any input other than the mouse wheel, and when the diagram
+     * changes, which the preview would otherwise hide.
+     */
+    void EndZoomPreview();
+
+    /**
+     * Draw the impact highlighting, if any, and the diagram.
+     *
+     * The DC must have been set up with PrepareDC().
+     */
+    void Draw(wxDC& dc);
+
     /**
      * Override event processing to send mouse events to the parent.
+     *
+     * Mouse events are also added to the trace first if recording.
      */
     bool ProcessEvent(wxEvent& event);
 
+    /**
+     * Start or stop recording into a trace.
+     *
+     * Implementation of GraphCtrl::StartRecording(), @a trace is NULL to
+     * stop.
+     */
+    void SetTrace(GraphTrace *trace);
+
+    /// Return the trace being recorded into, NULL if not recording.
+    GraphTrace *GetTrace() const { return m_trace; }
+
+    /**
+     * Add a mouse or key event to the trace, if recording.
+     *
+     * Key events go to the parent GraphCtrl, which passes them here.
+     */
+    void Record(const wxEvent& event);
+
+    /**
+     * Set the mouse state returned by GetMouseState() while replaying, or
+     * NULL to return to the real state.
+     *
+     * Set by GraphCtrl::Replay() before each event is injected.
+     */
+    void SetReplayState(const wxMouseState *state) { m_replayState = state; }
+
+    /**
+     * Return the state of the mouse buttons and modifier keys, with the
+     * position in screen coordinates.
+     *
+     * This is wxGetMouseState(), except while replaying a trace when it's the
+     * state recorded with the event being replayed, so that the handlers that
+     * look at the mouse directly behave as they did in the recording.
+     */
+    wxMouseState GetMouseState() const;
+
     /**
      * Release mouse if we currently have the capture.
      *
@@ -467,7 +587,9 @@ public:
      * Paint event handler.
      *
      * Calls wxDiagram::Redraw() to draw the diagram after adjusting the DC
-     * with PrepareDC().
+     * with PrepareDC(), preceded by the impact highlighting if any and
+     * followed by the performance overlay if shown. While a progressive zoom
+     * is in progress the ZoomPreview draws its bitmap instead.
      */
     void OnPaint(wxPaintEvent& event);
 
@@ -500,6 +622,13 @@ public:
      */
     void OnRightButton(wxMouseEvent& event);
 
+    /**
+     * Handle the middle mouse button.
+     *
+     * Only ends the zoom preview.
+     */
+    void OnMiddleButton(wxMouseEvent& event);
+
     /**
      * Mouse capture lost event handler.
      *
@@ -609,6 +738,27 @@ public:
      */
     wxPoint ScrollByOffset(int x, int y, bool draw = true);
 
+    /**
+     * Scale the graph to @a percent, placing the graph point @a ptGraph at
+     * the client point @a pt.
+     *
+     * The window is refreshed and the scrollbars checked from idle time.
+     */
+    void Zoom(double percent, const wxPoint& pt, const wxPoint& ptGraph);
+
+    /**
+     * Scale the graph to @a percent, keeping the graph point at the client
+     * point @a pt where it is.
+     */
+    void Zoom(double percent, const wxPoint& pt);
+
+    /// Return the graph point at a client point.
+    wxPoint ClientToGraph(const wxPoint& pt);
+
+    /// Limit a zoom percentage to the range supported.
+    static double ClampZoom(double percent)
+        { return max(1.0, min(500.0, percent)); }
+
     /**
      * Scroll the given rectangle into view.
      */
@@ -649,6 +799,11 @@ public:
     wxRect ScreenToGraph(const wxRect& rcScreen);
     /// Implementation of GraphCtrl::GraphToScreen().
     wxRect GraphToScreen(const wxRect& rcGraph);
+    /**
+     * Convert graph coordinates to client coordinates as PrepareDC() does,
+     * but without needing a DC.
+     */
+    wxRect GraphToClient(const wxRect& rcGraph) const;
 
     /// Return the client rectangle in screen coordinates.
     wxRect GetClientScreenRect() const;
@@ -684,6 +839,10 @@ private:
     static wxWindow *EnsureParent(wxWindow *parent);
 
     Graph *m_graph;             ///< The associated graph.
+    ImpactHighlight *m_impact;  ///< Impact highlighting or NULL.
+    EdgeBundles *m_bundles;     ///< Edge bundling or NULL.
+    PerfHud *m_hud;             ///< Performance overlay or NULL.
+    ZoomPreview *m_zoom;        ///< Progressive zooming or NULL.
     bool m_isPanning;           ///< Is panning operation in progress?
     bool m_checkBounds;         ///< Do we need to adjust scrollbars?
     wxPoint m_ptDrag;           ///< Point where dragging was started.
@@ -694,1671 +853,4458 @@ private:
     wxSize m_margin;            ///< Margin around the graph.
     bool m_fitsX;               ///< Do we need a horizontal scrollbar?
     bool m_fitsY;               ///< Do we need a vertical scrollbar?
+    GraphTrace *m_trace;        ///< Trace being recorded or NULL.
+    wxUint64 m_traceStart;      ///< Time the recording started.
+    const wxMouseState *m_replayState; ///< Replayed mouse state or NULL.
 
     DECLARE_EVENT_TABLE()
     DECLARE_DYNAMIC_CLASS(GraphCanvas)
     DECLARE_NO_COPY_CLASS(GraphCanvas)
 };
 
-const wxChar GraphCanvas::DefaultName[] = _T("graph_canvas");
+// ----------------------------------------------------------------------------
+// ImpactHighlight
+// ----------------------------------------------------------------------------
 
-IMPLEMENT_DYNAMIC_CLASS(GraphCanvas, wxShapeCanvas)
+/**
+ * Implements GraphCtrl's impact highlighting.
+ *
+ * Follows the node the highlighting is for, the node under the mouse taking
+ * precedence over the last node clicked, and keeps the lists of the nodes
+ * upstream and downstream of it. The lists are drawn by GraphCanvas::OnPaint()
+ * as a pass of halos underneath the shapes, so the elements' own colours are
+ * left alone and changing the highlighting only needs the area covered by
+ * the old and new halos repainting.
+ */
+class ImpactHighlight : public GraphReachability
+{
+public:
+    /// Ctor taking the canvas to draw on.
+    ImpactHighlight(GraphCanvas *canvas);
+    ~ImpactHighlight();
 
-BEGIN_EVENT_TABLE(GraphCanvas, wxShapeCanvas)
-    EVT_SCROLLWIN(GraphCanvas::OnScroll)
-    EVT_PAINT(GraphCanvas::OnPaint)
-    EVT_SIZE(GraphCanvas::OnSize)
-    EVT_LEFT_DOWN(GraphCanvas::OnLeftButton)
-    EVT_LEFT_UP(GraphCanvas::OnLeftButton)
-    EVT_RIGHT_DOWN(GraphCanvas::OnRightButton)
-    EVT_RIGHT_UP(GraphCanvas::OnRightButton)
-    EVT_SET_FOCUS(GraphCanvas::OnSetFocus)
-    EVT_MOUSE_CAPTURE_LOST(GraphCanvas::OnCaptureLost)
-END_EVENT_TABLE()
+    /**
+     * Follow a different graph, or NULL for none, forgetting the nodes of
+     * the old one and repainting.
+     */
+    void SetGraph(Graph *graph);
 
-GraphCanvas::GraphCanvas(
-        wxWindow *parent,
-        wxWindowID id,
-        const wxPoint& pos,
-        const wxSize& size,
-        long style,
-        const wxString& name)
-  : wxShapeCanvas(EnsureParent(parent), id, pos, size, style, name),
-    m_graph(NULL),
-    m_isPanning(false),
-    m_checkBounds(false),
-    m_border(0, 0),
-    m_borderType(GraphCtrl::Percentage_Border),
-    m_margin(GetScreenDPI() / 4),
-    m_fitsX(true),
-    m_fitsY(true)
+    /// GraphCtrl::ImpactMode values.
+    //@{
+    void SetMode(int mode);
+    int GetMode() const { return m_mode; }
+    //@}
+
+    /// The colours of the upstream and downstream halos.
+    void SetColours(const wxColour& upstream, const wxColour& downstream);
+
+    /// The node under the mouse, or NULL.
+    void SetHover(GraphNode *node);
+
+    /// The node clicked or set with GraphCtrl::SetImpactNode(), or NULL.
+    //@{
+    void SetSelected(GraphNode *node);
+    GraphNode *GetSelected() const { return m_selected; }
+    //@}
+
+    /// Returns true if the graph has changed and Update() should be called.
+    bool IsStale() const { return m_stale; }
+
+    /// Recompute the highlighted nodes and repaint the changed area.
+    void Update();
+
+    /// Draw the halos within the DC's clipping region.
+    void Draw(wxDC& dc);
+
+    /// Overridden GraphObserver methods.
+    //@{
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    void OnNodeMoved(GraphNode& node);
+    void OnGraphCleared();
+    void OnGraphDestroyed();
+    //@}
+
+private:
+    /// Returns the area covered by the halos in graph coordinates.
+    wxRect GetArea() const;
+
+    /// Repaint an area given in graph coordinates.
+    void RefreshArea(const wxRect& rc);
+
+    /// Width of the halos in graph pixels.
+    enum { HaloWidth = 4 };
+
+    GraphCanvas *m_canvas;              ///< The canvas drawn on.
+    int m_mode;                         ///< GraphCtrl::ImpactMode value.
+    wxColour m_colour[2];               ///< Upstream and downstream colours.
+    GraphNode *m_hover;                 ///< Node under the mouse.
+    GraphNode *m_selected;              ///< Node last clicked.
+    const GraphNode *m_source;          ///< Node the highlighting is for.
+    std::vector<const GraphNode*> m_nodes[2];   ///< Upstream, downstream.
+    wxRect m_area;                      ///< Area last painted.
+    bool m_stale;                       ///< The graph has changed.
+
+    DECLARE_NO_COPY_CLASS(ImpactHighlight)
+};
+
+ImpactHighlight::ImpactHighlight(GraphCanvas *canvas)
+  : GraphReachability(canvas->GetGraph()),
+    m_canvas(canvas),
+    m_mode(GraphCtrl::Impact_None),
+    m_hover(NULL),
+    m_selected(NULL),
+    m_source(NULL),
+    m_stale(false)
 {
-    SetScrollRate(1, 1);
-    SetFont(DefaultFont());
+    m_colour[0] = wxColour(255, 160, 64);
+    m_colour[1] = wxColour(64, 160, 255);
+    m_canvas->SetImpact(this);
 }
 
-GraphCanvas::~GraphCanvas()
+ImpactHighlight::~ImpactHighlight()
 {
-    wxFrame *dummy = wxDynamicCast(GetParent(), wxFrame);
-    if (dummy)
-        dummy->Destroy();
+    m_canvas->SetImpact(NULL);
 }
 
-bool GraphCanvas::ProcessEvent(wxEvent& event)
+void ImpactHighlight::SetGraph(Graph *graph)
 {
-    if (event.IsKindOf(CLASSINFO(wxMouseEvent)))
-        if (GetParent()->GetEventHandler()->ProcessEvent(event))
-            return true;
+    OnGraphCleared();
+    GraphReachability::SetGraph(graph);
+    m_area = wxRect();
+    m_canvas->Refresh();
+}
 
-    return wxShapeCanvas::ProcessEvent(event);
+void ImpactHighlight::SetMode(int mode)
+{
+    if (mode != m_mode) {
+        m_mode = mode;
+        m_source = NULL;
+        Update();
+    }
 }
 
-bool GraphCanvas::ReleaseIfCaptured()
+void ImpactHighlight::SetColours(const wxColour& upstream,
+                                 const wxColour& downstream)
 {
-    if (!HasCapture())
-        return false;
-    ReleaseMouse();
-    return true;
+    m_colour[0] = upstream;
+    m_colour[1] = downstream;
+    RefreshArea(m_area);
 }
 
-void GraphCanvas::OnSetFocus(wxFocusEvent&)
+void ImpactHighlight::SetHover(GraphNode *node)
 {
-    GetParent()->SetFocus();
+    if (node != m_hover) {
+        m_hover = node;
+        Update();
+    }
 }
 
-void GraphCanvas::OnLeftButton(wxMouseEvent& event)
+void ImpactHighlight::SetSelected(GraphNode *node)
 {
-    if (m_dragState == StartDraggingRight ||
-        m_dragState == ContinueDraggingRight)
+    if (node != m_selected) {
+        m_selected = node;
+        Update();
+    }
+}
+
+void ImpactHighlight::Update()
+{
+    const GraphNode *source = m_hover ? m_hover : m_selected;
+
+    // a collapsed group's proxy has no edges of its own
+    if (m_mode == GraphCtrl::Impact_None || !GetGraph() ||
+            (source && GetGraph()->IsGroupProxy(*source)))
+        source = NULL;
+
+    if (source == m_source && !m_stale)
         return;
 
-    if (event.LeftDown()) {
-        if (FindFocus() != GetParent())
-            SetFocus();
+    RefreshArea(m_area);
 
-        if (event.ShiftDown() && !event.Dragging()) {
-            wxClientDC dc(this);
-            PrepareDC(dc);
-            wxPoint ptLog(event.GetLogicalPosition(dc));
-            m_checkTolerance = true;
-            m_draggedShape = NULL;
-            m_dragState = StartDraggingLeft;
-            m_firstDragX = double(ptLog.x);
-            m_firstDragY = double(ptLog.y);
-            return;
+    m_source = source;
+    m_stale = false;
+
+    static const int directions[] = { Direction_In, Direction_Out };
+    static const int modes[] = { GraphCtrl::Impact_Upstream,
+                                 GraphCtrl::Impact_Downstream };
+
+    for (int i = 0; i < 2; i++) {
+        m_nodes[i].clear();
+
+        if (source && (m_mode & modes[i]) != 0) {
+            const NodeSet& nodes = Get(*source, directions[i]);
+            m_nodes[i].assign(nodes.begin(), nodes.end());
         }
     }
 
-    event.Skip();
+    m_area = GetArea();
+    RefreshArea(m_area);
 }
 
-void GraphCanvas::OnRightButton(wxMouseEvent& event)
+wxRect ImpactHighlight::GetArea() const
 {
-    if (m_dragState == StartDraggingLeft ||
-        m_dragState == ContinueDraggingLeft)
-        return;
+    wxRect rc;
 
-    event.Skip();
+    for (int i = 0; i < 2; i++)
+        for (size_t j = 0; j < m_nodes[i].size(); j++)
+            rc.Union(m_nodes[i][j]->GetBounds());
+
+    if (!rc.IsEmpty())
+        rc.Inflate(HaloWidth);
+
+    return rc;
 }
 
-wxWindow *GraphCanvas::EnsureParent(wxWindow *parent)
+void ImpactHighlight::RefreshArea(const wxRect& rc)
 {
-    if (!parent) {
-        parent = new wxFrame(NULL, wxID_ANY, DefaultName,
-                             wxDefaultPosition, wxDefaultSize, 0);
-        wxTopLevelWindows.remove(parent);
-    }
-    return parent;
+    RefreshGraphArea(m_canvas, rc);
 }
 
-bool GraphCanvas::SendEvent(wxEventType cmd, double x, double y)
+void ImpactHighlight::Draw(wxDC& dc)
 {
-    GraphEvent event(cmd, GetId());
-    event.SetPosition(wxPoint(int(x), int(y)));
-    event.SetEventObject(this);
-    GetEventHandler()->ProcessEvent(event);
+    wxRect clip;
+    dc.GetClipBox(clip);
 
-    return event.IsAllowed();
+    dc.SetPen(*wxTRANSPARENT_PEN);
+
+    for (int i = 0; i < 2; i++) {
+        if (m_nodes[i].empty())
+            continue;
+
+        dc.SetBrush(wxBrush(m_colour[i]));
+
+        for (size_t j = 0; j < m_nodes[i].size(); j++) {
+            wxRect rc = m_nodes[i][j]->GetBounds().Inflate(HaloWidth);
+
+            if (clip.IsEmpty() || clip.Intersects(rc))
+                dc.DrawRoundedRectangle(rc, HaloWidth);
+        }
+    }
+
+    dc.SetBrush(wxNullBrush);
+    dc.SetPen(wxNullPen);
 }
 
-void GraphCanvas::OnLeftClick(double x, double y, int)
+void ImpactHighlight::OnEdgeAdded(GraphEdge& edge)
 {
-    GetGraph()->UnselectAll();
-    SendEvent(Evt_Graph_Click, x, y);
+    GraphReachability::OnEdgeAdded(edge);
+    m_stale = m_source != NULL;
 }
 
-void GraphCanvas::OnRightClick(double x, double y, int)
+void ImpactHighlight::OnElementRemoving(GraphElement& element)
 {
-    SendEvent(Evt_Graph_Menu, x, y);
+    GraphReachability::OnElementRemoving(element);
+
+    if (&element == m_hover)
+        m_hover = NULL;
+    if (&element == m_selected)
+        m_selected = NULL;
+    if (&element == m_source)
+        m_source = NULL;
+
+    // don't leave a dangling pointer for OnPaint before the next Update()
+    for (int i = 0; i < 2; i++) {
+        vector<const GraphNode*>& nodes = m_nodes[i];
+        nodes.erase(remove(nodes.begin(), nodes.end(), &element), nodes.end());
+    }
+
+    m_stale = true;
 }
 
-void GraphCanvas::OnBeginDragLeft(double x, double y, int keys)
+void ImpactHighlight::OnNodeMoved(GraphNode& node)
 {
-    if ((keys & KEY_SHIFT) != 0) {
-        // panning
-        m_isPanning = true;
-        m_ptDrag = wxGetMousePosition();
-    }
-    else {
-        // rubber banding
-        m_ptDrag = wxPoint(int(x), int(y));
+    for (int i = 0; i < 2; i++) {
+        if (find(m_nodes[i].begin(), m_nodes[i].end(), &node) !=
+                m_nodes[i].end()) {
+            // the old position is gone, so repaint the whole old area
+            RefreshArea(m_area);
+            m_area = GetArea();
+            RefreshArea(node.GetBounds().Inflate(HaloWidth));
+            break;
+        }
     }
-    CaptureMouse();
 }
 
-void GraphCanvas::OnDragLeft(bool draw, double x, double y, int)
+void ImpactHighlight::OnGraphCleared()
 {
-    if (m_isPanning) {
-        // The mouse event that lead here may have been in queue before the
-        // last time the origin changed, in which case the x and y parameters
-        // would need adjusting to allow for that. Or OTOH the event may have
-        // come after and the x, y parameters need no adjustment. A simple
-        // way to avoid this problem is to use the global mouse position
-        // instead.
-        wxMouseState mouse = wxGetMouseState();
+    GraphReachability::OnGraphCleared();
+    m_hover = m_selected = NULL;
+    m_source = NULL;
+    m_nodes[0].clear();
+    m_nodes[1].clear();
+    m_stale = false;
+}
 
-        if (mouse.LeftIsDown()) {
-            m_ptDrag -= ScrollByOffset(m_ptDrag.x - mouse.GetX(),
-                                       m_ptDrag.y - mouse.GetY());
-            Update();
-        }
-    }
-    else {
-        // rubber banding
+void ImpactHighlight::OnGraphDestroyed()
+{
+    OnGraphCleared();
+    GraphReachability::OnGraphDestroyed();
+}
 
-        wxShapeCanvasOverlay overlay(this);
-        if (!draw) {
-            overlay.Reset();
-            return;
-        }
-
-        wxDC& dc = overlay.GetDC();
-        wxPen dottedPen(*wxBLACK, 1, wxPENSTYLE_DOT);
-        dc.SetPen(dottedPen);
-        dc.SetBrush(*wxTRANSPARENT_BRUSH);
-
-        wxSize size(int(x) - m_ptDrag.x, int(y) - m_ptDrag.y);
-        dc.DrawRectangle(m_ptDrag, size);
-    }
-}
+// ----------------------------------------------------------------------------
+// PerfHud
+// ----------------------------------------------------------------------------
 
-void GraphCanvas::OnEndDragLeft(double x, double y, int key)
+/**
+ * Implements GraphCtrl's performance overlay.
+ *
+ * The figures come from the profiling probes, so profiling is held on for
+ * as long as the overlay is shown. The overlay is rendered into a bitmap
+ * which is drawn into the corner of the canvas at the end of each paint.
+ * The timer re-renders it and invalidates only its corner, and a paint of
+ * just that corner isn't counted in the figures.
+ */
+class PerfHud : public wxTimer, public GraphObserver
 {
-    ReleaseIfCaptured();
-
-    if (m_isPanning) {
-        // finish panning
-        m_isPanning = false;
-        m_checkBounds = true;
-        // these aren't needed I think
-        SetScrollPos(wxHORIZONTAL, GetScrollPos(wxHORIZONTAL));
-        SetScrollPos(wxVERTICAL, GetScrollPos(wxVERTICAL));
-    }
-    else {
-        // rubber banding
-        wxRect rc;
+public:
+    /// Ctor taking the canvas to draw on.
+    PerfHud(GraphCanvas *canvas);
+    ~PerfHud();
 
-        if (x >= m_ptDrag.x) {
-            rc.x = m_ptDrag.x;
-            rc.width = int(x) - m_ptDrag.x;
-        } else {
-            rc.x = int(x);
-            rc.width = m_ptDrag.x - int(x);
-        }
+    /// Follow a different graph.
+    void SetGraph(Graph *graph);
 
-        if (y >= m_ptDrag.y) {
-            rc.y = m_ptDrag.y;
-            rc.height = int(y) - m_ptDrag.y;
-        } else {
-            rc.y = int(y);
-            rc.height = m_ptDrag.y - int(y);
-        }
+    /// Called at the end of GraphCanvas::OnPaint().
+    void OnPaint(wxDC& dc);
 
-        Graph *graph = GetGraph();
-        Graph::iterator i, j, end;
-        tie(i, end) = graph->GetElements();
+    /**
+     * Called when the canvas has been scrolled by blitting, which moves the
+     * overlay's pixels along with the diagram.
+     */
+    void OnScroll(int dx, int dy);
 
-        while (i != end)
-        {
-            // Increment i before calling Select, since Select invalidates
-            // iterators to that element.
-            j = i++;
+    /// Timer notification, updates the overlay.
+    void Notify();
 
-            if (!j->IsSelected()) {
-                if (rc.Intersects(j->GetBounds().Inflate(1)))
-                    j->Select();
-            }
-            else {
-                if ((key & KEY_CTRL) == 0 && !rc.Intersects(j->GetBounds()))
-                    j->Unselect();
-            }
-        }
-    }
-}
+    /// Overridden GraphObserver methods.
+    //@{
+    void OnNodeAdded(GraphNode& node);
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    void OnGraphCleared();
+    void OnGraphDestroyed();
+    //@}
 
-void GraphCanvas::OnCaptureLost(wxMouseCaptureLostEvent&)
-{
-    wxMouseState state = wxGetMouseState();
+private:
+    /// Render the figures into m_bitmap.
+    void Render();
 
-    int keys = 0;
-    if (state.ShiftDown())
-        keys |= KEY_SHIFT;
-    if (state.ControlDown())
-        keys |= KEY_CTRL;
+    /// The area covered by the overlay in device coordinates.
+    wxRect GetRect() const;
 
-    wxPoint pt(state.GetX(), state.GetY());
-    pt = ScreenToGraph(wxRect(pt, wxSize())).GetPosition();
-    double x = pt.x, y = pt.y;
+    /// Returns the change in a counter since the last call for it.
+    wxUint64 Delta(const char *name, wxUint64& last);
 
-    if (m_dragState == ContinueDraggingLeft) {
-        m_dragState = NoDragging;
-        m_checkTolerance = true;
+    /// Returns the last time of a probe in milliseconds, -1 if none.
+    static double LastTime(const char *name);
 
-        if (m_draggedShape != NULL) {
-            wxShapeEvtHandler *h = m_draggedShape->GetEventHandler();
-            h->OnDragLeft(false, m_oldDragX, m_oldDragY, keys, m_draggedAttachment);
-            h->OnEndDragLeft(x, y, keys, m_draggedAttachment);
-        }
-        else {
-            OnDragLeft(false, m_oldDragX, m_oldDragY, keys);
-            OnEndDragLeft(x, y, keys);
-        }
-    }
-    else if (m_dragState == ContinueDraggingRight) {
-        m_dragState = NoDragging;
-        m_checkTolerance = true;
+    enum {
+        Margin = 8,             ///< Margin around the overlay.
+        Padding = 4,            ///< Margin inside the overlay.
+        Interval = 500          ///< Update interval in milliseconds.
+    };
 
-        if (m_draggedShape != NULL) {
-            wxShapeEvtHandler *h = m_draggedShape->GetEventHandler();
-            h->OnDragRight(false, m_oldDragX, m_oldDragY, keys, m_draggedAttachment);
-            h->OnEndDragRight(x, y, keys, m_draggedAttachment);
-        }
-        else {
-            OnDragRight(false, m_oldDragX, m_oldDragY, keys);
-            OnEndDragRight(x, y, keys);
-        }
-    }
+    GraphCanvas *m_canvas;      ///< The canvas drawn on.
+    Graph *m_graph;             ///< The graph followed.
+    std::vector<wxUint64> m_paints; ///< Time of the paints in the last second.
+    double m_paintTime;         ///< Time of the last paint in milliseconds.
+    wxUint64 m_drawn;           ///< Shapes drawn by the last paint.
+    wxUint64 m_culled;          ///< Nodes skipped by the last paint.
+    wxUint64 m_shapesTotal;     ///< Counter totals at the last paint.
+    wxUint64 m_culledTotal;
+    size_t m_nodes;             ///< Number of nodes.
+    size_t m_edges;             ///< Number of edges.
+    wxBitmap m_bitmap;          ///< The rendered overlay.
+
+    DECLARE_NO_COPY_CLASS(PerfHud)
+};
 
-    m_draggedShape = NULL;
+PerfHud::PerfHud(GraphCanvas *canvas)
+  : m_canvas(canvas),
+    m_graph(NULL),
+    m_paintTime(-1),
+    m_drawn(0),
+    m_culled(0),
+    m_shapesTotal(0),
+    m_culledTotal(0),
+    m_nodes(0),
+    m_edges(0)
+{
+    GraphProfiler::Hold();
+    SetGraph(canvas->GetGraph());
+    m_canvas->SetHud(this);
+    Start(Interval);
 }
 
-void GraphCanvas::ScrollGraph(int orient, int type, int pos, int lines)
+PerfHud::~PerfHud()
 {
-    bool horz = orient == wxHORIZONTAL;
-    int scroll = horz ? m_xScrollPosition : m_yScrollPosition;
-    int size = horz ? m_virtualSize.x : m_virtualSize.y;
-    int cs = horz ? GetClientSize().x : GetClientSize().y;
-
-    if (type == wxEVT_SCROLLWIN_TOP)
-        pos = 0;
-    else if (type == wxEVT_SCROLLWIN_BOTTOM)
-        pos = size;
-    else if (type == wxEVT_SCROLLWIN_LINEUP)
-        pos = scroll - 16 * lines;
-    else if (type == wxEVT_SCROLLWIN_LINEDOWN)
-        pos = scroll + 16 * lines;
-    else if (type == wxEVT_SCROLLWIN_PAGEUP)
-        pos = scroll - cs;
-    else if (type == wxEVT_SCROLLWIN_PAGEDOWN)
-        pos = scroll + cs;
-
-    if (pos > size - cs)
-        pos = size - cs;
-    if (pos < 0)
-        pos = 0;
+    Stop();
+    SetGraph(NULL);
+    m_canvas->SetHud(NULL);
+    GraphProfiler::Release();
 
-    if (horz)
-        ScrollByOffset(pos - m_xScrollPosition, 0);
-    else
-        ScrollByOffset(0, pos - m_yScrollPosition);
+    if (m_bitmap.IsOk())
+        m_canvas->RefreshRect(GetRect());
 }
 
-void GraphCanvas::OnScroll(wxScrollWinEvent& event)
+void PerfHud::SetGraph(Graph *graph)
 {
-    if (FindFocus() != GetParent())
-        SetFocus();
+    if (m_graph)
+        m_graph->RemoveObserver(this);
 
-    int orient = event.GetOrientation();
-    int type = event.GetEventType();
-    int pos = event.GetPosition();
+    m_graph = graph;
+    m_nodes = m_edges = 0;
 
-    ScrollGraph(orient, type, pos);
+    if (m_graph) {
+        m_graph->AddObserver(this);
+        m_nodes = m_graph->GetNodeCount();
+        m_edges = m_graph->GetElementCount() - m_nodes;
+    }
 }
 
-bool GraphCanvas::CheckBounds()
+wxUint64 PerfHud::Delta(const char *name, wxUint64& last)
 {
-    wxClientDC dc(this);
-    PrepareDC(dc);
+    const GraphProbe *probe = GraphProfiler::Find(name);
+    wxUint64 total = probe ? probe->GetTotal() : 0;
+    wxUint64 delta = total >= last ? total - last : total;
+    last = total;
+    return delta;
+}
 
-    wxSize cs = GetFullClientSize();
-    wxSize fullclient = cs;
+double PerfHud::LastTime(const char *name)
+{
+    const GraphProbe *probe = GraphProfiler::Find(name);
+    return probe && probe->GetCount() ? probe->GetLast() / 1e6 : -1;
+}
 
-    wxRect b = m_graph->GetBounds();
+void PerfHud::OnPaint(wxDC& dc)
+{
+    wxUint64 shapes = Delta("GraphDiagram::Redraw/shapes", m_shapesTotal);
+    wxUint64 culled = Delta("GraphDiagram::Redraw/culled", m_culledTotal);
 
-    if (!b.IsEmpty()) {
-        if (m_borderType == GraphCtrl::Graph_Border)
-            b.Inflate(m_border);
+    if (!m_bitmap.IsOk())
+        Render();
 
-        b.x = dc.LogicalToDeviceX(b.x);
-        b.y = dc.LogicalToDeviceY(b.y);
-        b.width = dc.LogicalToDeviceXRel(b.width);
-        b.height = dc.LogicalToDeviceYRel(b.height);
+    // a paint of just the overlay, from Notify(), isn't counted
+    if (!GetRect().Contains(m_canvas->GetUpdateRegion().GetBox())) {
+        m_paints.push_back(GraphProfiler::Now());
+        m_paintTime = LastTime("GraphCanvas::OnPaint");
+        m_drawn = shapes - culled;
+        m_culled = culled;
+    }
 
-        if (m_borderType == GraphCtrl::Percentage_Border)
-            b.Inflate(wxSize(cs.x * m_border.x, cs.y * m_border.y) / 100);
-        else if (m_borderType == GraphCtrl::Ctrl_Border)
-            b.Inflate(m_border);
+    // draw in device coordinates
+    dc.SetDeviceOrigin(0, 0);
+    dc.SetUserScale(1, 1);
+    dc.DrawBitmap(m_bitmap, Margin, Margin);
+}
 
-        wxRect inner = m_graph->GetBounds();
-        inner.Inflate(m_margin);
-        inner.x = dc.LogicalToDeviceX(inner.x);
-        inner.y = dc.LogicalToDeviceY(inner.y);
-        inner.width = dc.LogicalToDeviceXRel(inner.width);
-        inner.height = dc.LogicalToDeviceYRel(inner.height);
-        b.Union(inner);
-    }
+void PerfHud::OnScroll(int dx, int dy)
+{
+    wxRect rc = GetRect();
+    m_canvas->RefreshRect(rc);
+    rc.Offset(dx, dy);
+    m_canvas->RefreshRect(rc);
+}
 
-    const wxRect b0 = b;
+void PerfHud::Notify()
+{
+    Render();
+    m_canvas->RefreshRect(GetRect());
+}
 
-    int x = -min(0, b.x);
-    int y = -min(0, b.y);
+wxRect PerfHud::GetRect() const
+{
+    return wxRect(Margin, Margin, m_bitmap.GetWidth(), m_bitmap.GetHeight());
+}
 
-    bool fitsX = m_fitsX, fitsY = m_fitsY;
+void PerfHud::Render()
+{
+    // drop the paints more than a second old for the rolling frame rate
+    wxUint64 now = GraphProfiler::Now();
+    size_t old = 0;
+    while (old < m_paints.size() && now - m_paints[old] > 1000000000)
+        old++;
+    m_paints.erase(m_paints.begin(), m_paints.begin() + old);
 
-    m_fitsX = b.width <= cs.x;
-    m_fitsY = b.height <= cs.y;
+    wxArrayString lines;
 
-    bool needHBar = false, needVBar = false;
-    bool done = false;
+    lines.push_back(wxString::Format(_T("Paint %.1f ms  FPS %u"),
+                    max(m_paintTime, 0.0), unsigned(m_paints.size())));
+    lines.push_back(wxString::Format(_T("Shapes %lu drawn  %lu culled"),
+                    (unsigned long)m_drawn, (unsigned long)m_culled));
+    lines.push_back(wxString::Format(_T("Nodes %lu  Edges %lu"),
+                    (unsigned long)m_nodes, (unsigned long)m_edges));
 
-    while (!done && !b.IsEmpty()) {
-        done = true;
+    double layout = LastTime("Graph::Layout");
+    double load = LastTime("Archive::Load");
+    double build = LastTime("Graph::DeserialiseInto");
+    wxString times;
 
-        b = b0;
-        wxRect csr = m_fitsY ? wxRect(fullclient) : wxRect(cs);
-        b.Union(csr.CentreIn(b));
-        m_fitsX = b.width <= csr.width;
+    if (layout >= 0)
+        times << wxString::Format(_T("Layout %.1f ms  "), layout);
+    if (load >= 0 || build >= 0)
+        times << wxString::Format(_T("Load %.1f ms"),
+                                  max(load, 0.0) + max(build, 0.0));
+    if (!times.empty())
+        lines.push_back(times);
 
-        x = -min(0, b.x);
-        m_virtualSize.x = max(cs.x, b.GetRight()) + x;
+    // hit rates of the caches, which count "<name>/hits" and "<name>/misses",
+    // e.g. the hit testing, symbol and rendering caches and zoom snapshots
+    typedef map<wxString, pair<double, double> > CacheMap;
+    CacheMap caches;
+    GraphProfiler::StatsList stats = GraphProfiler::GetStats();
 
-        if (m_virtualSize.x > cs.x) {
-            SetScrollbar(wxHORIZONTAL, x, cs.x, m_virtualSize.x);
-            GetClientSize(NULL, &cs.y);
-            needHBar = true;
-        }
-        else {
-            cs.y = fullclient.y;
-            needHBar = false;
-        }
+    for (size_t i = 0; i < stats.size(); i++) {
+        wxString name = stats[i].name;
+        wxString cache;
 
-        b = b0;
-        csr = m_fitsX ? wxRect(fullclient) : wxRect(cs);
-        b.Union(csr.CentreIn(b));
-        m_fitsY = b.height <= csr.height;
+        if (stats[i].kind != GraphProbe::Counter)
+            continue;
+        if (name.EndsWith(_T("/hits"), &cache))
+            caches[cache].first += stats[i].total;
+        else if (name.EndsWith(_T("/misses"), &cache))
+            caches[cache].second += stats[i].total;
+    }
 
-        y = -min(0, b.y);
-        m_virtualSize.y = max(cs.y, b.GetBottom()) + y;
+    for (CacheMap::iterator it = caches.begin(); it != caches.end(); ++it) {
+        double hits = it->second.first;
+        double total = hits + it->second.second;
 
-        if (m_virtualSize.y > cs.y) {
-            SetScrollbar(wxVERTICAL, y, cs.y, m_virtualSize.y);
-            GetClientSize(&cs.x, NULL);
-            done = needVBar;
-            needVBar = true;
-        }
-        else {
-            cs.x = fullclient.x;
-            needVBar = false;
-        }
+        lines.push_back(wxString::Format(_T("%s %.0f%% hits of %.0f"),
+                        it->first.c_str(),
+                        total ? 100 * hits / total : 0.0, total));
     }
 
-    m_ptOrigin.x += x - m_xScrollPosition;
-    m_xScrollPosition = x;
+    // size the bitmap to the text
+    wxMemoryDC dc;
+    dc.SetFont(*wxSMALL_FONT);
 
-    m_ptOrigin.y += y - m_yScrollPosition;
-    m_yScrollPosition = y;
+    int width = 0, lineHeight = 0;
 
-    if (!needHBar)
-        SetScrollbar(wxHORIZONTAL, 0, 0, 0);
-    if (!needVBar)
-        SetScrollbar(wxVERTICAL, 0, 0, 0);
+    for (size_t i = 0; i < lines.size(); i++) {
+        wxCoord w, h;
+        dc.GetTextExtent(lines[i], &w, &h);
+        width = max(width, int(w));
+        lineHeight = max(lineHeight, int(h));
+    }
 
-    m_sizeScrollbar = fullclient - cs;
+    wxSize size(width + 2 * Padding,
+                int(lines.size()) * lineHeight + 2 * Padding);
 
-    m_checkBounds = false;
+    // the bitmap only grows, so that a paint covers what the last one drew
+    if (!m_bitmap.IsOk() ||
+            m_bitmap.GetWidth() < size.x || m_bitmap.GetHeight() < size.y)
+        m_bitmap.Create(max(size.x, m_bitmap.IsOk() ? m_bitmap.GetWidth() : 0),
+                        max(size.y, m_bitmap.IsOk() ? m_bitmap.GetHeight() : 0));
 
-    return m_fitsX != fitsX || m_fitsY != fitsY;
+    dc.SelectObject(m_bitmap);
+    dc.SetBackground(wxBrush(wxColour(32, 32, 32)));
+    dc.Clear();
+    dc.SetTextForeground(wxColour(128, 255, 128));
+
+    for (size_t i = 0; i < lines.size(); i++)
+        dc.DrawText(lines[i], Padding, Padding + int(i) * lineHeight);
+
+    dc.SelectObject(wxNullBitmap);
 }
 
-wxSize GraphCanvas::GetScrollClientSize() const
+void PerfHud::OnNodeAdded(GraphNode&)
 {
-    wxSize cs = GetClientSize();
-    if (m_fitsY)
-        cs.x += m_sizeScrollbar.x;
-    if (m_fitsX)
-        cs.y += m_sizeScrollbar.y;
-    return cs;
+    m_nodes++;
 }
 
-wxSize GraphCanvas::GetFullClientSize() const
+void PerfHud::OnEdgeAdded(GraphEdge&)
 {
-    return GetClientSize() + m_sizeScrollbar;
+    m_edges++;
 }
 
-void GraphCanvas::OnPaint(wxPaintEvent&)
+void PerfHud::OnElementRemoving(GraphElement& element)
 {
-    wxPaintDC dc(this);
-    PrepareDC(dc);
+    if (wxDynamicCast(&element, GraphNode))
+        m_nodes--;
+    else
+        m_edges--;
+}
 
-    if (GetDiagram())
-        GetDiagram()->Redraw(dc);
+void PerfHud::OnGraphCleared()
+{
+    m_nodes = m_edges = 0;
 }
 
-void GraphCanvas::OnSize(wxSizeEvent& event)
+void PerfHud::OnGraphDestroyed()
 {
-    SetCheckBounds();
-    event.Skip();
+    m_graph = NULL;
+    m_nodes = m_edges = 0;
 }
 
-void GraphCanvas::PrepareDC(wxDC& dc)
+// ----------------------------------------------------------------------------
+// ZoomPreview
+// ----------------------------------------------------------------------------
+
+/**
+ * Progressive zooming with the mouse wheel, see GraphCtrl::SetZoomMode().
+ *
+ * When a zoom starts the canvas is drawn once into a bitmap, and until the
+ * wheel has been still for the delay GraphCanvas::OnPaint() draws that
+ * bitmap scaled to the current zoom instead of redrawing the diagram. The
+ * timer steps the animation from one zoom to the next, then fires once
+ * more after the delay to end the preview and repaint at the final zoom.
+ */
+class ZoomPreview : public wxTimer
 {
-    int x = m_ptOrigin.x - m_xScrollPosition;
-    int y = m_ptOrigin.y - m_yScrollPosition;
+public:
+    /// Ctor taking the canvas to draw on.
+    ZoomPreview(GraphCanvas *canvas);
+    ~ZoomPreview();
 
-    dc.SetDeviceOrigin(x, y);
-    dc.SetUserScale(m_scaleX, m_scaleY);
-}
+    /**
+     * Zoom to @a percent keeping the graph point at the client point @a pt
+     * where it is, starting the preview if it isn't active.
+     *
+     * @param animate the duration of the step in milliseconds, or zero to
+     * jump straight to it.
+     * @param delay the time in milliseconds to wait after the step before
+     * ending the preview.
+     */
+    void ZoomTo(double percent, const wxPoint& pt, int animate, int delay);
 
-wxPoint GraphCanvas::GetScroll() const
+    /// The zoom being moved to, the current zoom if not animating.
+    double GetTarget() const;
+
+    /// True while the bitmap is drawn in place of the diagram.
+    bool IsActive() const { return m_bitmap.IsOk(); }
+
+    /// End the preview, repainting the canvas if @a refresh.
+    void End(bool refresh = true);
+
+    /// Called by GraphCanvas::OnPaint() while active.
+    void OnPaint(wxDC& dc);
+
+    /// Timer notification, steps the animation or ends the preview.
+    void Notify();
+
+private:
+    /// Draw the canvas into m_bitmap at the current zoom.
+    void Snapshot();
+
+    enum {
+        FrameInterval = 15      ///< Milliseconds between animation frames.
+    };
+
+    GraphCanvas *m_canvas;      ///< The canvas drawn on.
+    wxBitmap m_bitmap;          ///< The canvas when the zoom started.
+    double m_scale;             ///< The scale m_bitmap was drawn at.
+    wxPoint m_origin;           ///< The device origin m_bitmap was drawn at.
+    double m_from;              ///< Zoom at the start of the step.
+    double m_to;                ///< Zoom at the end of the step.
+    wxPoint m_pt;               ///< Client point fixed by the step.
+    wxPoint m_ptGraph;          ///< Graph point kept at m_pt.
+    wxUint64 m_start;           ///< Time the step started.
+    wxUint64 m_duration;        ///< Duration of the step, 0 if not animated.
+    int m_delay;                ///< Milliseconds to wait before End().
+
+    DECLARE_NO_COPY_CLASS(ZoomPreview)
+};
+
+ZoomPreview::ZoomPreview(GraphCanvas *canvas)
+  : m_canvas(canvas),
+    m_scale(1),
+    m_from(100),
+    m_to(100),
+    m_start(0),
+    m_duration(0),
+    m_delay(0)
 {
-    return wxPoint(m_xScrollPosition, m_yScrollPosition);
+    m_canvas->SetZoomPreview(this);
 }
 
-void GraphCanvas::ScrollTo(const wxPoint& ptGraph, bool draw)
+ZoomPreview::~ZoomPreview()
 {
-    wxClientDC dc(this);
-    PrepareDC(dc);
+    End(false);
+    m_canvas->SetZoomPreview(NULL);
+}
 
-    wxSize cs = GetScrollClientSize();
-    int x = dc.LogicalToDeviceX(ptGraph.x) - cs.x / 2;
-    int y = dc.LogicalToDeviceY(ptGraph.y) - cs.y / 2;
+void ZoomPreview::ZoomTo(double percent, const wxPoint& pt,
+                         int animate, int delay)
+{
+    // each further step of a zoom reuses the snapshot
+    if (IsActive()) {
+        GRAPH_PROFILE_COUNT("ZoomPreview::Snapshot/hits", 1);
+    }
+    else {
+        GRAPH_PROFILE_COUNT("ZoomPreview::Snapshot/misses", 1);
+        Snapshot();
+    }
 
-    ScrollByOffset(x, y, draw);
+    // the graph point is found once for the whole step, rounding it again
+    // at each frame would make it wander
+    m_from = m_canvas->GetScaleX() * 100.0;
+    m_to = GraphCanvas::ClampZoom(percent);
+    m_pt = pt;
+    m_ptGraph = m_canvas->ClientToGraph(pt);
+    m_delay = max(delay, 1);
+    m_duration = animate > 0 ? wxUint64(animate) * 1000000 : 0;
+    m_start = GraphProfiler::Now();
+
+    if (m_duration) {
+        Start(FrameInterval);
+    }
+    else {
+        m_canvas->Zoom(m_to, m_pt, m_ptGraph);
+        Start(m_delay, wxTIMER_ONE_SHOT);
+    }
 }
 
-wxPoint GraphCanvas::GetScrollPosition()
+double ZoomPreview::GetTarget() const
 {
-    wxClientDC dc(this);
-    PrepareDC(dc);
-
-    wxSize cs = GetScrollClientSize();
-    wxPoint pt;
+    return IsActive() ? m_to : m_canvas->GetScaleX() * 100.0;
+}
 
-    pt.x = dc.DeviceToLogicalX(cs.x / 2);
-    pt.y = dc.DeviceToLogicalX(cs.y / 2);
+void ZoomPreview::End(bool refresh)
+{
+    Stop();
+    m_duration = 0;
 
-    return pt;
+    if (IsActive()) {
+        m_bitmap = wxNullBitmap;
+        if (refresh)
+            m_canvas->Refresh();
+    }
 }
 
-wxPoint GraphCanvas::ScrollByOffset(int x, int y, bool draw)
+void ZoomPreview::Notify()
 {
-    m_xScrollPosition += x;
-    m_yScrollPosition += y;
-
-    if (draw)
-        ScrollWindow(-x, -y);
+    if (!m_duration) {
+        End();
+        return;
+    }
 
-    SetCheckBounds();
+    wxUint64 elapsed = GraphProfiler::Now() - m_start;
 
-    return wxPoint(x, y);
+    if (elapsed < m_duration) {
+        // ease out, moving by equal ratios of zoom rather than equal
+        // differences so that zooming in and out look alike
+        double t = double(elapsed) / m_duration;
+        t = 1 - (1 - t) * (1 - t);
+        m_canvas->Zoom(m_from * pow(m_to / m_from, t), m_pt, m_ptGraph);
+    }
+    else {
+        m_duration = 0;
+        m_canvas->Zoom(m_to, m_pt, m_ptGraph);
+        Start(m_delay, wxTIMER_ONE_SHOT);
+    }
 }
 
-void GraphCanvas::EnsureVisible(wxRect rcGraph, bool draw)
+void ZoomPreview::Snapshot()
 {
-    wxClientDC dc(this);
-    PrepareDC(dc);
-
-    rcGraph.Inflate(m_margin);
-
-    wxRect rc(dc.LogicalToDeviceX(rcGraph.x),
-              dc.LogicalToDeviceY(rcGraph.y),
-              dc.LogicalToDeviceXRel(rcGraph.width),
-              dc.LogicalToDeviceYRel(rcGraph.height));
+    GRAPH_PROFILE_SCOPE("ZoomPreview::Snapshot");
 
-    wxRect rcClient = GetScrollClientSize();
+    wxSize cs = m_canvas->GetClientSize();
+    m_bitmap.Create(max(cs.x, 1), max(cs.y, 1));
 
-    int x = 0, y = 0;
+    wxMemoryDC dc(m_bitmap);
+    dc.SetBackground(wxBrush(m_canvas->GetBackgroundColour()));
+    dc.Clear();
 
-    if (rc.x < rcClient.x)
-        x = rc.x - rcClient.x;
-    else if (rc.GetRight() > rcClient.GetRight())
-        x = rc.GetRight() - rcClient.GetRight();
+    m_canvas->PrepareDC(dc);
+    m_canvas->Draw(dc);
 
-    if (rc.y < rcClient.y)
-        y = rc.y - rcClient.y;
-    else if (rc.GetBottom() > rcClient.GetBottom())
-        y = rc.GetBottom() - rcClient.GetBottom();
+    m_scale = m_canvas->GetScaleX();
+    m_origin = wxPoint(dc.LogicalToDeviceX(0), dc.LogicalToDeviceY(0));
 
-    if (x || y)
-        ScrollByOffset(x, y, draw);
+    dc.SelectObject(wxNullBitmap);
 }
 
-void GraphCanvas::ScrollTo(int side, bool draw)
+void ZoomPreview::OnPaint(wxDC& dc)
 {
-    wxASSERT(m_graph);
+    GRAPH_PROFILE_COUNT("ZoomPreview::OnPaint/frames", 1);
 
-    wxClientDC dc(this);
-    PrepareDC(dc);
+    // the bitmap's device origin moves to the current one, and everything
+    // else in it by the change of scale
+    double k = m_canvas->GetScaleX() / m_scale;
+    wxRect rc(dc.LogicalToDeviceX(0) - WXROUND(k * m_origin.x),
+              dc.LogicalToDeviceY(0) - WXROUND(k * m_origin.y),
+              WXROUND(k * m_bitmap.GetWidth()),
+              WXROUND(k * m_bitmap.GetHeight()));
 
-    wxRect rcGraph = m_graph->GetBounds();
-    rcGraph.Inflate(m_margin);
+    // draw in device coordinates
+    dc.SetDeviceOrigin(0, 0);
+    dc.SetUserScale(1, 1);
 
-    wxRect rc(dc.LogicalToDeviceX(rcGraph.x),
-              dc.LogicalToDeviceY(rcGraph.y),
-              dc.LogicalToDeviceXRel(rcGraph.width),
-              dc.LogicalToDeviceYRel(rcGraph.height));
+    wxMemoryDC mdc(m_bitmap);
+    dc.StretchBlit(rc.x, rc.y, rc.width, rc.height,
+                   &mdc, 0, 0, m_bitmap.GetWidth(), m_bitmap.GetHeight());
+    mdc.SelectObject(wxNullBitmap);
 
-    wxRect rcClient = GetScrollClientSize();
+    // and fill around it when zoomed out
+    wxSize cs = m_canvas->GetClientSize();
+    int right = rc.x + rc.width, bottom = rc.y + rc.height;
 
-    rc += rcClient.CentreIn(rc);
+    dc.SetPen(*wxTRANSPARENT_PEN);
+    dc.SetBrush(wxBrush(m_canvas->GetBackgroundColour()));
 
-    int x = 0, y = 0;
+    if (rc.y > 0)
+        dc.DrawRectangle(0, 0, cs.x, rc.y);
+    if (bottom < cs.y)
+        dc.DrawRectangle(0, bottom, cs.x, cs.y - bottom);
+    if (rc.x > 0)
+        dc.DrawRectangle(0, rc.y, rc.x, rc.height);
+    if (right < cs.x)
+        dc.DrawRectangle(right, rc.y, cs.x - right, rc.height);
+}
 
-    if ((side & wxLEFT) != 0)
-        x = rc.x - rcClient.x;
-    else if ((side & wxRIGHT) != 0)
-        x = rc.GetRight() - rcClient.GetRight();
-    else if (rc.x > rcClient.x)
-        x = rc.x - rcClient.x;
-    else if (rc.GetRight() < rcClient.GetRight())
-        x = rc.GetRight() - rcClient.GetRight();
+// ----------------------------------------------------------------------------
+// GraphCanvas
+// ----------------------------------------------------------------------------
 
-    if ((side & wxTOP) != 0)
-        y = rc.y - rcClient.y;
-    else if ((side & wxBOTTOM) != 0)
-        y = rc.GetBottom() - rcClient.GetBottom();
-    else if (rc.y > rcClient.y)
-        y = rc.y - rcClient.y;
-    else if (rc.GetBottom() < rcClient.GetBottom())
-        y = rc.GetBottom() - rcClient.GetBottom();
+const wxChar GraphCanvas::DefaultName[] = _T("graph_canvas");
 
-    if (x || y)
-        ScrollByOffset(x, y, draw);
-}
+IMPLEMENT_DYNAMIC_CLASS(GraphCanvas, wxShapeCanvas)
 
-wxRect GraphCanvas::ScreenToGraph(const wxRect& rcScreen)
-{
-    wxClientDC dc(this);
-    PrepareDC(dc);
-    wxPoint pt = ScreenToClient(rcScreen.GetTopLeft());
-    return wxRect(dc.DeviceToLogicalX(pt.x),
-                  dc.DeviceToLogicalY(pt.y),
-                  dc.DeviceToLogicalXRel(rcScreen.width),
-                  dc.DeviceToLogicalYRel(rcScreen.height));
-}
+BEGIN_EVENT_TABLE(GraphCanvas, wxShapeCanvas)
+    EVT_SCROLLWIN(GraphCanvas::OnScroll)
+    EVT_PAINT(GraphCanvas::OnPaint)
+    EVT_SIZE(GraphCanvas::OnSize)
+    EVT_LEFT_DOWN(GraphCanvas::OnLeftButton)
+    EVT_LEFT_UP(GraphCanvas::OnLeftButton)
+    EVT_RIGHT_DOWN(GraphCanvas::OnRightButton)
+    EVT_RIGHT_UP(GraphCanvas::OnRightButton)
+    EVT_MIDDLE_DOWN(GraphCanvas::OnMiddleButton)
+    EVT_SET_FOCUS(GraphCanvas::OnSetFocus)
+    EVT_MOUSE_CAPTURE_LOST(GraphCanvas::OnCaptureLost)
+END_EVENT_TABLE()
 
-wxRect GraphCanvas::GraphToScreen(const wxRect& rcGraph)
+GraphCanvas::GraphCanvas(
+        wxWindow *parent,
+        wxWindowID id,
+        const wxPoint& pos,
+        const wxSize& size,
+        long style,
+        const wxString& name)
+  : wxShapeCanvas(EnsureParent(parent), id, pos, size, style, name),
+    m_graph(NULL),
+    m_impact(NULL),
+    m_bundles(NULL),
+    m_hud(NULL),
+    m_zoom(NULL),
+    m_isPanning(false),
+    m_checkBounds(false),
+    m_border(0, 0),
+    m_borderType(GraphCtrl::Percentage_Border),
+    m_margin(GetScreenDPI() / 4),
+    m_fitsX(true),
+    m_fitsY(true),
+    m_trace(NULL),
+    m_traceStart(0),
+    m_replayState(NULL)
 {
-    wxClientDC dc(this);
-    PrepareDC(dc);
-    wxPoint pt( dc.LogicalToDeviceX(rcGraph.x),
-                dc.LogicalToDeviceY(rcGraph.y));
-    wxSize size(dc.LogicalToDeviceXRel(rcGraph.width),
-                dc.LogicalToDeviceYRel(rcGraph.height));
-    return wxRect(ClientToScreen(pt), size);
+    SetScrollRate(1, 1);
+    SetFont(DefaultFont());
 }
 
-wxRect GraphCanvas::GetClientScreenRect() const
+GraphCanvas::~GraphCanvas()
 {
-    return wxRect(ClientToScreen(wxPoint()), GetClientSize());
+    wxFrame *dummy = wxDynamicCast(GetParent(), wxFrame);
+    if (dummy)
+        dummy->Destroy();
 }
 
-} // namespace impl
-
-// ----------------------------------------------------------------------------
-// Handler to give shapes a transparent background
-// ----------------------------------------------------------------------------
+bool GraphCanvas::ProcessEvent(wxEvent& event)
+{
+    if (event.IsKindOf(CLASSINFO(wxMouseEvent))) {
+        Record(event);
+        if (GetParent()->GetEventHandler()->ProcessEvent(event))
+            return true;
+    }
 
-namespace {
+    return wxShapeCanvas::ProcessEvent(event);
+}
 
-/**
- * Generic event handler for the shape objects.
- *
- * This class is used as the event handler by GraphDiagram to allow changing
- * the behaviour of any existing shape without having to override its virtual
- * methods.
- *
- * It's both a base class inherited from by ControlPointHandler,
- * GraphNodeHandler and GraphEdgeHandler and a concrete class used directly
- * for the other graph elements.
- */
-class GraphHandler: public wxShapeEvtHandler
+void GraphCanvas::SetTrace(GraphTrace *trace)
 {
-public:
-    /// Ctor taking an existing shape.
-    GraphHandler(wxShapeEvtHandler *prev);
+    m_trace = trace;
+    m_traceStart = GraphProfiler::Now();
+}
 
-    /// Overridden base class virtual method.
-    //@{
-    void OnErase(wxDC& dc);
-    void OnMoveLink(wxDC& dc, bool moveControlPoints);
-    //@}
+void GraphCanvas::Record(const wxEvent& event)
+{
+    if (!m_trace)
+        return;
 
-protected:
-    /// Return the rectangle to refresh in OnErase().
-    virtual wxRect GetEraseRect() const;
-};
+    GraphTrace::Event ev;
+    if (ev.Set(event, GraphProfiler::Now() - m_traceStart))
+        m_trace->AddEvent(ev);
+}
 
-GraphHandler::GraphHandler(wxShapeEvtHandler *prev)
-  : wxShapeEvtHandler(prev, prev->GetShape())
+wxMouseState GraphCanvas::GetMouseState() const
 {
+    return m_replayState ? *m_replayState : wxGetMouseState();
 }
 
-void GraphHandler::OnErase(wxDC& dc)
+bool GraphCanvas::ReleaseIfCaptured()
 {
-    wxShape *shape = GetShape();
-
-    if (GetShape()->IsShown() && dc.IsKindOf(CLASSINFO(wxWindowDC)))
-    {
-        wxRect rcGraph = GetEraseRect();
-        wxRect rc;
-
-        rc.x = dc.LogicalToDeviceX(rcGraph.x);
-        rc.y = dc.LogicalToDeviceY(rcGraph.y);
-        rc.width = dc.LogicalToDeviceX(rcGraph.x + rcGraph.width) - rc.x + 1;
-        rc.height = dc.LogicalToDeviceY(rcGraph.y + rcGraph.height) - rc.y + 1;
+    if (!HasCapture())
+        return false;
+    ReleaseMouse();
+    return true;
+}
 
-        wxWindow *canvas = shape->GetCanvas();
-        canvas->RefreshRect(rc);
-    }
+void GraphCanvas::OnSetFocus(wxFocusEvent&)
+{
+    GetParent()->SetFocus();
 }
 
-wxRect GraphHandler::GetEraseRect() const
+void GraphCanvas::OnLeftButton(wxMouseEvent& event)
 {
-    wxShape *shape = GetShape();
-    wxPen *pen = shape->GetPen();
-    int penWidth = pen ? pen->GetWidth() : 0;
+    if (event.LeftDown())
+        EndZoomPreview();
 
-    double sizeX, sizeY;
-    shape->GetBoundingBoxMax(&sizeX, &sizeY);
-    sizeX += 2 * penWidth;
-    sizeY += 2 * penWidth;
+    if (m_dragState == StartDraggingRight ||
+        m_dragState == ContinueDraggingRight)
+        return;
 
-    int x1 = int(floor(shape->GetX() - sizeX / 2));
-    int y1 = int(floor(shape->GetY() - sizeY / 2));
-    int x2 = int(ceil(shape->GetX() + sizeX / 2));
-    int y2 = int(ceil(shape->GetY() + sizeY / 2));
+    if (event.LeftDown()) {
+        if (FindFocus() != GetParent())
+            SetFocus();
 
-    return wxRect(x1, y1, x2 - x1, y2 - y1);
-}
+        if (event.ShiftDown() && !event.Dragging()) {
+            wxClientDC dc(this);
+            PrepareDC(dc);
+            wxPoint ptLog(event.GetLogicalPosition(dc));
+            m_checkTolerance = true;
+            m_draggedShape = NULL;
+            m_dragState = StartDraggingLeft;
+            m_firstDragX = double(ptLog.x);
+            m_firstDragY = double(ptLog.y);
+            return;
+        }
+    }
 
-void GraphHandler::OnMoveLink(wxDC& dc, bool moveControlPoints)
-{
-    wxShape *shape = GetShape();
-    shape->Show(false);
-    wxShapeEvtHandler::OnMoveLink(dc, moveControlPoints);
-    shape->Show(true);
+    event.Skip();
 }
 
-/**
- * Event handler for control point shapes.
- */
-class ControlPointHandler: public GraphHandler
+void GraphCanvas::OnRightButton(wxMouseEvent& event)
 {
-public:
-    /// Ctor taking an existing shape.
-    ControlPointHandler(wxShapeEvtHandler *prev);
+    if (event.RightDown())
+        EndZoomPreview();
 
-    /// Overridden base class virtual method.
-    void OnErase(wxDC& dc);
-};
+    if (m_dragState == StartDraggingLeft ||
+        m_dragState == ContinueDraggingLeft)
+        return;
 
-ControlPointHandler::ControlPointHandler(wxShapeEvtHandler *prev)
-  : GraphHandler(prev)
-{
+    event.Skip();
 }
 
-void ControlPointHandler::OnErase(wxDC& dc)
+void GraphCanvas::OnMiddleButton(wxMouseEvent& event)
 {
-    wxControlPoint *control = wxStaticCast(GetShape(), wxControlPoint);
-    control->SetX(control->m_shape->GetX() + control->m_xoffset);
-    control->SetY(control->m_shape->GetY() + control->m_yoffset);
-    GraphHandler::OnErase(dc);
+    EndZoomPreview();
+    event.Skip();
 }
 
-/**
- * Common base class for GraphNodeHandler and GraphEdgeHandler.
- *
- * This class notably implements support for selection.
- */
-class GraphElementHandler: public GraphHandler
-{
-public:
-    /// Ctor taking an existing shape.
-    GraphElementHandler(wxShapeEvtHandler *prev);
-
-    /// Overridden base class virtual method.
-    //@{
-    void OnLeftClick(double x, double y, int keys, int attachment);
-    void OnLeftDoubleClick(double x, double y, int keys, int attachment);
-    void OnRightClick(double x, double y, int keys, int attachment);
-
-    void OnDraw(wxDC& dc)       { GetElement(GetShape())->OnDraw(dc); }
-    void OnDrawContents(wxDC&)  { }
-    //@}
-
-protected:
-    /// Implementation of OnLeftClick().
-    void HandleClick(wxEventType cmd, double x, double y, int keys);
-    /// Implementation pf OnLeftDoubleClick().
-    void HandleDClick(wxEventType cmd, double x, double y, int keys);
-    /// Implementation of OnRightClick().
-    void HandleRClick(wxEventType cmd, double x, double y, int keys);
-
-    /// Send a GraphEvent of the specified type.
-    bool SendEvent(wxEventType cmd, double x, double y);
-
-    /**
-     * Select or deselect the given shape.
-     *
-     * If @a keys doesn't include @c KEY_CTRL all the other currently selected
-     * shapes are deselected.
-     */
-    void Select(wxShape *shape, bool select, int keys);
-};
-
-GraphElementHandler::GraphElementHandler(wxShapeEvtHandler *prev)
-  : GraphHandler(prev)
+void GraphCanvas::EndZoomPreview()
 {
+    if (m_zoom && m_zoom->IsActive())
+        m_zoom->End();
 }
 
-void GraphElementHandler::OnLeftClick(double x, double y, int keys, int)
+wxWindow *GraphCanvas::EnsureParent(wxWindow *parent)
 {
-    HandleClick(Evt_Graph_Edge_Click, x, y, keys);
+    if (!parent) {
+        parent = new wxFrame(NULL, wxID_ANY, DefaultName,
+                             wxDefaultPosition, wxDefaultSize, 0);
+        wxTopLevelWindows.remove(parent);
+    }
+    return parent;
 }
 
-void GraphElementHandler::OnLeftDoubleClick(double x, double y,
-                                            int keys, int)
+bool GraphCanvas::SendEvent(wxEventType cmd, double x, double y)
 {
-    HandleDClick(Evt_Graph_Edge_Activate, x, y, keys);
-}
+    GraphEvent event(cmd, GetId());
+    event.SetPosition(wxPoint(int(x), int(y)));
+    event.SetEventObject(this);
+    GetEventHandler()->ProcessEvent(event);
 
-void GraphElementHandler::OnRightClick(double x, double y, int keys, int)
-{
-    HandleRClick(Evt_Graph_Edge_Menu, x, y, keys);
+    return event.IsAllowed();
 }
 
-void GraphElementHandler::HandleClick(wxEventType cmd,
-                                      double x, double y,
-                                      int keys)
+void GraphCanvas::OnLeftClick(double x, double y, int)
 {
-    wxShape *shape = GetShape();
-    Select(shape, !shape->Selected(), keys);
-    SendEvent(cmd, x, y);
+    GetGraph()->UnselectAll();
+    if (m_impact)
+        m_impact->SetSelected(NULL);
+    SendEvent(Evt_Graph_Click, x, y);
 }
 
-void GraphElementHandler::HandleDClick(wxEventType cmd,
-                                       double x, double y,
-                                       int keys)
+void GraphCanvas::OnRightClick(double x, double y, int)
 {
-    wxShape *shape = GetShape();
-    if (!shape->Selected())
-        Select(shape, true, keys);
-    SendEvent(cmd, x, y);
+    SendEvent(Evt_Graph_Menu, x, y);
 }
 
-void GraphElementHandler::HandleRClick(wxEventType cmd,
-                                       double x, double y,
-                                       int keys)
+void GraphCanvas::OnBeginDragLeft(double x, double y, int keys)
 {
-    wxShape *shape = GetShape();
-    if (!shape->Selected())
-        Select(shape, true, keys);
-    SendEvent(cmd, x, y);
+    if ((keys & KEY_SHIFT) != 0) {
+        // panning
+        m_isPanning = true;
+        m_ptDrag = GetMouseState().GetPosition();
+    }
+    else {
+        // rubber banding
+        m_ptDrag = wxPoint(int(x), int(y));
+    }
+    CaptureMouse();
 }
 
-bool GraphElementHandler::SendEvent(wxEventType cmd, double x, double y)
+void GraphCanvas::OnDragLeft(bool draw, double x, double y, int)
 {
-    wxShape *shape = GetShape();
-    wxShapeCanvas *canvas = shape->GetCanvas();
+    if (m_isPanning) {
+        // The mouse event that lead here may have been in queue before the
+        // last time the origin changed, in which case the x and y parameters
+        // would need adjusting to allow for that. Or OTOH the event may have
+        // come after and the x, y parameters need no adjustment. A simple
+        // way to avoid this problem is to use the global mouse position
+        // instead.
+        wxMouseState mouse = GetMouseState();
 
-    GraphElement *element = GetElement(shape);
-    GraphNode *node = wxDynamicCast(element, GraphNode);
-    GraphEdge *edge = node ? NULL : wxDynamicCast(element, GraphEdge);
+        if (mouse.LeftIsDown()) {
+            m_ptDrag -= ScrollByOffset(m_ptDrag.x - mouse.GetX(),
+                                       m_ptDrag.y - mouse.GetY());
+            Update();
+        }
+    }
+    else {
+        // rubber banding
 
-    GraphEvent event(cmd, canvas->GetId());
-    event.SetNode(node);
-    event.SetEdge(edge);
-    event.SetPosition(wxPoint(int(x), int(y)));
-    event.SetEventObject(canvas);
-    canvas->GetEventHandler()->ProcessEvent(event);
+        wxShapeCanvasOverlay overlay(this);
+        if (!draw) {
+            overlay.Reset();
+            return;
+        }
 
-    return event.IsAllowed();
+        wxDC& dc = overlay.GetDC();
+        wxPen dottedPen(*wxBLACK, 1, wxPENSTYLE_DOT);
+        dc.SetPen(dottedPen);
+        dc.SetBrush(*wxTRANSPARENT_BRUSH);
+
+        wxSize size(int(x) - m_ptDrag.x, int(y) - m_ptDrag.y);
+        dc.DrawRectangle(m_ptDrag, size);
+    }
 }
 
-void GraphElementHandler::Select(wxShape *shape, bool select, int keys)
+void GraphCanvas::OnEndDragLeft(double x, double y, int key)
 {
-    GraphElement *element = GetElement(shape);
+    ReleaseIfCaptured();
 
-    if ((keys & KEY_CTRL) == 0) {
-        Graph *graph = element->GetGraph();
-        Graph::iterator i, j, end;
+    if (m_isPanning) {
+        // finish panning
+        m_isPanning = false;
+        m_checkBounds = true;
+        // these aren't needed I think
+        SetScrollPos(wxHORIZONTAL, GetScrollPos(wxHORIZONTAL));
+        SetScrollPos(wxVERTICAL, GetScrollPos(wxVERTICAL));
+    }
+    else {
+        // rubber banding
+        wxRect rc;
 
-        tie(i, end) = graph->GetSelection();
+        if (x >= m_ptDrag.x) {
+            rc.x = m_ptDrag.x;
+            rc.width = int(x) - m_ptDrag.x;
+        } else {
+            rc.x = int(x);
+            rc.width = m_ptDrag.x - int(x);
+        }
 
-        while (i != end) {
-            j = i++;
-            if (&*j != element) {
-                j->Unselect();
-                select = true;
+        if (y >= m_ptDrag.y) {
+            rc.y = m_ptDrag.y;
+            rc.height = int(y) - m_ptDrag.y;
+        } else {
+            rc.y = int(y);
+            rc.height = m_ptDrag.y - int(y);
+        }
+
+        // Gather the elements before selecting any, since Select moves an
+        // element to the front, then test all their bounds against the band
+        // at once. Unselected elements are selected if they come within a
+        // pixel of it, selected ones stay selected if they overlap it. The
+        // shapes are walked rather than GetElements() so that the proxies
+        // of collapsed groups are included and their members left out.
+        wxList *shapes = GetDiagram()->GetShapeList();
+        wxList::iterator i;
+        vector<GraphElement*> elements;
+        wxOGLRectBuffer bounds;
+
+        for (i = shapes->begin(); i != shapes->end(); ++i) {
+            wxShape *shape = static_cast<wxShape*>(*i);
+            GraphElement *element = GetElement(shape);
+
+            if (element && shape->IsShown()) {
+                elements.push_back(element);
+                bounds.Add(element->GetBounds());
             }
         }
-    }
 
-    if (select)
-        element->Select();
-    else
-        element->Unselect();
-}
+        size_t n = elements.size();
+        vector<unsigned char> touching(n), overlapping(n);
+        double left = rc.x, top = rc.y;
+        double right = rc.x + rc.width, bottom = rc.y + rc.height;
 
-/**
- * Event handler defining the default node behaviour.
- */
-class GraphNodeHandler: public GraphElementHandler
-{
-public:
-    /// Shorter synonym.
-    typedef GraphEvent::NodeList NodeList;
+        if (n) {
+            wxOGLGeometry::FindOverlapping(bounds, left, top, right, bottom,
+                                           &touching[0], 1);
+            wxOGLGeometry::FindOverlapping(bounds, left, top, right, bottom,
+                                           &overlapping[0]);
+        }
 
-    /// Ctor taking an existing shape.
-    GraphNodeHandler(wxShapeEvtHandler *prev);
+        for (size_t k = 0; k < n; k++) {
+            GraphElement *element = elements[k];
 
-    /// Overridden base class virtual method.
-    //@{
-    void OnLeftClick(double x, double y, int keys, int attachment);
-    void OnLeftDoubleClick(double x, double y, int keys, int attachment);
-    void OnRightClick(double x, double y, int keys, int attachment);
+            if (!element->IsSelected()) {
+                if (touching[k])
+                    element->Select();
+            }
+            else {
+                if ((key & KEY_CTRL) == 0 && !overlapping[k])
+                    element->Unselect();
+            }
+        }
+    }
+}
 
-    void OnBeginDragLeft(double x, double y, int keys, int attachment);
-    void OnDragLeft(bool draw, double x, double y, int keys, int attachment);
-    void OnEndDragLeft(double x, double y, int keys, int attachment);
+wxShape *GraphCanvas::FindShape(double x, double y, int *attachment,
+                                wxClassInfo *info, wxShape *notObject)
+{
+    if (!m_bundles || !m_bundles->IsEnabled() || !GetDiagram())
+        return wxShapeCanvas::FindShape(x, y, attachment, info, notObject);
 
-    void OnBeginDragRight(double x, double y, int keys, int attachment);
-    void OnDragRight(bool draw, double x, double y, int keys, int attachment);
-    void OnEndDragRight(double x, double y, int keys, int attachment);
+    wxList *shapes = GetDiagram()->GetShapeList();
+    vector<wxShape*> hidden;
+    wxList::iterator it;
 
-    void OnBeginDrag(int mode, double x, double y);
-    void OnDrag(int mode, bool draw, double x, double y);
-    void OnEndDrag(int mode, double x, double y);
+    for (it = shapes->begin(); it != shapes->end(); ++it) {
+        wxShape *shape = static_cast<wxShape*>(*it);
 
-    void OnEraseContents(wxDC& dc)  { GraphElementHandler::OnErase(dc); }
-    void OnErase(wxDC& dc)          { wxShapeEvtHandler::OnErase(dc); }
+        if (shape->IsShown() && m_bundles->IsCollapsed(shape)) {
+            shape->Show(false);
+            hidden.push_back(shape);
+        }
+    }
 
-    void OnDraw(wxDC& dc);
+    wxShape *found =
+        wxShapeCanvas::FindShape(x, y, attachment, info, notObject);
 
-    void OnSizingDragLeft(wxControlPoint* pt, bool draw, double x, double y, int keys, int attachment);
-    void OnSizingEndDragLeft(wxControlPoint* pt, double x, double y, int keys, int attachment);
-    //@}
+    for (size_t i = 0; i < hidden.size(); i++)
+        hidden[i]->Show(true);
 
-    /// Return the associated GraphNode.
-    inline GraphNode *GetNode() const;
+    return found;
+}
 
-    enum {
-        Drag_Move = GraphCtrl::Drag_Move,
-        Drag_Connect = GraphCtrl::Drag_Connect
-    };
+void GraphCanvas::OnCaptureLost(wxMouseCaptureLostEvent&)
+{
+    wxMouseState state = GetMouseState();
 
-private:
-    NodeList m_sources;     ///< The source nodes being dragged onto this one.
-    GraphNode *m_target;    ///< Target of the drag operation.
-    wxPoint m_offset;       ///< Position where the dragging started.
-};
+    int keys = 0;
+    if (state.ShiftDown())
+        keys |= KEY_SHIFT;
+    if (state.ControlDown())
+        keys |= KEY_CTRL;
 
-GraphNodeHandler::GraphNodeHandler(wxShapeEvtHandler *prev)
-  : GraphElementHandler(prev),
-    m_target(NULL)
-{
-}
+    wxPoint pt(state.GetX(), state.GetY());
+    pt = ScreenToGraph(wxRect(pt, wxSize())).GetPosition();
+    double x = pt.x, y = pt.y;
 
-void GraphNodeHandler::OnLeftClick(double x, double y, int keys, int)
-{
-    HandleClick(Evt_Graph_Node_Click, x, y, keys);
-}
+    if (m_dragState == ContinueDraggingLeft) {
+        m_dragState = NoDragging;
+        m_checkTolerance = true;
 
-void GraphNodeHandler::OnLeftDoubleClick(double x, double y, int keys, int)
-{
-    HandleDClick(Evt_Graph_Node_Activate, x, y, keys);
-}
+        if (m_draggedShape != NULL) {
+            wxShapeEvtHandler *h = m_draggedShape->GetEventHandler();
+            h->OnDragLeft(false, m_oldDragX, m_oldDragY, keys, m_draggedAttachment);
+            h->OnEndDragLeft(x, y, keys, m_draggedAttachment);
+        }
+        else {
+            OnDragLeft(false, m_oldDragX, m_oldDragY, keys);
+            OnEndDragLeft(x, y, keys);
+        }
+    }
+    else if (m_dragState == ContinueDraggingRight) {
+        m_dragState = NoDragging;
+        m_checkTolerance = true;
 
-void GraphNodeHandler::OnRightClick(double x, double y, int keys, int)
-{
-    HandleRClick(Evt_Graph_Node_Menu, x, y, keys);
+        if (m_draggedShape != NULL) {
+            wxShapeEvtHandler *h = m_draggedShape->GetEventHandler();
+            h->OnDragRight(false, m_oldDragX, m_oldDragY, keys, m_draggedAttachment);
+            h->OnEndDragRight(x, y, keys, m_draggedAttachment);
+        }
+        else {
+            OnDragRight(false, m_oldDragX, m_oldDragY, keys);
+            OnEndDragRight(x, y, keys);
+        }
+    }
+
+    m_draggedShape = NULL;
 }
 
-GraphNode *GraphNodeHandler::GetNode() const
+void GraphCanvas::ScrollGraph(int orient, int type, int pos, int lines)
 {
-    return tt_solutions::GetNode(GetShape());
+    bool horz = orient == wxHORIZONTAL;
+    int scroll = horz ? m_xScrollPosition : m_yScrollPosition;
+    int size = horz ? m_virtualSize.x : m_virtualSize.y;
+    int cs = horz ? GetClientSize().x : GetClientSize().y;
+
+    if (type == wxEVT_SCROLLWIN_TOP)
+        pos = 0;
+    else if (type == wxEVT_SCROLLWIN_BOTTOM)
+        pos = size;
+    else if (type == wxEVT_SCROLLWIN_LINEUP)
+        pos = scroll - 16 * lines;
+    else if (type == wxEVT_SCROLLWIN_LINEDOWN)
+        pos = scroll + 16 * lines;
+    else if (type == wxEVT_SCROLLWIN_PAGEUP)
+        pos = scroll - cs;
+    else if (type == wxEVT_SCROLLWIN_PAGEDOWN)
+        pos = scroll + cs;
+
+    if (pos > size - cs)
+        pos = size - cs;
+    if (pos < 0)
+        pos = 0;
+
+    if (horz)
+        ScrollByOffset(pos - m_xScrollPosition, 0);
+    else
+        ScrollByOffset(0, pos - m_yScrollPosition);
 }
 
-void GraphNodeHandler::OnBeginDragLeft(double x, double y, int, int)
+void GraphCanvas::OnScroll(wxScrollWinEvent& event)
 {
-    OnBeginDrag(GraphCtrl::GetLeftDragMode(), x, y);
+    if (FindFocus() != GetParent())
+        SetFocus();
+
+    int orient = event.GetOrientation();
+    int type = event.GetEventType();
+    int pos = event.GetPosition();
+
+    ScrollGraph(orient, type, pos);
 }
 
-void GraphNodeHandler::OnDragLeft(bool draw, double x, double y, int, int)
+bool GraphCanvas::CheckBounds()
 {
-    OnDrag(GraphCtrl::GetLeftDragMode(), draw, x, y);
+    GRAPH_PROFILE_SCOPE("GraphCanvas::CheckBounds");
+
+    wxClientDC dc(this);
+    PrepareDC(dc);
+
+    wxSize cs = GetFullClientSize();
+    wxSize fullclient = cs;
+
+    wxRect b = m_graph->GetBounds();
+
+    if (!b.IsEmpty()) {
+        if (m_borderType == GraphCtrl::Graph_Border)
+            b.Inflate(m_border);
+
+        b.x = dc.LogicalToDeviceX(b.x);
+        b.y = dc.LogicalToDeviceY(b.y);
+        b.width = dc.LogicalToDeviceXRel(b.width);
+        b.height = dc.LogicalToDeviceYRel(b.height);
+
+        if (m_borderType == GraphCtrl::Percentage_Border)
+            b.Inflate(wxSize(cs.x * m_border.x, cs.y * m_border.y) / 100);
+        else if (m_borderType == GraphCtrl::Ctrl_Border)
+            b.Inflate(m_border);
+
+        wxRect inner = m_graph->GetBounds();
+        inner.Inflate(m_margin);
+        inner.x = dc.LogicalToDeviceX(inner.x);
+        inner.y = dc.LogicalToDeviceY(inner.y);
+        inner.width = dc.LogicalToDeviceXRel(inner.width);
+        inner.height = dc.LogicalToDeviceYRel(inner.height);
+        b.Union(inner);
+    }
+
+    const wxRect b0 = b;
+
+    int x = -min(0, b.x);
+    int y = -min(0, b.y);
+
+    bool fitsX = m_fitsX, fitsY = m_fitsY;
+
+    m_fitsX = b.width <= cs.x;
+    m_fitsY = b.height <= cs.y;
+
+    bool needHBar = false, needVBar = false;
+    bool done = false;
+
+    while (!done && !b.IsEmpty()) {
+        done = true;
+
+        b = b0;
+        wxRect csr = m_fitsY ? wxRect(fullclient) : wxRect(cs);
+        b.Union(csr.CentreIn(b));
+        m_fitsX = b.width <= csr.width;
+
+        x = -min(0, b.x);
+        m_virtualSize.x = max(cs.x, b.GetRight()) + x;
+
+        if (m_virtualSize.x > cs.x) {
+            SetScrollbar(wxHORIZONTAL, x, cs.x, m_virtualSize.x);
+            GetClientSize(NULL, &cs.y);
+            needHBar = true;
+        }
+        else {
+            cs.y = fullclient.y;
+            needHBar = false;
+        }
+
+        b = b0;
+        csr = m_fitsX ? wxRect(fullclient) : wxRect(cs);
+        b.Union(csr.CentreIn(b));
+        m_fitsY = b.height <= csr.height;
+
+        y = -min(0, b.y);
+        m_virtualSize.y = max(cs.y, b.GetBottom()) + y;
+
+        if (m_virtualSize.y > cs.y) {
+            SetScrollbar(wxVERTICAL, y, cs.y, m_virtualSize.y);
+            GetClientSize(&cs.x, NULL);
+            done = needVBar;
+            needVBar = true;
+        }
+        else {
+            cs.x = fullclient.x;
+            needVBar = false;
+        }
+    }
+
+    m_ptOrigin.x += x - m_xScrollPosition;
+    m_xScrollPosition = x;
+
+    m_ptOrigin.y += y - m_yScrollPosition;
+    m_yScrollPosition = y;
+
+    if (!needHBar)
+        SetScrollbar(wxHORIZONTAL, 0, 0, 0);
+    if (!needVBar)
+        SetScrollbar(wxVERTICAL, 0, 0, 0);
+
+    m_sizeScrollbar = fullclient - cs;
+
+    m_checkBounds = false;
+
+    return m_fitsX != fitsX || m_fitsY != fitsY;
 }
 
-void GraphNodeHandler::OnEndDragLeft(double x, double y, int, int)
+wxSize GraphCanvas::GetScrollClientSize() const
 {
-    OnEndDrag(GraphCtrl::GetLeftDragMode(), x, y);
+    wxSize cs = GetClientSize();
+    if (m_fitsY)
+        cs.x += m_sizeScrollbar.x;
+    if (m_fitsX)
+        cs.y += m_sizeScrollbar.y;
+    return cs;
 }
 
-void GraphNodeHandler::OnBeginDragRight(double x, double y, int, int)
+wxSize GraphCanvas::GetFullClientSize() const
 {
-    OnBeginDrag(GraphCtrl::GetRightDragMode(), x, y);
+    return GetClientSize() + m_sizeScrollbar;
 }
 
-void GraphNodeHandler::OnDragRight(bool draw, double x, double y, int, int)
+void GraphCanvas::OnPaint(wxPaintEvent&)
 {
-    OnDrag(GraphCtrl::GetRightDragMode(), draw, x, y);
+    wxPaintDC dc(this);
+
+    {
+        GRAPH_PROFILE_SCOPE("GraphCanvas::OnPaint");
+        PrepareDC(dc);
+
+        if (m_zoom && m_zoom->IsActive())
+            m_zoom->OnPaint(dc);
+        else
+            Draw(dc);
+    }
+
+    if (m_hud)
+        m_hud->OnPaint(dc);
 }
 
-void GraphNodeHandler::OnEndDragRight(double x, double y, int, int)
+void GraphCanvas::Draw(wxDC& dc)
 {
-    OnEndDrag(GraphCtrl::GetRightDragMode(), x, y);
+    if (GetDiagram()) {
+        if (m_impact)
+            m_impact->Draw(dc);
+        GetDiagram()->Redraw(dc);
+    }
 }
 
-void GraphNodeHandler::OnBeginDrag(int mode, double x, double y)
+void GraphCanvas::Zoom(double percent, const wxPoint& pt, const wxPoint& ptGraph)
+{
+    double scale = ClampZoom(percent) / 100.0;
+    SetScale(scale, scale);
+
+    Refresh();
+    SetCheckBounds();
+
+    wxClientDC dc(this);
+    PrepareDC(dc);
+    int x = dc.LogicalToDeviceX(ptGraph.x) - pt.x;
+    int y = dc.LogicalToDeviceY(ptGraph.y) - pt.y;
+
+    ScrollByOffset(x, y, false);
+}
+
+void GraphCanvas::Zoom(double percent, const wxPoint& pt)
+{
+    Zoom(percent, pt, ClientToGraph(pt));
+}
+
+wxPoint GraphCanvas::ClientToGraph(const wxPoint& pt)
+{
+    wxClientDC dc(this);
+    PrepareDC(dc);
+    return wxPoint(dc.DeviceToLogicalX(pt.x), dc.DeviceToLogicalY(pt.y));
+}
+
+void GraphCanvas::OnSize(wxSizeEvent& event)
+{
+    SetCheckBounds();
+    event.Skip();
+}
+
+void GraphCanvas::PrepareDC(wxDC& dc)
+{
+    int x = m_ptOrigin.x - m_xScrollPosition;
+    int y = m_ptOrigin.y - m_yScrollPosition;
+
+    dc.SetDeviceOrigin(x, y);
+    dc.SetUserScale(m_scaleX, m_scaleY);
+}
+
+wxPoint GraphCanvas::GetScroll() const
+{
+    return wxPoint(m_xScrollPosition, m_yScrollPosition);
+}
+
+void GraphCanvas::ScrollTo(const wxPoint& ptGraph, bool draw)
+{
+    wxClientDC dc(this);
+    PrepareDC(dc);
+
+    wxSize cs = GetScrollClientSize();
+    int x = dc.LogicalToDeviceX(ptGraph.x) - cs.x / 2;
+    int y = dc.LogicalToDeviceY(ptGraph.y) - cs.y / 2;
+
+    ScrollByOffset(x, y, draw);
+}
+
+wxPoint GraphCanvas::GetScrollPosition()
+{
+    wxClientDC dc(this);
+    PrepareDC(dc);
+
+    wxSize cs = GetScrollClientSize();
+    wxPoint pt;
+
+    pt.x = dc.DeviceToLogicalX(cs.x / 2);
+    pt.y = dc.DeviceToLogicalY(cs.y / 2);
+
+    return pt;
+}
+
+wxPoint GraphCanvas::ScrollByOffset(int x, int y, bool draw)
+{
+    m_xScrollPosition += x;
+    m_yScrollPosition += y;
+
+    if (draw) {
+        ScrollWindow(-x, -y);
+        if (m_hud)
+            m_hud->OnScroll(-x, -y);
+    }
+
+    SetCheckBounds();
+
+    return wxPoint(x, y);
+}
+
+void GraphCanvas::EnsureVisible(wxRect rcGraph, bool draw)
+{
+    wxClientDC dc(this);
+    PrepareDC(dc);
+
+    rcGraph.Inflate(m_margin);
+
+    wxRect rc(dc.LogicalToDeviceX(rcGraph.x),
+              dc.LogicalToDeviceY(rcGraph.y),
+              dc.LogicalToDeviceXRel(rcGraph.width),
+              dc.LogicalToDeviceYRel(rcGraph.height));
+
+    wxRect rcClient = GetScrollClientSize();
+
+    int x = 0, y = 0;
+
+    if (rc.x < rcClient.x)
+        x = rc.x - rcClient.x;
+    else if (rc.GetRight() > rcClient.GetRight())
+        x = rc.GetRight() - rcClient.GetRight();
+
+    if (rc.y < rcClient.y)
+        y = rc.y - rcClient.y;
+    else if (rc.GetBottom() > rcClient.GetBottom())
+        y = rc.GetBottom() - rcClient.GetBottom();
+
+    if (x || y)
+        ScrollByOffset(x, y, draw);
+}
+
+void GraphCanvas::ScrollTo(int side, bool draw)
+{
+    wxASSERT(m_graph);
+
+    wxClientDC dc(this);
+    PrepareDC(dc);
+
+    wxRect rcGraph = m_graph->GetBounds();
+    rcGraph.Inflate(m_margin);
+
+    wxRect rc(dc.LogicalToDeviceX(rcGraph.x),
+              dc.LogicalToDeviceY(rcGraph.y),
+              dc.LogicalToDeviceXRel(rcGraph.width),
+              dc.LogicalToDeviceYRel(rcGraph.height));
+
+    wxRect rcClient = GetScrollClientSize();
+
+    rc += rcClient.CentreIn(rc);
+
+    int x = 0, y = 0;
+
+    if ((side & wxLEFT) != 0)
+        x = rc.x - rcClient.x;
+    else if ((side & wxRIGHT) != 0)
+        x = rc.GetRight() - rcClient.GetRight();
+    else if (rc.x > rcClient.x)
+        x = rc.x - rcClient.x;
+    else if (rc.GetRight() < rcClient.GetRight())
+        x = rc.GetRight() - rcClient.GetRight();
+
+    if ((side & wxTOP) != 0)
+        y = rc.y - rcClient.y;
+    else if ((side & wxBOTTOM) != 0)
+        y = rc.GetBottom() - rcClient.GetBottom();
+    else if (rc.y > rcClient.y)
+        y = rc.y - rcClient.y;
+    else if (rc.GetBottom() < rcClient.GetBottom())
+        y = rc.GetBottom() - rcClient.GetBottom();
+
+    if (x || y)
+        ScrollByOffset(x, y, draw);
+}
+
+wxRect GraphCanvas::ScreenToGraph(const wxRect& rcScreen)
+{
+    wxClientDC dc(this);
+    PrepareDC(dc);
+    wxPoint pt = ScreenToClient(rcScreen.GetTopLeft());
+    return wxRect(dc.DeviceToLogicalX(pt.x),
+                  dc.DeviceToLogicalY(pt.y),
+                  dc.DeviceToLogicalXRel(rcScreen.width),
+                  dc.DeviceToLogicalYRel(rcScreen.height));
+}
+
+wxRect GraphCanvas::GraphToScreen(const wxRect& rcGraph)
+{
+    wxClientDC dc(this);
+    PrepareDC(dc);
+    wxPoint pt( dc.LogicalToDeviceX(rcGraph.x),
+                dc.LogicalToDeviceY(rcGraph.y));
+    wxSize size(dc.LogicalToDeviceXRel(rcGraph.width),
+                dc.LogicalToDeviceYRel(rcGraph.height));
+    return wxRect(ClientToScreen(pt), size);
+}
+
+wxRect GraphCanvas::GraphToClient(const wxRect& rcGraph) const
+{
+    wxPoint pt(m_ptOrigin.x + wxRound(rcGraph.x * m_scaleX),
+               m_ptOrigin.y + wxRound(rcGraph.y * m_scaleY));
+    wxSize size(wxRound(rcGraph.width * m_scaleX),
+                wxRound(rcGraph.height * m_scaleY));
+    return wxRect(CalcScrolledPosition(pt), size);
+}
+
+void RefreshGraphArea(wxShapeCanvas *canvas, const wxRect& rcGraph)
+{
+    if (rcGraph.IsEmpty())
+        return;
+
+    GraphCanvas *graphCanvas = static_cast<GraphCanvas*>(canvas);
+    canvas->RefreshRect(graphCanvas->GraphToClient(rcGraph).Inflate(1));
+}
+
+wxRect GraphCanvas::GetClientScreenRect() const
+{
+    return wxRect(ClientToScreen(wxPoint()), GetClientSize());
+}
+
+} // namespace impl
+
+// ----------------------------------------------------------------------------
+// Handler to give shapes a transparent background
+// ----------------------------------------------------------------------------
+
+namespace {
+
+/**
+ * Generic event handler for the shape objects.
+ *
+ * This class is used as the event handler by GraphDiagram to allow changing
+ * the behaviour of any existing shape without having to override its virtual
+ * methods.
+ *
+ * It's both a base class inherited from by ControlPointHandler,
+ * GraphNodeHandler and GraphEdgeHandler and a concrete class used directly
+ * for the other graph elements.
+ */
+class GraphHandler: public wxShapeEvtHandler
+{
+public:
+    /// Ctor taking an existing shape.
+    GraphHandler(wxShapeEvtHandler *prev);
+
+    /// Overridden base class virtual method.
+    //@{
+    void OnErase(wxDC& dc);
+    void OnMoveLink(wxDC& dc, bool moveControlPoints);
+    //@}
+
+    /// Return the rectangle to refresh in OnErase().
+    virtual wxRect GetEraseRect() const;
+
+    /// The GraphHandler in the shape's handler chain, or NULL.
+    static GraphHandler *Get(wxShape *shape);
+
+    DECLARE_CLASS(GraphHandler)
+};
+
+IMPLEMENT_CLASS(GraphHandler, wxShapeEvtHandler)
+
+GraphHandler::GraphHandler(wxShapeEvtHandler *prev)
+  : wxShapeEvtHandler(prev, prev->GetShape())
+{
+}
+
+void GraphHandler::OnErase(wxDC& dc)
 {
     wxShape *shape = GetShape();
-    GraphCanvas *canvas = wxStaticCast(shape->GetCanvas(), GraphCanvas);
 
-    m_target = NULL;
-    m_offset = wxPoint(int(shape->GetX() - x), int(shape->GetY() - y));
+    if (GetShape()->IsShown() && dc.IsKindOf(CLASSINFO(wxWindowDC)))
+    {
+        wxRect rcGraph = GetEraseRect();
+        wxRect rc;
+
+        rc.x = dc.LogicalToDeviceX(rcGraph.x);
+        rc.y = dc.LogicalToDeviceY(rcGraph.y);
+        rc.width = dc.LogicalToDeviceX(rcGraph.x + rcGraph.width) - rc.x + 1;
+        rc.height = dc.LogicalToDeviceY(rcGraph.y + rcGraph.height) - rc.y + 1;
+
+        wxWindow *canvas = shape->GetCanvas();
+        canvas->RefreshRect(rc);
+    }
+}
+
+wxRect GraphHandler::GetEraseRect() const
+{
+    wxShape *shape = GetShape();
+    wxPen *pen = shape->GetPen();
+    int penWidth = pen ? pen->GetWidth() : 0;
+
+    double sizeX, sizeY;
+    shape->GetBoundingBoxMax(&sizeX, &sizeY);
+    sizeX += 2 * penWidth;
+    sizeY += 2 * penWidth;
+
+    int x1 = int(floor(shape->GetX() - sizeX / 2));
+    int y1 = int(floor(shape->GetY() - sizeY / 2));
+    int x2 = int(ceil(shape->GetX() + sizeX / 2));
+    int y2 = int(ceil(shape->GetY() + sizeY / 2));
+
+    return wxRect(x1, y1, x2 - x1, y2 - y1);
+}
+
+GraphHandler *GraphHandler::Get(wxShape *shape)
+{
+    // other handlers may have been pushed on top of ours
+    wxShapeEvtHandler *handler = shape->GetEventHandler();
+
+    while (handler && handler != shape) {
+        if (GraphHandler *graphHandler = wxDynamicCast(handler, GraphHandler))
+            return graphHandler;
+        handler = handler->GetPreviousHandler();
+    }
+
+    return NULL;
+}
+
+void GraphHandler::OnMoveLink(wxDC& dc, bool moveControlPoints)
+{
+    // lines hidden in a collapsed group must stay hidden
+    wxShape *shape = GetShape();
+    bool shown = shape->IsShown();
+    shape->Show(false);
+    wxShapeEvtHandler::OnMoveLink(dc, moveControlPoints);
+    shape->Show(shown);
+}
+
+/**
+ * Event handler for control point shapes.
+ */
+class ControlPointHandler: public GraphHandler
+{
+public:
+    /// Ctor taking an existing shape.
+    ControlPointHandler(wxShapeEvtHandler *prev);
+
+    /// Overridden base class virtual method.
+    void OnErase(wxDC& dc);
+};
+
+ControlPointHandler::ControlPointHandler(wxShapeEvtHandler *prev)
+  : GraphHandler(prev)
+{
+}
+
+void ControlPointHandler::OnErase(wxDC& dc)
+{
+    wxControlPoint *control = wxStaticCast(GetShape(), wxControlPoint);
+    control->SetX(control->m_shape->GetX() + control->m_xoffset);
+    control->SetY(control->m_shape->GetY() + control->m_yoffset);
+    GraphHandler::OnErase(dc);
+}
+
+/**
+ * Common base class for GraphNodeHandler and GraphEdgeHandler.
+ *
+ * This class notably implements support for selection.
+ */
+class GraphElementHandler: public GraphHandler
+{
+public:
+    /// Ctor taking an existing shape.
+    GraphElementHandler(wxShapeEvtHandler *prev);
+
+    /// Overridden base class virtual method.
+    //@{
+    void OnLeftClick(double x, double y, int keys, int attachment);
+    void OnLeftDoubleClick(double x, double y, int keys, int attachment);
+    void OnRightClick(double x, double y, int keys, int attachment);
+
+    void OnDraw(wxDC& dc)       { GetElement(GetShape())->OnDraw(dc); }
+    void OnDrawContents(wxDC&)  { }
+    //@}
+
+protected:
+    /// Implementation of OnLeftClick().
+    void HandleClick(wxEventType cmd, double x, double y, int keys);
+    /// Implementation pf OnLeftDoubleClick().
+    void HandleDClick(wxEventType cmd, double x, double y, int keys);
+    /// Implementation of OnRightClick().
+    void HandleRClick(wxEventType cmd, double x, double y, int keys);
+
+    /// Send a GraphEvent of the specified type.
+    bool SendEvent(wxEventType cmd, double x, double y);
+
+    /**
+     * Select or deselect the given shape.
+     *
+     * If @a keys doesn't include @c KEY_CTRL all the other currently selected
+     * shapes are deselected.
+     */
+    void Select(wxShape *shape, bool select, int keys);
+};
+
+GraphElementHandler::GraphElementHandler(wxShapeEvtHandler *prev)
+  : GraphHandler(prev)
+{
+}
+
+void GraphElementHandler::OnLeftClick(double x, double y, int keys, int)
+{
+    HandleClick(Evt_Graph_Edge_Click, x, y, keys);
+}
+
+void GraphElementHandler::OnLeftDoubleClick(double x, double y,
+                                            int keys, int)
+{
+    HandleDClick(Evt_Graph_Edge_Activate, x, y, keys);
+}
+
+void GraphElementHandler::OnRightClick(double x, double y, int keys, int)
+{
+    HandleRClick(Evt_Graph_Edge_Menu, x, y, keys);
+}
+
+void GraphElementHandler::HandleClick(wxEventType cmd,
+                                      double x, double y,
+                                      int keys)
+{
+    wxShape *shape = GetShape();
+    Select(shape, !shape->Selected(), keys);
+    SendEvent(cmd, x, y);
+}
+
+void GraphElementHandler::HandleDClick(wxEventType cmd,
+                                       double x, double y,
+                                       int keys)
+{
+    wxShape *shape = GetShape();
+    if (!shape->Selected())
+        Select(shape, true, keys);
+    SendEvent(cmd, x, y);
+}
+
+void GraphElementHandler::HandleRClick(wxEventType cmd,
+                                       double x, double y,
+                                       int keys)
+{
+    wxShape *shape = GetShape();
+    if (!shape->Selected())
+        Select(shape, true, keys);
+    SendEvent(cmd, x, y);
+}
+
+bool GraphElementHandler::SendEvent(wxEventType cmd, double x, double y)
+{
+    wxShape *shape = GetShape();
+    wxShapeCanvas *canvas = shape->GetCanvas();
+
+    GraphElement *element = GetElement(shape);
+    GraphNode *node = wxDynamicCast(element, GraphNode);
+    GraphEdge *edge = node ? NULL : wxDynamicCast(element, GraphEdge);
+
+    GraphEvent event(cmd, canvas->GetId());
+    event.SetNode(node);
+    event.SetEdge(edge);
+    event.SetPosition(wxPoint(int(x), int(y)));
+    event.SetEventObject(canvas);
+    canvas->GetEventHandler()->ProcessEvent(event);
+
+    return event.IsAllowed();
+}
+
+void GraphElementHandler::Select(wxShape *shape, bool select, int keys)
+{
+    GraphElement *element = GetElement(shape);
+
+    if ((keys & KEY_CTRL) == 0) {
+        Graph *graph = element->GetGraph();
+        Graph::iterator i, j, end;
+
+        tie(i, end) = graph->GetSelection();
+
+        while (i != end) {
+            j = i++;
+            if (&*j != element) {
+                j->Unselect();
+                select = true;
+            }
+        }
+    }
+
+    if (select)
+        element->Select();
+    else
+        element->Unselect();
+}
+
+/**
+ * Event handler defining the default node behaviour.
+ */
+class GraphNodeHandler: public GraphElementHandler
+{
+public:
+    /// Shorter synonym.
+    typedef GraphEvent::NodeList NodeList;
+
+    /// Ctor taking an existing shape.
+    GraphNodeHandler(wxShapeEvtHandler *prev);
+
+    /// Overridden base class virtual method.
+    //@{
+    void OnLeftClick(double x, double y, int keys, int attachment);
+    void OnLeftDoubleClick(double x, double y, int keys, int attachment);
+    void OnRightClick(double x, double y, int keys, int attachment);
+
+    void OnBeginDragLeft(double x, double y, int keys, int attachment);
+    void OnDragLeft(bool draw, double x, double y, int keys, int attachment);
+    void OnEndDragLeft(double x, double y, int keys, int attachment);
+
+    void OnBeginDragRight(double x, double y, int keys, int attachment);
+    void OnDragRight(bool draw, double x, double y, int keys, int attachment);
+    void OnEndDragRight(double x, double y, int keys, int attachment);
+
+    void OnBeginDrag(int mode, double x, double y);
+    void OnDrag(int mode, bool draw, double x, double y);
+    void OnEndDrag(int mode, double x, double y);
+
+    void OnEraseContents(wxDC& dc)  { GraphElementHandler::OnErase(dc); }
+    void OnErase(wxDC& dc)          { wxShapeEvtHandler::OnErase(dc); }
+
+    void OnDraw(wxDC& dc);
+
+    void OnSizingDragLeft(wxControlPoint* pt, bool draw, double x, double y, int keys, int attachment);
+    void OnSizingEndDragLeft(wxControlPoint* pt, double x, double y, int keys, int attachment);
+    //@}
+
+    /// Return the associated GraphNode.
+    inline GraphNode *GetNode() const;
+
+    enum {
+        Drag_Move = GraphCtrl::Drag_Move,
+        Drag_Connect = GraphCtrl::Drag_Connect
+    };
+
+private:
+    NodeList m_sources;     ///< The source nodes being dragged onto this one.
+    GraphNode *m_target;    ///< Target of the drag operation.
+    wxPoint m_offset;       ///< Position where the dragging started.
+};
+
+GraphNodeHandler::GraphNodeHandler(wxShapeEvtHandler *prev)
+  : GraphElementHandler(prev),
+    m_target(NULL)
+{
+}
+
+void GraphNodeHandler::OnLeftClick(double x, double y, int keys, int)
+{
+    HandleClick(Evt_Graph_Node_Click, x, y, keys);
+
+    GraphCanvas *canvas = wxStaticCast(GetShape()->GetCanvas(), GraphCanvas);
+    ImpactHighlight *impact = canvas->GetImpact();
+    GraphNode *node = GetNode();
+
+    if (impact && node)
+        impact->SetSelected(node->IsSelected() ? node : NULL);
+}
+
+void GraphNodeHandler::OnLeftDoubleClick(double x, double y, int keys, int)
+{
+    HandleDClick(Evt_Graph_Node_Activate, x, y, keys);
+}
+
+void GraphNodeHandler::OnRightClick(double x, double y, int keys, int)
+{
+    HandleRClick(Evt_Graph_Node_Menu, x, y, keys);
+}
+
+GraphNode *GraphNodeHandler::GetNode() const
+{
+    return tt_solutions::GetNode(GetShape());
+}
+
+void GraphNodeHandler::OnBeginDragLeft(double x, double y, int, int)
+{
+    OnBeginDrag(GraphCtrl::GetLeftDragMode(), x, y);
+}
+
+void GraphNodeHandler::OnDragLeft(bool draw, double x, double y, int, int)
+{
+    OnDrag(GraphCtrl::GetLeftDragMode(), draw, x, y);
+}
+
+void GraphNodeHandler::OnEndDragLeft(double x, double y, int, int)
+{
+    OnEndDrag(GraphCtrl::GetLeftDragMode(), x, y);
+}
+
+void GraphNodeHandler::OnBeginDragRight(double x, double y, int, int)
+{
+    OnBeginDrag(GraphCtrl::GetRightDragMode(), x, y);
+}
+
+void GraphNodeHandler::OnDragRight(bool draw, double x, double y, int, int)
+{
+    OnDrag(GraphCtrl::GetRightDragMode(), draw, x, y);
+}
+
+void GraphNodeHandler::OnEndDragRight(double x, double y, int, int)
+{
+    OnEndDrag(GraphCtrl::GetRightDragMode(), x, y);
+}
+
+void GraphNodeHandler::OnBeginDrag(int mode, double x, double y)
+{
+    wxShape *shape = GetShape();
+    GraphCanvas *canvas = wxStaticCast(shape->GetCanvas(), GraphCanvas);
+
+    m_target = NULL;
+    m_offset = wxPoint(int(shape->GetX() - x), int(shape->GetY() - y));
+
+    if (!shape->Selected()) {
+        Select(shape, true, 0);
+        canvas->Update();
+    }
+
+    OnDrag(mode, true, x, y);
+    canvas->CaptureMouse();
+}
+
+void GraphNodeHandler::OnDrag(int mode, bool draw, double x, double y)
+{
+    bool hasNoEntry = m_target && m_sources.empty();
+    int attachment = 0;
+
+    wxShape *shape = GetShape();
+    GraphCanvas *canvas = wxStaticCast(shape->GetCanvas(), GraphCanvas);
+    Graph *graph = canvas->GetGraph();
+
+    if (draw && (mode & Drag_Connect) != 0) {
+        int new_attachment;
+        wxShape *sh =
+            canvas->FindFirstSensitiveShape(x, y, &new_attachment, OP_ALL);
+        GraphNode *target;
+
+        if (sh != NULL && sh != shape)
+            target = wxDynamicCast(GetElement(sh), GraphNode);
+        else
+            target = NULL;
+
+        if (target && graph->IsGroupProxy(*target))
+            target = NULL;
+
+        if (target && target != m_target) {
+            Graph::node_iterator it, end;
+            m_sources.clear();
+
+            for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it) {
+                if (&*it != target &&
+                        !graph->IsGroupProxy(*it) &&
+                        !graph->IsConnected(*it, *target) &&
+                        !(graph->IsAcyclic() &&
+                          graph->WouldCreateCycle(*it, *target)))
+                    m_sources.push_back(&*it);
+            }
+
+            if (!m_sources.empty()) {
+                GraphEvent event(Evt_Graph_Connect_Feedback);
+                event.SetNode(GetNode());
+                event.SetTarget(target);
+                event.SetSources(m_sources);
+                event.SetPosition(wxPoint(int(x), int(y)));
+                graph->SendEvent(event);
+
+                if (!event.IsAllowed())
+                    m_sources.clear();
+            }
+        }
+
+        m_target = target;
+    }
+
+    wxShapeCanvasOverlay overlay(canvas);
+    if (!draw) {
+        // We just needed to erase the overlay drawing.
+        overlay.Reset();
+        return;
+    }
+
+    wxDC& dc = overlay.GetDC();
+    wxPen dottedPen(*wxBLACK, 1, wxPENSTYLE_DOT);
+    dc.SetPen(dottedPen);
+
+    bool needNoEntry = m_target && m_sources.empty();
+
+    if (needNoEntry && !hasNoEntry)
+        canvas->SetCursor(wxCURSOR_NO_ENTRY);
+    else if (!needNoEntry && hasNoEntry)
+        canvas->SetCursor(wxCURSOR_DEFAULT);
+
+    if ((mode & Drag_Connect) != 0 && m_target) {
+        NodeList::iterator it;
+
+        for (it = m_sources.begin(); it != m_sources.end(); ++it) {
+            double xp, yp;
+            (*it)->GetShape()->GetAttachmentPosition(attachment, &xp, &yp);
+            dc.DrawLine(wxCoord(xp), wxCoord(yp), wxCoord(x), wxCoord(y));
+        }
+    }
+    else if ((mode & Drag_Move) != 0) {
+        dc.SetBrush(*wxTRANSPARENT_BRUSH);
+        Graph::node_iterator it, end;
+        double shapeX = shape->GetX();
+        double shapeY = shape->GetY();
+
+        for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it) {
+            wxShape *sh = it->GetShape();
+            double xx = x - shapeX + sh->GetX() + m_offset.x;
+            double yy = y - shapeY + sh->GetY() + m_offset.y;
+
+            canvas->Snap(&xx, &yy);
+            double w, h;
+            sh->GetBoundingBoxMax(&w, &h);
+            sh->OnDrawOutline(dc, xx, yy, w, h);
+        }
+    }
+    else if ((mode && Drag_Connect) != 0) {
+        Graph::node_iterator it, end;
+
+        for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it) {
+            double xp, yp;
+            it->GetShape()->GetAttachmentPosition(attachment, &xp, &yp);
+            dc.DrawLine(wxCoord(xp), wxCoord(yp), wxCoord(x), wxCoord(y));
+        }
+    }
+}
+
+void GraphNodeHandler::OnEndDrag(int mode, double x, double y)
+{
+    wxShape *shape = GetShape();
+    GraphCanvas *canvas = wxStaticCast(shape->GetCanvas(), GraphCanvas);
+    Graph *graph = canvas->GetGraph();
+    canvas->ReleaseIfCaptured();
+
+    if ((mode & Drag_Connect) != 0 && m_target) {
+        if (m_sources.empty()) {
+            canvas->SetCursor(wxCURSOR_DEFAULT);
+        }
+        else {
+            GraphEvent event(Evt_Graph_Connect);
+            event.SetNode(GetNode());
+            event.SetTarget(m_target);
+            event.SetSources(m_sources);
+            event.SetPosition(wxPoint(int(x), int(y)));
+            graph->SendEvent(event);
+
+            if (event.IsAllowed()) {
+                NodeList::iterator it;
+
+                for (it = m_sources.begin(); it != m_sources.end(); ++it)
+                    graph->Add(**it, *m_target);
+            }
+
+            m_target = NULL;
+            m_sources.clear();
+        }
+    }
+    else if ((mode & Drag_Move) != 0) {
+        wxPoint ptOffset = wxPoint(int(x), int(y)) + m_offset -
+                           GetNode()->GetPosition();
+        Graph::node_iterator it, end;
+
+        for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it)
+            it->SetPosition(it->GetPosition() + ptOffset);
+    }
+}
+
+void GraphNodeHandler::OnDraw(wxDC& dc)
+{
+    GraphNode *node = GetNode();
+    dc.SetFont(node->GetFont());
+    node->OnDraw(dc);
+}
+
+void GraphNodeHandler::OnSizingDragLeft(wxControlPoint* pt, bool draw,
+                                        double x, double y,
+                                        int keys, int attachment)
+{
+    GraphElementHandler::OnSizingDragLeft(pt, draw, x, y, keys, attachment);
+}
+
+void GraphNodeHandler::OnSizingEndDragLeft(wxControlPoint* pt,
+                                           double x, double y,
+                                           int keys, int attachment)
+{
+    GraphNode *node = GetNode();
+    wxShape *shape = GetShape();
+    wxDiagram *diagram = shape->GetCanvas()->GetDiagram();
+    node->Refresh();
+    shape->Show(false);
+    diagram->SetQuickEditMode(true);
+    GraphElementHandler::OnSizingEndDragLeft(pt, x, y, keys, attachment);
+    shape->Show(true);
+    diagram->SetQuickEditMode(false);
+    node->SetSize(node->GetSize());
+}
+
+/**
+ * Event handler for edges.
+ */
+class GraphEdgeHandler: public GraphElementHandler
+{
+public:
+    /// Ctor taking an existing shape.
+    GraphEdgeHandler(wxShapeEvtHandler *prev);
+
+protected:
+    /// Overridden base class virtual method.
+    //@{
+    wxRect GetEraseRect() const;
+    inline wxLineShape *GetShape() const;
+    //@}
+};
+
+GraphEdgeHandler::GraphEdgeHandler(wxShapeEvtHandler *prev)
+  : GraphElementHandler(prev)
+{
+}
+
+wxLineShape *GraphEdgeHandler::GetShape() const
+{
+    return static_cast<wxLineShape*>(GraphElementHandler::GetShape());
+};
+
+wxRect GraphEdgeHandler::GetEraseRect() const
+{
+    wxRect rc = GraphHandler::GetEraseRect();
+
+    wxLineShape *line = GetShape();
+    GraphEdge *edge = GetEdge(line);
+
+    wxList& arrows = line->GetArrows();
+    wxList::iterator it;
+    int size = 0;
+
+    for (it = arrows.begin(); it != arrows.end(); ++it) {
+        wxArrowHead *head = static_cast<wxArrowHead*>(*it);
+        size = max(size, int(head->GetSize()));
+    }
+
+    rc.Inflate(size / 2 + edge->GetLineWidth());
+
+    return rc;
+}
+
+// ----------------------------------------------------------------------------
+// GraphNodeShape
+// ----------------------------------------------------------------------------
+
+/**
+ *  Custom rectangle shape.
+ *
+ *  This is the same as wxRectangleShape except that it implements
+ *  GetPerimeterPoint() to account for our slightly different shape.
+ */
+class GraphNodeShape : public wxRectangleShape
+{
+public:
+    /// Overridden base class virtual method.
+    bool GetPerimeterPoint(double x1, double y1,
+                           double x2, double y2,
+                           double *x3, double *y3);
+
+    /**
+     * The font of the label, or NULL if it is drawn in the DC's current
+     * font.
+     */
+    const wxFont *GetLabelFont() const;
+
+    /**
+     * Draw the label as OnDrawContents() does, but leaving the font, text
+     * colour and background mode to the caller.
+     *
+     * Used by the batch renderer, which sets them only when they change.
+     */
+    void DrawLabel(wxDC& dc);
+};
+
+bool GraphNodeShape::GetPerimeterPoint(double x1, double y1,
+                                       double x2, double y2,
+                                       double *x3, double *y3)
+{
+    GraphNode *node = GetNode(this);
+    wxPoint pt1 = wxPoint(int(x1), int(y1));
+    wxPoint pt2 = wxPoint(int(x2), int(y2));
+    wxPoint inside, outside;
+
+    if (node->GetBounds().Contains(pt1)) {
+        inside = pt1;
+        outside = pt2;
+    } else {
+        inside = pt2;
+        outside = pt1;
+    }
+
+    wxPoint pt = GetNode(this)->GetPerimeterPoint(inside, outside);
+
+    *x3 = pt.x;
+    *y3 = pt.y;
+
+    return true;
+}
+
+const wxFont *GraphNodeShape::GetLabelFont() const
+{
+    if (m_regions.GetCount() < 1)
+        return NULL;
+
+    wxShapeRegion *region =
+        static_cast<wxShapeRegion*>(m_regions.GetFirst()->GetData());
+    return region->GetFont();
+}
+
+void GraphNodeShape::DrawLabel(wxDC& dc)
+{
+    if (m_regions.GetCount() < 1)
+        return;
+
+    wxShapeRegion *region =
+        static_cast<wxShapeRegion*>(m_regions.GetFirst()->GetData());
+    double width = m_width - 2 * m_textMarginX;
+    double height = m_height - 2 * m_textMarginY;
+
+    if (!m_formatted) {
+        oglCentreText(dc, &region->GetFormattedText(), m_xpos, m_ypos,
+                      width, height, region->GetFormatMode());
+        m_formatted = true;
+    }
+
+    if (!GetDisableLabel())
+        oglDrawFormattedText(dc, &region->GetFormattedText(), m_xpos, m_ypos,
+                             width, height, region->GetFormatMode());
+}
+
+// ----------------------------------------------------------------------------
+// GraphShapeGeometry
+// ----------------------------------------------------------------------------
+
+/**
+ * Immutable outline shared by every node of a polygon style.
+ *
+ * The points are offsets from the centre at unit scale. Nodes hold a
+ * pointer to one of these and scale it to their own size when drawing and
+ * hit-testing, so no per-node copy of the points is needed.
+ */
+class GraphShapeGeometry
+{
+public:
+    enum { MaxPoints = 8 };
+
+    GraphShapeGeometry(int num_points, const int points[][2]);
+
+    /// A geometry with no points, for default constructed shapes.
+    static const GraphShapeGeometry& Empty();
+
+    int GetCount() const { return m_count; }
+    const wxRealPoint& GetPoint(int i) const { return m_points[i]; }
+    double GetWidth() const { return m_width; }
+    double GetHeight() const { return m_height; }
+
+private:
+    wxRealPoint m_points[MaxPoints];
+    int m_count;
+    double m_width;
+    double m_height;
+};
+
+GraphShapeGeometry::GraphShapeGeometry(int num_points, const int points[][2])
+  : m_count(min(num_points, int(MaxPoints)))
+{
+    wxASSERT(num_points <= MaxPoints);
+
+    double left = 0, top = 0, right = 0, bottom = 0;
+
+    for (int i = 0; i < m_count; i++) {
+        m_points[i] = wxRealPoint(points[i][0], points[i][1]);
+        left = min(left, m_points[i].x);
+        right = max(right, m_points[i].x);
+        top = min(top, m_points[i].y);
+        bottom = max(bottom, m_points[i].y);
+    }
+
+    m_width = right - left;
+    m_height = bottom - top;
+}
+
+const GraphShapeGeometry& GraphShapeGeometry::Empty()
+{
+    static const GraphShapeGeometry empty(0, NULL);
+    return empty;
+}
+
+// ----------------------------------------------------------------------------
+// GraphPolygonShape
+// ----------------------------------------------------------------------------
+
+/**
+ * Polygon node shape drawn from a shared GraphShapeGeometry.
+ *
+ * This behaves like wxPolygonShape, but where that keeps two lists of
+ * heap allocated points per shape, this keeps just its size.
+ */
+class GraphPolygonShape : public wxShape
+{
+public:
+    GraphPolygonShape()
+      : m_geometry(GraphShapeGeometry::Empty()), m_width(0), m_height(0) { }
+    GraphPolygonShape(const GraphShapeGeometry& geometry)
+      : m_geometry(geometry), m_width(0), m_height(0) { }
+
+    /// Overridden base class virtual methods.
+    void GetBoundingBoxMin(double *w, double *h);
+    void SetSize(double x, double y, bool recursive = true);
+    void OnDraw(wxDC& dc);
+    void OnDrawOutline(wxDC& dc, double x, double y, double w, double h);
+    bool HitTest(double x, double y, int *attachment, double *distance);
+    bool GetPerimeterPoint(double x1, double y1,
+                           double x2, double y2,
+                           double *x3, double *y3);
+    int GetNumberOfAttachments() const;
+    bool GetAttachmentPosition(int attachment, double *x, double *y,
+                               int nth = 0, int no_arcs = 1,
+                               wxLineShape *line = NULL);
+    bool AttachmentIsValid(int attachment) const;
+
+private:
+    /// Vertex i scaled to a size of w by h, relative to the centre.
+    wxRealPoint GetPoint(int i, double w, double h) const;
+    wxRealPoint GetPoint(int i) const { return GetPoint(i, m_width, m_height); }
+
+    /// Fill @a points with the vertices scaled to w by h.
+    int GetPoints(wxPoint *points, double w, double h) const;
+
+    const GraphShapeGeometry& m_geometry;
+    double m_width;
+    double m_height;
+
+    DECLARE_DYNAMIC_CLASS(GraphPolygonShape)
+};
+
+IMPLEMENT_DYNAMIC_CLASS(GraphPolygonShape, wxShape)
+
+wxRealPoint GraphPolygonShape::GetPoint(int i, double w, double h) const
+{
+    const wxRealPoint& pt = m_geometry.GetPoint(i);
+    double sx = m_geometry.GetWidth() ? fabs(w / m_geometry.GetWidth()) : 0;
+    double sy = m_geometry.GetHeight() ? fabs(h / m_geometry.GetHeight()) : 0;
+    return wxRealPoint(pt.x * sx, pt.y * sy);
+}
+
+int GraphPolygonShape::GetPoints(wxPoint *points, double w, double h) const
+{
+    int n = m_geometry.GetCount();
+
+    for (int i = 0; i < n; i++) {
+        wxRealPoint pt = GetPoint(i, w, h);
+        points[i] = wxPoint(WXROUND(pt.x), WXROUND(pt.y));
+    }
+
+    return n;
+}
+
+void GraphPolygonShape::GetBoundingBoxMin(double *w, double *h)
+{
+    *w = m_width;
+    *h = m_height;
+}
+
+void GraphPolygonShape::SetSize(double x, double y, bool)
+{
+    SetAttachmentSize(x, y);
+    m_width = fabs(x);
+    m_height = fabs(y);
+    SetDefaultRegionSize();
+}
+
+void GraphPolygonShape::OnDraw(wxDC& dc)
+{
+    wxPoint points[GraphShapeGeometry::MaxPoints];
+    int n = GetPoints(points, m_width, m_height);
+
+    if (m_shadowMode != SHADOW_NONE) {
+        if (m_shadowBrush)
+            dc.SetBrush(*m_shadowBrush);
+        dc.SetPen(*g_oglTransparentPen);
+        dc.DrawPolygon(n, points, WXROUND(m_xpos + m_shadowOffsetX),
+                       WXROUND(m_ypos + m_shadowOffsetY));
+    }
+
+    if (m_pen) {
+        if (m_pen->GetWidth() == 0)
+            dc.SetPen(*g_oglTransparentPen);
+        else
+            dc.SetPen(*m_pen);
+    }
+    if (m_brush)
+        dc.SetBrush(*m_brush);
+
+    dc.DrawPolygon(n, points, WXROUND(m_xpos), WXROUND(m_ypos));
+}
+
+void GraphPolygonShape::OnDrawOutline(wxDC& dc,
+                                      double x, double y,
+                                      double w, double h)
+{
+    wxPoint points[GraphShapeGeometry::MaxPoints];
+    int n = GetPoints(points, w, h);
+
+    dc.SetBrush(*wxTRANSPARENT_BRUSH);
+    dc.DrawPolygon(n, points, WXROUND(x), WXROUND(y));
+}
+
+bool GraphPolygonShape::HitTest(double x, double y,
+                                int *attachment, double *distance)
+{
+    int n = m_geometry.GetCount();
+    bool inside = false;
+
+    // Even-odd crossing test against the scaled outline
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        wxRealPoint a = GetPoint(i), b = GetPoint(j);
+        a.x += m_xpos; a.y += m_ypos;
+        b.x += m_xpos; b.y += m_ypos;
+
+        if ((a.y > y) != (b.y > y) &&
+                x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+
+    if (!inside)
+        return false;
+
+    int nearest_attachment = 0;
+    double nearest = 999999.0;
+
+    for (int i = 0; i < GetNumberOfAttachments(); i++) {
+        double xp, yp;
+        if (GetAttachmentPositionEdge(i, &xp, &yp)) {
+            double l = sqrt((xp - x) * (xp - x) + (yp - y) * (yp - y));
+            if (l < nearest) {
+                nearest = l;
+                nearest_attachment = i;
+            }
+        }
+    }
+
+    *attachment = nearest_attachment;
+    *distance = nearest;
+    return true;
+}
+
+bool GraphPolygonShape::GetPerimeterPoint(double x1, double y1,
+                                          double x2, double y2,
+                                          double *x3, double *y3)
+{
+    int n = m_geometry.GetCount();
+
+    // As wxPolygonShape: oglFindEndForPolyline can't cope with a vertical
+    // line, so connect to the vertex on the vertical if there is one.
+    if (m_attachmentMode == ATTACHMENT_MODE_NONE && x1 == x2) {
+        for (int i = 0; i < n; i++) {
+            wxRealPoint pt = GetPoint(i);
+            if (pt.x == 0.0 && ((y2 > y1 && pt.y > 0.0) ||
+                                (y2 < y1 && pt.y < 0.0))) {
+                *x3 = pt.x + m_xpos;
+                *y3 = pt.y + m_ypos;
+                return true;
+            }
+        }
+    }
+
+    double xpoints[GraphShapeGeometry::MaxPoints];
+    double ypoints[GraphShapeGeometry::MaxPoints];
+
+    for (int i = 0; i < n; i++) {
+        wxRealPoint pt = GetPoint(i);
+        xpoints[i] = pt.x + m_xpos;
+        ypoints[i] = pt.y + m_ypos;
+    }
+
+    oglFindEndForPolyline(n, xpoints, ypoints, x1, y1, x2, y2, x3, y3);
+    return true;
+}
+
+int GraphPolygonShape::GetNumberOfAttachments() const
+{
+    int maxN = m_geometry.GetCount() - 1;
+    wxList::compatibility_iterator node = m_attachmentPoints.GetFirst();
+
+    for (; node; node = node->GetNext()) {
+        wxAttachmentPoint *point = (wxAttachmentPoint *)node->GetData();
+        maxN = max(maxN, point->m_id);
+    }
+
+    return maxN + 1;
+}
+
+bool GraphPolygonShape::GetAttachmentPosition(int attachment,
+                                              double *x, double *y,
+                                              int nth, int no_arcs,
+                                              wxLineShape *line)
+{
+    if (m_attachmentMode == ATTACHMENT_MODE_EDGE &&
+            attachment >= 0 && attachment < m_geometry.GetCount()) {
+        wxRealPoint pt = GetPoint(attachment);
+        *x = pt.x + m_xpos;
+        *y = pt.y + m_ypos;
+        return true;
+    }
+
+    return wxShape::GetAttachmentPosition(attachment, x, y,
+                                          nth, no_arcs, line);
+}
+
+bool GraphPolygonShape::AttachmentIsValid(int attachment) const
+{
+    if (attachment >= 0 && attachment < m_geometry.GetCount())
+        return true;
+
+    wxList::compatibility_iterator node = m_attachmentPoints.GetFirst();
+
+    for (; node; node = node->GetNext()) {
+        wxAttachmentPoint *point = (wxAttachmentPoint *)node->GetData();
+        if (point->m_id == attachment)
+            return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// GraphDiagram
+// ----------------------------------------------------------------------------
+
+namespace impl {
+
+/**
+ * A node packed for the batch renderer.
+ *
+ * Holds everything needed to draw an unselected plain node, copied out of
+ * the node and its shape so that drawing needs no virtual calls.
+ */
+struct CompactNode
+{
+    GraphNodeShape *shape;  ///< The shape, for drawing the label.
+    wxRect rect;            ///< Rounded as wxRectangleShape::OnDraw does.
+    wxUint32 colour;        ///< Pen colour, see PackColour().
+    wxUint32 bgcolour;      ///< Brush colour, see PackColour().
+    wxUint32 textcolour;    ///< Text colour, see PackColour().
+    const wxFont *font;     ///< Label font, NULL for the canvas font.
+};
+
+/// Pack a colour into 32 bits, for cheap comparison.
+inline wxUint32 PackColour(const wxColour& colour)
+{
+    return colour.Red() | colour.Green() << 8 | colour.Blue() << 16 |
+           wxUint32(colour.Alpha()) << 24;
+}
+
+/// Unpack a colour packed by PackColour().
+inline wxColour UnpackColour(wxUint32 rgba)
+{
+    return wxColour(rgba & 0xff, (rgba >> 8) & 0xff,
+                    (rgba >> 16) & 0xff, rgba >> 24);
+}
+
+/**
+ * The bounds of the nodes in drawing order, as used by Graph::HitTest()
+ * and Graph::GetBounds().
+ *
+ * The rectangles are kept as a structure of arrays so that the
+ * wxOGLGeometry kernels can test several at once.
+ */
+struct NodeIndex
+{
+    wxOGLRectBuffer rects;          ///< The nodes' GetBounds().
+    vector<const GraphNode*> nodes; ///< The node of each rectangle.
+
+    /// Empty the index.
+    void Clear() { rects.Clear(); nodes.clear(); }
+
+    /// Add the memory used by the index to @a usage.
+    void GetMemoryUsage(GraphMemoryUsage& usage) const;
+};
+
+void NodeIndex::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    if (nodes.capacity())
+        usage.Add(GraphMemoryUsage::Mem_Shapes,
+                  nodes.capacity() * (sizeof(const GraphNode*) +
+                                      4 * sizeof(double)), 5);
+}
+
+/**
+ * The top level shapes in drawing order, packed for GraphDiagram::Redraw().
+ *
+ * Compact nodes are packed into @c nodes, with their bounds in @c rects for
+ * culling. The other shapes are kept in @c shapes, each drawn just before
+ * the compact node given by the same element of @c breaks.
+ *
+ * The compact nodes are copies made for speed, their shapes still exist, so
+ * the list adds to the memory used by the graph, see GetMemoryUsage().
+ */
+struct DrawList
+{
+    vector<CompactNode> nodes;  ///< The compact nodes.
+    wxOGLRectBuffer rects;      ///< The bounds of the compact nodes.
+    vector<wxShape*> shapes;    ///< The shapes drawn through their handlers.
+    vector<size_t> breaks;      ///< Index into nodes of each shape.
+
+    /// Empty the list.
+    void Clear()
+    {
+        nodes.clear();
+        rects.Clear();
+        shapes.clear();
+        breaks.clear();
+    }
+
+    /// Add the memory used by the list to @a usage.
+    void GetMemoryUsage(GraphMemoryUsage& usage) const;
+};
+
+void DrawList::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    if (nodes.capacity())
+        usage.Add(GraphMemoryUsage::Mem_Shapes,
+                  nodes.capacity() * (sizeof(CompactNode) +
+                                      4 * sizeof(double)), 5);
+    if (shapes.capacity())
+        usage.Add(GraphMemoryUsage::Mem_Shapes,
+                  shapes.capacity() * (sizeof(wxShape*) + sizeof(size_t)), 2);
+}
+
+/**
+ * Diagram represents a collection of shapes.
+ *
+ * This class override wxDiagram virtual methods to ensure that each shape
+ * belonging to the diagram has a custom event handler associated with it.
+ */
+class GraphDiagram : public wxDiagram
+{
+public:
+    /// Default ctor.
+    GraphDiagram() : m_nodeIndexValid(false), m_drawListValid(false) { }
+
+    /**
+     * Override to set up a correct handler for @a shape.
+     *
+     * Calls SetEventHandler() and the base class method.
+     */
+    void AddShape(wxShape *shape, wxShape *addAfter = NULL);
+
+    /**
+     * Override to set up a correct handler for @a shape.
+     *
+     * Calls SetEventHandler() and the base class method.
+     */
+    void InsertShape(wxShape *shape);
+
+    /**
+     * Associate an appropriate custom event handler with the shape.
+     *
+     * Creates a new handler depending on the exact shape type
+     * (ControlPointHandler, GraphNodeHandler, GraphEdgeHandler or GraphHandler
+     * by default) and sets it up as the @a shape event handler.
+     */
+    void SetEventHandler(wxShape *shape);
+
+    /// Override to call Invalidate() and drop the shape from the bundles.
+    void RemoveShape(wxShape *shape);
+    /// Override to call Invalidate() and clear the bundles.
+    void RemoveAllShapes();
+
+    /**
+     * Override Redraw since the default method displays a busy cursor which
+     * flashes on and off during panning.
+     *
+     * Unselected plain nodes (see GraphNode::IsPlainDrawn()) are not drawn
+     * through their shape's handler chain but packed into a draw list which
+     * is kept between paints, culled against the clipping box and drawn by
+     * DrawBatch().
+     *
+     * If the canvas bundles edges, the bundles are drawn first and the
+     * lines drawn as part of them are skipped.
+     */
+    void Redraw(wxDC& dc);
+
+    /**
+     * The bounds of the shown nodes in drawing order, for hit testing.
+     *
+     * Rebuilt on demand after InvalidateNodeIndex().
+     */
+    const NodeIndex& GetNodeIndex();
+
+    /**
+     * Invalidate the node index and the draw list.
+     *
+     * Called when nodes are brought to the front, and by Invalidate().
+     */
+    void InvalidateNodeIndex()
+    {
+        m_nodeIndex.Clear();
+        m_nodeIndexValid = false;
+        InvalidateDrawList();
+    }
+
+    /**
+     * Invalidate the draw list, which holds copies of the nodes' colours
+     * and fonts, and end any zoom preview showing the old diagram.
+     *
+     * Called by GraphElement::Refresh(), which the setters of those call,
+     * and by the other Invalidate methods.
+     */
+    void InvalidateDrawList();
+
+    /**
+     * Invalidate the node index, the draw list and the canvas's edge
+     * bundles.
+     *
+     * Called whenever shapes are added, removed, shown or hidden.
+     */
+    void Invalidate();
+
+    /**
+     * Invalidate the node index, the draw list and the paths of the
+     * canvas's edge bundles, but not the bundles themselves.
+     *
+     * Called by Graph::RefreshBounds() when nodes are moved or resized.
+     */
+    void InvalidatePositions();
+
+    /// Add the memory used by the node index and draw list to @a usage.
+    void GetMemoryUsage(GraphMemoryUsage& usage) const
+    {
+        m_nodeIndex.GetMemoryUsage(usage);
+        m_drawList.GetMemoryUsage(usage);
+    }
+
+private:
+    /**
+     * Return the shape if it can be drawn by DrawBatch(), otherwise NULL.
+     */
+    static GraphNodeShape *GetCompactShape(wxShape *shape);
+
+    /// Rebuild the draw list if it has been invalidated.
+    const DrawList& GetDrawList();
+
+    /// The canvas's edge bundles, or NULL.
+    EdgeBundles *GetBundles() const;
+
+    /**
+     * Draw the compact nodes [begin, end) of the draw list that aren't
+     * culled, returning the number drawn.
+     *
+     * Nodes selected or given another handler since the list was packed
+     * are drawn through their shape instead.
+     */
+    size_t DrawBatch(wxDC& dc, size_t begin, size_t end);
+
+    NodeIndex m_nodeIndex;          ///< Node bounds in drawing order.
+    bool m_nodeIndexValid;          ///< False after InvalidateNodeIndex().
+    DrawList m_drawList;            ///< Redraw()'s packed shapes.
+    bool m_drawListValid;           ///< False after InvalidateDrawList().
+    vector<unsigned char> m_visible; ///< Redraw()'s culling flags.
+};
+
+// The custom behaviour of the wxShapes is achieved using wxShapeEvtHandler
+// objects rather than by overriding wxShape methods. This allows any old
+// wxShape to be used.
+//
+void GraphDiagram::SetEventHandler(wxShape *shape)
+{
+    wxShapeEvtHandler *handler;
+    void *data = shape->GetClientData();
+
+    if (shape->GetClassInfo() == CLASSINFO(wxControlPoint))
+        handler = new ControlPointHandler(shape);
+    else if (wxDynamicCast(data, GraphNode))
+        handler = new GraphNodeHandler(shape);
+    else if (wxDynamicCast(data, GraphElement))
+        handler = new GraphEdgeHandler(shape);
+    else
+        handler = new GraphHandler(shape);
+
+    shape->SetEventHandler(handler);
+}
+
+void GraphDiagram::AddShape(wxShape *shape, wxShape *addAfter)
+{
+    SetEventHandler(shape);
+    wxDiagram::AddShape(shape, addAfter);
+    Invalidate();
+}
+
+void GraphDiagram::InsertShape(wxShape *shape)
+{
+    SetEventHandler(shape);
+    wxDiagram::InsertShape(shape);
+    Invalidate();
+}
+
+void GraphDiagram::RemoveShape(wxShape *shape)
+{
+    EdgeBundles *bundles = GetBundles();
+    if (bundles)
+        bundles->RemoveLine(shape);
+
+    wxDiagram::RemoveShape(shape);
+    Invalidate();
+}
+
+void GraphDiagram::RemoveAllShapes()
+{
+    EdgeBundles *bundles = GetBundles();
+    if (bundles)
+        bundles->Clear();
+
+    wxDiagram::RemoveAllShapes();
+    Invalidate();
+}
+
+void GraphDiagram::InvalidateDrawList()
+{
+    m_drawListValid = false;
+
+    GraphCanvas *canvas = static_cast<GraphCanvas*>(GetCanvas());
+    if (canvas)
+        canvas->EndZoomPreview();
+}
+
+EdgeBundles *GraphDiagram::GetBundles() const
+{
+    GraphCanvas *canvas = static_cast<GraphCanvas*>(GetCanvas());
+    return canvas ? canvas->GetBundles() : NULL;
+}
+
+void GraphDiagram::Invalidate()
+{
+    InvalidateNodeIndex();
+
+    EdgeBundles *bundles = GetBundles();
+    if (bundles)
+        bundles->Invalidate();
+}
+
+void GraphDiagram::InvalidatePositions()
+{
+    InvalidateNodeIndex();
+
+    EdgeBundles *bundles = GetBundles();
+    if (bundles)
+        bundles->InvalidatePaths();
+}
+
+const NodeIndex& GraphDiagram::GetNodeIndex()
+{
+    if (!m_nodeIndexValid && m_shapeList) {
+        GRAPH_PROFILE_SCOPE("GraphDiagram::GetNodeIndex");
+
+        wxList::iterator it;
+        m_nodeIndex.rects.Reserve(m_shapeList->GetCount());
+
+        for (it = m_shapeList->begin(); it != m_shapeList->end(); ++it) {
+            wxShape *shape = static_cast<wxShape*>(*it);
+            GraphNode *node = wxDynamicCast(shape->GetClientData(), GraphNode);
+
+            if (node && shape->IsShown()) {
+                m_nodeIndex.rects.Add(node->GetBounds());
+                m_nodeIndex.nodes.push_back(node);
+            }
+        }
+
+        m_nodeIndexValid = true;
+    }
+
+    return m_nodeIndex;
+}
+
+GraphNodeShape *GraphDiagram::GetCompactShape(wxShape *shape)
+{
+    if (shape->Selected() || !shape->IsShown())
+        return NULL;
+
+    // the handler chain must be just our GraphNodeHandler
+    if (shape->GetEventHandler()->GetPreviousHandler() != shape)
+        return NULL;
+
+    GraphNode *node = wxDynamicCast(shape->GetClientData(), GraphNode);
+    if (!node || !node->IsPlainDrawn())
+        return NULL;
+
+    // Style_Rectangle nodes always have a GraphNodeShape, check that
+    // nothing has been changed on it that DrawBatch() doesn't draw
+    GraphNodeShape *rect = static_cast<GraphNodeShape*>(shape);
+
+    if (rect->GetShadowMode() != SHADOW_NONE ||
+            rect->GetCornerRadius() != 0 ||
+            rect->GetAttachmentMode() == ATTACHMENT_MODE_BRANCHING ||
+            rect->GetChildren().GetCount() != 0)
+        return NULL;
+
+    return rect;
+}
+
+const DrawList& GraphDiagram::GetDrawList()
+{
+    if (!m_drawListValid && m_shapeList) {
+        GRAPH_PROFILE_SCOPE("GraphDiagram::GetDrawList");
+
+        wxList::iterator it;
+        m_drawList.Clear();
+
+        for (it = m_shapeList->begin(); it != m_shapeList->end(); ++it) {
+            wxShape *object = static_cast<wxShape*>(*it);
+
+            if (object->GetParent())
+                continue;
+
+            GraphNodeShape *compact = GetCompactShape(object);
+
+            if (compact) {
+                GraphNode *node = GetNode(compact);
+                wxRect rc = node->GetBounds();
+
+                CompactNode cn = {
+                    compact,
+                    rc,
+                    PackColour(node->GetColour()),
+                    PackColour(node->GetBackgroundColour()),
+                    PackColour(node->GetTextColour()),
+                    compact->GetLabelFont()
+                };
+                m_drawList.nodes.push_back(cn);
+                m_drawList.rects.Add(rc);
+            }
+            else {
+                m_drawList.shapes.push_back(object);
+                m_drawList.breaks.push_back(m_drawList.nodes.size());
+            }
+        }
+
+        m_drawListValid = true;
+    }
+
+    return m_drawList;
+}
+
+size_t GraphDiagram::DrawBatch(wxDC& dc, size_t begin, size_t end)
+{
+    if (begin == end)
+        return 0;
+
+    GRAPH_PROFILE_SCOPE("GraphDiagram::DrawBatch");
+
+    // the DC's state is unknown after drawing shapes, so the first node
+    // drawn sets everything
+    bool reset = true;
+    wxUint32 pen = 0, brush = 0, text = 0;
+    const wxFont *font = NULL;
+    wxFont canvasFont = GetCanvas() ? GetCanvas()->GetFont() : wxNullFont;
+    size_t drawn = 0;
+
+    for (size_t i = begin; i < end; i++) {
+        if (!m_visible[i])
+            continue;
+
+        const CompactNode& cn = m_drawList.nodes[i];
+        GraphNodeShape *shape = cn.shape;
+
+        // cheap checks for the changes that don't invalidate the list
+        if (shape->Selected() || !shape->IsShown() ||
+                shape->GetEventHandler()->GetPreviousHandler() != shape)
+        {
+            if (shape->IsShown()) {
+                shape->Draw(dc);
+                drawn++;
+            }
+            reset = true;
+            continue;
+        }
+
+        drawn++;
+
+        if (reset) {
+            dc.SetBackgroundMode(wxTRANSPARENT);
+            pen = ~cn.colour;
+            brush = ~cn.bgcolour;
+            text = ~cn.textcolour;
+            font = NULL;
+            reset = false;
+        }
+
+        if (cn.colour != pen) {
+            pen = cn.colour;
+            dc.SetPen(wxPen(UnpackColour(pen)));
+        }
+        if (cn.bgcolour != brush) {
+            brush = cn.bgcolour;
+            dc.SetBrush(wxBrush(UnpackColour(brush)));
+        }
+
+        dc.DrawRectangle(cn.rect);
+
+        const wxFont *f = cn.font ? cn.font : &canvasFont;
+        if (f != font) {
+            font = f;
+            if (font->IsOk())
+                dc.SetFont(*font);
+        }
+        if (cn.textcolour != text) {
+            text = cn.textcolour;
+            dc.SetTextForeground(UnpackColour(text));
+        }
+
+        shape->DrawLabel(dc);
+    }
+
+    return drawn;
+}
+
+void GraphDiagram::Redraw(wxDC& dc)
+{
+    GRAPH_PROFILE_SCOPE("GraphDiagram::Redraw");
+
+    if (m_shapeList) {
+        size_t count = 0, culled = 0, batched = 0, hidden = 0, bundled = 0;
+
+        GraphCanvas *canvas = static_cast<GraphCanvas*>(GetCanvas());
+        EdgeBundles *bundles = canvas ? canvas->GetBundles() : NULL;
+
+        if (bundles && bundles->IsEnabled())
+            bundles->Draw(dc);
+        else
+            bundles = NULL;
+
+        const DrawList& list = GetDrawList();
+        size_t n = list.nodes.size();
+
+        // compact nodes outside the clipping box are skipped, the other
+        // shapes are drawn and left to the DC to clip
+        wxRect clip;
+        dc.GetClipBox(clip);
+
+        m_visible.resize(n);
+
+        if (clip.IsEmpty())
+            m_visible.assign(n, 1);
+        else if (n)
+            wxOGLGeometry::FindOverlapping(list.rects,
+                    clip.x, clip.y, clip.x + clip.width, clip.y + clip.height,
+                    &m_visible[0]);
+
+        size_t first = 0;
+
+        for (size_t i = 0; i < list.shapes.size(); i++) {
+            wxShape *object = list.shapes[i];
+
+            // hidden shapes, such as the contents of collapsed groups, are
+            // skipped without breaking the batch
+            if (!object->IsShown()) {
+                hidden++;
+                continue;
+            }
+
+            // likewise the lines drawn as part of a bundle
+            if (bundles && bundles->IsCollapsed(object)) {
+                bundled++;
+                continue;
+            }
+
+            count++;
+            batched += DrawBatch(dc, first, list.breaks[i]);
+            first = list.breaks[i];
+            object->Draw(dc);
+        }
+
+        batched += DrawBatch(dc, first, n);
+
+        count += n;
+        culled = n - batched;
+
+        GRAPH_PROFILE_COUNT("GraphDiagram::Redraw/shapes", count);
+        GRAPH_PROFILE_COUNT("GraphDiagram::Redraw/culled", culled);
+        GRAPH_PROFILE_COUNT("GraphDiagram::Redraw/batched", batched);
+        GRAPH_PROFILE_COUNT("GraphDiagram::Redraw/hidden", hidden);
+        GRAPH_PROFILE_COUNT("GraphDiagram::Redraw/bundled", bundled);
+    }
+}
+
+} // namespace impl
+
+namespace impl {
+
+/**
+ * Abstract interface for iterators over graph elements.
+ *
+ * This is used by GraphIteratorBase to implement its own interface.
+ */
+class GraphIteratorImpl
+{
+public:
+    virtual ~GraphIteratorImpl() { }
+
+    /// Advance the iterator forward.
+    virtual void inc() = 0;
+
+    /// Advance the iterator backwards.
+    virtual void dec() = 0;
+
+    /// Compare two iterators.
+    virtual bool eq(const GraphIteratorImpl& other) const = 0;
+
+    /// Dereference the iterator.
+    virtual GraphElement *get() const = 0;
+
+    /// Create a copy of this iterator polymorphically.
+    virtual GraphIteratorImpl *clone() const = 0;
+};
+
+GraphIteratorBase::GraphIteratorBase(const GraphIteratorBase& it)
+  : m_impl(it.m_impl ? it.m_impl->clone() : NULL)
+{
+}
+
+GraphIteratorBase::~GraphIteratorBase()
+{
+    delete m_impl;
+}
+
+GraphElement& GraphIteratorBase::operator*() const
+{
+    return *m_impl->get();
+}
+
+GraphIteratorBase& GraphIteratorBase::operator=(const GraphIteratorBase& it)
+{
+    if (&it != this) {
+        delete m_impl;
+        m_impl = it.m_impl ? it.m_impl->clone() : NULL;
+    }
+    return *this;
+}
+
+GraphIteratorBase& GraphIteratorBase::operator++()
+{
+    m_impl->inc();
+    return *this;
+}
+
+GraphIteratorBase& GraphIteratorBase::operator--()
+{
+    m_impl->dec();
+    return *this;
+}
+
+bool GraphIteratorBase::operator ==(const GraphIteratorBase& it) const
+{
+    return (m_impl == NULL && it.m_impl == NULL) ||
+           (m_impl != NULL && it.m_impl != NULL && m_impl->eq(*it.m_impl));
+}
+
+} // namespace impl
+
+namespace {
+
+/**
+ * The node shown in place of a collapsed group, see GroupIndex.
+ *
+ * The proxy classes exist so that IsProxy() can recognise them by their
+ * class info alone. They are never announced to the graph's observers.
+ */
+class GroupProxyNode : public GraphNode
+{
+public:
+    /// Ctor taking the name of the group.
+    GroupProxyNode(const wxString& name) : GraphNode(name) { SetGroup(name); }
+
+    DECLARE_CLASS(GroupProxyNode)
+};
+
+IMPLEMENT_CLASS(GroupProxyNode, GraphNode)
+
+/// An edge shown in place of edges to or from a collapsed group.
+class GroupProxyEdge : public GraphEdge
+{
+public:
+    DECLARE_CLASS(GroupProxyEdge)
+};
+
+IMPLEMENT_CLASS(GroupProxyEdge, GraphEdge)
+
+/// Returns true for the nodes and edges standing in for collapsed groups.
+inline bool IsProxy(const GraphElement *element)
+{
+    wxClassInfo *info = element->GetClassInfo();
+    return info == CLASSINFO(GroupProxyNode) ||
+           info == CLASSINFO(GroupProxyEdge);
+}
+
+/**
+ * A concrete iterator over lists of graph elements.
+ *
+ * This class implements the base graph iterator API defined by
+ * GraphIteratorImpl for iteration over graph elements. It supports iterating
+ * over ranges of items (and not all of them) and filtering the kind of items
+ * it returns to the items of the given type and, optionally, to just the
+ * incoming or outgoing edges.
+ */
+class ListIterImpl : public GraphIteratorImpl
+{
+public:
+    /**
+     * Constructor specifying the range to iterate over and filters to apply.
+     *
+     * @param begin The beginning of the range to iterate over.
+     * @param end The end of the range to iterate over.
+     * @param classinfo Type of elements to restrict iteration to, if @c NULL
+     * iterate over elements of any type.
+     * @param which One of IteratorFilter enum elements. By default we iterate
+     * over all elements.
+     * @param node Only used if @a which is InEdges or OutEdges and specifies
+     * the node whose incoming or outgoing edges we want to iterate over.
+     */
+    ListIterImpl(const wxList::iterator& begin,
+                 const wxList::iterator& end,
+                 wxClassInfo *classinfo,
+                 int which = All,
+                 const GraphNode *node = NULL)
+      : m_it(begin),
+        m_end(end),
+        m_classinfo(classinfo == CLASSINFO(GraphElement) ? NULL : classinfo),
+        m_which(which),
+        m_node(node)
+    {
+        while (m_it != m_end && !filter())
+            ++m_it;
+    }
+
+    /**
+     * Return true if the current element should be accepted.
+     *
+     * If false is returned, the iterator ignores the current element.
+     */
+    bool filter()
+    {
+        GraphElement *element = get();
+
+        if (!element)
+            return false;
+
+        if (m_which == Selected && !element->IsSelected())
+            return false;
+
+        // proxies for collapsed groups are not part of the graph, but can be
+        // selected and dragged along with the selection
+        if (m_which != Selected && IsProxy(element))
+            return false;
+
+        if (m_classinfo && !element->IsKindOf(m_classinfo))
+            return false;
+
+        if (m_node && (m_which == InEdges || m_which == OutEdges))
+        {
+            GraphEdge *edge = wxDynamicCast(element, GraphEdge);
+            if (!edge)
+                return false;
+            if (m_which == InEdges)
+                return edge->GetTo() == m_node;
+            else
+                return edge->GetFrom() == m_node;
+        }
+
+        return true;
+    }
+
+    /**
+     * Advance the iterator skipping over unacceptable elements.
+     */
+    void inc()
+    {
+        do {
+            ++m_it;
+        }
+        while (m_it != m_end && !filter());
+    }
+
+    /**
+     * Advance the iterator backwards skipping over unacceptable elements.
+     */
+    void dec()
+    {
+        do {
+            --m_it;
+        }
+        while (!filter());
+    }
+
+    /**
+     * Compare two iterators.
+     *
+     * The comparison doesn't take filter settings into account.
+     */
+    bool eq(const GraphIteratorImpl& other) const
+    {
+        return typeid(other) == typeid(ListIterImpl) &&
+               m_it == static_cast<const ListIterImpl&>(other).m_it;
+    }
+
+    /// Dereference the iterator.
+    GraphElement *get() const
+    {
+        return GetElement(wxStaticCast(*m_it, wxShape));
+    }
+
+    /// Create a copy of this iterator polymorphically.
+    ListIterImpl *clone() const
+    {
+        return new ListIterImpl(*this);
+    }
+
+private:
+    wxList::iterator m_it;      ///< The current iterator position.
+    wxList::iterator m_end;     ///< One past the last valid position.
+    wxClassInfo *m_classinfo;   ///< Type of accepted elements.
+    int m_which;                ///< Kind of elements to include.
+    const GraphNode *m_node;    ///< Node for InEdges/OutEdges filter.
+};
+
+/**
+ * Iterator over edge end points.
+ *
+ * This class iterates over the nodes connected to the given edge.
+ */
+class PairIterImpl : public GraphIteratorImpl
+{
+public:
+    /**
+     * Create an iterator over nodes connected by the given line.
+     *
+     * @param line The line whose terminal nodes we want to iterate over.
+     * @param classinfo The type of the nodes to return or @c NULL if any.
+     * @param end If true, position the iterator to the end initially so that
+     * it's one past the target node. Otherwise it's positioned at the
+     * beginning, i.e. at the source node.
+     */
+    PairIterImpl(wxLineShape *line, wxClassInfo *classinfo, bool end)
+      : m_line(line),
+        m_classinfo(classinfo == CLASSINFO(GraphElement) ? NULL : classinfo)
+    {
+        if (end) {
+            m_pos = 3;
+        } else {
+            m_pos = 0;
+            inc();
+        }
+    }
+
+    /**
+     * Return true if the current element should be accepted.
+     *
+     * If false is returned, the iterator ignores the current element.
+     */
+    bool filter()
+    {
+        GraphElement *element = get();
+        return element && (!m_classinfo || element->IsKindOf(m_classinfo));
+    }
+
+    /**
+     * Advance the iterator skipping over unacceptable elements.
+     */
+    void inc()
+    {
+        do {
+            m_pos++;
+        }
+        while (m_pos < 3 && !filter());
+    }
+
+    /**
+     * Advance the iterator backwards skipping over unacceptable elements.
+     */
+    void dec()
+    {
+        do {
+            m_pos--;
+        }
+        while (m_pos > 0 && !filter());
+    }
+
+    /**
+     * Compare two iterators.
+     *
+     * The comparison doesn't take filter settings (i.e. type of the elements
+     * to accept) into account.
+     */
+    bool eq(const GraphIteratorImpl& other) const
+    {
+        if (typeid(other) != typeid(PairIterImpl))
+            return false;
+        const PairIterImpl& oth = static_cast<const PairIterImpl&>(other);
+        return oth.m_line == m_line && oth.m_pos == m_pos;
+    }
+
+    /// Dereference the iterator.
+    GraphElement *get() const
+    {
+        return GetElement(m_pos == 1 ? m_line->GetFrom() : m_line->GetTo());
+    }
+
+    /// Create a copy of this iterator polymorphically.
+    PairIterImpl *clone() const
+    {
+        return new PairIterImpl(*this);
+    }
+
+private:
+    wxLineShape *m_line;        ///< The connecting edge.
+    wxClassInfo *m_classinfo;   ///< The type of nodes to accept or @c NULL.
+
+    /**
+     * Current position of the iterator.
+     *
+     * This is 0 for the position just before the beginning, 1 for the source
+     * node, 2 for the target one and 3 for the position right after end.
+     */
+    int m_pos;
+};
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// TopologicalOrder
+// ----------------------------------------------------------------------------
+
+namespace impl {
+
+/**
+ * Maintains a topological order of the nodes of a graph in acyclic mode.
+ *
+ * Every node has a position such that all edges go from a lower position to
+ * a higher one. Edges are added using the algorithm of Pearce and Kelly: an
+ * edge agreeing with the order needs no work, otherwise only the nodes with
+ * positions between the edge's ends (the affected region) are searched, and
+ * the ones found are shuffled within the positions they already occupy.
+ *
+ * The class keeps its own adjacency lists indexed by dense node ids so that
+ * the searches don't need to go through the shapes.
+ */
+class TopologicalOrder : public GraphObserver
+{
+public:
+    TopologicalOrder() : m_next(0), m_epoch(0) { }
+
+    /// Initialise from the graph, returns false if it has a cycle.
+    bool Build(Graph& graph);
+
+    /// Returns true if adding the edge from -> to would create a cycle.
+    bool WouldCreateCycle(const GraphNode& from, const GraphNode& to);
+
+    /// Overridden GraphObserver methods.
+    //@{
+    void OnNodeAdded(GraphNode& node);
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    void OnGraphCleared();
+    //@}
+
+private:
+    typedef wxUint32 Index;
+    typedef pair<Index, const GraphEdge*> Link;
+    typedef vector<Link> LinkList;
+
+    enum { npos = Index(-1) };
+
+    /// Return the id of a node, or npos if it isn't known.
+    Index GetId(const GraphNode *node) const;
+    /// Allocate an id and the next position for a node.
+    Index AddNode(const GraphNode *node);
+    /// Start a new search.
+    void NewSearch();
+    /**
+     * Depth first search forwards from @a start through the nodes
+     * positioned before @a target, collecting them in m_forward. Returns
+     * true if @a target is reached.
+     */
+    bool SearchForward(Index start, Index target);
+    /**
+     * Depth first search backwards from @a start through the nodes
+     * positioned after @a lower, collecting them in m_backward.
+     */
+    void SearchBackward(Index start, Index lower);
+    /// Reassign the positions of the nodes found by the searches.
+    void Reorder();
+    /// Reassign positions from zero, keeping the order.
+    void Renumber();
+
+    unordered_map<const GraphNode*, Index> m_ids;   ///< Id of each node.
+    vector<const GraphNode*> m_nodes;   ///< Nodes by id, NULL if unused.
+    vector<Index> m_pos;                ///< Position of each node by id.
+    vector<LinkList> m_out;             ///< Out edges of each node by id.
+    vector<LinkList> m_in;              ///< In edges of each node by id.
+    vector<Index> m_free;               ///< Unused ids.
+    Index m_next;                       ///< Position for the next new node.
+
+    vector<Index> m_mark;               ///< Search in which ids were seen.
+    Index m_epoch;                      ///< The current search.
+    vector<Index> m_stack;              ///< Search stack.
+    vector<Index> m_forward;            ///< Nodes found searching forwards.
+    vector<Index> m_backward;           ///< Nodes found searching backwards.
+
+    DECLARE_NO_COPY_CLASS(TopologicalOrder)
+};
+
+bool TopologicalOrder::Build(Graph& graph)
+{
+    OnGraphCleared();
+
+    Graph::node_iterator it, end;
+
+    for (tie(it, end) = graph.GetNodes(); it != end; ++it) {
+        Index id = AddNode(&*it);
+        GraphNode::iterator i, iend;
+
+        for (tie(i, iend) = it->GetInEdges(); i != iend; ++i)
+            m_in[id].push_back(Link(npos, &*i));
+    }
+
+    // now that all nodes have ids, fill in both directions of the links
+    for (Index id = 0; id < m_nodes.size(); id++) {
+        LinkList& in = m_in[id];
+
+        for (size_t i = 0; i < in.size(); i++) {
+            Index from = GetId(in[i].second->GetFrom());
+            in[i].first = from;
+            m_out[from].push_back(Link(id, in[i].second));
+        }
+    }
+
+    // Kahn's algorithm assigns the initial positions
+    vector<Index> indegree(m_nodes.size());
+    vector<Index> queue;
+    m_next = 0;
+
+    for (Index id = 0; id < m_nodes.size(); id++)
+        if ((indegree[id] = Index(m_in[id].size())) == 0)
+            queue.push_back(id);
+
+    for (size_t i = 0; i < queue.size(); i++) {
+        Index id = queue[i];
+        m_pos[id] = m_next++;
+
+        for (size_t j = 0; j < m_out[id].size(); j++)
+            if (--indegree[m_out[id][j].first] == 0)
+                queue.push_back(m_out[id][j].first);
+    }
+
+    return queue.size() == m_nodes.size();
+}
+
+TopologicalOrder::Index TopologicalOrder::GetId(const GraphNode *node) const
+{
+    unordered_map<const GraphNode*, Index>::const_iterator it = m_ids.find(node);
+    return it != m_ids.end() ? it->second : Index(npos);
+}
+
+TopologicalOrder::Index TopologicalOrder::AddNode(const GraphNode *node)
+{
+    Index id;
 
-    if (!shape->Selected()) {
-        Select(shape, true, 0);
-        canvas->Update();
+    if (m_free.empty()) {
+        id = Index(m_nodes.size());
+        m_nodes.push_back(node);
+        m_pos.push_back(0);
+        m_out.push_back(LinkList());
+        m_in.push_back(LinkList());
+        m_mark.push_back(0);
+    }
+    else {
+        id = m_free.back();
+        m_free.pop_back();
+        m_nodes[id] = node;
     }
 
-    OnDrag(mode, true, x, y);
-    canvas->CaptureMouse();
+    if (m_next == Index(npos))
+        Renumber();
+
+    m_ids[node] = id;
+    m_pos[id] = m_next++;
+    return id;
 }
 
-void GraphNodeHandler::OnDrag(int mode, bool draw, double x, double y)
+void TopologicalOrder::Renumber()
 {
-    bool hasNoEntry = m_target && m_sources.empty();
-    int attachment = 0;
+    vector< pair<Index, Index> > order;
 
-    wxShape *shape = GetShape();
-    GraphCanvas *canvas = wxStaticCast(shape->GetCanvas(), GraphCanvas);
-    Graph *graph = canvas->GetGraph();
+    for (Index id = 0; id < m_nodes.size(); id++)
+        if (m_nodes[id])
+            order.push_back(make_pair(m_pos[id], id));
 
-    if (draw && (mode & Drag_Connect) != 0) {
-        int new_attachment;
-        wxShape *sh =
-            canvas->FindFirstSensitiveShape(x, y, &new_attachment, OP_ALL);
-        GraphNode *target;
+    sort(order.begin(), order.end());
 
-        if (sh != NULL && sh != shape)
-            target = wxDynamicCast(GetElement(sh), GraphNode);
-        else
-            target = NULL;
+    for (m_next = 0; m_next < order.size(); m_next++)
+        m_pos[order[m_next].second] = m_next;
+}
 
-        if (target && target != m_target) {
-            Graph::node_iterator it, end;
-            m_sources.clear();
+void TopologicalOrder::NewSearch()
+{
+    if (++m_epoch == 0) {
+        fill(m_mark.begin(), m_mark.end(), 0);
+        m_epoch = 1;
+    }
+}
 
-            for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it) {
-                if (&*it != target) {
-                    GraphNode::iterator i, iend;
+bool TopologicalOrder::SearchForward(Index start, Index target)
+{
+    Index upper = m_pos[target];
 
-                    for (tie(i, iend) = it->GetEdges(); i != iend; ++i) {
-                        GraphEdge::iterator j, jend;
+    m_forward.clear();
+    m_stack.assign(1, start);
+    m_mark[start] = m_epoch;
 
-                        for (tie(j, jend) = i->GetNodes(); j != jend; ++j)
-                            if (&*j == target)
-                                break;
+    while (!m_stack.empty()) {
+        Index id = m_stack.back();
+        m_stack.pop_back();
+        m_forward.push_back(id);
 
-                        if (j != jend)
-                            break;
-                    }
+        const LinkList& out = m_out[id];
 
-                    if (i == iend)
-                        m_sources.push_back(&*it);
-                }
-            }
+        for (size_t i = 0; i < out.size(); i++) {
+            Index next = out[i].first;
 
-            if (!m_sources.empty()) {
-                GraphEvent event(Evt_Graph_Connect_Feedback);
-                event.SetNode(GetNode());
-                event.SetTarget(target);
-                event.SetSources(m_sources);
-                event.SetPosition(wxPoint(int(x), int(y)));
-                graph->SendEvent(event);
+            if (next == target)
+                return true;
 
-                if (!event.IsAllowed())
-                    m_sources.clear();
+            if (m_mark[next] != m_epoch && m_pos[next] < upper) {
+                m_mark[next] = m_epoch;
+                m_stack.push_back(next);
             }
         }
-
-        m_target = target;
-    }
-
-    wxShapeCanvasOverlay overlay(canvas);
-    if (!draw) {
-        // We just needed to erase the overlay drawing.
-        overlay.Reset();
-        return;
     }
 
-    wxDC& dc = overlay.GetDC();
-    wxPen dottedPen(*wxBLACK, 1, wxPENSTYLE_DOT);
-    dc.SetPen(dottedPen);
-
-    bool needNoEntry = m_target && m_sources.empty();
-
-    if (needNoEntry && !hasNoEntry)
-        canvas->SetCursor(wxCURSOR_NO_ENTRY);
-    else if (!needNoEntry && hasNoEntry)
-        canvas->SetCursor(wxCURSOR_DEFAULT);
+    return false;
+}
 
-    if ((mode & Drag_Connect) != 0 && m_target) {
-        NodeList::iterator it;
+void TopologicalOrder::SearchBackward(Index start, Index lower)
+{
+    m_backward.clear();
+    m_stack.assign(1, start);
+    m_mark[start] = m_epoch;
 
-        for (it = m_sources.begin(); it != m_sources.end(); ++it) {
-            double xp, yp;
-            (*it)->GetShape()->GetAttachmentPosition(attachment, &xp, &yp);
-            dc.DrawLine(wxCoord(xp), wxCoord(yp), wxCoord(x), wxCoord(y));
-        }
-    }
-    else if ((mode & Drag_Move) != 0) {
-        dc.SetBrush(*wxTRANSPARENT_BRUSH);
-        Graph::node_iterator it, end;
-        double shapeX = shape->GetX();
-        double shapeY = shape->GetY();
+    while (!m_stack.empty()) {
+        Index id = m_stack.back();
+        m_stack.pop_back();
+        m_backward.push_back(id);
 
-        for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it) {
-            wxShape *sh = it->GetShape();
-            double xx = x - shapeX + sh->GetX() + m_offset.x;
-            double yy = y - shapeY + sh->GetY() + m_offset.y;
+        const LinkList& in = m_in[id];
 
-            canvas->Snap(&xx, &yy);
-            double w, h;
-            sh->GetBoundingBoxMax(&w, &h);
-            sh->OnDrawOutline(dc, xx, yy, w, h);
-        }
-    }
-    else if ((mode && Drag_Connect) != 0) {
-        Graph::node_iterator it, end;
+        for (size_t i = 0; i < in.size(); i++) {
+            Index prev = in[i].first;
 
-        for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it) {
-            double xp, yp;
-            it->GetShape()->GetAttachmentPosition(attachment, &xp, &yp);
-            dc.DrawLine(wxCoord(xp), wxCoord(yp), wxCoord(x), wxCoord(y));
+            if (m_mark[prev] != m_epoch && m_pos[prev] > lower) {
+                m_mark[prev] = m_epoch;
+                m_stack.push_back(prev);
+            }
         }
     }
 }
 
-void GraphNodeHandler::OnEndDrag(int mode, double x, double y)
+void TopologicalOrder::Reorder()
 {
-    wxShape *shape = GetShape();
-    GraphCanvas *canvas = wxStaticCast(shape->GetCanvas(), GraphCanvas);
-    Graph *graph = canvas->GetGraph();
-    canvas->ReleaseIfCaptured();
+    vector<Index> positions;
+    positions.reserve(m_backward.size() + m_forward.size());
 
-    if ((mode & Drag_Connect) != 0 && m_target) {
-        if (m_sources.empty()) {
-            canvas->SetCursor(wxCURSOR_DEFAULT);
-        }
-        else {
-            GraphEvent event(Evt_Graph_Connect);
-            event.SetNode(GetNode());
-            event.SetTarget(m_target);
-            event.SetSources(m_sources);
-            event.SetPosition(wxPoint(int(x), int(y)));
-            graph->SendEvent(event);
+    // sort each set by position, so that each keeps its relative order
+    vector< pair<Index, Index> > sorted;
 
-            if (event.IsAllowed()) {
-                NodeList::iterator it;
+    for (size_t i = 0; i < m_backward.size(); i++)
+        sorted.push_back(make_pair(m_pos[m_backward[i]], m_backward[i]));
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++)
+        m_backward[i] = sorted[i].second;
 
-                for (it = m_sources.begin(); it != m_sources.end(); ++it)
-                    graph->Add(**it, *m_target);
-            }
+    sorted.clear();
+    for (size_t i = 0; i < m_forward.size(); i++)
+        sorted.push_back(make_pair(m_pos[m_forward[i]], m_forward[i]));
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++)
+        m_forward[i] = sorted[i].second;
 
-            m_target = NULL;
-            m_sources.clear();
-        }
-    }
-    else if ((mode & Drag_Move) != 0) {
-        wxPoint ptOffset = wxPoint(int(x), int(y)) + m_offset -
-                           GetNode()->GetPosition();
-        Graph::node_iterator it, end;
+    // then the nodes reaching the edge's source take the lowest of the
+    // positions, followed by the nodes reachable from its target
+    for (size_t i = 0; i < m_backward.size(); i++)
+        positions.push_back(m_pos[m_backward[i]]);
+    for (size_t i = 0; i < m_forward.size(); i++)
+        positions.push_back(m_pos[m_forward[i]]);
+    sort(positions.begin(), positions.end());
 
-        for (tie(it, end) = graph->GetSelectionNodes(); it != end; ++it)
-            it->SetPosition(it->GetPosition() + ptOffset);
-    }
+    size_t j = 0;
+    for (size_t i = 0; i < m_backward.size(); i++)
+        m_pos[m_backward[i]] = positions[j++];
+    for (size_t i = 0; i < m_forward.size(); i++)
+        m_pos[m_forward[i]] = positions[j++];
 }
 
-void GraphNodeHandler::OnDraw(wxDC& dc)
+bool TopologicalOrder::WouldCreateCycle(const GraphNode& from,
+                                        const GraphNode& to)
 {
-    GraphNode *node = GetNode();
-    dc.SetFont(node->GetFont());
-    node->OnDraw(dc);
-}
+    Index x = GetId(&from), y = GetId(&to);
 
-void GraphNodeHandler::OnSizingDragLeft(wxControlPoint* pt, bool draw,
-                                        double x, double y,
-                                        int keys, int attachment)
-{
-    GraphElementHandler::OnSizingDragLeft(pt, draw, x, y, keys, attachment);
+    if (x == Index(npos) || y == Index(npos))
+        return false;
+    if (x == y)
+        return true;
+    if (m_pos[x] < m_pos[y])
+        return false;
+
+    NewSearch();
+    return SearchForward(y, x);
 }
 
-void GraphNodeHandler::OnSizingEndDragLeft(wxControlPoint* pt,
-                                           double x, double y,
-                                           int keys, int attachment)
+void TopologicalOrder::OnNodeAdded(GraphNode& node)
 {
-    GraphNode *node = GetNode();
-    wxShape *shape = GetShape();
-    wxDiagram *diagram = shape->GetCanvas()->GetDiagram();
-    node->Refresh();
-    shape->Show(false);
-    diagram->SetQuickEditMode(true);
-    GraphElementHandler::OnSizingEndDragLeft(pt, x, y, keys, attachment);
-    shape->Show(true);
-    diagram->SetQuickEditMode(false);
-    node->SetSize(node->GetSize());
+    if (GetId(&node) == Index(npos))
+        AddNode(&node);
 }
 
-/**
- * Event handler for edges.
- */
-class GraphEdgeHandler: public GraphElementHandler
+void TopologicalOrder::OnEdgeAdded(GraphEdge& edge)
 {
-public:
-    /// Ctor taking an existing shape.
-    GraphEdgeHandler(wxShapeEvtHandler *prev);
+    Index x = GetId(edge.GetFrom()), y = GetId(edge.GetTo());
 
-protected:
-    /// Overridden base class virtual method.
-    //@{
-    wxRect GetEraseRect() const;
-    inline wxLineShape *GetShape() const;
-    //@}
-};
+    if (x == Index(npos) || y == Index(npos))
+        return;
 
-GraphEdgeHandler::GraphEdgeHandler(wxShapeEvtHandler *prev)
-  : GraphElementHandler(prev)
-{
-}
+    if (m_pos[x] > m_pos[y]) {
+        NewSearch();
 
-wxLineShape *GraphEdgeHandler::GetShape() const
-{
-    return static_cast<wxLineShape*>(GraphElementHandler::GetShape());
-};
+        if (SearchForward(y, x)) {
+            wxFAIL_MSG(_T("edge creates a cycle in an acyclic graph"));
+        }
+        else {
+            SearchBackward(x, m_pos[y]);
+            Reorder();
+        }
+    }
+    else {
+        wxASSERT_MSG(x != y, _T("edge creates a cycle in an acyclic graph"));
+    }
 
-wxRect GraphEdgeHandler::GetEraseRect() const
+    m_out[x].push_back(Link(y, &edge));
+    m_in[y].push_back(Link(x, &edge));
+}
+
+void TopologicalOrder::OnElementRemoving(GraphElement& element)
 {
-    wxRect rc = GraphHandler::GetEraseRect();
+    GraphEdge *edge = wxDynamicCast(&element, GraphEdge);
 
-    wxLineShape *line = GetShape();
-    GraphEdge *edge = GetEdge(line);
+    if (edge) {
+        // removing an edge never invalidates the order
+        Index x = GetId(edge->GetFrom()), y = GetId(edge->GetTo());
+        if (x == Index(npos) || y == Index(npos))
+            return;
 
-    wxList& arrows = line->GetArrows();
-    wxList::iterator it;
-    int size = 0;
+        LinkList& out = m_out[x];
+        for (size_t i = 0; i < out.size(); i++) {
+            if (out[i].second == edge) {
+                out.erase(out.begin() + i);
+                break;
+            }
+        }
 
-    for (it = arrows.begin(); it != arrows.end(); ++it) {
-        wxArrowHead *head = static_cast<wxArrowHead*>(*it);
-        size = max(size, int(head->GetSize()));
+        LinkList& in = m_in[y];
+        for (size_t i = 0; i < in.size(); i++) {
+            if (in[i].second == edge) {
+                in.erase(in.begin() + i);
+                break;
+            }
+        }
     }
+    else {
+        const GraphNode *node = wxStaticCast(&element, GraphNode);
+        Index id = GetId(node);
+
+        if (id != Index(npos)) {
+            // the node's edges have already been removed
+            m_ids.erase(node);
+            m_nodes[id] = NULL;
+            m_out[id].clear();
+            m_in[id].clear();
+            m_free.push_back(id);
+        }
+    }
+}
 
-    rc.Inflate(size / 2 + edge->GetLineWidth());
-
-    return rc;
+void TopologicalOrder::OnGraphCleared()
+{
+    m_ids.clear();
+    m_nodes.clear();
+    m_pos.clear();
+    m_out.clear();
+    m_in.clear();
+    m_free.clear();
+    m_mark.clear();
+    m_next = 0;
+    m_epoch = 0;
 }
 
+} // namespace impl
+
 // ----------------------------------------------------------------------------
-// GraphNodeShape
+// ConnectionIndex
 // ----------------------------------------------------------------------------
 
+namespace impl {
+
 /**
- *  Custom rectangle shape.
+ * Counts the edges between each ordered pair of nodes, so that
+ * Graph::IsConnected() doesn't need to walk the nodes' edges.
  *
- *  This is the same as wxRectangleShape except that it implements
- *  GetPerimeterPoint() to account for our slightly different shape.
+ * Adding an edge increments its pair's count and removing it decrements it,
+ * dropping the pair at zero.
  */
-class GraphNodeShape : public wxRectangleShape
+class ConnectionIndex : public GraphObserver
 {
 public:
-    /// Overridden base class virtual method.
-    bool GetPerimeterPoint(double x1, double y1,
-                           double x2, double y2,
-                           double *x3, double *y3);
+    ConnectionIndex() { }
+
+    /// Returns the number of edges from -> to.
+    size_t Count(const GraphNode *from, const GraphNode *to) const;
+
+    /// Overridden GraphObserver methods.
+    //@{
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    void OnGraphCleared();
+    //@}
+
+private:
+    typedef pair<const GraphNode*, const GraphNode*> Key;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            hash<const GraphNode*> h;
+            return h(key.first) * 31 + h(key.second);
+        }
+    };
+
+    typedef unordered_map<Key, size_t, KeyHash> CountMap;
+
+    CountMap m_count;       ///< Number of edges for each (from, to) pair.
+
+    DECLARE_NO_COPY_CLASS(ConnectionIndex)
 };
 
-bool GraphNodeShape::GetPerimeterPoint(double x1, double y1,
-                                       double x2, double y2,
-                                       double *x3, double *y3)
+size_t ConnectionIndex::Count(const GraphNode *from, const GraphNode *to) const
 {
-    GraphNode *node = GetNode(this);
-    wxPoint pt1 = wxPoint(int(x1), int(y1));
-    wxPoint pt2 = wxPoint(int(x2), int(y2));
-    wxPoint inside, outside;
+    CountMap::const_iterator it = m_count.find(Key(from, to));
+    return it != m_count.end() ? it->second : 0;
+}
 
-    if (node->GetBounds().Contains(pt1)) {
-        inside = pt1;
-        outside = pt2;
-    } else {
-        inside = pt2;
-        outside = pt1;
-    }
+void ConnectionIndex::OnEdgeAdded(GraphEdge& edge)
+{
+    m_count[Key(edge.GetFrom(), edge.GetTo())]++;
+}
+
+void ConnectionIndex::OnElementRemoving(GraphElement& element)
+{
+    GraphEdge *edge = wxDynamicCast(&element, GraphEdge);
+    if (!edge)
+        return;
 
-    wxPoint pt = GetNode(this)->GetPerimeterPoint(inside, outside);
+    CountMap::iterator it = m_count.find(Key(edge->GetFrom(), edge->GetTo()));
+    wxCHECK_RET(it != m_count.end(), _T("Edge removed was never added"));
 
-    *x3 = pt.x;
-    *y3 = pt.y;
+    if (--it->second == 0)
+        m_count.erase(it);
+}
 
-    return true;
+void ConnectionIndex::OnGraphCleared()
+{
+    m_count.clear();
 }
 
-} // namespace
+} // namespace impl
 
 // ----------------------------------------------------------------------------
-// GraphDiagram
+// GroupIndex
 // ----------------------------------------------------------------------------
 
 namespace impl {
 
 /**
- * Diagram represents a collection of shapes.
+ * The groups of nodes, see GraphNode::SetGroup(), and the proxies shown in
+ * place of the collapsed ones.
  *
- * This class override wxDiagram virtual methods to ensure that each shape
- * belonging to the diagram has a custom event handler associated with it.
+ * Collapsing or expanding a group unroutes the edges of its members, hides
+ * or shows the members, then routes the edges again. Routing an edge shows
+ * it if neither end is hidden, otherwise hides it and, if its ends are in
+ * different places, counts it into the proxy edge between the nodes or
+ * proxies that stand for them. So the work is proportional to the group's
+ * nodes and edges, and the rest of the graph is not visited.
  */
-class GraphDiagram : public wxDiagram
+class GroupIndex : public GraphObserver
 {
 public:
-    /**
-     * Override to set up a correct handler for @a shape.
-     *
-     * Calls SetEventHandler() and the base class method.
-     */
-    void AddShape(wxShape *shape, wxShape *addAfter = NULL);
+    /// Ctor taking the graph and its diagram, which proxies are added to.
+    GroupIndex(Graph *graph, GraphDiagram *diagram)
+      : m_graph(graph), m_diagram(diagram), m_collapsed(0), m_shown(false) { }
 
-    /**
-     * Override to set up a correct handler for @a shape.
-     *
-     * Calls SetEventHandler() and the base class method.
-     */
-    void InsertShape(wxShape *shape);
+    /// Implementations of the Graph methods of the same name.
+    //@{
+    GraphNode *Collapse(const wxString& name);
+    void Expand(const wxString& name);
+    GraphNode *GetProxy(const wxString& name) const;
+    //@}
 
-    /**
-     * Associate an appropriate custom event handler with the shape.
-     *
-     * Creates a new handler depending on the exact shape type
-     * (ControlPointHandler, GraphNodeHandler, GraphEdgeHandler or GraphHandler
-     * by default) and sets it up as the @a shape event handler.
-     */
-    void SetEventHandler(wxShape *shape);
+    /// The node's proxy if it is hidden in a collapsed group, else the node.
+    const GraphNode *GetVisible(const GraphNode *node) const
+        { return Visible(const_cast<GraphNode*>(node)); }
+
+    /// Move a node to the group it now names.
+    void Regroup(GraphNode& node);
+
+    /// Remove all the proxies and forget the groups.
+    void Clear();
+
+    /// Overridden GraphObserver methods.
+    //@{
+    void OnNodeAdded(GraphNode& node);
+    void OnEdgeAdded(GraphEdge& edge);
+    void OnElementRemoving(GraphElement& element);
+    //@}
+
+private:
+    /// A group and, while it's collapsed, its proxy.
+    struct Group
+    {
+        Group() : proxy(NULL) { }
+
+        wxString name;                      ///< The group's name.
+        unordered_set<GraphNode*> members;  ///< The nodes in the group.
+        GraphNode *proxy;                   ///< Proxy, NULL when expanded.
+        wxPoint origin;                     ///< Proxy's position when made.
+    };
+
+    /// The nodes or proxies at the ends of a proxy edge.
+    typedef pair<GraphNode*, GraphNode*> Key;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            hash<GraphNode*> h;
+            return h(key.first) * 31 + h(key.second);
+        }
+    };
+
+    /// A proxy edge and the number of edges it stands for.
+    struct Bundle
+    {
+        GraphEdge *edge;
+        size_t count;
+    };
+
+    typedef map<wxString, Group> GroupMap;
+    typedef unordered_map<const GraphNode*, Group*> NodeMap;
+    typedef unordered_map<Key, Bundle, KeyHash> BundleMap;
+    typedef unordered_map<const GraphEdge*, Key> RouteMap;
+
+    /// The node's proxy if it is hidden in a collapsed group, else the node.
+    GraphNode *Visible(GraphNode *node) const;
+
+    /// The edges of the group's members, each once.
+    void GetEdges(const Group& group, vector<GraphEdge*>& edges) const;
+
+    /// Show or hide an edge according to where its ends are visible.
+    void Route(GraphEdge& edge);
+    /// Take an edge out of the proxy edge it was counted into, if any.
+    void Unroute(GraphEdge& edge);
+
+    /// Add the node to the group it names, hiding it if that is collapsed.
+    void AddMember(GraphNode& node);
+    /// Remove the node from its group, showing it if that was collapsed.
+    void RemoveMember(GraphNode& node);
 
     /**
-     * Override Redraw since the default method displays a busy cursor which
-     * flashes on and off during panning.
+     * Show or hide a member or edge.
+     *
+     * The change is not repainted until Flush(), so that collapsing or
+     * expanding a group invalidates the diagram and repaints just once.
      */
-    void Redraw(wxDC& dc);
+    void Show(GraphElement& element, bool show);
+    /// Invalidate the diagram and repaint the elements shown or hidden.
+    void Flush();
+
+    /// Create the proxy of a group being collapsed.
+    GraphNode *NewProxy(const Group& group);
+    /// Set the proxy's tooltip to describe the group.
+    void UpdateProxy(const Group& group);
+    /// Remove a proxy node or edge from the diagram and delete it.
+    void DeleteProxy(GraphElement *element);
+
+    Graph *m_graph;             ///< The graph, for RefreshBounds().
+    GraphDiagram *m_diagram;    ///< The diagram proxies are shown in.
+    GroupMap m_groups;          ///< The groups that have members.
+    NodeMap m_nodes;            ///< The group of each member.
+    BundleMap m_bundles;        ///< The proxy edges.
+    RouteMap m_routes;          ///< The proxy edge of each hidden edge.
+    size_t m_collapsed;         ///< The number of collapsed groups.
+    bool m_shown;               ///< Show() has changed something.
+    wxRect m_dirty;             ///< Graph area to repaint in Flush().
+
+    DECLARE_NO_COPY_CLASS(GroupIndex)
 };
 
-// The custom behaviour of the wxShapes is achieved using wxShapeEvtHandler
-// objects rather than by overriding wxShape methods. This allows any old
-// wxShape to be used.
-//
-void GraphDiagram::SetEventHandler(wxShape *shape)
+GraphNode *GroupIndex::Visible(GraphNode *node) const
 {
-    wxShapeEvtHandler *handler;
-    void *data = shape->GetClientData();
-
-    if (shape->GetClassInfo() == CLASSINFO(wxControlPoint))
-        handler = new ControlPointHandler(shape);
-    else if (wxDynamicCast(data, GraphNode))
-        handler = new GraphNodeHandler(shape);
-    else if (wxDynamicCast(data, GraphElement))
-        handler = new GraphEdgeHandler(shape);
-    else
-        handler = new GraphHandler(shape);
+    if (!m_collapsed)
+        return node;
 
-    shape->SetEventHandler(handler);
+    NodeMap::const_iterator it = m_nodes.find(node);
+    return it != m_nodes.end() && it->second->proxy ? it->second->proxy : node;
 }
 
-void GraphDiagram::AddShape(wxShape *shape, wxShape *addAfter)
+GraphNode *GroupIndex::GetProxy(const wxString& name) const
 {
-    SetEventHandler(shape);
-    wxDiagram::AddShape(shape, addAfter);
+    GroupMap::const_iterator it = m_groups.find(name);
+    return it != m_groups.end() ? it->second.proxy : NULL;
 }
 
-void GraphDiagram::InsertShape(wxShape *shape)
+void GroupIndex::GetEdges(const Group& group, vector<GraphEdge*>& edges) const
 {
-    SetEventHandler(shape);
-    wxDiagram::InsertShape(shape);
-}
+    unordered_set<GraphEdge*> seen;
+    unordered_set<GraphNode*>::const_iterator it;
 
-void GraphDiagram::Redraw(wxDC& dc)
-{
-    if (m_shapeList) {
-        wxList::iterator it;
+    for (it = group.members.begin(); it != group.members.end(); ++it) {
+        GraphNode::iterator i, end;
 
-        for (it = m_shapeList->begin(); it != m_shapeList->end(); ++it) {
-            wxShape *object = static_cast<wxShape*>(*it);
-            if (!object->GetParent())
-                object->Draw(dc);
-        }
+        for (tie(i, end) = (*it)->GetEdges(); i != end; ++i)
+            if (seen.insert(&*i).second)
+                edges.push_back(&*i);
     }
 }
 
-} // namespace impl
+void GroupIndex::Route(GraphEdge& edge)
+{
+    GraphNode *from = edge.GetFrom(), *to = edge.GetTo();
+    if (!from || !to)
+        return;
 
-namespace impl {
+    GraphNode *visFrom = Visible(from), *visTo = Visible(to);
 
-/**
- * Abstract interface for iterators over graph elements.
- *
- * This is used by GraphIteratorBase to implement its own interface.
- */
-class GraphIteratorImpl
-{
-public:
-    virtual ~GraphIteratorImpl() { }
+    if (visFrom == from && visTo == to) {
+        Show(edge, true);
+        return;
+    }
 
-    /// Advance the iterator forward.
-    virtual void inc() = 0;
+    Show(edge, false);
 
-    /// Advance the iterator backwards.
-    virtual void dec() = 0;
+    // an edge within a collapsed group just disappears
+    if (visFrom == visTo)
+        return;
 
-    /// Compare two iterators.
-    virtual bool eq(const GraphIteratorImpl& other) const = 0;
+    Key key(visFrom, visTo);
+    BundleMap::iterator it = m_bundles.find(key);
 
-    /// Dereference the iterator.
-    virtual GraphElement *get() const = 0;
+    if (it == m_bundles.end()) {
+        GraphEdge *proxy = new GroupProxyEdge;
+        wxLineShape *line = proxy->EnsureShape();
+        m_diagram->InsertShape(line);
+        ShowLine(line, visFrom, visTo);
+        proxy->Refresh();
 
-    /// Create a copy of this iterator polymorphically.
-    virtual GraphIteratorImpl *clone() const = 0;
-};
+        Bundle bundle = { proxy, 0 };
+        it = m_bundles.insert(make_pair(key, bundle)).first;
+    }
 
-GraphIteratorBase::GraphIteratorBase(const GraphIteratorBase& it)
-  : m_impl(it.m_impl ? it.m_impl->clone() : NULL)
+    it->second.count++;
+    m_routes[&edge] = key;
+}
+
+void GroupIndex::Unroute(GraphEdge& edge)
 {
+    RouteMap::iterator it = m_routes.find(&edge);
+    if (it == m_routes.end())
+        return;
+
+    BundleMap::iterator b = m_bundles.find(it->second);
+    m_routes.erase(it);
+
+    if (b != m_bundles.end() && --b->second.count == 0) {
+        DeleteProxy(b->second.edge);
+        m_bundles.erase(b);
+    }
 }
 
-GraphIteratorBase::~GraphIteratorBase()
+void GroupIndex::Show(GraphElement& element, bool show)
 {
-    delete m_impl;
+    wxShape *shape = element.GetShape();
+
+    if (!shape || shape->IsShown() == show)
+        return;
+
+    if (!show)
+        element.Unselect();
+
+    if (GraphHandler *handler = GraphHandler::Get(shape))
+        m_dirty.Union(handler->GetEraseRect());
+
+    shape->Show(show);
+    m_shown = true;
+
+    if (GraphNode *node = wxDynamicCast(&element, GraphNode))
+        m_graph->NotifyShown(*node);
 }
 
-GraphElement& GraphIteratorBase::operator*() const
+void GroupIndex::Flush()
 {
-    return *m_impl->get();
+    if (!m_shown)
+        return;
+
+    m_diagram->Invalidate();
+
+    wxShapeCanvas *canvas = m_diagram->GetCanvas();
+    if (canvas)
+        RefreshGraphArea(canvas, m_dirty);
+
+    m_shown = false;
+    m_dirty = wxRect();
 }
 
-GraphIteratorBase& GraphIteratorBase::operator=(const GraphIteratorBase& it)
+GraphNode *GroupIndex::NewProxy(const Group& group)
 {
-    if (&it != this) {
-        delete m_impl;
-        m_impl = it.m_impl ? it.m_impl->clone() : NULL;
+    wxRect bounds;
+    wxSize size;
+    unordered_set<GraphNode*>::const_iterator it;
+
+    for (it = group.members.begin(); it != group.members.end(); ++it) {
+        wxRect rc = (*it)->GetBounds();
+        bounds.Union(rc);
+        size.IncTo((*it)->GetSize());
     }
-    return *this;
+
+    GraphNode *proxy = new GroupProxyNode(group.name);
+    m_diagram->AddShape(proxy->EnsureShape());
+    proxy->SetPosition(wxPoint(bounds.x + bounds.width / 2,
+                               bounds.y + bounds.height / 2));
+    proxy->SetSize(size);
+
+    return proxy;
 }
 
-GraphIteratorBase& GraphIteratorBase::operator++()
+void GroupIndex::UpdateProxy(const Group& group)
 {
-    m_impl->inc();
-    return *this;
+    if (group.proxy)
+        group.proxy->SetToolTip(wxString::Format(_("%s (%lu nodes)"),
+                group.name, (unsigned long)group.members.size()));
 }
 
-GraphIteratorBase& GraphIteratorBase::operator--()
+void GroupIndex::DeleteProxy(GraphElement *element)
 {
-    m_impl->dec();
-    return *this;
+    GraphEdge *edge = wxDynamicCast(element, GraphEdge);
+    if (edge)
+        edge->GetShape()->Unlink();
+
+    wxShape *shape = element->GetShape();
+    if (shape->GetCanvas()) {
+        element->Refresh();
+        if (shape->Selected())
+            shape->Select(false);
+    }
+    m_diagram->RemoveShape(shape);
+    delete element;
 }
 
-bool GraphIteratorBase::operator ==(const GraphIteratorBase& it) const
+GraphNode *GroupIndex::Collapse(const wxString& name)
 {
-    return (m_impl == NULL && it.m_impl == NULL) ||
-           (m_impl != NULL && it.m_impl != NULL && m_impl->eq(*it.m_impl));
-}
+    GroupMap::iterator g = m_groups.find(name);
+    if (g == m_groups.end())
+        return NULL;
 
-} // namespace impl
+    Group& group = g->second;
+    if (group.proxy)
+        return group.proxy;
 
-namespace {
+    GRAPH_PROFILE_SCOPE("GroupIndex::Collapse");
 
-/**
- * A concrete iterator over lists of graph elements.
- *
- * This class implements the base graph iterator API defined by
- * GraphIteratorImpl for iteration over graph elements. It supports iterating
- * over ranges of items (and not all of them) and filtering the kind of items
- * it returns to the items of the given type and, optionally, to just the
- * incoming or outgoing edges.
- */
-class ListIterImpl : public GraphIteratorImpl
-{
-public:
-    /**
-     * Constructor specifying the range to iterate over and filters to apply.
-     *
-     * @param begin The beginning of the range to iterate over.
-     * @param end The end of the range to iterate over.
-     * @param classinfo Type of elements to restrict iteration to, if @c NULL
-     * iterate over elements of any type.
-     * @param which One of IteratorFilter enum elements. By default we iterate
-     * over all elements.
-     * @param node Only used if @a which is InEdges or OutEdges and specifies
-     * the node whose incoming or outgoing edges we want to iterate over.
-     */
-    ListIterImpl(const wxList::iterator& begin,
-                 const wxList::iterator& end,
-                 wxClassInfo *classinfo,
-                 int which = All,
-                 const GraphNode *node = NULL)
-      : m_it(begin),
-        m_end(end),
-        m_classinfo(classinfo == CLASSINFO(GraphElement) ? NULL : classinfo),
-        m_which(which),
-        m_node(node)
-    {
-        while (m_it != m_end && !filter())
-            ++m_it;
-    }
+    vector<GraphEdge*> edges;
+    vector<GraphEdge*>::iterator e;
+    GetEdges(group, edges);
 
-    /**
-     * Return true if the current element should be accepted.
-     *
-     * If false is returned, the iterator ignores the current element.
-     */
-    bool filter()
-    {
-        GraphElement *element = get();
+    for (e = edges.begin(); e != edges.end(); ++e)
+        Unroute(**e);
 
-        if (!element)
-            return false;
+    unordered_set<GraphNode*>::iterator it;
+    for (it = group.members.begin(); it != group.members.end(); ++it)
+        Show(**it, false);
 
-        if (m_which == Selected && !element->IsSelected())
-            return false;
+    group.proxy = NewProxy(group);
+    group.origin = group.proxy->GetPosition();
+    m_collapsed++;
+    UpdateProxy(group);
 
-        if (m_classinfo && !element->IsKindOf(m_classinfo))
-            return false;
+    for (e = edges.begin(); e != edges.end(); ++e)
+        Route(**e);
 
-        if (m_node && (m_which == InEdges || m_which == OutEdges))
-        {
-            GraphEdge *edge = wxDynamicCast(element, GraphEdge);
-            if (!edge)
-                return false;
-            if (m_which == InEdges)
-                return edge->GetTo() == m_node;
-            else
-                return edge->GetFrom() == m_node;
-        }
+    Flush();
+    m_graph->RefreshBounds();
 
-        return true;
-    }
+    return group.proxy;
+}
 
-    /**
-     * Advance the iterator skipping over unacceptable elements.
-     */
-    void inc()
-    {
-        do {
-            ++m_it;
-        }
-        while (m_it != m_end && !filter());
-    }
+void GroupIndex::Expand(const wxString& name)
+{
+    GroupMap::iterator g = m_groups.find(name);
+    if (g == m_groups.end() || !g->second.proxy)
+        return;
 
-    /**
-     * Advance the iterator backwards skipping over unacceptable elements.
-     */
-    void dec()
-    {
-        do {
-            --m_it;
-        }
-        while (!filter());
-    }
+    GRAPH_PROFILE_SCOPE("GroupIndex::Expand");
 
-    /**
-     * Compare two iterators.
-     *
-     * The comparison doesn't take filter settings into account.
-     */
-    bool eq(const GraphIteratorImpl& other) const
-    {
-        return typeid(other) == typeid(ListIterImpl) &&
-               m_it == static_cast<const ListIterImpl&>(other).m_it;
-    }
+    Group& group = g->second;
+    vector<GraphEdge*> edges;
+    vector<GraphEdge*>::iterator e;
+    GetEdges(group, edges);
 
-    /// Dereference the iterator.
-    GraphElement *get() const
-    {
-        return GetElement(wxStaticCast(*m_it, wxShape));
-    }
+    for (e = edges.begin(); e != edges.end(); ++e)
+        Unroute(**e);
 
-    /// Create a copy of this iterator polymorphically.
-    ListIterImpl *clone() const
-    {
-        return new ListIterImpl(*this);
+    // the members follow the proxy if it was moved while collapsed
+    wxPoint offset = group.proxy->GetPosition() - group.origin;
+
+    DeleteProxy(group.proxy);
+    group.proxy = NULL;
+    m_collapsed--;
+
+    unordered_set<GraphNode*>::iterator it;
+    for (it = group.members.begin(); it != group.members.end(); ++it) {
+        if (offset != wxPoint())
+            (*it)->SetPosition((*it)->GetPosition() + offset);
+        Show(**it, true);
     }
 
-private:
-    wxList::iterator m_it;      ///< The current iterator position.
-    wxList::iterator m_end;     ///< One past the last valid position.
-    wxClassInfo *m_classinfo;   ///< Type of accepted elements.
-    int m_which;                ///< Kind of elements to include.
-    const GraphNode *m_node;    ///< Node for InEdges/OutEdges filter.
-};
+    for (e = edges.begin(); e != edges.end(); ++e)
+        Route(**e);
 
-/**
- * Iterator over edge end points.
- *
- * This class iterates over the nodes connected to the given edge.
- */
-class PairIterImpl : public GraphIteratorImpl
+    Flush();
+    m_graph->RefreshBounds();
+}
+
+void GroupIndex::AddMember(GraphNode& node)
 {
-public:
-    /**
-     * Create an iterator over nodes connected by the given line.
-     *
-     * @param line The line whose terminal nodes we want to iterate over.
-     * @param classinfo The type of the nodes to return or @c NULL if any.
-     * @param end If true, position the iterator to the end initially so that
-     * it's one past the target node. Otherwise it's positioned at the
-     * beginning, i.e. at the source node.
-     */
-    PairIterImpl(wxLineShape *line, wxClassInfo *classinfo, bool end)
-      : m_line(line),
-        m_classinfo(classinfo == CLASSINFO(GraphElement) ? NULL : classinfo)
-    {
-        if (end) {
-            m_pos = 3;
-        } else {
-            m_pos = 0;
-            inc();
-        }
-    }
+    wxString name = node.GetGroup();
+    if (name.empty())
+        return;
 
-    /**
-     * Return true if the current element should be accepted.
-     *
-     * If false is returned, the iterator ignores the current element.
-     */
-    bool filter()
-    {
-        GraphElement *element = get();
-        return element && (!m_classinfo || element->IsKindOf(m_classinfo));
-    }
+    Group& group = m_groups[name];
+    group.name = name;
+    group.members.insert(&node);
+    m_nodes[&node] = &group;
 
-    /**
-     * Advance the iterator skipping over unacceptable elements.
-     */
-    void inc()
-    {
-        do {
-            m_pos++;
-        }
-        while (m_pos < 3 && !filter());
+    if (group.proxy) {
+        Show(node, false);
+        UpdateProxy(group);
+        m_graph->RefreshBounds();
     }
+}
 
-    /**
-     * Advance the iterator backwards skipping over unacceptable elements.
-     */
-    void dec()
-    {
-        do {
-            m_pos--;
+void GroupIndex::RemoveMember(GraphNode& node)
+{
+    NodeMap::iterator it = m_nodes.find(&node);
+    if (it == m_nodes.end())
+        return;
+
+    Group *group = it->second;
+    m_nodes.erase(it);
+    group->members.erase(&node);
+
+    if (group->proxy) {
+        Show(node, true);
+
+        // the node's edges have been unrouted, so an empty group's proxy
+        // has no edges left
+        if (group->members.empty()) {
+            DeleteProxy(group->proxy);
+            group->proxy = NULL;
+            m_collapsed--;
+        }
+        else {
+            UpdateProxy(*group);
         }
-        while (m_pos > 0 && !filter());
-    }
 
-    /**
-     * Compare two iterators.
-     *
-     * The comparison doesn't take filter settings (i.e. type of the elements
-     * to accept) into account.
-     */
-    bool eq(const GraphIteratorImpl& other) const
-    {
-        if (typeid(other) != typeid(PairIterImpl))
-            return false;
-        const PairIterImpl& oth = static_cast<const PairIterImpl&>(other);
-        return oth.m_line == m_line && oth.m_pos == m_pos;
+        m_graph->RefreshBounds();
     }
 
-    /// Dereference the iterator.
-    GraphElement *get() const
-    {
-        return GetElement(m_pos == 1 ? m_line->GetFrom() : m_line->GetTo());
-    }
+    if (group->members.empty())
+        m_groups.erase(group->name);
+}
 
-    /// Create a copy of this iterator polymorphically.
-    PairIterImpl *clone() const
-    {
-        return new PairIterImpl(*this);
+void GroupIndex::Regroup(GraphNode& node)
+{
+    NodeMap::iterator it = m_nodes.find(&node);
+    if (it != m_nodes.end() && it->second->name == node.GetGroup())
+        return;
+
+    vector<GraphEdge*> edges;
+    vector<GraphEdge*>::iterator e;
+    GraphNode::iterator i, end;
+
+    for (tie(i, end) = node.GetEdges(); i != end; ++i)
+        edges.push_back(&*i);
+
+    for (e = edges.begin(); e != edges.end(); ++e)
+        Unroute(**e);
+
+    RemoveMember(node);
+    AddMember(node);
+
+    for (e = edges.begin(); e != edges.end(); ++e)
+        Route(**e);
+
+    Flush();
+}
+
+void GroupIndex::Clear()
+{
+    BundleMap::iterator b;
+    for (b = m_bundles.begin(); b != m_bundles.end(); ++b)
+        DeleteProxy(b->second.edge);
+
+    GroupMap::iterator g;
+    for (g = m_groups.begin(); g != m_groups.end(); ++g)
+        if (g->second.proxy)
+            DeleteProxy(g->second.proxy);
+
+    m_bundles.clear();
+    m_routes.clear();
+    m_nodes.clear();
+    m_groups.clear();
+    m_collapsed = 0;
+    m_shown = false;
+    m_dirty = wxRect();
+}
+
+void GroupIndex::OnNodeAdded(GraphNode& node)
+{
+    AddMember(node);
+    Flush();
+}
+
+void GroupIndex::OnEdgeAdded(GraphEdge& edge)
+{
+    if (m_collapsed) {
+        Route(edge);
+        Flush();
     }
+}
 
-private:
-    wxLineShape *m_line;        ///< The connecting edge.
-    wxClassInfo *m_classinfo;   ///< The type of nodes to accept or @c NULL.
+void GroupIndex::OnElementRemoving(GraphElement& element)
+{
+    GraphEdge *edge = wxDynamicCast(&element, GraphEdge);
 
-    /**
-     * Current position of the iterator.
-     *
-     * This is 0 for the position just before the beginning, 1 for the source
-     * node, 2 for the target one and 3 for the position right after end.
-     */
-    int m_pos;
-};
+    // a node's edges are removed before it
+    if (edge)
+        Unroute(*edge);
+    else
+        RemoveMember(static_cast<GraphNode&>(element));
 
-} // namespace
+    Flush();
+}
+
+} // namespace impl
 
 // ----------------------------------------------------------------------------
 // Graph
@@ -2414,44 +5360,245 @@ Graph::Graph(wxEvtHandler *handler)
   : m_diagram(new GraphDiagram),
     m_nodeHit(NULL),
     m_handler(handler),
-    m_dpi(GetScreenDPI())
+    m_dpi(GetScreenDPI()),
+    m_connections(new ConnectionIndex),
+    m_order(NULL)
+{
+    m_groups = new GroupIndex(this, m_diagram);
+
+    // first, so that the other observers can call IsConnected()
+    AddObserver(m_connections);
+    AddObserver(m_groups);
+    New();
+}
+
+Graph::~Graph()
 {
     New();
+
+    while (!m_observers.empty()) {
+        GraphObserver *observer = m_observers.front();
+        m_observers.pop_front();
+        observer->OnGraphDestroyed();
+    }
+
+    delete m_order;
+    delete m_groups;
+    delete m_connections;
+
+    GraphCtrl *ctrl = GetCtrl();
+
+    if (ctrl) {
+        m_diagram->SetCanvas(NULL);
+        ctrl->SetGraph(NULL);
+    }
+    else {
+        delete m_diagram->GetCanvas();
+    }
+
+    delete m_diagram;
+}
+
+void Graph::New()
+{
+    GRAPH_PROFILE_SCOPE("Graph::New");
+
+    // the proxies aren't returned by GetElements()
+    m_groups->Clear();
+
+    // deleting in list order means each shape finds itself at the front of
+    // the diagram's list when it removes itself
+    iterator it, end;
+    for (tie(it, end) = GetElements(); it != end; )
+        delete &*it++;
+
+    m_diagram->DeleteAllShapes();
+
+    // give the pools' chunks back if this was the last graph using them
+    wxOGLPool::Trim();
+
+    wxShapeCanvas *canvas = m_diagram->GetCanvas();
+    if (canvas) {
+        canvas->SetFont(DefaultFont());
+        wxStaticCast(canvas, GraphCanvas)->ScrollTo(wxPoint(0, 0), false);
+    }
+
+    SetGridSpacing(m_dpi.y / 18);
+
+    RefreshBounds();
+
+    list<GraphObserver*>::iterator i = m_observers.begin();
+    while (i != m_observers.end())
+        (*i++)->OnGraphCleared();
+}
+
+void Graph::AddObserver(GraphObserver *observer)
+{
+    wxASSERT(observer != NULL);
+    m_observers.push_back(observer);
+}
+
+void Graph::RemoveObserver(GraphObserver *observer)
+{
+    m_observers.remove(observer);
+}
+
+void Graph::NotifyAdded(GraphElement& element)
+{
+    GraphNode *node = wxDynamicCast(&element, GraphNode);
+    list<GraphObserver*>::iterator i = m_observers.begin();
+
+    // Increment before calling in case the observer removes itself.
+    while (i != m_observers.end()) {
+        GraphObserver *observer = *i++;
+        if (node)
+            observer->OnNodeAdded(*node);
+        else
+            observer->OnEdgeAdded(static_cast<GraphEdge&>(element));
+    }
+}
+
+void Graph::NotifyRemoving(GraphElement& element)
+{
+    list<GraphObserver*>::iterator i = m_observers.begin();
+    while (i != m_observers.end())
+        (*i++)->OnElementRemoving(element);
+}
+
+void Graph::NotifyTextChanged(GraphNode& node)
+{
+    if (IsGroupProxy(node))
+        return;
+
+    list<GraphObserver*>::iterator i = m_observers.begin();
+    while (i != m_observers.end())
+        (*i++)->OnNodeTextChanged(node);
+}
+
+void Graph::NotifyMoved(GraphNode& node)
+{
+    if (IsGroupProxy(node))
+        return;
+
+    list<GraphObserver*>::iterator i = m_observers.begin();
+    while (i != m_observers.end())
+        (*i++)->OnNodeMoved(node);
+}
+
+void Graph::NotifyShown(GraphNode& node)
+{
+    if (IsGroupProxy(node))
+        return;
+
+    list<GraphObserver*>::iterator i = m_observers.begin();
+    while (i != m_observers.end())
+        (*i++)->OnNodeShown(node);
+}
+
+void Graph::NotifyGroupChanged(GraphNode& node)
+{
+    wxCHECK_RET(!IsGroupProxy(node), _T("A group's proxy can't be regrouped"));
+    m_groups->Regroup(node);
+}
+
+GraphNode *Graph::CollapseGroup(const wxString& name)
+{
+    return m_groups->Collapse(name);
+}
+
+void Graph::ExpandGroup(const wxString& name)
+{
+    m_groups->Expand(name);
+}
+
+GraphNode *Graph::GetGroupProxy(const wxString& name) const
+{
+    return m_groups->GetProxy(name);
+}
+
+bool Graph::IsGroupProxy(const GraphElement& element) const
+{
+    return IsProxy(&element);
+}
+
+bool Graph::IsHidden(const GraphElement& element) const
+{
+    wxShape *shape = element.GetShape();
+    return shape && !shape->IsShown();
 }
 
-Graph::~Graph()
+bool Graph::SetAcyclic(bool acyclic)
 {
-    New();
-    GraphCtrl *ctrl = GetCtrl();
+    if (acyclic == IsAcyclic())
+        return true;
 
-    if (ctrl) {
-        m_diagram->SetCanvas(NULL);
-        ctrl->SetGraph(NULL);
+    if (acyclic) {
+        m_order = new TopologicalOrder;
+
+        if (!m_order->Build(*this)) {
+            delete m_order;
+            m_order = NULL;
+            return false;
+        }
+
+        AddObserver(m_order);
     }
     else {
-        delete m_diagram->GetCanvas();
+        RemoveObserver(m_order);
+        delete m_order;
+        m_order = NULL;
     }
 
-    delete m_diagram;
+    return true;
 }
 
-void Graph::New()
+bool Graph::IsConnected(const GraphNode& from,
+                        const GraphNode& to,
+                        bool directed) const
 {
-    iterator it, end;
-    for (tie(it, end) = GetElements(); it != end; )
-        delete &*it++;
+    return m_connections->Count(&from, &to) != 0 ||
+           (!directed && m_connections->Count(&to, &from) != 0);
+}
 
-    m_diagram->DeleteAllShapes();
+void Graph::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    const_iterator it, end;
 
-    wxShapeCanvas *canvas = m_diagram->GetCanvas();
-    if (canvas) {
-        canvas->SetFont(DefaultFont());
-        wxStaticCast(canvas, GraphCanvas)->ScrollTo(wxPoint(0, 0), false);
-    }
+    for (tie(it, end) = GetElements(); it != end; ++it)
+        it->GetMemoryUsage(usage);
 
-    SetGridSpacing(m_dpi.y / 18);
+    m_diagram->GetMemoryUsage(usage);
+}
 
-    RefreshBounds();
+bool Graph::WouldCreateCycle(const GraphNode& from, const GraphNode& to) const
+{
+    if (m_order)
+        return m_order->WouldCreateCycle(from, to);
+
+    if (&from == &to)
+        return true;
+
+    // look for a path back from 'to' to 'from'
+    set<const GraphNode*> visited;
+    vector<const GraphNode*> stack(1, &to);
+
+    while (!stack.empty()) {
+        const GraphNode *node = stack.back();
+        stack.pop_back();
+
+        GraphNode::const_iterator it, end;
+
+        for (tie(it, end) = node->GetOutEdges(); it != end; ++it) {
+            const GraphNode *next = it->GetTo();
+
+            if (next == &from)
+                return true;
+            if (visited.insert(next).second)
+                stack.push_back(next);
+        }
+    }
+
+    return false;
 }
 
 void Graph::SetEventHandler(wxEvtHandler *handler)
@@ -2475,10 +5622,12 @@ void Graph::SendEvent(wxEvent& event)
 wxRect Graph::GetBounds() const
 {
     if (m_rcBounds.IsEmpty()) {
-        const_node_iterator it, end;
+        double left, top, right, bottom;
 
-        for (tie(it, end) = GetNodes(); it != end; ++it)
-            m_rcBounds.Union(it->GetBounds());
+        if (wxOGLGeometry::GetBounds(m_diagram->GetNodeIndex().rects,
+                                     &left, &top, &right, &bottom))
+            m_rcBounds = wxRect(int(left), int(top),
+                                int(right - left), int(bottom - top));
     }
 
     return m_rcBounds;
@@ -2492,6 +5641,7 @@ void Graph::RefreshBounds()
     m_rcBounds = wxRect();
     m_rcHit = wxRect();
     m_nodeHit = NULL;
+    m_diagram->InvalidatePositions();
 }
 
 void Graph::SetCanvas(GraphCanvas *canvas)
@@ -2584,6 +5734,7 @@ GraphNode *Graph::DoAdd(GraphNode *node,
     m_diagram->AddShape(shape);
     node->SetPosition(pt);
     node->SetSize(size);
+    NotifyAdded(*node);
 
     return node;
 }
@@ -2600,7 +5751,7 @@ GraphEdge *Graph::Add(GraphNode& from, GraphNode& to, GraphEdge *edge)
     GraphNode *dest = event.GetTarget();
     wxASSERT(src != NULL && dest != NULL);
 
-    if (event.IsAllowed())
+    if (event.IsAllowed() && !(m_order && WouldCreateCycle(*src, *dest)))
         return DoAdd(*src, *dest, edge);
 
     delete edge;
@@ -2618,12 +5769,17 @@ GraphEdge *Graph::DoAdd(GraphNode& from, GraphNode& to, GraphEdge *edge)
     m_diagram->InsertShape(line);
     ShowLine(line, &from, &to);
     edge->Refresh();
+    NotifyAdded(*edge);
 
     return edge;
 }
 
 void Graph::Delete(GraphElement *element)
 {
+    // proxies come and go with their groups' collapsing and expanding
+    if (IsGroupProxy(*element))
+        return;
+
     GraphNode *node = wxDynamicCast(element, GraphNode);
 
     if (node) {
@@ -2650,15 +5806,19 @@ void Graph::Delete(GraphElement *element)
         event.SetEdge(edge);
         SendEvent(event);
 
-        if (event.IsAllowed()) {
-            edge->GetShape()->Unlink();
+        if (event.IsAllowed())
             DoDelete(edge);
-        }
     }
 }
 
 void Graph::DoDelete(GraphElement *element)
 {
+    NotifyRemoving(*element);
+
+    GraphEdge *edge = wxDynamicCast(element, GraphEdge);
+    if (edge)
+        edge->GetShape()->Unlink();
+
     wxShape *shape = element->GetShape();
     if (shape->GetCanvas()) {
         element->Refresh();
@@ -2669,6 +5829,16 @@ void Graph::DoDelete(GraphElement *element)
     delete element;
 }
 
+void Graph::Discard(GraphElement *element)
+{
+    GraphEdge *edge = wxDynamicCast(element, GraphEdge);
+    if (edge)
+        edge->GetShape()->Unlink();
+
+    m_diagram->RemoveShape(element->GetShape());
+    delete element;
+}
+
 void Graph::Delete(const iterator_pair& range)
 {
     iterator i, endi;
@@ -2680,6 +5850,9 @@ void Graph::Delete(const iterator_pair& range)
         ++i;
         GraphNode *node = wxDynamicCast(element, GraphNode);
 
+        if (IsGroupProxy(*element))
+            continue;
+
         if (node) {
             GraphEvent event(Evt_Graph_Node_Delete);
             event.SetNode(node);
@@ -2712,21 +5885,33 @@ void Graph::Delete(const iterator_pair& range)
 
 const GraphNode *Graph::HitTest(const wxPoint& pt) const
 {
+    GRAPH_PROFILE_SCOPE("Graph::HitTest");
+
     wxRect bounds = GetBounds();
 
     if (!bounds.Contains(pt))
         return NULL;
 
-    if (!m_rcHit.Contains(pt)) {
-        const_node_iterator begin, it;
-        tie(begin, it) = GetNodes();
+    if (m_rcHit.Contains(pt)) {
+        GRAPH_PROFILE_COUNT("Graph::HitTest/hits", 1);
+    }
+    else {
+        GRAPH_PROFILE_COUNT("Graph::HitTest/misses", 1);
+
+        const NodeIndex& index = m_diagram->GetNodeIndex();
+        int i = int(index.nodes.size());
 
         m_rcHit = bounds;
         m_nodeHit = NULL;
 
-        while (it != begin) {
-            const GraphNode& node = *--it;
-            wxRect nb = node.GetBounds();
+        // nodes clear of m_rcHit, not even sharing an edge with it, would
+        // leave it unchanged, so only those touching it are visited
+        while ((i = wxOGLGeometry::FindLastTouching(index.rects, i,
+                        m_rcHit.x, m_rcHit.y,
+                        m_rcHit.x + m_rcHit.width,
+                        m_rcHit.y + m_rcHit.height)) >= 0)
+        {
+            wxRect nb = index.rects.GetRect(i);
 
             if (!nb.Contains(pt)) {
                 wxRect rx, ry;
@@ -2761,7 +5946,7 @@ const GraphNode *Graph::HitTest(const wxPoint& pt) const
             }
             else {
                 m_rcHit.Intersect(nb);
-                m_nodeHit = &node;
+                m_nodeHit = index.nodes[i];
                 break;
             }
         }
@@ -2839,12 +6024,16 @@ bool Graph::Layout(const node_iterator_pair& range,
                    double ranksep,
                    double nodesep)
 {
+    GRAPH_PROFILE_SCOPE("Graph::Layout");
+    GRAPH_PROFILE_NAMED_SCOPE(build, "Graph::Layout/dot");
+
     wxString dot;
 
     // Create a dot file for all the nodes in the range and the edges that
     // connect that. To find the edges, first put all the nodes into a set,
     // then iterate over all the edges of the nodes, looking for the edges
-    // which connect nodes in the set.
+    // which connect nodes in the set. The nodes of a collapsed group are
+    // replaced by its proxy, and their edges by edges of the proxy.
     dot << _T("digraph Project {\n");
     dot << _T("\tnodesep=") << nodesep << _T("\n");
     dot << _T("\tranksep=") << ranksep << _T("\n");
@@ -2858,37 +6047,72 @@ bool Graph::Layout(const node_iterator_pair& range,
     typedef multiset<const GraphNode*, ElementCompare> NodeSet;
     typedef multiset<const GraphEdge*, ElementCompare> EdgeSet;
     typedef set< pair<wxString, const GraphNode*> > RankSet;
+    typedef pair<const GraphNode*, const GraphNode*> NodePair;
+    typedef map<wxString, vector<const GraphNode*> > ClusterMap;
     NodeSet nodeset;
     EdgeSet edgeset;
     RankSet rankset;
+    ClusterMap clusters;
+    vector<const GraphNode*> members;
+    unordered_set<const GraphNode*> visible, external;
+    set<NodePair> pairs;
 
     // First put the nodes into a set. The ElementCompare functor puts them
     // into the order they appear on the screen, which avoids the nodes
     // being randomly reordered on screen.
-    for (tie(i, endi) = range; i != endi; ++i)
-        nodeset.insert(&*i);
+    for (tie(i, endi) = range; i != endi; ++i) {
+        const GraphNode *node = m_groups->GetVisible(&*i);
+        members.push_back(&*i);
+        if (visible.insert(node).second)
+            nodeset.insert(node);
+    }
 
-    // Now iterate over all the edges of all the nodes
-    for (NodeSet::iterator it = nodeset.begin(); it != nodeset.end(); ++it)
+    // Now iterate over all the edges of all the nodes, as the nodes or
+    // proxies they're seen as
+    for (size_t k = 0; k < members.size(); k++)
     {
-        const GraphNode *node = *it;
+        const GraphNode *node = members[k];
         GraphNode::const_iterator j, endj;
-        bool extCon = false;
 
         for (tie(j, endj) = node->GetEdges(); j != endj; ++j)
         {
             const GraphNode *n1 = j->GetFrom(), *n2 = j->GetTo();
+            const GraphNode *v1 = m_groups->GetVisible(n1);
+            const GraphNode *v2 = m_groups->GetVisible(n2);
+            bool proxied = v1 != n1 || v2 != n2;
+
+            // edges within a collapsed group are left out
+            if (proxied && v1 == v2)
+                continue;
 
             // looking for edges which connect nodes in the set
-            if (nodeset.count(n1 != node ? n1 : n2)) {
+            if (visible.count(v1 != m_groups->GetVisible(node) ? v1 : v2)) {
                 // each edge will be found twice, but only add it once
-                if (n1 == node)
+                if (!proxied) {
+                    if (n1 == node)
+                        edgeset.insert(&*j);
+                }
+                // and only one of the edges between the same proxies
+                else if (pairs.insert(NodePair(v1, v2)).second) {
                     edgeset.insert(&*j);
+                }
             }
             else {
-                extCon = true;
+                external.insert(m_groups->GetVisible(node));
             }
         }
+    }
+
+    members.clear();
+    pairs.clear();
+
+    if (fixed)
+        fixed = m_groups->GetVisible(fixed);
+
+    for (NodeSet::iterator it = nodeset.begin(); it != nodeset.end(); ++it)
+    {
+        const GraphNode *node = *it;
+        bool extCon = external.count(node) != 0;
 
         // If the range is a subset of the whole graph, and one of the nodes
         // has an edge to another node outside the range, then hold that
@@ -2911,11 +6135,17 @@ bool Graph::Layout(const node_iterator_pair& range,
             << _T("\", height=\"") << double(size.y) / dpi.y
             << _T("\"]\n");
 
+        // nodes of expanded groups are kept together in clusters, except
+        // those with a rank since dot can't always honour both
         if (!node->GetRank().empty())
             rankset.insert(make_pair(node->GetRank(), node));
+        else if (!node->GetGroup().empty() && !IsGroupProxy(*node))
+            clusters[node->GetGroup()].push_back(node);
     }
 
     nodeset.clear();
+    visible.clear();
+    external.clear();
 
     wxString rank;
     for (RankSet::iterator it = rankset.begin(); it != rankset.end(); ++it)
@@ -2933,17 +6163,29 @@ bool Graph::Layout(const node_iterator_pair& range,
 
     rankset.clear();
 
+    int cluster = 0;
+    for (ClusterMap::iterator it = clusters.begin(); it != clusters.end(); ++it)
+    {
+        dot << _T("\tsubgraph cluster_") << cluster++ << _T(" {\n");
+        for (size_t k = 0; k < it->second.size(); k++)
+            dot << _T("\t\t") << NodeName(*it->second[k]) << _T(";\n");
+        dot << _T("\t}\n");
+    }
+
+    clusters.clear();
+
     // Now add the edges. These are also sorted by ElementCompare into the
     // order they appear on the screen, to avoid the nodes being reordered
     // too much.
     for (EdgeSet::iterator it = edgeset.begin(); it != edgeset.end(); ++it)
-        dot << _T("\t") << NodeName(*(*it)->GetFrom())
-            << _T(" -> ") << NodeName(*(*it)->GetTo())
+        dot << _T("\t") << NodeName(*m_groups->GetVisible((*it)->GetFrom()))
+            << _T(" -> ") << NodeName(*m_groups->GetVisible((*it)->GetTo()))
             << _T(";\n");
 
     dot << _T("}\n");
 
     edgeset.clear();
+    build.Stop();
 
 #ifdef NO_GRAPHVIZ
     wxLogError(_("No layout engine available"));
@@ -2995,15 +6237,21 @@ bool Graph::Layout(const node_iterator_pair& range,
         context = theContext.get();
 
         // parse the dot file
-        graph = agmemread(unconst(dot.mb_str()));
+        {
+            GRAPH_PROFILE_SCOPE("Graph::Layout/parse");
+            graph = agmemread(unconst(dot.mb_str()));
+        }
         wxCHECK(graph, false);
 
         // do the layout
+        GRAPH_PROFILE_SCOPE("Graph::Layout/gvLayout");
         ok = gvLayout(context, graph, (char*)"dot") == 0;
     }
 
     if (ok)
     {
+        GRAPH_PROFILE_SCOPE("Graph::Layout/apply");
+
         double offsetX = 0;
         double offsetY = 0;
 
@@ -3056,7 +6304,8 @@ void Graph::Select(const iterator_pair& range)
 
     while (i != end) {
         j = i++;
-        j->Select();
+        if (!IsHidden(*j))
+            j->Select();
     }
 }
 
@@ -3142,6 +6391,9 @@ bool Graph::Serialise(Archive& archive, const iterator_pair& range)
         tie(it, end) = range;
 
     for ( ; it != end; ++it) {
+        if (IsGroupProxy(*it))
+            continue;
+
         Factory<GraphElement> factory(*it);
 
         if (factory) {
@@ -3229,6 +6481,8 @@ bool Graph::DeserialiseInto(wxInputStream& stream, const wxPoint& pt)
 
 bool Graph::DeserialiseInto(Archive& archive, const wxPoint& pt)
 {
+    GRAPH_PROFILE_SCOPE("Graph::DeserialiseInto");
+
     Archive::Item *item = archive.Get(TAGGRAPH);
     GraphCanvas *canvas = GetCanvas();
 
@@ -3269,10 +6523,22 @@ bool Graph::DeserialiseInto(Archive& archive, const wxPoint& pt)
 
             m_diagram->AddShape(shape);
 
-            if (element->Serialise(*arc))
+            bool ok = element->Serialise(*arc);
+
+            // in acyclic mode drop any edges that would close a cycle, which
+            // mustn't be vetoable as Delete() would be
+            GraphEdge *edge = wxDynamicCast(element, GraphEdge);
+            if (ok && edge && m_order &&
+                    WouldCreateCycle(*edge->GetFrom(), *edge->GetTo()))
+                ok = false;
+
+            if (ok) {
                 element->Layout();
-            else
-                Delete(element);
+                NotifyAdded(*element);
+            }
+            else {
+                Discard(element);
+            }
         }
     }
 
@@ -3396,6 +6662,13 @@ GraphCtrl::GraphCtrl(
   : wxControl(parent, winid, pos, size, style | wxWANTS_CHARS, validator, name),
     m_canvas(new GraphCanvas(this, winid, wxPoint(0, 0), size, 0)),
     m_graph(NULL),
+    m_impact(NULL),
+    m_bundles(NULL),
+    m_hud(NULL),
+    m_zoom(NULL),
+    m_zoommode(Zoom_Immediate),
+    m_zoomdelay(250),
+    m_zoomanim(150),
     m_tiptimer(this),
     m_tipmode(Tip_Enable),
     m_tipdelay(500),
@@ -3408,17 +6681,31 @@ GraphCtrl::GraphCtrl(
 GraphCtrl::~GraphCtrl()
 {
     SetGraph(NULL);
+    delete m_zoom;
+    delete m_hud;
+    if (m_bundles)
+        m_canvas->SetBundles(NULL);
+    delete m_bundles;
+    delete m_impact;
     delete m_canvas;
 }
 
 void GraphCtrl::SetGraph(Graph *graph)
 {
+    if (m_zoom)
+        m_zoom->End(false);
+
     if (m_graph)
         m_graph->SetCanvas(NULL);
 
     m_graph = graph;
     m_canvas->SetGraph(graph);
 
+    if (m_impact)
+        m_impact->SetGraph(graph);
+    if (m_hud)
+        m_hud->SetGraph(graph);
+
     if (graph) {
         m_canvas->SetDiagram(graph->m_diagram);
         graph->SetCanvas(m_canvas);
@@ -3427,6 +6714,9 @@ void GraphCtrl::SetGraph(Graph *graph)
         m_canvas->SetDiagram(NULL);
     }
 
+    if (m_bundles)
+        m_bundles->Update();
+
     Refresh();
 }
 
@@ -3435,38 +6725,259 @@ wxSize GraphCtrl::GetDPI() const
     return GetScreenDPI();
 }
 
+ImpactHighlight *GraphCtrl::GetImpact()
+{
+    if (!m_impact)
+        m_impact = new ImpactHighlight(m_canvas);
+    return m_impact;
+}
+
+void GraphCtrl::SetImpactMode(int mode)
+{
+    if (mode != Impact_None || m_impact)
+        GetImpact()->SetMode(mode);
+}
+
+int GraphCtrl::GetImpactMode() const
+{
+    return m_impact ? m_impact->GetMode() : int(Impact_None);
+}
+
+void GraphCtrl::SetImpactNode(GraphNode *node)
+{
+    GetImpact()->SetSelected(node);
+}
+
+GraphNode *GraphCtrl::GetImpactNode() const
+{
+    return m_impact ? m_impact->GetSelected() : NULL;
+}
+
+void GraphCtrl::SetImpactColours(const wxColour& upstream,
+                                 const wxColour& downstream)
+{
+    GetImpact()->SetColours(upstream, downstream);
+}
+
+EdgeBundles *GraphCtrl::GetBundles()
+{
+    if (!m_bundles) {
+        m_bundles = new EdgeBundles(m_canvas);
+        m_canvas->SetBundles(m_bundles);
+    }
+    return m_bundles;
+}
+
+void GraphCtrl::SetEdgeBundling(bool bundle)
+{
+    if (bundle || m_bundles)
+        GetBundles()->Enable(bundle);
+}
+
+bool GraphCtrl::IsEdgeBundling() const
+{
+    return m_bundles && m_bundles->IsEnabled();
+}
+
+void GraphCtrl::SetBundleThreshold(size_t threshold)
+{
+    GetBundles()->SetThreshold(threshold);
+}
+
+size_t GraphCtrl::GetBundleThreshold() const
+{
+    return m_bundles ? m_bundles->GetThreshold()
+                     : size_t(EdgeBundles::DefaultThreshold);
+}
+
+void GraphCtrl::SetBundleColour(const wxColour& colour)
+{
+    GetBundles()->SetColour(colour);
+}
+
+void GraphCtrl::ShowPerfHud(bool show)
+{
+    if (show && !m_hud) {
+        m_hud = new PerfHud(m_canvas);
+        m_canvas->Refresh();
+    }
+    else if (!show && m_hud) {
+        delete m_hud;
+        m_hud = NULL;
+    }
+}
+
+void GraphCtrl::StartRecording(GraphTrace& trace)
+{
+    trace.Clear();
+
+    if (m_graph)
+        trace.SetGraph(*m_graph);
+
+    trace.SetView(m_canvas->GetClientSize(), GetZoom(), GetScrollPosition());
+    m_canvas->SetTrace(&trace);
+}
+
+void GraphCtrl::StopRecording()
+{
+    m_canvas->SetTrace(NULL);
+}
+
+bool GraphCtrl::IsRecording() const
+{
+    return m_canvas->GetTrace() != NULL;
+}
+
+bool GraphCtrl::ProcessEvent(wxEvent& event)
+{
+    // mouse events are recorded by the canvas before it passes them here
+    if (m_canvas && event.IsKindOf(CLASSINFO(wxKeyEvent)))
+        m_canvas->Record(event);
+
+    return wxControl::ProcessEvent(event);
+}
+
+bool GraphCtrl::Replay(const GraphTrace& trace,
+                       GraphTrace::TimingList *timings)
+{
+    if (!m_graph || IsRecording())
+        return false;
+
+    GRAPH_PROFILE_SCOPE("GraphCtrl::Replay");
+
+    CloseTip();
+    m_canvas->ReleaseIfCaptured();
+
+    wxSize size = trace.GetViewSize();
+    if (size.x > 0 && size.y > 0) {
+        SetClientSize(size);
+        m_canvas->SetSize(GetClientSize());
+    }
+
+    if (!trace.RestoreGraph(*m_graph))
+        return false;
+
+    SetZoom(trace.GetZoom());
+    ScrollTo(trace.GetViewCentre());
+    m_canvas->Update();
+
+    const GraphTrace::EventList& events = trace.GetEvents();
+
+    if (timings) {
+        timings->clear();
+        timings->reserve(events.size());
+    }
+
+    // the handlers that look at the mouse directly see the recorded state
+    wxMouseState state;
+    m_canvas->SetReplayState(&state);
+
+    for (size_t i = 0; i < events.size(); i++) {
+        const GraphTrace::Event& ev = events[i];
+        GraphTrace::Timing timing;
+        wxUint64 start, handled;
+
+        if (ev.IsKey()) {
+            wxKeyEvent key;
+            ev.Get(key);
+            key.SetId(GetId());
+            key.SetEventObject(this);
+            static_cast<wxKeyboardState&>(state) = key;
+
+            start = GraphProfiler::Now();
+            GetEventHandler()->ProcessEvent(key);
+            handled = GraphProfiler::Now();
+        }
+        else {
+            wxMouseEvent mouse;
+            ev.Get(mouse);
+            mouse.SetId(m_canvas->GetId());
+            mouse.SetEventObject(m_canvas);
+            state = mouse;
+            state.SetPosition(m_canvas->ClientToScreen(ev.pos));
+
+            start = GraphProfiler::Now();
+            m_canvas->GetEventHandler()->ProcessEvent(mouse);
+            handled = GraphProfiler::Now();
+        }
+
+        wxIdleEvent idle;
+        GetEventHandler()->ProcessEvent(idle);
+        m_canvas->Update();
+
+        timing.handler = handled - start;
+        timing.update = GraphProfiler::Now() - handled;
+
+        if (timings)
+            timings->push_back(timing);
+    }
+
+    m_canvas->SetReplayState(NULL);
+    m_canvas->ReleaseIfCaptured();
+
+    return true;
+}
+
 void GraphCtrl::SetZoom(double percent)
 {
     SetZoom(percent, wxPoint() + m_canvas->GetClientSize() / 2);
 }
 
 void GraphCtrl::SetZoom(double percent, const wxPoint& ptCentre)
+{
+    wxPoint pt = ptCentre;
+    if (!SendZoomEvent(percent, pt))
+        return;
+
+    if (m_zoom)
+        m_zoom->End(false);
+
+    m_canvas->Zoom(percent, pt);
+}
+
+bool GraphCtrl::SendZoomEvent(double& percent, wxPoint& pt)
 {
     GraphEvent event(Evt_Graph_Ctrl_Zoom, m_canvas->GetId());
     event.SetZoom(percent);
-    event.SetPosition(ptCentre);
+    event.SetPosition(pt);
     event.SetEventObject(m_canvas);
     m_canvas->GetEventHandler()->ProcessEvent(event);
     if (!event.IsAllowed())
-        return;
+        return false;
     percent = event.GetZoom();
-    wxPoint pt = event.GetPosition();
+    pt = event.GetPosition();
+    return true;
+}
 
-    wxClientDC dc(m_canvas);
-    m_canvas->PrepareDC(dc);
-    wxPoint ptGraph(dc.DeviceToLogicalX(pt.x), dc.DeviceToLogicalY(pt.y));
+void GraphCtrl::ZoomBy(double factor, const wxPoint& pt)
+{
+    if (m_zoommode == Zoom_Immediate || !m_graph) {
+        SetZoom(GetZoom() * factor, pt);
+        return;
+    }
 
-    double scale = max(1.0, min(500.0, percent)) / 100.0;
-    m_canvas->SetScale(scale, scale);
+    if (!m_zoom)
+        m_zoom = new ZoomPreview(m_canvas);
 
-    m_canvas->Refresh();
-    m_canvas->SetCheckBounds();
+    // steps taken while animating are from the zoom being moved to
+    double percent = m_zoom->GetTarget() * factor;
+    wxPoint ptZoom = pt;
 
-    m_canvas->PrepareDC(dc);
-    int x = dc.LogicalToDeviceX(ptGraph.x) - pt.x;
-    int y = dc.LogicalToDeviceY(ptGraph.y) - pt.y;
+    if (SendZoomEvent(percent, ptZoom)) {
+        int animate = m_zoommode == Zoom_Animated ? m_zoomanim : 0;
+        m_zoom->ZoomTo(percent, ptZoom, animate, m_zoomdelay);
+    }
+}
+
+void GraphCtrl::SetZoomMode(ZoomMode mode)
+{
+    m_zoommode = mode;
 
-    m_canvas->ScrollByOffset(x, y, false);
+    if (mode == Zoom_Immediate && m_zoom) {
+        m_zoom->End();
+        delete m_zoom;
+        m_zoom = NULL;
+    }
 }
 
 double GraphCtrl::GetZoom() const
@@ -3714,7 +7225,12 @@ void GraphCtrl::OnIdle(wxIdleEvent&)
     if (m_canvas->HasCapture())
         return;
 
-    wxMouseState state = wxGetMouseState();
+    if (m_impact && m_impact->IsStale())
+        m_impact->Update();
+    if (m_bundles && m_bundles->IsStale())
+        m_bundles->Update();
+
+    wxMouseState state = m_canvas->GetMouseState();
 
     if (m_canvas->GetCheckBounds() && !state.LeftIsDown()) {
         m_canvas->CheckBounds();
@@ -3735,6 +7251,14 @@ void GraphCtrl::OnSize(wxSizeEvent&)
 
 void GraphCtrl::OnChar(wxKeyEvent& event)
 {
+    m_canvas->EndZoomPreview();
+
+    if (event.GetKeyCode() == WXK_F12 &&
+            event.GetModifiers() == (wxMOD_CONTROL | wxMOD_SHIFT)) {
+        ShowPerfHud(!IsPerfHudShown());
+        return;
+    }
+
     if (m_graph) {
         int key = event.GetKeyCode();
 
@@ -3776,7 +7300,7 @@ void GraphCtrl::OnMouseWheel(wxMouseEvent& event)
 
     if (zoom) {
         double factor = pow(2.0, lines / 10.0);
-        SetZoom(GetZoom() * factor, event.GetPosition());
+        ZoomBy(factor, event.GetPosition());
     }
     else {
         int orient = event.ShiftDown() ? wxHORIZONTAL : wxVERTICAL;
@@ -3789,6 +7313,10 @@ void GraphCtrl::OnMouseWheel(wxMouseEvent& event)
 void GraphCtrl::OnMouseLeave(wxMouseEvent& event)
 {
     CloseTip(event.GetPosition());
+    if (m_impact)
+        m_impact->SetHover(NULL);
+    if (m_bundles)
+        m_bundles->SetHover(wxDefaultPosition);
     event.Skip();
 }
 
@@ -3815,7 +7343,13 @@ void GraphCtrl::OnMouseMove(wxMouseEvent& event)
         m_tipnode = NULL;
     }
     else {
-        CheckTip(m_canvas->ClientToScreen(event.GetPosition()));
+        wxPoint ptScreen = m_canvas->ClientToScreen(event.GetPosition());
+        CheckTip(ptScreen);
+
+        if (m_graph && m_impact && m_impact->GetMode() != Impact_None)
+            m_impact->SetHover(m_graph->HitTest(ScreenToGraph(ptScreen)));
+        if (m_bundles && m_bundles->IsEnabled())
+            m_bundles->SetHover(ScreenToGraph(ptScreen));
     }
 
     event.Skip();
@@ -3875,6 +7409,16 @@ GraphElement::~GraphElement()
     delete m_shape;
 }
 
+void *GraphElement::operator new(size_t size)
+{
+    return wxOGLPool::Alloc(size);
+}
+
+void GraphElement::operator delete(void *p, size_t size)
+{
+    wxOGLPool::Free(p, size);
+}
+
 GraphElement::GraphElement(const GraphElement& element)
   : wxObject(element),
     wxClientDataContainer(element),
@@ -3984,6 +7528,9 @@ void GraphElement::Refresh()
 {
     wxShapeCanvas *canvas = GetCanvas(m_shape);
     if (canvas) {
+        // the draw list holds copies of the colours and fonts
+        static_cast<GraphDiagram*>(canvas->GetDiagram())->InvalidateDrawList();
+
         wxClientDC dc(canvas);
         canvas->PrepareDC(dc);
         m_shape->Erase(dc);
@@ -4034,6 +7581,12 @@ void GraphElement::DoSelect(bool select)
                 m_shape->OnEraseControlPoints(dc);
                 m_shape->Select(false);
             }
+
+            // a bundled edge is drawn by itself while selected
+            EdgeBundles *bundles =
+                static_cast<GraphCanvas*>(canvas)->GetBundles();
+            if (bundles)
+                bundles->RefreshLines(*m_shape);
         }
     }
 }
@@ -4099,6 +7652,12 @@ bool GraphElement::Serialise(Archive::Item& arc)
     return true;
 }
 
+void GraphElement::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    if (m_shape)
+        usage.AddShape(*m_shape);
+}
+
 // ----------------------------------------------------------------------------
 // GraphEdge
 // ----------------------------------------------------------------------------
@@ -4199,6 +7758,12 @@ bool GraphEdge::MoveFront()
     return true;
 }
 
+void GraphEdge::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    usage.AddObject(GraphMemoryUsage::Mem_Edges, *this);
+    GraphElement::GetMemoryUsage(usage);
+}
+
 bool GraphEdge::Serialise(Archive::Item& arc)
 {
     if (!GraphElement::Serialise(arc))
@@ -4303,7 +7868,11 @@ void GraphNode::DoSelect(bool select)
                 wxRect rc, bounds = GetBounds();
                 Graph::node_iterator begin, it;
 
-                tie(begin, it) = GetGraph()->GetNodes();
+                // a proxy isn't among the nodes to search back to
+                if (GetGraph()->IsGroupProxy(*this))
+                    rc = bounds;
+                else
+                    tie(begin, it) = GetGraph()->GetNodes();
 
                 while (it != begin && &*--it != this)
                     rc.Union(it->GetBounds().Intersect(bounds));
@@ -4316,15 +7885,27 @@ void GraphNode::DoSelect(bool select)
                     canvas->RefreshRect(rc);
                 }
 
-                wxDiagram *diagram = canvas->GetDiagram();
+                GraphDiagram *diagram =
+                    static_cast<GraphDiagram*>(canvas->GetDiagram());
                 wxList *list = diagram->GetShapeList();
                 list->remove(shape);
                 list->push_back(shape);
+                diagram->InvalidateNodeIndex();
             }
             else {
                 shape->OnEraseControlPoints(dc);
                 shape->Select(false);
+
+                // back into the batch
+                static_cast<GraphDiagram*>(canvas->GetDiagram())->
+                    InvalidateDrawList();
             }
+
+            // the bundled edges of a selected node are drawn by themselves
+            EdgeBundles *bundles =
+                static_cast<GraphCanvas*>(canvas)->GetBundles();
+            if (bundles)
+                bundles->RefreshLines(*shape);
         }
     }
 }
@@ -4370,6 +7951,8 @@ void GraphNode::SetStyle(int style)
     static const int diamond[][2] = {
         { 0, -1 }, { 1, 0 }, { 0, 1 }, { -1, 0 }
     };
+    static const GraphShapeGeometry triangleGeometry(WXSIZEOF(triangle), triangle);
+    static const GraphShapeGeometry diamondGeometry(WXSIZEOF(diamond), diamond);
 
     wxShape *shape;
 
@@ -4378,10 +7961,10 @@ void GraphNode::SetStyle(int style)
             shape = new wxEllipseShape;
             break;
         case Style_Triangle:
-            shape = CreatePolygon(WXSIZEOF(triangle), triangle);
+            shape = new GraphPolygonShape(triangleGeometry);
             break;
         case Style_Diamond:
-            shape = CreatePolygon(WXSIZEOF(diamond), diamond);
+            shape = new GraphPolygonShape(diamondGeometry);
             break;
         default:
             shape = new GraphNodeShape;
@@ -4406,6 +7989,12 @@ void GraphNode::Layout()
     }
 }
 
+bool GraphNode::IsPlainDrawn() const
+{
+    return GetStyle() == Style_Rectangle &&
+           GetClassInfo() == CLASSINFO(GraphNode);
+}
+
 void GraphNode::SetPosition(const wxPoint& pt)
 {
     wxShape *shape = GetShape();
@@ -4430,6 +8019,7 @@ void GraphNode::SetPosition(const wxPoint& pt)
             shape->Erase(dc);
             OnLayout(dc);
             graph->RefreshBounds();
+            graph->NotifyMoved(*this);
         }
     }
 }
@@ -4443,6 +8033,7 @@ void GraphNode::DoSetSize(wxDC& dc, const wxSize& size)
     shape->MoveLinks(dc);
     shape->Erase(dc);
     GetGraph()->RefreshBounds();
+    GetGraph()->NotifyMoved(*this);
 }
 
 void GraphNode::SetSize(const wxSize& size)
@@ -4490,6 +8081,16 @@ void GraphNode::SetText(const wxString& text)
         Layout();
         Refresh();
     }
+
+    NotifyTextChanged();
+}
+
+void GraphNode::SetToolTip(const wxString& text)
+{
+    if (text != m_tooltip) {
+        m_tooltip = text;
+        NotifyTextChanged();
+    }
 }
 
 wxString GraphNode::GetToolTip(const wxPoint&) const
@@ -4497,6 +8098,46 @@ wxString GraphNode::GetToolTip(const wxPoint&) const
     return m_tooltip;
 }
 
+void GraphNode::SetRank(const wxString& name)
+{
+    if (name != m_rank) {
+        m_rank = name;
+        NotifyTextChanged();
+    }
+}
+
+void GraphNode::SetGroup(const wxString& name)
+{
+    if (name != m_group) {
+        m_group = name;
+
+        Graph *graph = GetGraph();
+        if (graph)
+            graph->NotifyGroupChanged(*this);
+    }
+}
+
+wxString GraphNode::GetSearchText(int field) const
+{
+    switch (field) {
+        case Search_Text:
+            return GetText();
+        case Search_ToolTip:
+            return GetToolTip();
+        case Search_Rank:
+            return GetRank();
+    }
+
+    return wxEmptyString;
+}
+
+void GraphNode::NotifyTextChanged()
+{
+    Graph *graph = GetGraph();
+    if (graph)
+        graph->NotifyTextChanged(*this);
+}
+
 void GraphNode::SetFont(const wxFont& font)
 {
     m_font = font;
@@ -4609,6 +8250,16 @@ wxPoint GraphNode::GetPerimeterPoint(const wxPoint& inside,
     return pt;
 }
 
+void GraphNode::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    usage.AddObject(GraphMemoryUsage::Mem_Nodes, *this);
+    usage.AddString(GraphMemoryUsage::Mem_Text, m_text);
+    usage.AddString(GraphMemoryUsage::Mem_Text, m_tooltip);
+    usage.AddString(GraphMemoryUsage::Mem_Text, m_rank);
+    usage.AddString(GraphMemoryUsage::Mem_Text, m_group);
+    GraphElement::GetMemoryUsage(usage);
+}
+
 bool GraphNode::Serialise(Archive::Item& arc)
 {
     if (!GraphElement::Serialise(arc))
@@ -4630,6 +8281,7 @@ bool GraphNode::Serialise(Archive::Item& arc)
     arc.Exch(_T("text"), m_text, def.m_text);
     arc.Exch(_T("tooltip"), m_tooltip, def.m_tooltip);
     arc.Exch(_T("rank"), m_rank, def.m_rank);
+    arc.Exch(_T("group"), m_group, def.m_group);
     arc.Exch(_T("position"), position);
     arc.Exch(_T("size"), size);
 
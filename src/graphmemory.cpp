@@ -0,0 +1,219 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphmemory.cpp
+// Purpose:     Accounting of the memory used by graphs and archives
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of GraphMemoryUsage and GetGraphPoolStats().
+ *
+ * Nothing here is exact: string buffers are sized from their capacity, and
+ * the list nodes from the fields a wxList node holds, but it is close enough
+ * to see where the memory goes and to measure the effect of reducing it.
+ */
+
+#include "graphmemory.h"
+#include <wx/ogl/ogl.h>
+
+namespace tt_solutions {
+
+namespace {
+
+// A wxList node holds a key, the data, the next and previous links and a
+// back pointer to the list.
+const size_t ListNodeSize = 5 * sizeof(void*);
+
+// wxRealPoint lists are used for polygon points.
+void AddPoints(GraphMemoryUsage& usage, const wxList *points)
+{
+    if (points) {
+        usage.Add(GraphMemoryUsage::Mem_Shapes, sizeof(wxList));
+        usage.AddList(GraphMemoryUsage::Mem_Shapes, *points);
+        usage.Add(GraphMemoryUsage::Mem_Shapes,
+                  points->GetCount() * sizeof(wxRealPoint),
+                  points->GetCount());
+    }
+}
+
+} // namespace
+
+void GraphMemoryUsage::Add(int category, size_t bytes, size_t allocations)
+{
+    wxASSERT(category >= 0 && category < Num_Categories);
+    m_bytes[category] += bytes;
+    m_allocations[category] += allocations;
+}
+
+void GraphMemoryUsage::AddString(int category, const wxString& str)
+{
+    // short strings fit in the buffer of an empty one
+    static const size_t inplace = wxString().capacity();
+
+    if (str.capacity() > inplace)
+        Add(category, (str.capacity() + 1) * sizeof(wxStringCharType));
+}
+
+void GraphMemoryUsage::AddList(int category, const wxList& list)
+{
+    size_t count = list.GetCount();
+    if (count)
+        Add(category, count * ListNodeSize, count);
+}
+
+void GraphMemoryUsage::AddObject(int category, const wxObject& object)
+{
+    Add(category, object.GetClassInfo()->GetSize());
+}
+
+void GraphMemoryUsage::AddShape(const wxShape& constShape)
+{
+    // OGL's accessors aren't const
+    wxShape& shape = const_cast<wxShape&>(constShape);
+
+    AddObject(Mem_Shapes, shape);
+
+    wxShapeEvtHandler *handler = shape.GetEventHandler();
+    if (handler && handler != &shape)
+        AddObject(Mem_Shapes, *handler);
+
+    // the lines are counted with their edges, only the list is the shape's
+    AddList(Mem_Shapes, shape.GetLines());
+
+    wxList& attachments = shape.GetAttachments();
+    AddList(Mem_Shapes, attachments);
+    Add(Mem_Shapes, attachments.GetCount() * sizeof(wxAttachmentPoint),
+        attachments.GetCount());
+
+    wxList& regions = shape.GetRegions();
+    AddList(Mem_Regions, regions);
+
+    for (wxNode *node = regions.GetFirst(); node; node = node->GetNext()) {
+        wxShapeRegion *region = (wxShapeRegion*)node->GetData();
+        AddObject(Mem_Regions, *region);
+        AddString(Mem_Text, region->GetText());
+        AddString(Mem_Text, region->GetName());
+        AddString(Mem_Text, region->GetColour());
+        AddString(Mem_Text, region->GetPenColour());
+
+        wxList& lines = region->GetFormattedText();
+        AddList(Mem_Regions, lines);
+
+        for (wxNode *n = lines.GetFirst(); n; n = n->GetNext()) {
+            wxShapeTextLine *line = (wxShapeTextLine*)n->GetData();
+            AddObject(Mem_Regions, *line);
+            AddString(Mem_Text, line->GetText());
+        }
+    }
+
+    if (wxLineShape *line = wxDynamicCast(&shape, wxLineShape)) {
+        // a few points are held inline in the line itself
+        wxLinePoints& points = line->GetLinePoints();
+        if (!points.IsInline())
+            Add(Mem_Shapes, points.GetCapacity() * sizeof(wxRealPoint));
+
+        wxList& arrows = line->GetArrows();
+        AddList(Mem_Shapes, arrows);
+
+        for (wxNode *n = arrows.GetFirst(); n; n = n->GetNext()) {
+            wxArrowHead *arrow = (wxArrowHead*)n->GetData();
+            AddObject(Mem_Shapes, *arrow);
+            AddString(Mem_Text, arrow->GetName());
+        }
+    }
+    else if (wxPolygonShape *poly = wxDynamicCast(&shape, wxPolygonShape)) {
+        AddPoints(*this, poly->GetPoints());
+        AddPoints(*this, poly->GetOriginalPoints());
+    }
+
+    wxList& children = shape.GetChildren();
+    AddList(Mem_Shapes, children);
+
+    for (wxNode *n = children.GetFirst(); n; n = n->GetNext())
+        AddShape(*(wxShape*)n->GetData());
+}
+
+void GraphMemoryUsage::AddImage(const wxObject& image,
+                                int width,
+                                int height,
+                                int depth)
+{
+    const void *data = image.GetRefData();
+
+    if (data && m_shared.insert(data).second) {
+        size_t bits = size_t(width) * height * (depth > 0 ? depth : 32);
+        Add(Mem_Images, bits / 8);
+    }
+}
+
+size_t GraphMemoryUsage::GetBytes(int category) const
+{
+    wxASSERT(category >= 0 && category < Num_Categories);
+    return m_bytes[category];
+}
+
+size_t GraphMemoryUsage::GetAllocations(int category) const
+{
+    wxASSERT(category >= 0 && category < Num_Categories);
+    return m_allocations[category];
+}
+
+size_t GraphMemoryUsage::GetTotalBytes() const
+{
+    size_t total = 0;
+    for (int i = 0; i < Num_Categories; i++)
+        total += m_bytes[i];
+    return total;
+}
+
+size_t GraphMemoryUsage::GetTotalAllocations() const
+{
+    size_t total = 0;
+    for (int i = 0; i < Num_Categories; i++)
+        total += m_allocations[i];
+    return total;
+}
+
+wxString GraphMemoryUsage::GetName(int category)
+{
+    static const wxChar *names[] = {
+        _T("nodes"), _T("edges"), _T("shapes"), _T("regions"),
+        _T("text"), _T("images"), _T("archive")
+    };
+
+    wxCOMPILE_TIME_ASSERT(WXSIZEOF(names) == Num_Categories, NamesCount);
+    wxASSERT(category >= 0 && category < Num_Categories);
+
+    return names[category];
+}
+
+void GraphMemoryUsage::Clear()
+{
+    for (int i = 0; i < Num_Categories; i++)
+        m_bytes[i] = m_allocations[i] = 0;
+    m_shared.clear();
+}
+
+GraphPoolStats GetGraphPoolStats()
+{
+    wxOGLPoolStats ogl;
+    wxOGLPool::GetStats(ogl);
+
+    GraphPoolStats stats;
+    stats.allocations = ogl.m_allocations;
+    stats.frees = ogl.m_frees;
+    stats.live = ogl.m_live;
+    stats.liveBytes = ogl.m_liveBytes;
+    stats.chunks = ogl.m_chunks;
+    stats.chunkBytes = ogl.m_chunkBytes;
+    stats.heapAllocations = ogl.m_heapAllocations;
+
+    return stats;
+}
+
+} // namespace tt_solutions
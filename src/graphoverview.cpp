@@ -0,0 +1,475 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphoverview.cpp
+// Purpose:     Overview of a whole graph for navigating a GraphCtrl
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of GraphOverviewCtrl.
+ *
+ * Each node's bounds are cached when it is counted into the grid, so that
+ * when it moves or is removed the cells it covered can be counted down
+ * again without asking the graph. When a node lands outside the grid the
+ * grid is chosen again and recounted from the cache, which is the only
+ * operation proportional to the size of the graph.
+ */
+
+#include "graphoverview.h"
+#include "graphprofile.h"
+
+#include <algorithm>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace {
+
+// A cell covered by this many nodes is drawn in the full node colour.
+const wxUint32 SATURATION = 3;
+
+// Space left around the overview inside the control.
+const int MARGIN = 4;
+
+unsigned char Mix(unsigned char from, unsigned char to, double f)
+{
+    return (unsigned char)(from + (to - from) * f + 0.5);
+}
+
+} // namespace
+
+IMPLEMENT_DYNAMIC_CLASS(GraphOverviewCtrl, wxControl)
+
+BEGIN_EVENT_TABLE(GraphOverviewCtrl, wxControl)
+    EVT_PAINT(GraphOverviewCtrl::OnPaint)
+    EVT_SIZE(GraphOverviewCtrl::OnSize)
+    EVT_LEFT_DOWN(GraphOverviewCtrl::OnMouse)
+    EVT_LEFT_UP(GraphOverviewCtrl::OnMouse)
+    EVT_MOTION(GraphOverviewCtrl::OnMouse)
+    EVT_MOUSE_CAPTURE_LOST(GraphOverviewCtrl::OnCaptureLost)
+    EVT_IDLE(GraphOverviewCtrl::OnIdle)
+END_EVENT_TABLE()
+
+const wxChar GraphOverviewCtrl::DefaultName[] = _T("graphoverviewctrl");
+
+GraphOverviewCtrl::GraphOverviewCtrl(
+        wxWindow *parent,
+        wxWindowID id,
+        const wxPoint& pos,
+        const wxSize& size,
+        long style,
+        const wxString& name)
+  : wxControl(parent, id, pos, size, style, wxDefaultValidator, name)
+{
+    Init();
+    SetBackgroundStyle(wxBG_STYLE_PAINT);
+    SetBackgroundColour(*wxWHITE);
+}
+
+GraphOverviewCtrl::~GraphOverviewCtrl()
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+}
+
+void GraphOverviewCtrl::Init()
+{
+    m_ctrl = NULL;
+    m_graph = NULL;
+    m_cell = 1;
+    m_cols = 0;
+    m_rows = 0;
+    m_stale = false;
+    m_rebuild = false;
+    m_scale = 1;
+    m_viewZoom = 0;
+    m_resolution = 256;
+    m_nodeColour = wxColour(0x50, 0x70, 0xb0);
+    m_viewportColour = *wxRED;
+}
+
+void GraphOverviewCtrl::SetGraphCtrl(GraphCtrl *ctrl)
+{
+    m_ctrl = ctrl;
+    m_viewport = wxRect();
+    m_viewZoom = 0;
+    SetGraph(ctrl ? ctrl->GetGraph() : NULL);
+}
+
+void GraphOverviewCtrl::SetGraph(Graph *graph)
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+
+    m_graph = graph;
+    m_nodes.clear();
+
+    if (m_graph) {
+        m_graph->AddObserver(this);
+
+        Graph::node_iterator it, end;
+        for (tie(it, end) = m_graph->GetNodes(); it != end; ++it)
+            if (!m_graph->IsHidden(*it))
+                m_nodes[&*it] = it->GetBounds();
+    }
+
+    m_rebuild = true;
+    Refresh();
+}
+
+void GraphOverviewCtrl::SetResolution(int cells)
+{
+    m_resolution = max(cells, 8);
+    m_rebuild = true;
+    Refresh();
+}
+
+void GraphOverviewCtrl::SetNodeColour(const wxColour& colour)
+{
+    m_nodeColour = colour;
+    m_rebuild = true;
+    Refresh();
+}
+
+void GraphOverviewCtrl::SetViewportColour(const wxColour& colour)
+{
+    m_viewportColour = colour;
+    Refresh();
+}
+
+void GraphOverviewCtrl::Rebuild()
+{
+    GRAPH_PROFILE_SCOPE("GraphOverviewCtrl::Rebuild");
+
+    m_rebuild = false;
+    m_stale = true;
+    m_grid = wxRect();
+    m_cols = m_rows = 0;
+    m_density.clear();
+    m_image = wxImage();
+
+    wxRect bounds;
+    unordered_map<const GraphNode*, wxRect>::const_iterator it;
+
+    for (it = m_nodes.begin(); it != m_nodes.end(); ++it)
+        bounds.Union(it->second);
+
+    if (bounds.IsEmpty())
+        return;
+
+    // leave room for the graph to grow by an eighth on each side before
+    // the grid has to be chosen again
+    bounds.Inflate(bounds.width / 8 + 1, bounds.height / 8 + 1);
+
+    int longer = max(bounds.width, bounds.height);
+    m_cell = max(1, (longer + m_resolution - 1) / m_resolution);
+    m_cols = (bounds.width + m_cell - 1) / m_cell;
+    m_rows = (bounds.height + m_cell - 1) / m_cell;
+    m_grid = wxRect(bounds.x, bounds.y, m_cols * m_cell, m_rows * m_cell);
+
+    m_density.assign(size_t(m_cols) * m_rows, 0);
+    m_image.Create(m_cols, m_rows, false);
+
+    wxColour bg = GetBackgroundColour();
+    m_image.SetRGB(wxRect(0, 0, m_cols, m_rows), bg.Red(), bg.Green(), bg.Blue());
+
+    for (it = m_nodes.begin(); it != m_nodes.end(); ++it)
+        Count(it->second, 1);
+}
+
+void GraphOverviewCtrl::Count(const wxRect& rc, int delta)
+{
+    // a pending rebuild recounts everything anyway
+    if (m_rebuild || rc.IsEmpty())
+        return;
+
+    if (m_density.empty() || !m_grid.Contains(rc)) {
+        m_rebuild = true;
+        return;
+    }
+
+    int x0 = (rc.x - m_grid.x) / m_cell;
+    int y0 = (rc.y - m_grid.y) / m_cell;
+    int x1 = (rc.GetRight() - m_grid.x) / m_cell;
+    int y1 = (rc.GetBottom() - m_grid.y) / m_cell;
+
+    wxColour bg = GetBackgroundColour();
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            wxUint32& n = m_density[size_t(y) * m_cols + x];
+
+            if (delta < 0 && n < wxUint32(-delta))
+                n = 0;
+            else
+                n += delta;
+
+            double f = double(min(n, SATURATION)) / SATURATION;
+            m_image.SetRGB(x, y, Mix(bg.Red(), m_nodeColour.Red(), f),
+                                 Mix(bg.Green(), m_nodeColour.Green(), f),
+                                 Mix(bg.Blue(), m_nodeColour.Blue(), f));
+        }
+    }
+
+    m_stale = true;
+}
+
+void GraphOverviewCtrl::Update(const GraphNode& node, const wxRect *rc)
+{
+    unordered_map<const GraphNode*, wxRect>::iterator it = m_nodes.find(&node);
+
+    if (it != m_nodes.end()) {
+        Count(it->second, -1);
+        if (rc)
+            it->second = *rc;
+        else
+            m_nodes.erase(it);
+    }
+    else if (rc) {
+        m_nodes[&node] = *rc;
+    }
+
+    if (rc)
+        Count(*rc, 1);
+
+    Refresh();
+}
+
+void GraphOverviewCtrl::Update(const GraphNode& node)
+{
+    if (m_graph && m_graph->IsHidden(node)) {
+        Update(node, NULL);
+    }
+    else {
+        wxRect rc = node.GetBounds();
+        Update(node, &rc);
+    }
+}
+
+void GraphOverviewCtrl::OnNodeAdded(GraphNode& node)
+{
+    Update(node);
+}
+
+void GraphOverviewCtrl::OnNodeMoved(GraphNode& node)
+{
+    Update(node);
+}
+
+void GraphOverviewCtrl::OnNodeShown(GraphNode& node)
+{
+    Update(node);
+}
+
+void GraphOverviewCtrl::OnElementRemoving(GraphElement& element)
+{
+    GraphNode *node = wxDynamicCast(&element, GraphNode);
+    if (node)
+        Update(*node, NULL);
+}
+
+void GraphOverviewCtrl::OnGraphCleared()
+{
+    m_nodes.clear();
+    m_rebuild = true;
+    Refresh();
+}
+
+void GraphOverviewCtrl::OnGraphDestroyed()
+{
+    m_graph = NULL;
+    m_nodes.clear();
+    m_rebuild = true;
+    Refresh();
+}
+
+wxRect GraphOverviewCtrl::GetViewport() const
+{
+    if (!m_ctrl || !m_ctrl->GetGraph())
+        return wxRect();
+
+    wxWindow *canvas = m_ctrl->GetCanvas();
+    wxSize cs = canvas->GetClientSize();
+
+    wxPoint tl = m_ctrl->ScreenToGraph(canvas->ClientToScreen(wxPoint(0, 0)));
+    wxPoint br = m_ctrl->ScreenToGraph(canvas->ClientToScreen(wxPoint(cs.x, cs.y)));
+
+    return wxRect(tl.x, tl.y, br.x - tl.x, br.y - tl.y);
+}
+
+bool GraphOverviewCtrl::UpdateViewport()
+{
+    wxPoint start;
+    double zoom = 0;
+    wxSize size;
+
+    if (m_ctrl && m_ctrl->GetGraph()) {
+        wxWindow *canvas = m_ctrl->GetCanvas();
+        wxScrolledWindow *scrolled = wxDynamicCast(canvas, wxScrolledWindow);
+
+        if (scrolled)
+            start = scrolled->GetViewStart();
+        zoom = m_ctrl->GetZoom();
+        size = canvas->GetClientSize();
+    }
+
+    if (zoom == m_viewZoom && start == m_viewStart && size == m_viewSize)
+        return false;
+
+    m_viewStart = start;
+    m_viewZoom = zoom;
+    m_viewSize = size;
+
+    wxRect viewport = GetViewport();
+    if (viewport == m_viewport)
+        return false;
+
+    m_viewport = viewport;
+    return true;
+}
+
+void GraphOverviewCtrl::UpdateLayout()
+{
+    // the viewport is included so that it can always be seen, even when
+    // scrolled away from the graph
+    m_extent = m_grid;
+    m_extent.Union(m_viewport);
+
+    m_scale = 1;
+    m_offset = wxPoint(MARGIN, MARGIN);
+
+    wxSize cs = GetClientSize() - wxSize(2 * MARGIN, 2 * MARGIN);
+
+    if (m_extent.IsEmpty() || cs.x <= 0 || cs.y <= 0)
+        return;
+
+    m_scale = min(double(cs.x) / m_extent.width,
+                  double(cs.y) / m_extent.height);
+
+    m_offset.x += (cs.x - int(m_extent.width * m_scale)) / 2;
+    m_offset.y += (cs.y - int(m_extent.height * m_scale)) / 2;
+}
+
+wxPoint GraphOverviewCtrl::ClientToGraph(const wxPoint& pt) const
+{
+    return wxPoint(m_extent.x + int((pt.x - m_offset.x) / m_scale),
+                   m_extent.y + int((pt.y - m_offset.y) / m_scale));
+}
+
+wxRect GraphOverviewCtrl::GraphToClient(const wxRect& rc) const
+{
+    return wxRect(m_offset.x + int((rc.x - m_extent.x) * m_scale),
+                  m_offset.y + int((rc.y - m_extent.y) * m_scale),
+                  max(1, int(rc.width * m_scale + 0.5)),
+                  max(1, int(rc.height * m_scale + 0.5)));
+}
+
+void GraphOverviewCtrl::OnPaint(wxPaintEvent&)
+{
+    GRAPH_PROFILE_SCOPE("GraphOverviewCtrl::OnPaint");
+
+    wxPaintDC dc(this);
+
+    if (m_rebuild)
+        Rebuild();
+
+    // keep the mapping still while dragging, so that the point under the
+    // mouse doesn't move as the viewport does
+    UpdateViewport();
+    if (!HasCapture())
+        UpdateLayout();
+
+    dc.SetBackground(wxBrush(GetBackgroundColour()));
+    dc.Clear();
+
+    if (m_image.IsOk()) {
+        if (m_stale) {
+            m_bitmap = wxBitmap(m_image);
+            m_stale = false;
+        }
+
+        wxRect rc = GraphToClient(m_grid);
+        wxMemoryDC mdc(m_bitmap);
+        dc.StretchBlit(rc.x, rc.y, rc.width, rc.height,
+                       &mdc, 0, 0, m_cols, m_rows);
+        mdc.SelectObject(wxNullBitmap);
+    }
+
+    if (!m_viewport.IsEmpty()) {
+        dc.SetPen(wxPen(m_viewportColour));
+        dc.SetBrush(*wxTRANSPARENT_BRUSH);
+        dc.DrawRectangle(GraphToClient(m_viewport));
+    }
+}
+
+void GraphOverviewCtrl::OnSize(wxSizeEvent& event)
+{
+    Refresh();
+    event.Skip();
+}
+
+void GraphOverviewCtrl::Pan(const wxPoint& pt)
+{
+    m_ctrl->ScrollTo(ClientToGraph(pt) + m_dragOffset);
+    Refresh();
+}
+
+void GraphOverviewCtrl::OnMouse(wxMouseEvent& event)
+{
+    event.Skip();
+
+    if (!m_ctrl || !m_ctrl->GetGraph())
+        return;
+
+    wxPoint pt = event.GetPosition();
+
+    if (event.LeftDown()) {
+        UpdateLayout();
+        m_dragOffset = wxSize();
+
+        // dragging the viewport moves it by the distance dragged, rather
+        // than centring it on the mouse
+        if (GraphToClient(m_viewport).Contains(pt)) {
+            wxPoint centre = m_ctrl->GetScrollPosition();
+            wxPoint ptGraph = ClientToGraph(pt);
+            m_dragOffset = wxSize(centre.x - ptGraph.x, centre.y - ptGraph.y);
+        }
+
+        CaptureMouse();
+        Pan(pt);
+    }
+    else if (event.Dragging() && HasCapture()) {
+        Pan(pt);
+    }
+    else if (event.LeftUp() && HasCapture()) {
+        ReleaseMouse();
+        Refresh();
+    }
+}
+
+void GraphOverviewCtrl::OnCaptureLost(wxMouseCaptureLostEvent&)
+{
+    Refresh();
+}
+
+void GraphOverviewCtrl::OnIdle(wxIdleEvent& event)
+{
+    event.Skip();
+
+    if (!m_ctrl)
+        return;
+
+    if (m_ctrl->GetGraph() != m_graph)
+        SetGraph(m_ctrl->GetGraph());
+
+    if (UpdateViewport())
+        Refresh();
+}
+
+} // namespace tt_solutions
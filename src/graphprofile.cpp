@@ -0,0 +1,318 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphprofile.cpp
+// Purpose:     Lightweight timers and counters for profiling the hot paths
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of GraphProfiler and GraphProbe.
+ *
+ * The trace file uses the JSON array form of the trace event format, in
+ * which the closing bracket is optional, so the events can simply be
+ * appended as they are flushed.
+ */
+
+#include "graphprofile.h"
+
+#include <wx/ffile.h>
+#include <wx/timer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace {
+
+// A completed timing waiting to be written to the trace file.
+struct TraceEvent
+{
+    const GraphProbe *probe;
+    wxUint64 start;
+    wxUint64 elapsed;
+};
+
+// Flushes the trace file while the application is idle.
+class TraceTimer : public wxTimer
+{
+public:
+    void Notify() { GraphProfiler::FlushTrace(); }
+};
+
+// The state of the trace file.
+struct Trace
+{
+    Trace()
+      : timer(NULL), start(0), lastFlush(0), interval(0), first(true)
+    { }
+
+    wxFFile file;
+    vector<TraceEvent> events;
+    TraceTimer *timer;      // flushes every interval, NULL if none
+    wxUint64 start;         // time the trace started
+    wxUint64 lastFlush;     // time of the last flush
+    wxUint64 interval;      // flush interval in nanoseconds
+    bool first;             // no events written yet
+};
+
+Trace& GetTrace()
+{
+    static Trace trace;
+    return trace;
+}
+
+// Microseconds from the start of the trace, as the format expects. Always
+// with a '.', whatever the locale, so that the JSON stays valid.
+wxString Micro(wxUint64 ns)
+{
+    return wxString::FromCDouble(ns / 1000.0, 3);
+}
+
+bool CompareNames(const GraphProfiler::Stats& a, const GraphProfiler::Stats& b)
+{
+    return a.name < b.name;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// GraphProbe
+// ----------------------------------------------------------------------------
+
+GraphProbe::GraphProbe(const char *name, Kind kind)
+  : m_name(name),
+    m_kind(kind),
+    m_next(GraphProfiler::sm_probes)
+{
+    Reset();
+    GraphProfiler::sm_probes = this;
+}
+
+void GraphProbe::AddTime(wxUint64 start, wxUint64 elapsed)
+{
+    if (m_count == 0 || elapsed < m_min)
+        m_min = elapsed;
+    if (elapsed > m_max)
+        m_max = elapsed;
+
+    m_count++;
+    m_total += elapsed;
+    m_last = elapsed;
+
+    if (GraphProfiler::IsTracing())
+        GraphProfiler::AddEvent(*this, start, elapsed);
+}
+
+void GraphProbe::Reset()
+{
+    m_count = 0;
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+    m_last = 0;
+}
+
+// ----------------------------------------------------------------------------
+// GraphProfiler
+// ----------------------------------------------------------------------------
+
+bool GraphProfiler::sm_enabled;
+bool GraphProfiler::sm_switchedOn;
+int GraphProfiler::sm_holds;
+bool GraphProfiler::sm_tracing;
+GraphProbe *GraphProfiler::sm_probes;
+
+wxUint64 GraphProfiler::Now()
+{
+    using namespace chrono;
+    return duration_cast<nanoseconds>(
+            steady_clock::now().time_since_epoch()).count();
+}
+
+void GraphProfiler::Enable(bool enable)
+{
+    sm_switchedOn = enable;
+    Update();
+}
+
+void GraphProfiler::Hold()
+{
+    sm_holds++;
+    Update();
+}
+
+void GraphProfiler::Release()
+{
+    wxCHECK_RET(sm_holds > 0, _T("GraphProfiler::Release() without Hold()"));
+    sm_holds--;
+    Update();
+}
+
+GraphProfiler::StatsList GraphProfiler::GetStats()
+{
+    StatsList list;
+    const double ms = 1e6;
+
+    for (const GraphProbe *p = sm_probes; p; p = p->m_next) {
+        if (p->m_count == 0)
+            continue;
+
+        Stats s;
+        s.name = wxString::FromAscii(p->m_name);
+        s.kind = p->m_kind;
+        s.count = p->m_count;
+
+        if (p->m_kind == GraphProbe::Timer) {
+            s.total = p->m_total / ms;
+            s.mean = s.total / p->m_count;
+            s.min = p->m_min / ms;
+            s.max = p->m_max / ms;
+            s.last = p->m_last / ms;
+        }
+        else {
+            s.total = double(p->m_total);
+            s.mean = s.min = s.max = s.last = 0;
+        }
+
+        list.push_back(s);
+    }
+
+    sort(list.begin(), list.end(), CompareNames);
+    return list;
+}
+
+const GraphProbe *GraphProfiler::Find(const char *name)
+{
+    for (const GraphProbe *p = sm_probes; p; p = p->m_next)
+        if (strcmp(p->m_name, name) == 0)
+            return p;
+
+    return NULL;
+}
+
+void GraphProfiler::Reset()
+{
+    for (GraphProbe *p = sm_probes; p; p = p->m_next)
+        p->Reset();
+}
+
+bool GraphProfiler::StartTrace(const wxString& filename, int flushMillisecs)
+{
+    StopTrace();
+
+    Trace& trace = GetTrace();
+
+    if (!trace.file.Open(filename, _T("w")))
+        return false;
+
+    trace.file.Write(wxString(_T("[\n")));
+    trace.events.clear();
+    trace.start = trace.lastFlush = Now();
+    trace.interval = wxUint64(max(flushMillisecs, 0)) * 1000000;
+    trace.first = true;
+
+    // the timer is heap allocated so that it isn't destroyed after wx has
+    // been cleaned up if the trace is never stopped
+    if (flushMillisecs > 0) {
+        trace.timer = new TraceTimer;
+        trace.timer->Start(flushMillisecs);
+    }
+
+    sm_tracing = true;
+    Hold();
+    return true;
+}
+
+void GraphProfiler::StopTrace()
+{
+    if (!sm_tracing)
+        return;
+
+    FlushTrace();
+
+    Trace& trace = GetTrace();
+    trace.file.Write(wxString(_T("\n]\n")));
+    trace.file.Close();
+
+    delete trace.timer;
+    trace.timer = NULL;
+
+    sm_tracing = false;
+    Release();
+}
+
+void GraphProfiler::AddEvent(const GraphProbe& probe,
+                             wxUint64 start,
+                             wxUint64 elapsed)
+{
+    Trace& trace = GetTrace();
+
+    // a scope that began before the trace started
+    if (start < trace.start)
+        return;
+
+    TraceEvent event = { &probe, start, elapsed };
+    trace.events.push_back(event);
+
+    if (start + elapsed - trace.lastFlush >= trace.interval)
+        FlushTrace();
+}
+
+void GraphProfiler::FlushTrace()
+{
+    if (!sm_tracing)
+        return;
+
+    Trace& trace = GetTrace();
+    wxString out;
+
+    for (size_t i = 0; i < trace.events.size(); i++) {
+        const TraceEvent& e = trace.events[i];
+
+        out << (trace.first ? _T("") : _T(",\n"))
+            << _T("{\"name\":\"") << wxString::FromAscii(e.probe->GetName())
+            << _T("\",\"cat\":\"grapheditor\",\"ph\":\"X\",\"ts\":")
+            << Micro(e.start - trace.start)
+            << _T(",\"dur\":") << Micro(e.elapsed)
+            << _T(",\"pid\":1,\"tid\":1}");
+
+        trace.first = false;
+    }
+
+    // the counters' running totals
+    wxUint64 now = Now();
+
+    for (const GraphProbe *p = sm_probes; p; p = p->m_next) {
+        if (p->GetKind() == GraphProbe::Counter && p->GetCount() != 0) {
+            out << (trace.first ? _T("") : _T(",\n"))
+                << _T("{\"name\":\"") << wxString::FromAscii(p->GetName())
+                << _T("\",\"cat\":\"grapheditor\",\"ph\":\"C\",\"ts\":")
+                << Micro(now - trace.start)
+                << _T(",\"pid\":1,\"args\":{\"total\":")
+                << wxString::Format(_T("%llu"),
+                                    (unsigned long long)p->GetTotal())
+                << _T("}}");
+
+            trace.first = false;
+        }
+    }
+
+    trace.events.clear();
+    trace.lastFlush = now;
+
+    if (!out.empty()) {
+        trace.file.Write(out, wxConvUTF8);
+        trace.file.Flush();
+    }
+}
+
+} // namespace tt_solutions
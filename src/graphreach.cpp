@@ -0,0 +1,178 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphreach.cpp
+// Purpose:     Cache of the nodes upstream and downstream of graph nodes
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of GraphReachability.
+ *
+ * Adding an edge u -> v can only make more nodes reachable, so a cached
+ * downstream set containing u (or starting at u) is brought up to date by
+ * searching from v through the nodes not already in the set, and similarly
+ * for upstream sets. Deleting an edge can make nodes unreachable, which
+ * would need a full search to find out, so the sets that contain the edge
+ * are simply discarded and recomputed on demand.
+ */
+
+#include "graphreach.h"
+#include <algorithm>
+#include <vector>
+
+namespace tt_solutions {
+
+using namespace std;
+
+GraphReachability::GraphReachability(Graph *graph, size_t capacity)
+  : m_graph(NULL),
+    m_capacity(capacity)
+{
+    SetGraph(graph);
+}
+
+GraphReachability::~GraphReachability()
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+}
+
+void GraphReachability::SetGraph(Graph *graph)
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+
+    m_graph = graph;
+
+    if (m_graph)
+        m_graph->AddObserver(this);
+
+    Clear();
+}
+
+void GraphReachability::Extend(Entry& entry, const GraphNode& start)
+{
+    vector<const GraphNode*> stack(1, &start);
+    bool out = entry.direction == Direction_Out;
+
+    while (!stack.empty()) {
+        const GraphNode *node = stack.back();
+        stack.pop_back();
+
+        GraphNode::const_iterator it, end;
+
+        if (out)
+            tie(it, end) = node->GetOutEdges();
+        else
+            tie(it, end) = node->GetInEdges();
+
+        for (; it != end; ++it) {
+            const GraphNode *next = out ? it->GetTo() : it->GetFrom();
+            if (entry.nodes.insert(next).second)
+                stack.push_back(next);
+        }
+    }
+}
+
+const GraphReachability::NodeSet&
+GraphReachability::Get(const GraphNode& node, int direction)
+{
+    wxASSERT(direction == Direction_Out || direction == Direction_In);
+
+    EntryList::iterator it;
+
+    for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->node == &node && it->direction == direction) {
+            m_entries.splice(m_entries.begin(), m_entries, it);
+            return m_entries.front().nodes;
+        }
+    }
+
+    m_entries.push_front(Entry());
+    Entry& entry = m_entries.front();
+    entry.node = &node;
+    entry.direction = direction;
+    Extend(entry, node);
+
+    while (m_entries.size() > max(m_capacity, size_t(1)))
+        m_entries.pop_back();
+
+    return entry.nodes;
+}
+
+bool GraphReachability::IsCached(const GraphNode& node, int direction) const
+{
+    EntryList::const_iterator it;
+
+    for (it = m_entries.begin(); it != m_entries.end(); ++it)
+        if (it->node == &node && it->direction == direction)
+            return true;
+
+    return false;
+}
+
+void GraphReachability::OnEdgeAdded(GraphEdge& edge)
+{
+    const GraphNode *from = edge.GetFrom();
+    const GraphNode *to = edge.GetTo();
+    EntryList::iterator it;
+
+    for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+        Entry& entry = *it;
+        const GraphNode *tail = from, *head = to;
+
+        if (entry.direction == Direction_In)
+            swap(tail, head);
+
+        if ((tail == entry.node || entry.nodes.count(tail)) &&
+                entry.nodes.insert(head).second)
+            Extend(entry, *head);
+    }
+}
+
+void GraphReachability::OnElementRemoving(GraphElement& element)
+{
+    GraphEdge *edge = wxDynamicCast(&element, GraphEdge);
+    EntryList::iterator it = m_entries.begin();
+
+    while (it != m_entries.end()) {
+        EntryList::iterator i = it++;
+        Entry& entry = *i;
+
+        if (edge) {
+            const GraphNode *tail = edge->GetFrom(), *head = edge->GetTo();
+
+            if (entry.direction == Direction_In)
+                swap(tail, head);
+
+            // the edge was one of the paths counted, the set may shrink
+            if (tail == entry.node || entry.nodes.count(tail))
+                m_entries.erase(i);
+        }
+        else if (entry.node == &element) {
+            m_entries.erase(i);
+        }
+        else {
+            // normally already discarded along with the node's edges
+            entry.nodes.erase(static_cast<GraphNode*>(&element));
+        }
+    }
+}
+
+void GraphReachability::OnGraphCleared()
+{
+    Clear();
+}
+
+void GraphReachability::OnGraphDestroyed()
+{
+    Clear();
+    m_graph = NULL;
+}
+
+} // namespace tt_solutions
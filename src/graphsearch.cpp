@@ -0,0 +1,362 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphsearch.cpp
+// Purpose:     Full-text search index over the nodes of a graph
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of the graph search index.
+ *
+ * The index holds a lower case copy of each node's searchable fields and a
+ * map from each trigram (sequence of three characters) occurring in them to
+ * the list of nodes containing it. A query of three or more characters is
+ * answered by taking the shortest posting list among the query's trigrams as
+ * the candidates and verifying them against the stored text, so the cost is
+ * proportional to the number of nodes containing the rarest part of the
+ * query rather than to the size of the graph.
+ *
+ * Nodes are stored in slots which are reused after a node is removed. The
+ * postings of a removed node are not searched for and erased, they are left
+ * in place and filtered out by the verification step, and are discarded in
+ * bulk once they outnumber the live postings.
+ */
+
+#include "graphsearch.h"
+#include <algorithm>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace {
+
+// Score weights of the different kinds of match.
+enum {
+    Match_Substring = 1,
+    Match_WordStart,
+    Match_Prefix,
+    Match_Exact
+};
+
+// The relative importance of the fields, indexed by GraphNode::SearchField.
+const int fieldWeight[GraphNode::Num_SearchFields] = { 5, 1, 2, 3, 4 };
+
+// The minimum number of stale postings before compacting the index.
+const size_t minCompact = 4096;
+
+wxString Normalise(const wxString& text)
+{
+    wxString str = text.Lower();
+    str.Trim(true).Trim(false);
+    return str;
+}
+
+bool IsWordChar(wxUniChar ch)
+{
+    return wxIsalnum(ch) || ch == '_';
+}
+
+// Returns the kind of the best match of 'query' in 'text', 0 if none.
+int MatchKind(const wxString& text, const wxString& query)
+{
+    size_t pos = text.find(query);
+    if (pos == wxString::npos)
+        return 0;
+    if (pos == 0)
+        return text.length() == query.length() ? Match_Exact : Match_Prefix;
+
+    while (pos != wxString::npos) {
+        if (!IsWordChar(text[pos - 1]))
+            return Match_WordStart;
+        pos = text.find(query, pos + 1);
+    }
+
+    return Match_Substring;
+}
+
+bool BetterMatch(const GraphSearch::Match& a, const GraphSearch::Match& b)
+{
+    return a.score > b.score;
+}
+
+} // namespace
+
+GraphSearch::GraphSearch(Graph *graph)
+  : m_graph(NULL),
+    m_fields((1 << GraphNode::Num_SearchFields) - 1),
+    m_live(0),
+    m_stale(0)
+{
+    SetGraph(graph);
+}
+
+GraphSearch::~GraphSearch()
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+}
+
+void GraphSearch::SetGraph(Graph *graph)
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+
+    m_graph = graph;
+
+    if (m_graph)
+        m_graph->AddObserver(this);
+
+    Rebuild();
+}
+
+void GraphSearch::SetFields(int mask)
+{
+    if (mask != m_fields) {
+        m_fields = mask;
+        Rebuild();
+    }
+}
+
+void GraphSearch::Clear()
+{
+    m_entries.clear();
+    m_free.clear();
+    m_slots.clear();
+    m_postings.clear();
+    m_live = m_stale = 0;
+}
+
+void GraphSearch::Rebuild()
+{
+    Clear();
+
+    if (!m_graph)
+        return;
+
+    m_slots.reserve(m_graph->GetNodeCount());
+
+    Graph::node_iterator it, end;
+
+    for (tie(it, end) = m_graph->GetNodes(); it != end; ++it)
+        Insert(*it);
+}
+
+void GraphSearch::Insert(GraphNode& node)
+{
+    wxUint32 slot;
+
+    if (m_free.empty()) {
+        slot = wxUint32(m_entries.size());
+        m_entries.push_back(Entry());
+    }
+    else {
+        slot = m_free.back();
+        m_free.pop_back();
+    }
+
+    Entry& entry = m_entries[slot];
+    entry.node = &node;
+
+    for (int i = 0; i < GraphNode::Num_SearchFields; i++)
+        if (m_fields & (1 << i))
+            entry.text[i] = Normalise(node.GetSearchText(i));
+
+    m_slots[&node] = slot;
+    Index(slot);
+}
+
+void GraphSearch::Remove(const GraphNode& node)
+{
+    SlotMap::iterator it = m_slots.find(&node);
+    if (it == m_slots.end())
+        return;
+
+    wxUint32 slot = it->second;
+    m_slots.erase(it);
+
+    Entry& entry = m_entries[slot];
+    m_live -= entry.trigrams;
+    m_stale += entry.trigrams;
+    entry = Entry();
+    m_free.push_back(slot);
+
+    if (m_stale > max(m_live, minCompact))
+        Compact();
+}
+
+void GraphSearch::Index(wxUint32 slot)
+{
+    Entry& entry = m_entries[slot];
+    vector<Trigram> trigrams;
+
+    for (int i = 0; i < GraphNode::Num_SearchFields; i++)
+        GetTrigrams(entry.text[i], trigrams);
+
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    for (size_t i = 0; i < trigrams.size(); i++)
+        m_postings[trigrams[i]].push_back(slot);
+
+    entry.trigrams = trigrams.size();
+    m_live += entry.trigrams;
+}
+
+void GraphSearch::Compact()
+{
+    // A slot may have been reused since the stale postings were added, so
+    // rather than filtering the lists reindex all the live entries.
+    m_postings.clear();
+    m_live = m_stale = 0;
+
+    for (size_t i = 0; i < m_entries.size(); i++)
+        if (m_entries[i].node)
+            Index(wxUint32(i));
+}
+
+void GraphSearch::GetTrigrams(const wxString& text, vector<Trigram>& trigrams)
+{
+    Trigram tri = 0;
+    size_t n = 0;
+
+    for (wxString::const_iterator it = text.begin(); it != text.end(); ++it) {
+        tri = ((tri << 21) | wxUint32(*it)) & ((Trigram(1) << 63) - 1);
+        if (++n >= 3)
+            trigrams.push_back(tri);
+    }
+}
+
+int GraphSearch::Score(const Entry& entry,
+                       const wxString& query,
+                       int *field) const
+{
+    int best = 0;
+
+    for (int i = 0; i < GraphNode::Num_SearchFields; i++) {
+        const wxString& text = entry.text[i];
+        if (text.length() < query.length())
+            continue;
+
+        int kind = MatchKind(text, query);
+        if (kind == 0)
+            continue;
+
+        // Prefer shorter fields, where the query covers more of the text.
+        int score = kind * 100 + fieldWeight[i] * 10
+                    + int(query.length() * 9 / text.length());
+
+        if (score > best) {
+            best = score;
+            *field = i;
+        }
+    }
+
+    return best;
+}
+
+GraphSearch::MatchList GraphSearch::Find(const wxString& query,
+                                         size_t maxResults) const
+{
+    MatchList matches;
+    wxString str = Normalise(query);
+
+    if (str.empty() || maxResults == 0)
+        return matches;
+
+    Match match;
+    vector<wxUint32> candidates;
+
+    if (str.length() >= 3) {
+        vector<Trigram> trigrams;
+        GetTrigrams(str, trigrams);
+
+        const Postings *shortest = NULL;
+
+        for (size_t i = 0; i < trigrams.size(); i++) {
+            PostingMap::const_iterator it = m_postings.find(trigrams[i]);
+            if (it == m_postings.end())
+                return matches;
+            if (!shortest || it->second.size() < shortest->size())
+                shortest = &it->second;
+        }
+
+        candidates = *shortest;
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+    }
+    else {
+        candidates.reserve(m_slots.size());
+        for (size_t i = 0; i < m_entries.size(); i++)
+            candidates.push_back(wxUint32(i));
+    }
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Entry& entry = m_entries[candidates[i]];
+
+        if (entry.node) {
+            match.field = GraphNode::Search_Text;
+            match.score = Score(entry, str, &match.field);
+
+            if (match.score) {
+                match.node = entry.node;
+                matches.push_back(match);
+            }
+        }
+    }
+
+    if (matches.size() > maxResults) {
+        partial_sort(matches.begin(), matches.begin() + maxResults,
+                     matches.end(), BetterMatch);
+        matches.resize(maxResults);
+    }
+    else {
+        sort(matches.begin(), matches.end(), BetterMatch);
+    }
+
+    for (size_t i = 0; i < matches.size(); i++)
+        matches[i].bounds = matches[i].node->GetBounds();
+
+    return matches;
+}
+
+void GraphSearch::OnNodeAdded(GraphNode& node)
+{
+    Remove(node);
+    Insert(node);
+}
+
+void GraphSearch::OnElementRemoving(GraphElement& element)
+{
+    GraphNode *node = wxDynamicCast(&element, GraphNode);
+    if (node)
+        Remove(*node);
+}
+
+void GraphSearch::OnNodeTextChanged(GraphNode& node)
+{
+    // Nodes also change their text while being added, before OnNodeAdded.
+    if (m_slots.count(&node)) {
+        Remove(node);
+        Insert(node);
+    }
+}
+
+void GraphSearch::OnGraphCleared()
+{
+    Clear();
+}
+
+void GraphSearch::OnGraphDestroyed()
+{
+    Clear();
+    m_graph = NULL;
+}
+
+} // namespace tt_solutions
@@ -0,0 +1,365 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphsnapshot.cpp
+// Purpose:     Compact read-only copy of a graph's structure
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of GraphSnapshot and GraphSnapshotTracker.
+ *
+ * The edges of a snapshot are kept as two parallel arrays of source and
+ * target indices, from which the in and out adjacency arrays are built with
+ * a counting sort. An incremental refresh therefore only has to filter and
+ * renumber these arrays and append the new elements, the elements that
+ * haven't changed are never dereferenced.
+ */
+
+#include "graphsnapshot.h"
+#include <algorithm>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace {
+
+// The minimum number of changes before the tracker gives up recording them
+// and retakes the snapshot instead.
+const size_t minRebuild = 1024;
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// GraphSnapshot
+// ----------------------------------------------------------------------------
+
+const GraphSnapshot::Index GraphSnapshot::npos;
+
+GraphSnapshot::GraphSnapshot(Graph& graph)
+{
+    Graph::node_iterator it, end;
+
+    for (tie(it, end) = graph.GetNodes(); it != end; ++it)
+        AddNode(&*it);
+
+    AddEdges();
+    BuildAdjacency();
+}
+
+GraphSnapshot::GraphSnapshot(const Graph::node_iterator_pair& range)
+{
+    Graph::node_iterator it, end;
+
+    for (tie(it, end) = range; it != end; ++it)
+        AddNode(&*it);
+
+    AddEdges();
+    BuildAdjacency();
+}
+
+GraphSnapshot::Index GraphSnapshot::GetIndex(const GraphNode *node) const
+{
+    IndexMap::const_iterator it = m_index.find(node);
+    return it != m_index.end() ? it->second : npos;
+}
+
+void GraphSnapshot::AddNode(GraphNode *node)
+{
+    // a range can contain duplicates
+    if (!m_index.insert(make_pair(node, Index(m_nodes.size()))).second)
+        return;
+
+    m_nodes.push_back(node);
+    m_left.push_back(0);
+    m_top.push_back(0);
+    m_width.push_back(0);
+    m_height.push_back(0);
+    SetGeometry(Index(m_nodes.size() - 1));
+}
+
+void GraphSnapshot::SetGeometry(Index n)
+{
+    wxRect rc = m_nodes[n]->GetBounds();
+    m_left[n] = rc.x;
+    m_top[n] = rc.y;
+    m_width[n] = rc.width;
+    m_height[n] = rc.height;
+}
+
+void GraphSnapshot::AddEdges()
+{
+    for (size_t n = 0; n < m_nodes.size(); n++) {
+        GraphNode::iterator it, end;
+
+        for (tie(it, end) = m_nodes[n]->GetOutEdges(); it != end; ++it) {
+            Index to = GetIndex(it->GetTo());
+
+            // only the edges connecting nodes in the snapshot
+            if (to != npos) {
+                m_edges.push_back(&*it);
+                m_from.push_back(Index(n));
+                m_to.push_back(to);
+            }
+        }
+    }
+}
+
+void GraphSnapshot::BuildAdjacency()
+{
+    size_t nodes = m_nodes.size();
+    size_t edges = m_edges.size();
+
+    m_outOffset.assign(nodes + 1, 0);
+    m_inOffset.assign(nodes + 1, 0);
+
+    for (size_t e = 0; e < edges; e++) {
+        m_outOffset[m_from[e] + 1]++;
+        m_inOffset[m_to[e] + 1]++;
+    }
+
+    for (size_t n = 0; n < nodes; n++) {
+        m_outOffset[n + 1] += m_outOffset[n];
+        m_inOffset[n + 1] += m_inOffset[n];
+    }
+
+    m_outNodes.resize(edges);
+    m_outEdges.resize(edges);
+    m_inNodes.resize(edges);
+    m_inEdges.resize(edges);
+
+    vector<Index> outPos(m_outOffset.begin(), m_outOffset.end() - 1);
+    vector<Index> inPos(m_inOffset.begin(), m_inOffset.end() - 1);
+
+    for (size_t e = 0; e < edges; e++) {
+        Index i = outPos[m_from[e]]++;
+        m_outNodes[i] = m_to[e];
+        m_outEdges[i] = Index(e);
+
+        i = inPos[m_to[e]]++;
+        m_inNodes[i] = m_from[e];
+        m_inEdges[i] = Index(e);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// GraphSnapshotTracker
+// ----------------------------------------------------------------------------
+
+GraphSnapshotTracker::GraphSnapshotTracker(Graph *graph)
+  : m_graph(NULL),
+    m_rebuild(true)
+{
+    SetGraph(graph);
+}
+
+GraphSnapshotTracker::~GraphSnapshotTracker()
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+}
+
+void GraphSnapshotTracker::SetGraph(Graph *graph)
+{
+    if (m_graph)
+        m_graph->RemoveObserver(this);
+
+    m_graph = graph;
+
+    if (m_graph)
+        m_graph->AddObserver(this);
+
+    Reset();
+    m_rebuild = true;
+}
+
+bool GraphSnapshotTracker::IsModified() const
+{
+    return m_rebuild || !m_added.empty() ||
+           !m_removed.empty() || !m_moved.empty();
+}
+
+const GraphSnapshot& GraphSnapshotTracker::GetSnapshot()
+{
+    if (IsModified())
+        Refresh();
+
+    return m_snapshot;
+}
+
+void GraphSnapshotTracker::Reset()
+{
+    m_rebuild = false;
+    m_added.clear();
+    m_addedSet.clear();
+    m_removed.clear();
+    m_moved.clear();
+}
+
+void GraphSnapshotTracker::Refresh()
+{
+    const GraphSnapshot& old = m_snapshot;
+    size_t oldNodes = old.GetNodeCount();
+    size_t oldEdges = old.GetEdgeCount();
+
+    if (!m_graph) {
+        GraphSnapshot empty;
+        swap(m_snapshot, empty);
+    }
+    else if (m_rebuild) {
+        GraphSnapshot snap(*m_graph);
+        swap(m_snapshot, snap);
+    }
+    else if (m_added.empty() && m_removed.empty()) {
+        // only the geometry has changed
+        unordered_set<GraphNode*>::iterator it;
+
+        for (it = m_moved.begin(); it != m_moved.end(); ++it) {
+            GraphSnapshot::Index n = m_snapshot.GetIndex(*it);
+            if (n != GraphSnapshot::npos)
+                m_snapshot.SetGeometry(n);
+        }
+    }
+    else {
+        typedef GraphSnapshot::Index Index;
+        const Index npos = GraphSnapshot::npos;
+
+        GraphSnapshot snap;
+        vector<Index> remap(oldNodes, npos);
+
+        snap.m_nodes.reserve(oldNodes + m_added.size());
+        snap.m_index.reserve(oldNodes + m_added.size());
+
+        // the surviving nodes keep their order and geometry
+        for (size_t n = 0; n < oldNodes; n++) {
+            GraphNode *node = old.m_nodes[n];
+
+            if (!m_removed.count(node)) {
+                Index i = Index(snap.m_nodes.size());
+                remap[n] = i;
+                snap.m_nodes.push_back(node);
+                snap.m_index[node] = i;
+                snap.m_left.push_back(old.m_left[n]);
+                snap.m_top.push_back(old.m_top[n]);
+                snap.m_width.push_back(old.m_width[n]);
+                snap.m_height.push_back(old.m_height[n]);
+
+                if (m_moved.count(node))
+                    snap.SetGeometry(i);
+            }
+        }
+
+        for (size_t e = 0; e < oldEdges; e++) {
+            GraphEdge *edge = old.m_edges[e];
+            Index from = remap[old.m_from[e]];
+            Index to = remap[old.m_to[e]];
+
+            if (!m_removed.count(edge) && from != npos && to != npos) {
+                snap.m_edges.push_back(edge);
+                snap.m_from.push_back(from);
+                snap.m_to.push_back(to);
+            }
+        }
+
+        // then the new nodes, followed by the new edges since they can
+        // connect new nodes
+        vector<GraphEdge*> addedEdges;
+
+        for (size_t i = 0; i < m_added.size(); i++) {
+            GraphElement *element = m_added[i];
+
+            // skip the ones since removed, and duplicates in case an
+            // element was removed and another allocated at the same address
+            if (m_addedSet.erase(element)) {
+                GraphNode *node = wxDynamicCast(element, GraphNode);
+                if (node)
+                    snap.AddNode(node);
+                else
+                    addedEdges.push_back(static_cast<GraphEdge*>(element));
+            }
+        }
+
+        for (size_t i = 0; i < addedEdges.size(); i++) {
+            GraphEdge *edge = addedEdges[i];
+            Index from = snap.GetIndex(edge->GetFrom());
+            Index to = snap.GetIndex(edge->GetTo());
+
+            if (from != npos && to != npos) {
+                snap.m_edges.push_back(edge);
+                snap.m_from.push_back(from);
+                snap.m_to.push_back(to);
+            }
+        }
+
+        snap.BuildAdjacency();
+        swap(m_snapshot, snap);
+    }
+
+    Reset();
+}
+
+void GraphSnapshotTracker::Record(GraphElement& element)
+{
+    if (m_rebuild)
+        return;
+
+    m_added.push_back(&element);
+    m_addedSet.insert(&element);
+
+    // rather than accumulate a long list of changes, retake the snapshot
+    size_t size = m_snapshot.GetNodeCount() + m_snapshot.GetEdgeCount();
+    if (m_added.size() + m_removed.size() > max(size / 4, minRebuild)) {
+        Reset();
+        m_rebuild = true;
+    }
+}
+
+void GraphSnapshotTracker::OnNodeAdded(GraphNode& node)
+{
+    Record(node);
+}
+
+void GraphSnapshotTracker::OnEdgeAdded(GraphEdge& edge)
+{
+    Record(edge);
+}
+
+void GraphSnapshotTracker::OnElementRemoving(GraphElement& element)
+{
+    if (m_rebuild)
+        return;
+
+    GraphNode *node = wxDynamicCast(&element, GraphNode);
+    if (node)
+        m_moved.erase(node);
+
+    // an element added since the snapshot can just be forgotten
+    if (!m_addedSet.erase(&element))
+        m_removed.insert(&element);
+}
+
+void GraphSnapshotTracker::OnNodeMoved(GraphNode& node)
+{
+    if (!m_rebuild)
+        m_moved.insert(&node);
+}
+
+void GraphSnapshotTracker::OnGraphCleared()
+{
+    Reset();
+    m_rebuild = true;
+}
+
+void GraphSnapshotTracker::OnGraphDestroyed()
+{
+    m_graph = NULL;
+    Reset();
+    m_rebuild = true;
+}
+
+} // namespace tt_solutions
@@ -0,0 +1,360 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:        graphtrace.cpp
+// Purpose:     Recording and replaying of interaction with a GraphCtrl
+// Author:      TT-Solutions SARL
+// Modified by:
+// Created:     October 2026
+// RCS-ID:      $Id$
+// Copyright:   (c) 2026 TT-Solutions SARL
+// Licence:     wxWindows licence
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief Implementation of GraphTrace.
+ *
+ * A saved trace is the archive of the graph with one more item holding the
+ * view and the events. The events are stored one per line as the type's
+ * name followed by the time, position, state and parameters, which keeps
+ * long sessions compact and readable.
+ */
+
+#include "graphtrace.h"
+#include "graphctrl.h"
+#include "archive.h"
+
+#include <wx/mstream.h>
+#include <wx/tokenzr.h>
+
+namespace tt_solutions {
+
+using namespace std;
+
+namespace {
+
+const wxChar *TAGTRACE  = _T("graphtrace");
+const wxChar *TAGSIZE   = _T("size");
+const wxChar *TAGZOOM   = _T("zoom");
+const wxChar *TAGCENTRE = _T("centre");
+const wxChar *TAGEVENTS = _T("events");
+
+// The zoom is stored in hundredths of a percent to keep it an integer.
+const double ZOOM_SCALE = 100.0;
+
+int GetState(const wxKeyboardState& keys)
+{
+    int state = 0;
+
+    if (keys.ShiftDown())
+        state |= GraphTrace::State_Shift;
+    if (keys.ControlDown())
+        state |= GraphTrace::State_Control;
+    if (keys.AltDown())
+        state |= GraphTrace::State_Alt;
+    if (keys.MetaDown())
+        state |= GraphTrace::State_Meta;
+
+    return state;
+}
+
+void SetState(wxKeyboardState& keys, int state)
+{
+    keys.SetShiftDown((state & GraphTrace::State_Shift) != 0);
+    keys.SetControlDown((state & GraphTrace::State_Control) != 0);
+    keys.SetAltDown((state & GraphTrace::State_Alt) != 0);
+    keys.SetMetaDown((state & GraphTrace::State_Meta) != 0);
+}
+
+// The mouse event type of each mouse EventType. A function rather than a
+// table since the wxEVT_ constants aren't initialised until run time.
+wxEventType GetMouseEventType(GraphTrace::EventType type)
+{
+    switch (type) {
+        case GraphTrace::Mouse_Motion:          return wxEVT_MOTION;
+        case GraphTrace::Mouse_LeftDown:        return wxEVT_LEFT_DOWN;
+        case GraphTrace::Mouse_LeftUp:          return wxEVT_LEFT_UP;
+        case GraphTrace::Mouse_LeftDClick:      return wxEVT_LEFT_DCLICK;
+        case GraphTrace::Mouse_MiddleDown:      return wxEVT_MIDDLE_DOWN;
+        case GraphTrace::Mouse_MiddleUp:        return wxEVT_MIDDLE_UP;
+        case GraphTrace::Mouse_MiddleDClick:    return wxEVT_MIDDLE_DCLICK;
+        case GraphTrace::Mouse_RightDown:       return wxEVT_RIGHT_DOWN;
+        case GraphTrace::Mouse_RightUp:         return wxEVT_RIGHT_UP;
+        case GraphTrace::Mouse_RightDClick:     return wxEVT_RIGHT_DCLICK;
+        case GraphTrace::Mouse_Wheel:           return wxEVT_MOUSEWHEEL;
+        case GraphTrace::Mouse_Enter:           return wxEVT_ENTER_WINDOW;
+        case GraphTrace::Mouse_Leave:           return wxEVT_LEAVE_WINDOW;
+        default:                                break;
+    }
+
+    return wxEVT_NULL;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// GraphTrace::Event
+// ----------------------------------------------------------------------------
+
+bool GraphTrace::Event::Set(const wxEvent& event, wxUint64 t)
+{
+    wxEventType evtype = event.GetEventType();
+
+    *this = Event();
+    time = t;
+
+    const wxMouseEvent *mouse = wxDynamicCast(&event, wxMouseEvent);
+
+    if (mouse) {
+        int i = 0;
+        while (i < Key_Down && GetMouseEventType(EventType(i)) != evtype)
+            i++;
+        if (i == Key_Down)
+            return false;
+
+        type = EventType(i);
+        pos = mouse->GetPosition();
+        state = GetState(*mouse);
+
+        if (mouse->LeftIsDown())
+            state |= State_Left;
+        if (mouse->MiddleIsDown())
+            state |= State_Middle;
+        if (mouse->RightIsDown())
+            state |= State_Right;
+
+        if (type == Mouse_Wheel) {
+            param1 = mouse->GetWheelRotation();
+            param2 = mouse->GetWheelDelta();
+        }
+
+        return true;
+    }
+
+    const wxKeyEvent *key = wxDynamicCast(&event, wxKeyEvent);
+
+    if (key) {
+        if (evtype == wxEVT_KEY_DOWN)
+            type = Key_Down;
+        else if (evtype == wxEVT_KEY_UP)
+            type = Key_Up;
+        else if (evtype == wxEVT_CHAR)
+            type = Key_Char;
+        else
+            return false;
+
+        pos = key->GetPosition();
+        state = GetState(*key);
+        param1 = key->GetKeyCode();
+        param2 = int(key->GetUnicodeKey());
+
+        return true;
+    }
+
+    return false;
+}
+
+void GraphTrace::Event::Get(wxMouseEvent& event) const
+{
+    wxASSERT(!IsKey());
+
+    event.SetEventType(GetMouseEventType(type));
+    event.SetPosition(pos);
+    SetState(event, state);
+    event.SetLeftDown((state & State_Left) != 0);
+    event.SetMiddleDown((state & State_Middle) != 0);
+    event.SetRightDown((state & State_Right) != 0);
+
+    if (type == Mouse_Wheel) {
+        event.m_wheelRotation = param1;
+        event.m_wheelDelta = param2;
+        event.m_linesPerAction = 3;
+    }
+}
+
+void GraphTrace::Event::Get(wxKeyEvent& event) const
+{
+    wxASSERT(IsKey());
+
+    static const wxEventType types[] = {
+        wxEVT_KEY_DOWN, wxEVT_KEY_UP, wxEVT_CHAR
+    };
+
+    event.SetEventType(types[type - Key_Down]);
+    SetState(event, state);
+    event.m_x = pos.x;
+    event.m_y = pos.y;
+    event.m_keyCode = param1;
+    event.m_uniChar = wxChar(param2);
+}
+
+const char *GraphTrace::Event::GetTypeName(EventType type)
+{
+    static const char *names[] = {
+        "motion",
+        "left_down", "left_up", "left_dclick",
+        "middle_down", "middle_up", "middle_dclick",
+        "right_down", "right_up", "right_dclick",
+        "wheel", "enter", "leave",
+        "key_down", "key_up", "char"
+    };
+
+    wxCOMPILE_TIME_ASSERT(WXSIZEOF(names) == Event_Max, EventNamesMismatch);
+
+    return type >= 0 && type < Event_Max ? names[type] : "";
+}
+
+// ----------------------------------------------------------------------------
+// GraphTrace
+// ----------------------------------------------------------------------------
+
+GraphTrace::GraphTrace()
+  : m_zoom(100.0)
+{
+}
+
+void GraphTrace::Clear()
+{
+    m_graph.SetDataLen(0);
+    m_size = wxSize();
+    m_zoom = 100.0;
+    m_centre = wxPoint();
+    m_events.clear();
+}
+
+bool GraphTrace::SetGraph(Graph& graph)
+{
+    wxMemoryOutputStream out;
+
+    if (!graph.Serialise(out))
+        return false;
+
+    size_t len = size_t(out.GetLength());
+    m_graph.SetDataLen(0);
+    out.CopyTo(m_graph.GetWriteBuf(len), len);
+    m_graph.UngetWriteBuf(len);
+
+    return true;
+}
+
+bool GraphTrace::RestoreGraph(Graph& graph) const
+{
+    if (m_graph.IsEmpty())
+        return false;
+
+    wxMemoryInputStream in(m_graph.GetData(), m_graph.GetDataLen());
+    return graph.Deserialise(in);
+}
+
+void GraphTrace::SetView(const wxSize& size, double zoom, const wxPoint& centre)
+{
+    m_size = size;
+    m_zoom = zoom;
+    m_centre = centre;
+}
+
+bool GraphTrace::Save(wxOutputStream& stream) const
+{
+    Archive archive;
+
+    if (!m_graph.IsEmpty()) {
+        wxMemoryInputStream in(m_graph.GetData(), m_graph.GetDataLen());
+        if (!archive.Load(in))
+            return false;
+    }
+
+    archive.Remove(TAGTRACE);
+    Archive::Item *arc = archive.Put(TAGTRACE, TAGTRACE);
+    wxASSERT(arc);
+
+    arc->Put(TAGSIZE, m_size);
+    arc->Put(TAGZOOM, int(m_zoom * ZOOM_SCALE + 0.5));
+    arc->Put(TAGCENTRE, m_centre);
+
+    wxString events;
+
+    for (size_t i = 0; i < m_events.size(); i++) {
+        const Event& ev = m_events[i];
+
+        events << wxString::FromAscii(Event::GetTypeName(ev.type))
+               << _T(" ") << wxULongLong(ev.time).ToString()
+               << wxString::Format(_T(" %d %d %d %d %d\n"),
+                                   ev.pos.x, ev.pos.y, ev.state,
+                                   ev.param1, ev.param2);
+    }
+
+    arc->Put(TAGEVENTS, events);
+
+    return archive.Save(stream);
+}
+
+bool GraphTrace::Load(wxInputStream& stream)
+{
+    Clear();
+
+    Archive archive;
+    if (!archive.Load(stream))
+        return false;
+
+    Archive::Item *arc = archive.Get(TAGTRACE);
+    if (!arc) {
+        wxLogError(_("Error loading: not an interaction trace"));
+        return false;
+    }
+
+    int zoom = int(m_zoom * ZOOM_SCALE);
+    arc->Get(TAGSIZE, m_size);
+    arc->Get(TAGZOOM, zoom);
+    arc->Get(TAGCENTRE, m_centre);
+    m_zoom = zoom / ZOOM_SCALE;
+
+    wxStringTokenizer lines(arc->Get(TAGEVENTS), _T("\n"));
+
+    while (lines.HasMoreTokens()) {
+        wxStringTokenizer fields(lines.GetNextToken(), _T(" "));
+        wxString name = fields.GetNextToken();
+        wxULongLong_t time;
+        long values[5];
+
+        Event ev;
+        int type = 0;
+        while (type < Event_Max &&
+               name != wxString::FromAscii(Event::GetTypeName(EventType(type))))
+            type++;
+
+        bool ok = type < Event_Max && fields.GetNextToken().ToULongLong(&time);
+
+        for (size_t i = 0; ok && i < WXSIZEOF(values); i++)
+            ok = fields.GetNextToken().ToLong(&values[i]);
+
+        if (!ok) {
+            wxLogError(_("Error loading: bad event '%s' in trace"),
+                       name.c_str());
+            Clear();
+            return false;
+        }
+
+        ev.type = EventType(type);
+        ev.time = time;
+        ev.pos = wxPoint(int(values[0]), int(values[1]));
+        ev.state = int(values[2]);
+        ev.param1 = int(values[3]);
+        ev.param2 = int(values[4]);
+
+        m_events.push_back(ev);
+    }
+
+    // what remains is the graph, kept serialised for RestoreGraph()
+    archive.Remove(TAGTRACE);
+
+    wxMemoryOutputStream out;
+    if (!archive.Save(out))
+        return false;
+
+    size_t len = size_t(out.GetLength());
+    out.CopyTo(m_graph.GetWriteBuf(len), len);
+    m_graph.UngetWriteBuf(len);
+
+    return true;
+}
+
+} // namespace tt_solutions
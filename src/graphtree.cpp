@@ -12,6 +12,12 @@
 #include "graphtree.h"
 #include <wx/imaglist.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 /**
  * @file
  * @brief Implementation of the custom tree control class.
@@ -19,6 +25,150 @@
 
 namespace tt_solutions {
 
+using namespace std;
+
+namespace {
+
+/// Filtered categories are expanded while there are no more items than this.
+const size_t autoExpandLimit = 500;
+
+/// The size of the image list created for a provider's icons.
+const int defaultIconSize = 16;
+
+} // namespace
+
+namespace impl {
+
+// ----------------------------------------------------------------------------
+// IconLoader
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Loads a GraphTreeProvider's icons on a worker thread.
+ *
+ * Names are queued by Request() and the images collected by Collect() on
+ * the main thread, which is woken for idle processing as each arrives. The
+ * strings and images passed between the threads are deep copies, or only
+ * touched with the mutex held, since their reference counts are not atomic.
+ */
+class IconLoader
+{
+public:
+    /// A loaded icon, with its name.
+    typedef pair<wxString, wxImage> Icon;
+    typedef vector<Icon> IconList;
+
+    IconLoader(const GraphTreeProvider& provider)
+      : m_provider(provider), m_stop(false)
+    { }
+
+    /// Finishes the icon being loaded and drops the rest.
+    ~IconLoader();
+
+    /// Queue an icon to load.
+    void Request(const wxString& name);
+
+    /// Append the icons loaded so far, returning false if there are none.
+    bool Collect(IconList& icons);
+
+private:
+    /// The worker thread.
+    void Run();
+
+    const GraphTreeProvider& m_provider;
+    mutex m_mutex;              ///< Guards the members below.
+    condition_variable m_wake;  ///< Signalled for a request or to stop.
+    deque<wxString> m_queue;    ///< Names to load.
+    IconList m_loaded;          ///< Icons not yet collected.
+    bool m_stop;                ///< The worker should exit.
+    thread m_thread;            ///< Started by the first request.
+};
+
+IconLoader::~IconLoader()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+        m_queue.clear();
+        m_loaded.clear();
+    }
+
+    m_wake.notify_one();
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void IconLoader::Request(const wxString& name)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_queue.push_back(name.Clone());
+    }
+
+    if (!m_thread.joinable())
+        m_thread = thread(&IconLoader::Run, this);
+    else
+        m_wake.notify_one();
+}
+
+bool IconLoader::Collect(IconList& icons)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (m_loaded.empty())
+        return false;
+
+    if (icons.empty())
+        icons.swap(m_loaded);
+    else
+        icons.insert(icons.end(), m_loaded.begin(), m_loaded.end());
+
+    m_loaded.clear();
+    return true;
+}
+
+void IconLoader::Run()
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    for (;;) {
+        while (!m_stop && m_queue.empty())
+            m_wake.wait(lock);
+        if (m_stop)
+            break;
+
+        wxString name;
+        name.swap(m_queue.front());
+        m_queue.pop_front();
+
+        lock.unlock();
+        wxImage image = m_provider.LoadIcon(name);
+        lock.lock();
+
+        // the copy's reference is dropped with the lock still held
+        if (!m_stop)
+            m_loaded.push_back(Icon(name, image));
+        image = wxImage();
+        name.clear();
+
+        wxWakeUpIdle();
+    }
+}
+
+} // namespace impl
+
+// ----------------------------------------------------------------------------
+// GraphTreeProvider
+// ----------------------------------------------------------------------------
+
+const GraphTreeProvider::Id GraphTreeProvider::RootId = 0;
+const GraphTreeProvider::Id GraphTreeProvider::NoId = ~GraphTreeProvider::Id(0);
+
+// ----------------------------------------------------------------------------
+// GraphTreeCtrl
+// ----------------------------------------------------------------------------
+
 DEFINE_EVENT_TYPE(Evt_GraphTree_Drop)
 
 IMPLEMENT_DYNAMIC_CLASS(GraphTreeCtrl, wxTreeCtrl)
@@ -26,17 +176,285 @@ IMPLEMENT_DYNAMIC_CLASS(GraphTreeEvent, wxCommandEvent)
 
 BEGIN_EVENT_TABLE(GraphTreeCtrl, wxTreeCtrl)
     EVT_TREE_BEGIN_DRAG(wxID_ANY, GraphTreeCtrl::OnBeginDrag)
+    EVT_TREE_ITEM_EXPANDING(wxID_ANY, GraphTreeCtrl::OnItemExpanding)
+    EVT_TREE_DELETE_ITEM(wxID_ANY, GraphTreeCtrl::OnDeleteItem)
     EVT_MOTION(GraphTreeCtrl::OnMouseMove)
     EVT_LEFT_UP(GraphTreeCtrl::OnLeftButtonUp)
+    EVT_IDLE(GraphTreeCtrl::OnIdle)
 END_EVENT_TABLE()
 
 const wxChar GraphTreeCtrl::DefaultName[] = _T("graphtreectrl");
 
+GraphTreeCtrl::~GraphTreeCtrl()
+{
+    delete m_loader;
+}
+
+void GraphTreeCtrl::SetProvider(GraphTreeProvider *provider)
+{
+    delete m_loader;
+    m_loader = NULL;
+    m_provider = provider;
+
+    m_images.clear();
+    m_waiting.clear();
+    m_matches.clear();
+    m_filter.clear();
+
+    if (m_provider) {
+        m_loader = new impl::IconLoader(*m_provider);
+        if (!GetImageList())
+            AssignImageList(new wxImageList(defaultIconSize, defaultIconSize));
+        Repopulate();
+    }
+    else {
+        DeleteAllItems();
+        m_items.clear();
+    }
+}
+
+GraphTreeProvider::Id GraphTreeCtrl::GetEntry(const wxTreeItemId& item) const
+{
+    unordered_map<wxTreeItemIdValue, Id>::const_iterator it =
+        m_items.find(item.GetID());
+
+    return it != m_items.end() ? it->second : GraphTreeProvider::NoId;
+}
+
+void GraphTreeCtrl::SetFilter(const wxString& text)
+{
+    wxString filter = text.Lower();
+
+    if (!m_provider || filter == m_filter)
+        return;
+
+    // every entry matching a longer filter matched the shorter one, so only
+    // those need testing again
+    unordered_map<Id, IdList> old;
+    old.swap(m_matches);
+    bool refine = !m_filter.empty() && filter.Contains(m_filter);
+    m_filter = filter;
+
+    // an empty list at the root shows nothing matches
+    if (!m_filter.empty() && !Filter(GraphTreeProvider::RootId,
+                                     refine ? &old : NULL))
+        m_matches[GraphTreeProvider::RootId].clear();
+
+    Repopulate();
+}
+
+bool GraphTreeCtrl::Filter(Id parent, const unordered_map<Id, IdList> *old)
+{
+    IdList children;
+    GetShown(parent, children, old);
+
+    IdList shown;
+
+    for (size_t i = 0; i < children.size(); i++) {
+        Id id = children[i];
+
+        // the children of a category that matches are all shown, so it
+        // gets no entry in m_matches
+        if (m_provider->GetText(id).Lower().Contains(m_filter))
+            shown.push_back(id);
+        else if (m_provider->HasChildren(id) && Filter(id, old))
+            shown.push_back(id);
+    }
+
+    if (shown.empty())
+        return false;
+
+    m_matches[parent].swap(shown);
+    return true;
+}
+
+void GraphTreeCtrl::GetShown(Id parent, IdList& children,
+                             const unordered_map<Id, IdList> *old) const
+{
+    const unordered_map<Id, IdList>& matches = old ? *old : m_matches;
+    bool filtered = old || !m_filter.empty();
+
+    if (filtered) {
+        unordered_map<Id, IdList>::const_iterator it = matches.find(parent);
+        if (it != matches.end()) {
+            children = it->second;
+            return;
+        }
+    }
+
+    // while filtering, entries without matches under them aren't shown, so
+    // a missing entry is a category that matched itself
+    m_provider->GetChildren(parent, children);
+}
+
+void GraphTreeCtrl::Repopulate()
+{
+    Freeze();
+
+    DeleteAllItems();
+    m_items.clear();
+
+    Id root = GraphTreeProvider::RootId;
+    wxTreeItemId item = AddRoot(m_provider->GetText(root));
+    m_items[item.GetID()] = root;
+    SetItemHasChildren(item);
+    Populate(item);
+
+    if (!HasFlag(wxTR_HIDE_ROOT))
+        Expand(item);
+    if (!m_filter.empty())
+        ExpandMatches();
+
+    Thaw();
+}
+
+void GraphTreeCtrl::Populate(const wxTreeItemId& item)
+{
+    Id id = GetEntry(item);
+
+    if (id == GraphTreeProvider::NoId || GetChildrenCount(item, false) != 0)
+        return;
+
+    IdList children;
+    GetShown(id, children);
+
+    for (size_t i = 0; i < children.size(); i++)
+        AppendEntry(item, children[i]);
+
+    if (children.empty())
+        SetItemHasChildren(item, false);
+}
+
+wxTreeItemId GraphTreeCtrl::AppendEntry(const wxTreeItemId& parent, Id id)
+{
+    wxString name = m_provider->GetIconName(id);
+    int image = name.empty() ? -1 : GetImage(name);
+
+    wxTreeItemId item = AppendItem(parent, m_provider->GetText(id),
+                                   max(image, -1), -1,
+                                   m_provider->CreateItemData(id));
+    m_items[item.GetID()] = id;
+
+    if (image == Loading)
+        m_waiting[name].push_back(make_pair(item, id));
+    if (m_provider->HasChildren(id))
+        SetItemHasChildren(item);
+
+    return item;
+}
+
+int GraphTreeCtrl::GetImage(const wxString& name)
+{
+    map<wxString, int>::iterator it = m_images.find(name);
+
+    if (it != m_images.end())
+        return it->second;
+
+    m_images[name] = Loading;
+    m_loader->Request(name);
+    return Loading;
+}
+
+void GraphTreeCtrl::ExpandMatches()
+{
+    wxTreeItemId root = GetRootItem();
+    deque<wxTreeItemId> queue(1, root);
+
+    while (!queue.empty()) {
+        wxTreeItemId item = queue.front();
+        wxTreeItemIdValue cookie;
+        queue.pop_front();
+
+        // categories that match themselves hold everything, so are left
+        // for the user to expand
+        unordered_map<Id, IdList>::const_iterator it =
+            m_matches.find(GetEntry(item));
+
+        if (it == m_matches.end() ||
+                GetCount() + it->second.size() > autoExpandLimit)
+            continue;
+
+        if (item != root || !HasFlag(wxTR_HIDE_ROOT))
+            Expand(item);
+
+        wxTreeItemId child = GetFirstChild(item, cookie);
+
+        for (; child.IsOk(); child = GetNextChild(item, cookie))
+            if (ItemHasChildren(child))
+                queue.push_back(child);
+    }
+}
+
+void GraphTreeCtrl::Expand(const wxTreeItemId& item)
+{
+    Populate(item);
+    wxTreeCtrl::Expand(item);
+}
+
+void GraphTreeCtrl::OnItemExpanding(wxTreeEvent& event)
+{
+    Populate(event.GetItem());
+    event.Skip();
+}
+
+void GraphTreeCtrl::OnDeleteItem(wxTreeEvent& event)
+{
+    m_items.erase(event.GetItem().GetID());
+    event.Skip();
+}
+
+void GraphTreeCtrl::OnIdle(wxIdleEvent& event)
+{
+    impl::IconLoader::IconList icons;
+
+    wxImageList *images = GetImageList();
+
+    if (m_loader && images && m_loader->Collect(icons)) {
+        int width = defaultIconSize, height = defaultIconSize;
+
+        if (images->GetImageCount() > 0)
+            images->GetSize(0, width, height);
+
+        for (size_t i = 0; i < icons.size(); i++) {
+            const wxString& name = icons[i].first;
+            wxImage& image = icons[i].second;
+            int index = -1;
+
+            if (image.IsOk()) {
+                if (image.GetWidth() != width || image.GetHeight() != height)
+                    image.Rescale(width, height, wxIMAGE_QUALITY_HIGH);
+                index = images->Add(wxBitmap(image));
+            }
+
+            m_images[name] = index;
+
+            // items deleted since are skipped, even if their id was reused
+            const WaitList& waiting = m_waiting[name];
+
+            for (size_t j = 0; index != -1 && j < waiting.size(); j++) {
+                const wxTreeItemId& item = waiting[j].first;
+                if (GetEntry(item) == waiting[j].second)
+                    SetItemImage(item, index);
+            }
+
+            m_waiting.erase(name);
+        }
+    }
+
+    event.Skip();
+}
+
 void GraphTreeCtrl::OnBeginDrag(wxTreeEvent& event)
 {
     wxTreeItemId item = event.GetItem();
+    Id id = GetEntry(item);
+
+    // categories from the provider may have no children until expanded
+    bool leaf = id != GraphTreeProvider::NoId ?
+                    !m_provider->HasChildren(id) :
+                    GetChildrenCount(item, false) == 0;
 
-    if (GetChildrenCount(item, false) == 0) {
+    if (leaf) {
         m_dragItem = item;
         SelectItem(item);
         int image = GetItemImage(item);
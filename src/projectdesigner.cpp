@@ -10,6 +10,8 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #include "projectdesigner.h"
+#include "graphmemory.h"
+#include "graphprofile.h"
 #include <cstdlib>
 
 /**
@@ -252,7 +254,7 @@ ProjectNode::~ProjectNode()
 void ProjectNode::SetText(const wxString& text)
 {
     m_rcText = wxRect();
-    SetToolTip(wxEmptyString);
+    DoSetToolTip(wxEmptyString);
     GraphNode::SetText(text);
 }
 
@@ -266,15 +268,33 @@ void ProjectNode::SetFont(const wxFont& font)
 void ProjectNode::SetId(const wxString& text)
 {
     m_id = text;
+    NotifyTextChanged();
 }
 
 void ProjectNode::SetResult(const wxString& text)
 {
     m_result = text;
     m_rcResult = wxRect();
-    SetToolTip(wxEmptyString);
+    DoSetToolTip(wxEmptyString);
     Layout();
     Refresh();
+
+    // if the new result doesn't fit, Layout() has set a tooltip for it,
+    // which notified the observers already
+    if (GetToolTip().empty())
+        NotifyTextChanged();
+}
+
+wxString ProjectNode::GetSearchText(int field) const
+{
+    switch (field) {
+        case Search_Result:
+            return GetResult();
+        case Search_Id:
+            return GetId();
+    }
+
+    return GraphNode::GetSearchText(field);
 }
 
 void ProjectNode::SetIcon(const wxIcon& icon)
@@ -324,12 +344,21 @@ int ProjectNode::GetSpacing() const
     return spacing;
 }
 
+bool ProjectNode::IsPlainDrawn() const
+{
+    // the non-custom styles are drawn by GraphNode::OnDraw
+    return GetStyle() == Style_Rectangle &&
+           GetClassInfo() == CLASSINFO(ProjectNode);
+}
+
 // Recalculates the positions of the things within the node. Only recalcs
 // the sizes of the text labels, m_rcText and m_rcResult, when the rects
 // are null, so usual it runs quickly.
 //
 void ProjectNode::OnLayout(wxDC &dc)
 {
+    GRAPH_PROFILE_SCOPE("ProjectNode::OnLayout");
+
     int spacing = GetSpacing();
     int border = GetBorderThickness();
     int corner = GetCornerRadius();
@@ -415,6 +444,8 @@ void ProjectNode::OnLayout(wxDC &dc)
 
 void ProjectNode::OnDraw(wxDC& dc)
 {
+    GRAPH_PROFILE_SCOPE("ProjectNode::OnDraw");
+
     if (GetStyle() == Style_Custom) {
         wxRect bounds = GetBounds();
         wxRect clip = GetGraph()->GetDrawRect();
@@ -573,6 +604,18 @@ bool ProjectNode::Serialise(Archive::Item& arc)
     return true;
 }
 
+void ProjectNode::GetMemoryUsage(GraphMemoryUsage& usage) const
+{
+    GraphNode::GetMemoryUsage(usage);
+
+    usage.AddString(GraphMemoryUsage::Mem_Text, m_id);
+    usage.AddString(GraphMemoryUsage::Mem_Text, m_result);
+
+    if (m_icon.IsOk())
+        usage.AddImage(m_icon, m_icon.GetWidth(), m_icon.GetHeight(),
+                       m_icon.GetDepth());
+}
+
 IMPLEMENT_DYNAMIC_CLASS(ProjectDesigner, GraphCtrl)
 
 } // namespace datactics